@@ -0,0 +1,155 @@
+/*******************************************************************************
+* Copyright 2018 Tensor Tang. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+#include <gflags/gflags.h>
+#include <functional>
+#include <mkldnn.hpp>
+#include <sstream>
+#include "jitinfer.h"
+#include "log.h"
+#include "util_benchmark.h"
+#include "util_jitinfer.h"
+#include "util_mkldnn.h"
+
+DEFINE_int32(burning_iter, 50, "Burning iterations");
+DEFINE_int32(iter, 100, "Iterations for average");
+DEFINE_int32(bs, 0, "Batch size, number of images");
+DEFINE_int32(c, 0, "Channels");
+DEFINE_int32(h, 0, "Image height");
+DEFINE_int32(w, 0, "Image width");
+DEFINE_string(dtype, "u8", "Data type");
+
+static mkldnn::engine eng = mkldnn::engine(mkldnn::engine::cpu, 0);
+
+double avg_time(const std::function<void()>& run) {
+  for (auto i = 0; i < FLAGS_burning_iter; ++i) {
+    jitinfer::util::clear_cache();
+    run();
+    jitinfer::util::clear_cache();
+  }
+
+  double sum = 0;
+  for (auto i = 0; i < FLAGS_iter; ++i) {
+    jitinfer::util::clear_cache();
+    auto s1 = jitinfer::util::timer::get_current_ms();
+    run();
+    auto s2 = jitinfer::util::timer::get_current_ms();
+    sum += (s2 - s1);
+    jitinfer::util::clear_cache();
+  }
+  return sum / (double)FLAGS_iter;
+}
+
+// relu
+double bench_mkldnn_relu(const jitinfer::memory::nchw_dims& dm,
+                         jitinfer::memory::dtype dt) {
+  using namespace mkldnn;
+  auto md = memory::desc({dm[0], dm[1], dm[2], dm[3]},
+                         jitinfer::util::exchange::dtype(dt),
+                         memory::format::nhwc);
+  auto pd = jitinfer::util::get_mkldnn_relu_pd(md, eng);
+  auto src = memory(memory::primitive_desc(md, eng));
+  auto dst = memory(pd->dst_primitive_desc());
+  std::vector<primitive> pp = {eltwise_forward(*pd, src, dst)};
+  auto avg = avg_time([&]() { stream(stream::kind::eager).submit(pp).wait(); });
+  info("MKL-DNN Relu avg time: %f ms", avg);
+  return avg;
+}
+
+double bench_jitinfer_relu(const jitinfer::memory::nchw_dims& dm,
+                           jitinfer::memory::dtype dt) {
+  using namespace jitinfer;
+  std::unique_ptr<memory> src, dst;
+  src.reset(new memory(dm, memory::format::nhwc, dt));
+  dst.reset(new memory(dm, memory::format::nhwc, dt));
+  auto relu = eltwise(src, dst, eltwise_relu);
+  auto avg = avg_time([&]() { relu->submit(); });
+  info("JitInfer Relu avg time: %f ms", avg);
+  return avg;
+}
+
+// add
+double bench_mkldnn_add(const jitinfer::memory::nchw_dims& dm,
+                        jitinfer::memory::dtype dt) {
+  using namespace mkldnn;
+  auto md = memory::desc({dm[0], dm[1], dm[2], dm[3]},
+                         jitinfer::util::exchange::dtype(dt),
+                         memory::format::nhwc);
+  auto mpd = memory::primitive_desc(md, eng);
+  auto pd = sum::primitive_desc(md, {1.f, 1.f}, {mpd, mpd});
+  auto src0 = memory(mpd);
+  auto src1 = memory(mpd);
+  auto dst = memory(pd.dst_primitive_desc());
+  std::vector<primitive::at> inputs = {src0, src1};
+  std::vector<primitive> pp = {sum(pd, inputs, dst)};
+  auto avg = avg_time([&]() { stream(stream::kind::eager).submit(pp).wait(); });
+  info("MKL-DNN Add avg time: %f ms", avg);
+  return avg;
+}
+
+double bench_jitinfer_add(const jitinfer::memory::nchw_dims& dm,
+                          jitinfer::memory::dtype dt) {
+  using namespace jitinfer;
+  std::unique_ptr<memory> src0, src1, dst;
+  src0.reset(new memory(dm, memory::format::nhwc, dt));
+  src1.reset(new memory(dm, memory::format::nhwc, dt));
+  dst.reset(new memory(dm, memory::format::nhwc, dt));
+  auto add = binary(src0, src1, dst, binary_add);
+  auto avg = avg_time([&]() { add->submit(); });
+  info("JitInfer Add avg time: %f ms", avg);
+  return avg;
+}
+
+void bench_both(const jitinfer::memory::nchw_dims& dm,
+                jitinfer::memory::dtype dt) {
+  std::ostringstream oss;
+  info("==========================================");
+  oss << "Benchmark relu and add with data type "
+      << jitinfer::util::dtype2str(dt);
+  oss << "\nData sizes: (" << dm[0] << ", " << dm[1] << ", " << dm[2] << ", "
+      << dm[3] << ")@NCHW";
+  info("%s", oss.str().c_str());
+  auto m = bench_mkldnn_relu(dm, dt);
+  auto j = bench_jitinfer_relu(dm, dt);
+  info("Jitinfer relu promote: %.2f %%", (m - j) / j * 100);
+  m = bench_mkldnn_add(dm, dt);
+  j = bench_jitinfer_add(dm, dt);
+  info("Jitinfer add promote: %.2f %%", (m - j) / j * 100);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  using namespace jitinfer::util;
+  // only run if given some input sizes
+  // for example:
+  // bench_eltwise -bs 2 -c 256 -h 56 -w 56 -dtype u8
+  if (FLAGS_bs > 0) {
+    bench_both({FLAGS_bs, FLAGS_c, FLAGS_h, FLAGS_w}, str2dtype(FLAGS_dtype));
+    return 0;
+  }
+
+  // nothing input, then run some default cases
+  jitinfer::memory::nchw_dims default_cases[] = {
+      {4, 64, 112, 112}, {4, 256, 56, 56}, {4, 512, 28, 28}, {4, 2048, 7, 7}};
+  jitinfer::memory::dtype dtypes[] = {jitinfer::memory::dtype::u8,
+                                      jitinfer::memory::dtype::s8,
+                                      jitinfer::memory::dtype::f32};
+  for (auto& dm : default_cases) {
+    for (auto dt : dtypes) {
+      bench_both(dm, dt);
+    }
+  }
+  return 0;
+}
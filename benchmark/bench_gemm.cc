@@ -0,0 +1,156 @@
+/*******************************************************************************
+* Copyright 2018 Tensor Tang. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+#include <gflags/gflags.h>
+#include <functional>
+#include <mkldnn.hpp>
+#include <sstream>
+#include "jitinfer.h"
+#include "log.h"
+#include "util_benchmark.h"
+#include "util_jitinfer.h"
+#include "util_mkldnn.h"
+#include "util_params.h"
+
+DEFINE_int32(burning_iter, 50, "Burning iterations");
+DEFINE_int32(iter, 100, "Iterations for average");
+DEFINE_int32(m, 0, "Rows of A and C, pixels of 1x1 conv or batch of fc");
+DEFINE_int32(n, 0, "Columns of B and C, output channels");
+DEFINE_int32(k, 0, "Columns of A and rows of B, input channels");
+DEFINE_string(dtype, "u8", "Dst data type");
+
+static mkldnn::engine eng = mkldnn::engine(mkldnn::engine::cpu, 0);
+static const jitinfer::memory::dtype src_dt = jitinfer::memory::dtype::u8;
+static const jitinfer::memory::dtype wei_dt = jitinfer::memory::dtype::s8;
+static const jitinfer::memory::dtype bia_dt = jitinfer::memory::dtype::s32;
+static std::vector<float> scales = {0.3f};
+static jitinfer::round_mode rmode = jitinfer::round_mode::nearest;
+
+double avg_time(const std::function<void()>& run) {
+  for (auto i = 0; i < FLAGS_burning_iter; ++i) {
+    jitinfer::util::clear_cache();
+    run();
+    jitinfer::util::clear_cache();
+  }
+
+  double sum = 0;
+  for (auto i = 0; i < FLAGS_iter; ++i) {
+    jitinfer::util::clear_cache();
+    auto s1 = jitinfer::util::timer::get_current_ms();
+    run();
+    auto s2 = jitinfer::util::timer::get_current_ms();
+    sum += (s2 - s1);
+    jitinfer::util::clear_cache();
+  }
+  return sum / (double)FLAGS_iter;
+}
+
+// the gemm as a 1x1 conv on a 1 x m image
+jitinfer::util::conv_params gemm2conv(int m, int n, int k) {
+  /*bs, gp, ic, ih, iw, oc, oh, ow, kh, kw, ph, pw, sh, sw, oc1x1*/
+  return jitinfer::util::conv_params(
+      1, 1, k, 1, m, n, 1, m, 1, 1, 0, 0, 1, 1, n);
+}
+
+double gops(int m, int n, int k, double ms) {
+  return 2. * m * n * k / (ms * 1e6);
+}
+
+double bench_mkldnn_conv1x1(int m, int n, int k, jitinfer::memory::dtype dt) {
+  using namespace jitinfer::util;
+  auto desc = get_conv_desc(gemm2conv(m, n, k),
+                            exchange::dtype(src_dt),
+                            exchange::dtype(wei_dt),
+                            exchange::dtype(bia_dt),
+                            exchange::dtype(dt));
+  auto pd = get_conv_pd(desc, eng, scales, exchange::round_mode(rmode), false);
+  mkldnn::memory src(pd->src_primitive_desc());
+  mkldnn::memory wei(pd->weights_primitive_desc());
+  mkldnn::memory bia(pd->bias_primitive_desc());
+  mkldnn::memory dst(pd->dst_primitive_desc());
+  std::vector<mkldnn::primitive> pp = {
+      mkldnn::convolution_forward(*pd, src, wei, bia, dst)};
+  auto avg = avg_time(
+      [&]() { mkldnn::stream(mkldnn::stream::kind::eager).submit(pp).wait(); });
+  info("MKL-DNN Conv1x1 avg time: %f ms, %.2f GOPS", avg, gops(m, n, k, avg));
+  return avg;
+}
+
+double bench_jitinfer_conv1x1(int m, int n, int k, jitinfer::memory::dtype dt) {
+  using namespace jitinfer;
+  using format = memory::format;
+  std::unique_ptr<memory> src, wei, bia, dst;
+  src.reset(new memory({1, k, 1, m}, format::nhwc, src_dt));
+  wei.reset(new memory({n, k, 1, 1}, format::OIhw4i16o4i, wei_dt));
+  bia.reset(new memory({n}, bia_dt));
+  dst.reset(new memory({1, n, 1, m}, format::nhwc, dt));
+  auto c = conv(src, wei, bia, {1, 1}, {0, 0}, dst, false, scales, rmode);
+  auto avg = avg_time([&]() { c->submit(); });
+  info("JitInfer Conv1x1 avg time: %f ms, %.2f GOPS", avg, gops(m, n, k, avg));
+  return avg;
+}
+
+double bench_jitinfer_fc(int m, int n, int k, jitinfer::memory::dtype dt) {
+  using namespace jitinfer;
+  using format = memory::format;
+  std::unique_ptr<memory> src, wei, bia, dst;
+  src.reset(new memory({m, k, 1, 1}, format::nhwc, src_dt));
+  wei.reset(new memory({n, k, 1, 1}, format::OIhw4i16o4i, wei_dt));
+  bia.reset(new memory({n}, bia_dt));
+  dst.reset(new memory({m, n, 1, 1}, format::nhwc, dt));
+  auto fc = inner_product(src, wei, bia, dst, false, scales, rmode);
+  auto avg = avg_time([&]() { fc->submit(); });
+  info("JitInfer FC avg time: %f ms, %.2f GOPS", avg, gops(m, n, k, avg));
+  return avg;
+}
+
+void bench_all(int m, int n, int k, jitinfer::memory::dtype dt) {
+  std::ostringstream oss;
+  info("==========================================");
+  oss << "Benchmark u8s8s32 GEMM with dst data type "
+      << jitinfer::util::dtype2str(dt);
+  oss << "\nSizes: m=" << m << ", n=" << n << ", k=" << k;
+  info("%s", oss.str().c_str());
+  auto mk = bench_mkldnn_conv1x1(m, n, k, dt);
+  auto j = bench_jitinfer_conv1x1(m, n, k, dt);
+  info("Jitinfer conv1x1 promote: %.2f %%", (mk - j) / j * 100);
+  bench_jitinfer_fc(m, n, k, dt);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  using namespace jitinfer::util;
+  // only run if given some input sizes
+  // for example:
+  // bench_gemm -m 3136 -n 64 -k 256 -dtype u8
+  if (FLAGS_m > 0) {
+    bench_all(FLAGS_m, FLAGS_n, FLAGS_k, str2dtype(FLAGS_dtype));
+    return 0;
+  }
+
+  // nothing input, then run some default cases
+  // {m, n, k}: 1x1 convs of resnet50 and fc heads of batch 1 and 32
+  int default_cases[][3] = {{3136, 64, 256},
+                            {3136, 256, 64},
+                            {784, 512, 128},
+                            {196, 1024, 256},
+                            {49, 2048, 512},
+                            {1, 1008, 2048},
+                            {32, 1008, 2048}};
+  for (auto& c : default_cases) {
+    bench_all(c[0], c[1], c[2], str2dtype(FLAGS_dtype));
+  }
+  return 0;
+}
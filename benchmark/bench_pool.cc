@@ -0,0 +1,193 @@
+/*******************************************************************************
+* Copyright 2018 Tensor Tang. All Rights Reserved
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*     http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*******************************************************************************/
+#include <gflags/gflags.h>
+#include <mkldnn.hpp>
+#include <sstream>
+#include "jitinfer.h"
+#include "log.h"
+#include "util_benchmark.h"
+#include "util_jitinfer.h"
+#include "util_mkldnn.h"
+#include "util_params.h"
+
+DEFINE_int32(burning_iter, 50, "Burning iterations");
+DEFINE_int32(iter, 100, "Iterations for average");
+DEFINE_int32(bs, 0, "Batch size, number of images");
+DEFINE_int32(c, 0, "Channels");
+DEFINE_int32(ih, 0, "Input image height");
+DEFINE_int32(iw, 0, "Input image width");
+DEFINE_int32(kh, 0, "Kernel height");
+DEFINE_int32(kw, 0, "Kernel width");
+DEFINE_int32(sh, 1, "Stride height");
+DEFINE_int32(sw, 1, "Stride width");
+DEFINE_int32(ph, 0, "Padding height");
+DEFINE_int32(pw, 0, "Padding width");
+DEFINE_string(dtype, "u8", "Data type");
+DEFINE_string(kind, "max", "Pooling kind, max or avg");
+
+static mkldnn::engine eng = mkldnn::engine(mkldnn::engine::cpu, 0);
+
+double bench_mkldnn(const jitinfer::util::pool_params& p,
+                    jitinfer::memory::dtype dt,
+                    jitinfer::pooling_kind kind) {
+  using namespace mkldnn;
+  std::unique_ptr<pooling_forward::desc> desc;
+  std::unique_ptr<pooling_forward::primitive_desc> pd;
+  std::unique_ptr<primitive> fwd;
+  std::vector<primitive> pp;
+  memory::format fmt = memory::format::nhwc;
+  auto mkldnn_dt = jitinfer::util::exchange::dtype(dt);
+  auto src_desc = memory::desc({p.bs, p.c, p.ih, p.iw}, mkldnn_dt, fmt);
+  auto dst_desc = memory::desc({p.bs, p.c, p.oh, p.ow}, mkldnn_dt, fmt);
+  // pool_output_size is ceil mode, so pad more on the right side
+  memory::dims padding_l = {p.ph, p.pw};
+  memory::dims padding_r = {(p.oh - 1) * p.sh + p.kh - p.ih - p.ph,
+                            (p.ow - 1) * p.sw + p.kw - p.iw - p.pw};
+  algorithm alg = kind == jitinfer::pooling_max
+                      ? algorithm::pooling_max
+                      : (kind == jitinfer::pooling_avg_include_padding
+                             ? algorithm::pooling_avg_include_padding
+                             : algorithm::pooling_avg_exclude_padding);
+  desc.reset(new pooling_forward::desc(prop_kind::forward_inference,
+                                       alg,
+                                       src_desc,
+                                       dst_desc,
+                                       {p.sh, p.sw},
+                                       {p.kh, p.kw},
+                                       padding_l,
+                                       padding_r,
+                                       padding_kind::zero));
+  pd.reset(new pooling_forward::primitive_desc(*desc, eng));
+  auto src = memory(memory::primitive_desc(src_desc, eng));
+  auto dst = memory(pd->dst_primitive_desc());
+  fwd.reset(new pooling_forward(*pd, src, dst));
+  pp.push_back(*fwd);
+
+  for (auto i = 0; i < FLAGS_burning_iter; ++i) {
+    jitinfer::util::clear_cache();
+    stream(stream::kind::eager).submit(pp).wait();
+    jitinfer::util::clear_cache();
+  }
+
+  double sum = 0;
+  for (auto i = 0; i < FLAGS_iter; ++i) {
+    jitinfer::util::clear_cache();
+    auto s1 = jitinfer::util::timer::get_current_ms();
+    stream(stream::kind::eager).submit(pp).wait();
+    auto s2 = jitinfer::util::timer::get_current_ms();
+    sum += (s2 - s1);
+    jitinfer::util::clear_cache();
+  }
+
+  auto avg = sum / (double)FLAGS_iter;
+  info("MKL-DNN Pool avg time: %f ms", avg);
+  return avg;
+}
+
+double bench_jitinfer(const jitinfer::util::pool_params& p,
+                      jitinfer::memory::dtype dt,
+                      jitinfer::pooling_kind kind) {
+  using namespace jitinfer;
+  memory::format fmt = memory::format::nhwc;
+  std::unique_ptr<memory> src, dst;
+  src.reset(new memory({p.bs, p.c, p.ih, p.iw}, fmt, dt));
+  dst.reset(new memory({p.bs, p.c, p.oh, p.ow}, fmt, dt));
+  auto pl = pool(src, dst, {p.kh, p.kw}, {p.sh, p.sw}, {p.ph, p.pw}, kind);
+
+  for (auto i = 0; i < FLAGS_burning_iter; ++i) {
+    jitinfer::util::clear_cache();
+    pl->submit();
+    jitinfer::util::clear_cache();
+  }
+
+  double sum = 0;
+  for (auto i = 0; i < FLAGS_iter; ++i) {
+    jitinfer::util::clear_cache();
+    auto s1 = jitinfer::util::timer::get_current_ms();
+    pl->submit();
+    auto s2 = jitinfer::util::timer::get_current_ms();
+    sum += (s2 - s1);
+    jitinfer::util::clear_cache();
+  }
+
+  auto avg = sum / (double)FLAGS_iter;
+  info("JitInfer Pool avg time: %f ms", avg);
+  return avg;
+}
+
+void bench_both(const jitinfer::util::pool_params& p,
+                jitinfer::memory::dtype dt,
+                jitinfer::pooling_kind kind) {
+  std::ostringstream oss;
+  info("==========================================");
+  oss << "Benchmark " << (kind == jitinfer::pooling_max ? "max" : "avg")
+      << " pooling with data type " << jitinfer::util::dtype2str(dt);
+  oss << "\nData sizes: In(" << p.bs << ", " << p.c << ", " << p.ih << ", "
+      << p.iw << ")@NCHW ==> Kernel(" << p.kh << ", " << p.kw
+      << "), Stride(" << p.sh << ", " << p.sw << "), Padding(" << p.ph
+      << ", " << p.pw << ") ==> Out(" << p.bs << ", " << p.c << ", " << p.oh
+      << ", " << p.ow << ")@NCHW";
+  info("%s", oss.str().c_str());
+  auto m = bench_mkldnn(p, dt, kind);
+  auto j = bench_jitinfer(p, dt, kind);
+  info("Jitinfer promote: %.2f %%", (m - j) / j * 100);
+}
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  using namespace jitinfer::util;
+  // only run if given some input sizes
+  // for example:
+  // bench_pool -bs 2 -c 64 -ih 112 -iw 112 -kh 3 -kw 3 -sh 2 -sw 2 -kind max
+  if (FLAGS_bs > 0) {
+    pool_params p(FLAGS_bs,
+                  FLAGS_c,
+                  FLAGS_ih,
+                  FLAGS_iw,
+                  pool_output_size(FLAGS_ih, FLAGS_kh, FLAGS_sh, FLAGS_ph),
+                  pool_output_size(FLAGS_iw, FLAGS_kw, FLAGS_sw, FLAGS_pw),
+                  FLAGS_kh,
+                  FLAGS_kw,
+                  FLAGS_ph,
+                  FLAGS_pw,
+                  FLAGS_sh,
+                  FLAGS_sw);
+    bench_both(p,
+               str2dtype(FLAGS_dtype),
+               FLAGS_kind == "max" ? jitinfer::pooling_max
+                                   : jitinfer::pooling_avg);
+    return 0;
+  }
+
+  // nothing input, then run some default cases
+  pool_params default_cases[] = {
+      /*bs, c, ih, iw, oh, ow, kh, kw, ph, pw, sh, sw*/
+      {4, 64, 112, 112, 56, 56, 3, 3, 0, 0, 2, 2},
+      {4, 256, 56, 56, 28, 28, 2, 2, 0, 0, 2, 2},
+      {4, 512, 14, 14, 7, 7, 2, 2, 0, 0, 2, 2},
+      {4, 2048, 7, 7, 1, 1, 7, 7, 0, 0, 1, 1}};
+  jitinfer::memory::dtype dtypes[] = {jitinfer::memory::dtype::u8,
+                                      jitinfer::memory::dtype::s8,
+                                      jitinfer::memory::dtype::f32};
+  for (size_t i = 0; i < sizeof(default_cases) / sizeof(pool_params); ++i) {
+    for (auto kind : {jitinfer::pooling_max, jitinfer::pooling_avg}) {
+      for (size_t j = 0; j < sizeof(dtypes) / sizeof(dtypes[0]); ++j) {
+        bench_both(default_cases[i], dtypes[j], kind);
+      }
+    }
+  }
+  return 0;
+}
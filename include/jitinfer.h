@@ -19,7 +19,11 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <array>
+#include <condition_variable>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 
 namespace jitinfer {
@@ -48,6 +52,30 @@ enum round_mode {
   down,
 };
 
+enum pooling_kind {
+  pooling_max = 0,
+  pooling_avg_include_padding,
+  pooling_avg_exclude_padding,
+  pooling_avg = pooling_avg_exclude_padding,
+};
+
+enum eltwise_kind {
+  eltwise_relu = 0,
+  eltwise_clip,  // clip into [alpha, beta]
+};
+
+enum binary_kind {
+  binary_add = 0,
+  binary_mul,
+};
+
+enum resize_kind {
+  // src index floor(dst index * scale), the asymmetric nearest
+  resize_nearest = 0,
+  // with half pixel centers, the same as align_corners = false
+  resize_bilinear,
+};
+
 struct memory {
 public:
   enum format {
@@ -58,6 +86,9 @@ public:
     OIhw4i16o4i,
     gOIhw4i16o4i,
     goihw,
+    // OIhw4i16o4i with the blocks of ic after h and w, the inner product
+    // weights of which k is ordered as (h, w, ic) as the nhwc src
+    OhwI4i16o4i,
     oihw = nchw,
   };
   typedef std::vector<int> dims;
@@ -81,6 +112,17 @@ public:
                   const dtype dt,
                   int alignment = 4096);
 
+  // memory on an external buffer, which is not owned by this memory,
+  // so the buffer must outlive this memory
+  explicit memory(const nchw_dims &dm,
+                  const format fmt,
+                  const dtype dt,
+                  void *data);
+
+  // zero-copy view of channels [c_offset, c_offset + c) of a nhwc memory,
+  // the buffer is still owned by base, so base must outlive this view
+  explicit memory(const std::unique_ptr<memory> &base, int c_offset, int c);
+
   ~memory();
   size_t size();
   size_t buffer_size();
@@ -89,6 +131,9 @@ public:
   dtype data_type() { return dt_; }
   format dim_format() { return fmt_; }
   void *data() { return data_; }
+  // elements between two adjacent pixels of nhwc, larger than c when it's view
+  int ld() { return ld_; }
+  bool is_view() { return !own_buffer_; }
 
 private:
   void allocate_buffer(int alignment);
@@ -97,18 +142,50 @@ private:
   nchw_dims std_dims_;  // nchw or oihw
   format fmt_;
   dtype dt_;
+  int ld_;
+  bool own_buffer_;
 
   DISABLE_COPY_AND_ASSIGN(memory);
 };
 
+// how to run one submit of an op or one run of a network
+struct exec_ctx {
+  explicit exec_ctx(int nthreads = 0, const std::vector<int> &cpus = {})
+      : nthreads(nthreads), cpus(cpus) {}
+  // 0 for all threads, and at most the threads the ops are created with,
+  // since the workspace of each thread is allocated in creating
+  int nthreads;
+  // the threads are pinned to these cpus if not empty, and there are no more
+  // threads than cpus
+  std::vector<int> cpus;
+};
+
+class async_queue;
+
 class op {
 public:
-  explicit op() {}
-  virtual void submit();
+  explicit op();
+  virtual ~op();
+  virtual void submit(const exec_ctx &ctx = exec_ctx());
+  // enqueue submit(ctx) after the submit_async of this op enqueued before,
+  // and return at once, such as to prepare the next batch meanwhile.
+  // The op and its memories must be alive and not changed until it's done.
+  std::shared_future<void> submit_async(const exec_ctx &ctx = exec_ctx());
+  // wait for all submit_async of this op
+  void wait();
 
 protected:
-  virtual void infer() = 0;
+  // infer in one parallel region of the threads of ctx
+  virtual void infer(const exec_ctx &ctx);
+  // the part of thread ithr in nthr threads, called in a parallel region,
+  // so that network can run a sequence of ops in one region
+  virtual void infer_thread(int ithr, int nthr) = 0;
   virtual const char *name() = 0;
+  friend class network;
+
+private:
+  std::unique_ptr<async_queue> queue_;  // of submit_async
+  std::shared_future<void> last_;
   DISABLE_COPY_AND_ASSIGN(op);
 };
 
@@ -116,7 +193,52 @@ std::unique_ptr<op> concat(const std::vector<std::unique_ptr<memory>> &srcs,
                            std::unique_ptr<memory> &dst,
                            bool post_relu = false);
 
+// split src on channel to dsts, the inverse of concat
+// if no copy is needed, use the view of memory instead
+std::unique_ptr<op> split(const std::unique_ptr<memory> &src,
+                          std::vector<std::unique_ptr<memory>> &dsts,
+                          bool post_relu = false);
+
+// pooling on nhwc, the dst data type must be the same as src
+std::unique_ptr<op> pool(const std::unique_ptr<memory> &src,
+                         std::unique_ptr<memory> &dst,
+                         std::array<int, 2> sz_kernel,
+                         std::array<int, 2> sz_stride,
+                         std::array<int, 2> sz_padding,
+                         pooling_kind kind = pooling_max);
+
+// resize h and w of nhwc, such as upsample of fpn and unet decoders,
+// the dst data type must be the same as src, dst can be a channel view
+std::unique_ptr<op> resize(const std::unique_ptr<memory> &src,
+                           std::unique_ptr<memory> &dst,
+                           resize_kind kind = resize_nearest);
+
+// resize srcs to the h and w of dst and concat them on channel,
+// srcs of the same size as dst, such as skip connections, are only copied
+std::unique_ptr<op> resize_concat(
+    const std::vector<std::unique_ptr<memory>> &srcs,
+    std::unique_ptr<memory> &dst,
+    resize_kind kind = resize_nearest,
+    bool post_relu = false);
+
+// dst can be the same memory with src
+std::unique_ptr<op> eltwise(const std::unique_ptr<memory> &src,
+                            std::unique_ptr<memory> &dst,
+                            eltwise_kind kind,
+                            float alpha = 0.f,
+                            float beta = 0.f);
+
+// src1 has the same dims with src0, or is a {c} vector of x format
+// which is broadcasted to all pixels
+std::unique_ptr<op> binary(const std::unique_ptr<memory> &src0,
+                           const std::unique_ptr<memory> &src1,
+                           std::unique_ptr<memory> &dst,
+                           binary_kind kind,
+                           bool post_relu = false);
+
 // only conv
+// when global_avg_pool, dst is n x c, which is nhwc of {n, c, 1, 1},
+// the per channel average is summed in conv and full size output is skipped
 std::unique_ptr<op> conv(const std::unique_ptr<memory> &src,
                          const std::unique_ptr<memory> &wei,
                          const std::unique_ptr<memory> &bia,
@@ -125,7 +247,8 @@ std::unique_ptr<op> conv(const std::unique_ptr<memory> &src,
                          std::unique_ptr<memory> &dst,
                          bool conv0_relu = false,
                          std::vector<float> conv0_scales = {1.f},
-                         round_mode conv0_round_mode = round_mode::nearest);
+                         round_mode conv0_round_mode = round_mode::nearest,
+                         bool global_avg_pool = false);
 
 // conv and fuse conv1x1_relu
 std::unique_ptr<op> conv(const std::unique_ptr<memory> &src,
@@ -142,4 +265,370 @@ std::unique_ptr<op> conv(const std::unique_ptr<memory> &src,
                          bool conv1_relu = false,
                          std::vector<float> conv1_scales = {1.f},
                          round_mode conv1_round_mode = round_mode::nearest);
+
+// conv and fuse max pooling, dst is the pooled output
+// the full size conv output is only kept in a few rows per thread
+std::unique_ptr<op> conv(const std::unique_ptr<memory> &src,
+                         const std::unique_ptr<memory> &wei,
+                         const std::unique_ptr<memory> &bia,
+                         std::array<int, 2> sz_stride,
+                         std::array<int, 2> sz_padding,
+                         std::array<int, 2> sz_pool_kernel,
+                         std::array<int, 2> sz_pool_stride,
+                         std::array<int, 2> sz_pool_padding,
+                         std::unique_ptr<memory> &dst,
+                         bool conv0_relu = false,
+                         std::vector<float> conv0_scales = {1.f},
+                         round_mode conv0_round_mode = round_mode::nearest);
+
+// conv and fuse channel shuffle of shufflenet into the output store,
+// channel i of group g is stored to channel i * shuffle_groups + g,
+// oc / shuffle_groups should be 16x
+std::unique_ptr<op> conv(const std::unique_ptr<memory> &src,
+                         const std::unique_ptr<memory> &wei,
+                         const std::unique_ptr<memory> &bia,
+                         std::array<int, 2> sz_stride,
+                         std::array<int, 2> sz_padding,
+                         int shuffle_groups,
+                         std::unique_ptr<memory> &dst,
+                         bool conv0_relu = false,
+                         std::vector<float> conv0_scales = {1.f},
+                         round_mode conv0_round_mode = round_mode::nearest);
+
+// plain conv1x1 (stride 1 without padding) and fuse the sum of a shortcut,
+// such as the last conv1x1 of resnet block,
+// dst = relu(conv + sum_scale * sum) when post_relu, sum has the dims of dst
+std::unique_ptr<op> conv_sum(const std::unique_ptr<memory> &src,
+                             const std::unique_ptr<memory> &wei,
+                             const std::unique_ptr<memory> &bia,
+                             const std::unique_ptr<memory> &sum,
+                             std::unique_ptr<memory> &dst,
+                             bool post_relu = false,
+                             std::vector<float> scales = {1.f},
+                             round_mode rmode = round_mode::nearest,
+                             float sum_scale = 1.f);
+
+// conv1x1_relu and conv fused, the 1x1 output is u8 and never stored in whole
+// wei1x1 is {c1x1, ic, 1, 1}, wei is {oc, c1x1, kh, kw}
+// the 1x1 rows are kept in a rolling buffer of kh rows per thread
+std::unique_ptr<op> conv1x1_conv(
+    const std::unique_ptr<memory> &src,
+    const std::unique_ptr<memory> &wei1x1,
+    const std::unique_ptr<memory> &bia1x1,
+    const std::unique_ptr<memory> &wei,
+    const std::unique_ptr<memory> &bia,
+    std::array<int, 2> sz_stride,
+    std::array<int, 2> sz_padding,
+    std::unique_ptr<memory> &dst,
+    std::vector<float> conv1x1_scales = {1.f},
+    bool conv0_relu = false,
+    std::vector<float> conv0_scales = {1.f},
+    round_mode conv0_round_mode = round_mode::nearest);
+
+// resnet bottleneck block fused in one op:
+// conv1x1 + relu + conv + relu + conv1 (with 1x1 weight) + sum + relu,
+// wei1x1 is {c1x1, ic, 1, 1}, wei is {c0, c1x1, kh, kw}, wei1 is {oc, c0, 1, 1}
+// sum is the shortcut of dst dims, such as src without projection,
+// dst = relu(conv1 output + sum_scale * sum), sum can be nullptr.
+// Only kh rows of conv1x1 and one row of conv output live in each thread.
+std::unique_ptr<op> bottleneck(
+    const std::unique_ptr<memory> &src,
+    const std::unique_ptr<memory> &wei1x1,
+    const std::unique_ptr<memory> &bia1x1,
+    const std::unique_ptr<memory> &wei,
+    const std::unique_ptr<memory> &bia,
+    std::array<int, 2> sz_stride,
+    std::array<int, 2> sz_padding,
+    const std::unique_ptr<memory> &wei1,
+    const std::unique_ptr<memory> &bia1,
+    const std::unique_ptr<memory> &sum,
+    std::unique_ptr<memory> &dst,
+    std::vector<float> conv1x1_scales = {1.f},
+    std::vector<float> conv0_scales = {1.f},
+    std::vector<float> conv1_scales = {1.f},
+    float sum_scale = 1.f);
+
+// depthwise conv + relu fused with conv1x1, the mobilenet block
+// wei is oihw of {c, 1, kh, kw}, wei1x1 is {oc, c, 1, 1}
+// the depthwise output is u8 and only one row of it lives in each thread
+std::unique_ptr<op> dwconv_conv1x1(
+    const std::unique_ptr<memory> &src,
+    const std::unique_ptr<memory> &wei,
+    const std::unique_ptr<memory> &bia,
+    std::array<int, 2> sz_stride,
+    std::array<int, 2> sz_padding,
+    const std::unique_ptr<memory> &wei1x1,
+    const std::unique_ptr<memory> &bia1x1,
+    std::unique_ptr<memory> &dst,
+    std::vector<float> dw_scales = {1.f},
+    bool conv1x1_relu = false,
+    std::vector<float> conv1x1_scales = {1.f},
+    round_mode conv1x1_round_mode = round_mode::nearest);
+
+// conv1x1 of several branches on one src, such as the branches of inception,
+// fused as one wide conv so src is read only once.
+// weis are {oc_i, ic, 1, 1}, each dst can be a channel view of concat output,
+// bias can be empty or one for each branch, which can be nullptr,
+// scales can be empty or one for each branch, of 1 or oc_i values
+std::unique_ptr<op> conv1x1_multi(
+    const std::unique_ptr<memory> &src,
+    const std::vector<std::unique_ptr<memory>> &weis,
+    const std::vector<std::unique_ptr<memory>> &bias,
+    std::vector<std::unique_ptr<memory>> &dsts,
+    bool post_relu = false,
+    std::vector<std::vector<float>> scales = {},
+    round_mode rmode = round_mode::nearest);
+
+// conv1x1 on the concat of srcs without writing the concat, such as densenet
+// srcs are u8 nhwc of {n, ic_i, h, w}, and can be channel views,
+// wei is {oc, sum of ic_i, 1, 1}, scales can have 1 or oc values
+std::unique_ptr<op> concat_conv1x1(
+    const std::vector<std::unique_ptr<memory>> &srcs,
+    const std::unique_ptr<memory> &wei,
+    const std::unique_ptr<memory> &bia,
+    std::unique_ptr<memory> &dst,
+    bool post_relu = false,
+    std::vector<float> scales = {1.f},
+    round_mode rmode = round_mode::nearest);
+
+// two convs fused depth first, such as the stacked 3x3 convs of vgg and unet
+// wei0 is {c0, ic, kh0, kw0}, wei1 is {oc, c0, kh1, kw1},
+// the u8 output of conv0 only lives in kh1 rows of each thread
+std::unique_ptr<op> conv_conv(
+    const std::unique_ptr<memory> &src,
+    const std::unique_ptr<memory> &wei0,
+    const std::unique_ptr<memory> &bia0,
+    std::array<int, 2> sz_stride0,
+    std::array<int, 2> sz_padding0,
+    const std::unique_ptr<memory> &wei1,
+    const std::unique_ptr<memory> &bia1,
+    std::array<int, 2> sz_stride1,
+    std::array<int, 2> sz_padding1,
+    std::unique_ptr<memory> &dst,
+    std::vector<float> conv0_scales = {1.f},
+    bool conv1_relu = false,
+    std::vector<float> conv1_scales = {1.f},
+    round_mode conv1_round_mode = round_mode::nearest);
+
+// inner product (fully connected) of u8 src and s8 wei
+// src is nhwc of {n, ic, ih, iw}, wei is OIhw4i16o4i or OhwI4i16o4i of
+// {oc, ic, ih, iw}, dst is nhwc of {n, oc, 1, 1}, scales can have 1 or oc
+// values. OIhw4i16o4i of more than one pixel is reordered to OhwI4i16o4i by
+// each op, network does it once for all of its streams.
+std::unique_ptr<op> inner_product(const std::unique_ptr<memory> &src,
+                                  const std::unique_ptr<memory> &wei,
+                                  const std::unique_ptr<memory> &bia,
+                                  std::unique_ptr<memory> &dst,
+                                  bool post_relu = false,
+                                  std::vector<float> scales = {1.f},
+                                  round_mode rmode = round_mode::nearest);
+
+// fold the batch norm after conv into conv0 scales and bias, where
+// bn(x) = gamma * (x - mean) / sqrt(var + eps) + beta.
+// mean and var can be empty for a plain scale layer, bia can be nullptr,
+// conv0_scales can have 1 or oc values.
+// folded_bia is allocated as f32 {oc} and folded_scales has oc values,
+// use them to create the conv instead of the original ones.
+void fold_batch_norm(const std::vector<float> &gamma,
+                     const std::vector<float> &beta,
+                     const std::vector<float> &mean,
+                     const std::vector<float> &var,
+                     float eps,
+                     const std::unique_ptr<memory> &bia,
+                     const std::vector<float> &conv0_scales,
+                     std::unique_ptr<memory> &folded_bia,
+                     std::vector<float> &folded_scales);
+
+// a network of layers on nhwc tensors, each layer outputs one tensor and
+// tensors are referred by the ids returned when they are added.
+// The dims of each tensor are inferred when its layer is added.
+// Weights and bias are not copied, so they must outlive the network.
+// build() places all intermediate tensors in one arena by their lifetimes,
+// then run() infers the layers in the order they are added.
+class network {
+public:
+  explicit network();
+  ~network();
+
+  int input(const memory::nchw_dims &dims,
+            memory::dtype dt = memory::dtype::u8);
+
+  int conv(int src,
+           const std::unique_ptr<memory> &wei,
+           const std::unique_ptr<memory> &bia,
+           std::array<int, 2> sz_stride,
+           std::array<int, 2> sz_padding,
+           bool post_relu = false,
+           std::vector<float> scales = {1.f},
+           round_mode rmode = round_mode::nearest,
+           memory::dtype dt = memory::dtype::u8);
+
+  int pool(int src,
+           std::array<int, 2> sz_kernel,
+           std::array<int, 2> sz_stride,
+           std::array<int, 2> sz_padding,
+           pooling_kind kind = pooling_max);
+
+  int concat(const std::vector<int> &srcs, bool post_relu = false);
+
+  int eltwise(int src, eltwise_kind kind, float alpha = 0.f, float beta = 0.f);
+
+  int binary(int src0, int src1, binary_kind kind, bool post_relu = false);
+
+  int resize(int src,
+             std::array<int, 2> sz_out,
+             resize_kind kind = resize_nearest);
+
+  int inner_product(int src,
+                    const std::unique_ptr<memory> &wei,
+                    const std::unique_ptr<memory> &bia,
+                    bool post_relu = false,
+                    std::vector<float> scales = {1.f},
+                    round_mode rmode = round_mode::nearest,
+                    memory::dtype dt = memory::dtype::f32);
+
+  // mark a tensor as the next output of run
+  void output(int id);
+
+  // rewrite the layers to fused ops and zero-copy views after all layers
+  // and outputs are added, returns what are fused, such as "conv + relu".
+  // Only the fusions giving the same results as the layers are done.
+  std::vector<std::string> fuse();
+
+  void build();
+
+  // inputs and outputs are in the order they are added, as nhwc memories
+  // of the same dims and data type. The ops are created on the first run
+  // and created again only when the buffers of inputs or outputs change.
+  // All ops run on the threads of ctx.
+  void run(const std::vector<std::unique_ptr<memory>> &inputs,
+           std::vector<std::unique_ptr<memory>> &outputs,
+           const exec_ctx &ctx = exec_ctx());
+
+  // enqueue run after the run_async of this network enqueued before, and
+  // return at once, inputs and outputs must be alive and not changed until
+  // it's done
+  std::shared_future<void> run_async(
+      const std::vector<std::unique_ptr<memory>> &inputs,
+      std::vector<std::unique_ptr<memory>> &outputs,
+      const exec_ctx &ctx = exec_ctx());
+  // wait for all run_async of this network
+  void wait();
+
+  // save the layers, scales and weights to a versioned binary model,
+  // the weights are kept in the blocked format used by the kernels,
+  // each on its own page so it can be mapped without copy.
+  void save(const std::string &path);
+
+  // load a model saved by save(), the file is mapped read only and
+  // the weights are used in place, so it is shared by all processes.
+  // fuse() and build() can be called on it as usual.
+  static std::unique_ptr<network> load(const std::string &path);
+
+  memory::nchw_dims dims(int id);
+  memory::dtype data_type(int id);
+  size_t arena_size() { return arena_size_; }
+
+private:
+  struct tensor;
+  struct layer;
+  struct instance;
+  int add_layer(std::unique_ptr<layer> l,
+                const memory::nchw_dims &dims,
+                memory::dtype dt);
+  int producer_of(int id);
+  int readers_of(int id);
+  bool only_read_once(int id);
+  void update_lifetimes();
+  double work_of(const layer &l);
+  // reorder the inner product weights of more than one pixel once, which
+  // the ops of all streams use in place
+  void pack_weights();
+  std::unique_ptr<instance> create_instance();
+  bool bind(instance &inst,
+            const std::vector<int> &ids,
+            const std::vector<std::unique_ptr<memory>> &mems);
+  void create_ops(instance &inst);
+  // bind inputs and outputs to inst, and create its ops if they change
+  void prepare(instance &inst,
+               const std::vector<std::unique_ptr<memory>> &inputs,
+               std::vector<std::unique_ptr<memory>> &outputs);
+  // the part of thread ithr of all ops, called in a parallel region
+  void infer_thread(instance &inst, int ithr, int nthr);
+  std::vector<std::unique_ptr<tensor>> tensors_;
+  std::vector<std::unique_ptr<layer>> layers_;
+  std::vector<int> inputs_, outputs_;
+  // the first layer of each stage and the number of layers, the layers of
+  // a stage do not depend on each other and run at the same time
+  std::vector<int> stages_;
+  std::unique_ptr<instance> inst_;  // used by run
+  std::unique_ptr<async_queue> queue_;  // of run_async
+  std::shared_future<void> last_;
+  size_t arena_size_;
+  bool built_;
+  // the weights of a loaded model, on the mapped file
+  std::vector<std::unique_ptr<memory>> weights_;
+  std::vector<std::unique_ptr<memory>> packed_weights_;  // by pack_weights
+  void *map_;
+  size_t map_size_;
+  friend class stream;
+
+  DISABLE_COPY_AND_ASSIGN(network);
+};
+
+class thread_pool;
+
+// an inference stream of a built network on a group of cpus, which owns its
+// thread pool, arena and ops, while the weights and the jit code of kernels
+// are shared with the other streams of the network.
+// The network must outlive its streams, and is not changed after build.
+class stream {
+public:
+  explicit stream(network &net, const std::vector<int> &cpus);
+  ~stream();
+
+  // the same as network::run, on the cpus of this stream
+  void run(const std::vector<std::unique_ptr<memory>> &inputs,
+           std::vector<std::unique_ptr<memory>> &outputs);
+
+  const std::vector<int> &cpus() { return cpus_; }
+  // the ops of this stream, created by the first run
+  const std::vector<std::unique_ptr<op>> &ops();
+
+private:
+  network &net_;
+  std::vector<int> cpus_;
+  std::unique_ptr<thread_pool> pool_;
+  std::unique_ptr<network::instance> inst_;
+
+  DISABLE_COPY_AND_ASSIGN(stream);
+};
+
+// streams of a network on disjoint groups of cpus for throughput, such as
+// 4 streams of 7 cpus each on 28 cores, instead of running N processes
+// with taskset. Each run goes to a free stream.
+class stream_group {
+public:
+  // split cpus into nstreams groups of adjacent cpus, all the cpus this
+  // process can run on if cpus is empty
+  explicit stream_group(network &net,
+                        int nstreams,
+                        const std::vector<int> &cpus = {});
+
+  // run on a free stream, or wait until one is free,
+  // so it can be called by many threads at the same time
+  void run(const std::vector<std::unique_ptr<memory>> &inputs,
+           std::vector<std::unique_ptr<memory>> &outputs);
+
+  int size() { return streams_.size(); }
+  stream &at(int i) { return *streams_[i]; }
+
+private:
+  std::vector<std::unique_ptr<stream>> streams_;
+  std::vector<int> free_;  // the streams not running
+  std::mutex mu_;
+  std::condition_variable cv_;
+
+  DISABLE_COPY_AND_ASSIGN(stream_group);
+};
 }
@@ -0,0 +1,58 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "conv_rows.h"
+
+namespace jitinfer {
+
+void conv_row(const jit::jit_conv_kernel *kernel,
+              const u8 *src,
+              const s8 *wei,
+              const char *bia,
+              const float *scales,
+              int i_t_overflow,
+              int kh_padding,
+              char *dst,
+              s32 *ws) {
+  const auto &jcp = kernel->jcp;
+  int oc_chunks = jcp.nb_oc / jcp.nb_oc_blocking;
+  int ic_chunks = jcp.nb_ic / jcp.nb_ic_blocking;
+  // o/16, i/16, h, w, 4i, 16o, 4i
+  size_t wht_h_stride = jcp.kw * 4 * 16 * 4;
+  size_t wht_ic_stride = jcp.kh * wht_h_stride;
+
+  jit::jit_conv_call_s p = {0};
+  for (int occ = 0; occ < oc_chunks; ++occ) {
+    int ocb = occ * jcp.nb_oc_blocking;
+    int oc = ocb * jcp.oc_block;
+    auto wht_w = wei + ocb * jcp.oc_block * jcp.ic * jcp.kh * jcp.kw +
+                 i_t_overflow * wht_h_stride;
+    auto src_c = src;
+    for (int icc = 0; icc < ic_chunks; ++icc) {
+      p.src = src_c;
+      p.wei = wht_w;
+      p.bia = bia ? bia + oc * jcp.typesize_conv0_bia : 0;
+      p.acc_s32 = ws;
+      p.channel = icc * jcp.nb_ic_blocking;
+      p.kh_padding = kh_padding;
+      p.scales = jcp.conv0_multi_oc_scale ? scales + oc : scales;
+      p.dst = dst + oc * jcp.typesize_out;
+      kernel->jit_ker_(&p);
+      src_c += jcp.ic_block * jcp.nb_ic_blocking;
+      wht_w += wht_ic_stride * jcp.nb_ic_blocking;
+    }
+  }
+}
+}
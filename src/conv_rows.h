@@ -0,0 +1,71 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#pragma once
+
+#include <jitinfer.h>
+#include <algorithm>
+#include <cstring>
+#include "jit_conv_kernel.h"
+
+namespace jitinfer {
+
+// one output row of conv kernel on all oc, src is the first of kh_padding
+// rows and i_t_overflow is the kernel rows above it
+void conv_row(const jit::jit_conv_kernel *kernel,
+              const u8 *src,
+              const s8 *wei,
+              const char *bia,
+              const float *scales,
+              int i_t_overflow,
+              int kh_padding,
+              char *dst,
+              s32 *ws);
+
+// the rolling buffer of u8 rows of one thread, which are computed by the
+// first conv of a fusion and are the src rows of the next conv.
+// The rows overlapped by the next output row are kept instead of computed.
+class conv_rows {
+public:
+  conv_rows(u8 *data, size_t row_stride)
+      : data_(data), row_stride_(row_stride), s_(0), e_(0), n_(-1) {}
+
+  // make rows [ih_s, ih_e) of image n in buffer, from data(), and call
+  // compute(ir, row) for each row ir not in buffer yet
+  template <typename F>
+  void update(int n, int ih_s, int ih_e, F compute) {
+    if (n == n_ && ih_s >= s_ && ih_s < e_) {
+      memmove(data_,
+              data_ + (ih_s - s_) * row_stride_,
+              (e_ - ih_s) * row_stride_ * sizeof(u8));
+    } else {
+      e_ = ih_s;
+    }
+    s_ = ih_s;
+    n_ = n;
+    for (int ir = e_; ir < ih_e; ++ir) {
+      compute(ir, data_ + (ir - s_) * row_stride_);
+    }
+    e_ = std::max(e_, ih_e);
+  }
+
+  u8 *data() { return data_; }
+
+private:
+  u8 *data_;
+  size_t row_stride_;
+  int s_, e_, n_;  // rows [s_, e_) of image n_ are in buffer
+};
+}
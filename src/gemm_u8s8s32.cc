@@ -0,0 +1,136 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "gemm_u8s8s32.h"
+#include <algorithm>
+#include "jit_conv_kernel.h"  // scales_extended_size
+#include "log.h"
+#include "thread_pool.h"
+#include "util_jitinfer.h"
+
+namespace jitinfer {
+
+template <typename dst_data_t>
+gemm_u8s8s32<dst_data_t>::gemm_u8s8s32(int m,
+                                       int n,
+                                       int k,
+                                       int lda,
+                                       int ldc,
+                                       const s8 *b,
+                                       const void *bia,
+                                       memory::dtype bias_dt,
+                                       const std::vector<float> &scales,
+                                       bool post_relu,
+                                       round_mode rmode,
+                                       bool in_thread,
+                                       memory::dtype sum_dt,
+                                       int ld_sum,
+                                       float sum_scale)
+    : b_(b), bia_(reinterpret_cast<const char *>(bia)) {
+  auto conf = util::zero<jit::jit_gemm_conf_t>();
+  if (!jit::jit_gemm_kernel::init_conf(conf,
+                                       m,
+                                       n,
+                                       k,
+                                       lda,
+                                       ldc,
+                                       util::type2dtype<dst_data_t>::dtype,
+                                       bia ? bias_dt : memory::dtype::undef,
+                                       scales.size(),
+                                       post_relu,
+                                       rmode,
+                                       in_thread ? 1 : get_max_threads(),
+                                       sum_dt,
+                                       ld_sum,
+                                       sum_scale)) {
+    error_and_exit("Init GEMM failed!");
+  }
+  kernel_ = jit::get_kernel<jit::jit_gemm_kernel>(conf);
+
+  scales_data_ = util::extend_scales(scales, scales_extended_size);
+}
+
+template <typename dst_data_t>
+gemm_u8s8s32<dst_data_t>::~gemm_u8s8s32() {
+  free(scales_data_);
+}
+
+template <typename dst_data_t>
+void gemm_u8s8s32<dst_data_t>::compute_part(int ithr,
+                                            int nthr,
+                                            const u8 *a,
+                                            dst_data_t *c,
+                                            const void *sum) {
+  using namespace util;
+  const auto &jcp = kernel_->jcp_;
+  auto sum_data = reinterpret_cast<const char *>(sum);
+
+  int n_chunks = jcp.nb_n / jcp.nb_n_blocking;
+  int m_chunks = div_up(jcp.m, jcp.ur_m);
+
+  // n is the outer loop, so the B chunk stays in cache along m,
+  // and small m is only split over n
+  int start{0}, end{0};
+  int work_amount = n_chunks * m_chunks;
+  balance211(work_amount, nthr, ithr, start, end);
+
+  jit::jit_gemm_call_s p = {0};
+  int iwork = start;
+  while (iwork < end) {
+    int nc = iwork / m_chunks;
+    int mc = iwork % m_chunks;
+    // all the m chunks of this n chunk are done in one call
+    int mc_end = std::min(m_chunks, mc + end - iwork);
+    int n_off = nc * jcp.nb_n_blocking * jcp.n_block;
+    int m_off = mc * jcp.ur_m;
+    p.a = a + (size_t)m_off * jcp.lda;
+    p.b = b_ + (size_t)n_off * jcp.k;
+    p.c = c + (size_t)m_off * jcp.ldc + n_off;
+    p.bia = bia_ ? bia_ + n_off * jcp.typesize_bia : nullptr;
+    p.scales = jcp.multi_n_scale ? scales_data_ + n_off : scales_data_;
+    p.sum = sum_data ? sum_data + ((size_t)m_off * jcp.ld_sum + n_off) *
+                                      jcp.typesize_sum
+                     : nullptr;
+    p.m = std::min(mc_end * jcp.ur_m, jcp.m) - m_off;
+    kernel_->jit_ker_(&p);
+    iwork += mc_end - mc;
+  }
+}
+
+template <typename dst_data_t>
+void gemm_u8s8s32<dst_data_t>::compute_in_thread(const u8 *a,
+                                                 dst_data_t *c,
+                                                 const void *sum) {
+  const auto &jcp = kernel_->jcp_;
+  auto sum_data = reinterpret_cast<const char *>(sum);
+  jit::jit_gemm_call_s p = {0};
+  p.a = a;
+  p.m = jcp.m;
+  for (int n_off = 0; n_off < jcp.n;
+       n_off += jcp.nb_n_blocking * jcp.n_block) {
+    p.b = b_ + (size_t)n_off * jcp.k;
+    p.c = c + n_off;
+    p.bia = bia_ ? bia_ + n_off * jcp.typesize_bia : nullptr;
+    p.scales = jcp.multi_n_scale ? scales_data_ + n_off : scales_data_;
+    p.sum = sum_data ? sum_data + n_off * jcp.typesize_sum : nullptr;
+    kernel_->jit_ker_(&p);
+  }
+}
+
+template class gemm_u8s8s32<f32>;
+template class gemm_u8s8s32<s32>;
+template class gemm_u8s8s32<s8>;
+template class gemm_u8s8s32<u8>;
+}
@@ -0,0 +1,68 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#pragma once
+
+#include <jitinfer.h>
+#include "jit_gemm_kernel.h"
+
+namespace jitinfer {
+
+// threaded C = epilogue(A * B) on the JIT GEMM micro-kernel,
+// used by the ops which can be seen as a GEMM, like 1x1 conv and fc.
+// A is u8 of m x k with lda, C is dst_data_t of m x n with ldc,
+// B is s8 of k x n packed as [n/16][k/4][16n][4k], the OIhw4i16o4i of 1x1.
+// B and bias are not copied, they should outlive this object.
+// When in_thread, the gemm is blocked for one thread and compute_in_thread
+// is called by each thread inside a parallel region on its own A and C.
+// When sum_dt is not undef, sum_scale * sum of m x n with ld_sum is added
+// to C before relu, sum is given on each compute.
+template <typename dst_data_t>
+class gemm_u8s8s32 {
+public:
+  explicit gemm_u8s8s32(int m,
+                        int n,
+                        int k,
+                        int lda,
+                        int ldc,
+                        const s8 *b,
+                        const void *bia,
+                        memory::dtype bias_dt,
+                        const std::vector<float> &scales,
+                        bool post_relu,
+                        round_mode rmode,
+                        bool in_thread = false,
+                        memory::dtype sum_dt = memory::dtype::undef,
+                        int ld_sum = 0,
+                        float sum_scale = 1.f);
+  ~gemm_u8s8s32();
+
+  // the part of thread ithr in nthr threads, called in a parallel region
+  void compute_part(int ithr,
+                    int nthr,
+                    const u8 *a,
+                    dst_data_t *c,
+                    const void *sum = nullptr);
+  void compute_in_thread(const u8 *a, dst_data_t *c, const void *sum = nullptr);
+
+private:
+  std::shared_ptr<jit::jit_gemm_kernel> kernel_;
+  const s8 *b_;
+  const char *bia_;
+  float *scales_data_;
+
+  DISABLE_COPY_AND_ASSIGN(gemm_u8s8s32);
+};
+}
@@ -0,0 +1,197 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "jit_binary_kernel.h"
+#include "util_jitinfer.h"
+
+#define GET_OFF(field) offsetof(jit_binary_call_s, field)
+
+namespace jitinfer {
+namespace jit {
+
+using namespace Xbyak;
+
+void jit_binary_kernel::load_src(zmm_t zmm, const Address& addr) {
+  using data_type = memory::dtype;
+  switch (jcp_.dt) {
+    case data_type::f32:
+    case data_type::s32:
+      vmovups(zmm, addr);
+      break;
+    case data_type::s8:
+      vpmovsxbd(zmm, addr);
+      break;
+    case data_type::u8:
+      vpmovzxbd(zmm, addr);
+      break;
+    default:
+      assert(!"unsupported data type");
+  }
+}
+
+void jit_binary_kernel::compute() {
+  using data_type = memory::dtype;
+  const bool is_f32 = jcp_.dt == data_type::f32;
+  for (int i = 0; i < jcp_.nb_c_blocking; ++i) {
+    int offset = jcp_.typesize * i * jcp_.c_block;
+    load_src(zmm_out(i), EVEX_compress_addr(aux_reg_src0, offset));
+    load_src(zmm_src1(i), EVEX_compress_addr(aux_reg_src1, offset));
+  }
+  for (int i = 0; i < jcp_.nb_c_blocking; ++i) {
+    Zmm zmm = zmm_out(i);
+    if (jcp_.kind == binary_add) {
+      if (is_f32) {
+        vaddps(zmm, zmm, zmm_src1(i));
+      } else {
+        vpaddd(zmm, zmm, zmm_src1(i));
+      }
+    } else {
+      if (is_f32) {
+        vmulps(zmm, zmm, zmm_src1(i));
+      } else {
+        vpmulld(zmm, zmm, zmm_src1(i));
+      }
+    }
+    if (jcp_.with_relu) {
+      if (is_f32) {
+        vmaxps(zmm, zmm, zmm_zero);
+      } else {
+        vpmaxsd(zmm, zmm, zmm_zero);
+      }
+    }
+  }
+  for (int i = 0; i < jcp_.nb_c_blocking; ++i) {
+    Zmm zmm = zmm_out(i);
+    Xmm xmm = Xmm(zmm.getIdx());
+    int offset = jcp_.typesize * i * jcp_.c_block;
+    auto addr = EVEX_compress_addr(aux_reg_dst, offset);
+    switch (jcp_.dt) {
+      case data_type::f32:
+      case data_type::s32:
+        vmovups(addr, zmm);
+        break;
+      case data_type::s8:
+        vpmovsdb(xmm, zmm);
+        vmovups(addr, xmm);
+        break;
+      case data_type::u8:
+        vpmovusdb(xmm, zmm);
+        vmovups(addr, xmm);
+        break;
+      default:
+        assert(!"unsupported data type");
+    }
+  }
+}
+
+void jit_binary_kernel::generate() {
+  const int shift_c = jcp_.typesize * jcp_.c_block * jcp_.nb_c_blocking;
+  preamble();
+
+  mov(reg_ptr_src0, ptr[param + GET_OFF(src0)]);
+  mov(reg_ptr_src1, ptr[param + GET_OFF(src1)]);
+  mov(reg_ptr_dst, ptr[param + GET_OFF(dst)]);
+  mov(reg_work, ptr[param + GET_OFF(work)]);
+  vpxord(zmm_zero, zmm_zero, zmm_zero);
+
+  Label l_pixel, l_chunk, l_ret;
+  cmp(reg_work, 0);
+  jle(l_ret, T_NEAR);
+  L(l_pixel);
+  {
+    mov(aux_reg_src0, reg_ptr_src0);
+    mov(aux_reg_src1, reg_ptr_src1);
+    mov(aux_reg_dst, reg_ptr_dst);
+    mov(reg_nb, jcp_.nb_c / jcp_.nb_c_blocking);
+    L(l_chunk);
+    {
+      compute();
+      add(aux_reg_src0, shift_c);
+      add(aux_reg_src1, shift_c);
+      add(aux_reg_dst, shift_c);
+      dec(reg_nb);
+      cmp(reg_nb, 0);
+      jg(l_chunk, T_NEAR);
+    }
+    add(reg_ptr_src0, jcp_.typesize * jcp_.src0_ld);
+    if (!jcp_.broadcast) {
+      add(reg_ptr_src1, jcp_.typesize * jcp_.src1_ld);
+    }
+    add(reg_ptr_dst, jcp_.typesize * jcp_.dst_ld);
+    dec(reg_work);
+    cmp(reg_work, 0);
+    jg(l_pixel, T_NEAR);
+  }
+  L(l_ret);
+
+  postamble();
+}
+
+bool jit_binary_kernel::init_conf(jit_binary_conf_t& jcp,
+                                  const std::unique_ptr<memory>& src0,
+                                  const std::unique_ptr<memory>& src1,
+                                  const std::unique_ptr<memory>& dst,
+                                  binary_kind kind,
+                                  bool post_relu) {
+  using namespace util;
+  jcp = zero<decltype(jcp)>();
+  if (!all_true(one_of(src0->dim_format(), memory::format::nhwc),
+                one_of(src1->dim_format(),
+                       memory::format::nhwc,
+                       memory::format::x),
+                one_of(dst->dim_format(), memory::format::nhwc),
+                src0->data_type() == src1->data_type(),
+                src0->data_type() == dst->data_type(),
+                src0->std_dims() == dst->std_dims(),
+                one_of(kind, binary_add, binary_mul))) {
+    return false;
+  }
+  if (!mayiuse(avx512_core)) {
+    return false;
+  }
+
+  auto dims = src0->std_dims();  // nchw
+  jcp.bs = dims[0];
+  jcp.c = dims[1];
+  jcp.h = dims[2];
+  jcp.w = dims[3];
+  jcp.broadcast = src1->dim_format() == memory::format::x;
+  if (jcp.broadcast) {
+    if (src1->std_dims()[0] != jcp.c) {
+      return false;
+    }
+  } else if (src1->std_dims() != dims) {
+    return false;
+  }
+  jcp.src0_ld = src0->ld();
+  jcp.src1_ld = jcp.broadcast ? 0 : src1->ld();
+  jcp.dst_ld = dst->ld();
+  jcp.kind = kind;
+  jcp.with_relu = post_relu;
+  jcp.dt = src0->data_type();
+  jcp.typesize = dtype_size(jcp.dt);
+  if (!one_of(jcp.typesize, 1, 4)) {
+    return false;
+  }
+  jcp.c_block = 16;
+  if (jcp.c % jcp.c_block != 0) {
+    return false;
+  }
+  jcp.nb_c = jcp.c / jcp.c_block;
+  jcp.nb_c_blocking = dividable_of(jcp.nb_c, 8, 4, 2, 1);
+  return true;
+}
+}
+}
@@ -0,0 +1,76 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#pragma once
+
+#include "jit_call_conf.h"
+#include "jit_generator.h"
+
+namespace jitinfer {
+
+namespace jit {
+
+struct jit_binary_kernel : public jit_generator {
+  DECLARE_JIT_KERNEL(jit_binary_kernel);
+
+  jit_binary_kernel(jit_binary_conf_t ajcp) : jcp_(ajcp) {
+    generate();
+    jit_ker_ = (void (*)(jit_binary_call_s*))getCode();
+  }
+
+  static bool init_conf(jit_binary_conf_t& jcp,
+                        const std::unique_ptr<memory>& src0,
+                        const std::unique_ptr<memory>& src1,
+                        const std::unique_ptr<memory>& dst,
+                        binary_kind kind,
+                        bool post_relu);
+
+  jit_binary_conf_t jcp_;
+  void (*jit_ker_)(jit_binary_call_s*);
+
+private:
+  using reg64_t = const Xbyak::Reg64;
+  using zmm_t = const Xbyak::Zmm;
+  using xmm_t = const Xbyak::Xmm;
+
+  reg64_t param = abi_param1;
+  reg64_t reg_ptr_src0 = r8;
+  reg64_t reg_ptr_src1 = r9;
+  reg64_t reg_ptr_dst = r10;
+  reg64_t reg_work = r11;
+  reg64_t aux_reg_src0 = r12;
+  reg64_t aux_reg_src1 = r13;
+  reg64_t aux_reg_dst = r14;
+  reg64_t reg_nb = r15;
+
+  zmm_t zmm_zero = zmm_t(31);
+
+  // i-th c block of src0 and dst
+  zmm_t zmm_out(int i) {
+    assert(i < jcp_.nb_c_blocking);
+    return zmm_t(i);
+  }
+  // i-th c block of src1
+  zmm_t zmm_src1(int i) {
+    assert(i < jcp_.nb_c_blocking);
+    return zmm_t(jcp_.nb_c_blocking + i);
+  }
+
+  void load_src(zmm_t zmm, const Xbyak::Address& addr);
+  void compute();
+  void generate();
+};
+}
+}
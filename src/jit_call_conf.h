@@ -22,6 +22,7 @@ namespace jitinfer {
 enum conv_loop_order_t { loop_cgn, loop_gnc, loop_ngc };
 
 namespace jit {
+// when split, src is the list of dsts and dst is the only src
 struct jit_concat_call_s {
   const void **src;
   const int *nb_ic;
@@ -32,12 +33,147 @@ struct jit_concat_conf_t {
   int bs;
   int h, w;
   int oc;
-  int n_inputs;
+  int n_inputs;  // number of dsts when split
   memory::dtype dt;
   int typesize;
   int block;      // u8: 64, s32: 16
   int bits_size;  // 128, 256, 512 : xmm, ymm, zmm
   bool with_relu;
+  bool is_split;  // copy from one to the list in reverse
+};
+
+struct jit_pool_call_s {
+  const void *src;  // the first valid pixel of window
+  const void *dst;
+  size_t kh_padding;  // valid kernel height without padding
+  size_t kw_padding;  // valid kernel width without padding
+  float inv_area;     // only used in avg pooling
+};
+
+struct jit_pool_conf_t {
+  int bs;
+  int c;
+  int ih, iw, oh, ow;
+  int src_ld;  // elements between two src pixels
+  int kh, kw;
+  int sh, sw;
+  int t_pad, l_pad;
+  pooling_kind kind;
+  memory::dtype dt;
+  int typesize;
+  int c_block;        // channels in one vector register
+  int nb_c;
+  int nb_c_blocking;  // c blocks computed in registers at once
+  int bits_size;      // 128, 256, 512 : xmm, ymm, zmm of src loading
+};
+
+struct jit_dw_call_s {
+  const void *src;  // the first valid row of window
+  const void *wei;  // the first valid row of kernel
+  const void *bia;
+  const void *scales;
+  const void *dst;
+  size_t kh_padding;  // valid kernel height without padding
+};
+
+struct jit_dw_conf_t {
+  int bs;
+  int c;
+  int ih, iw, oh, ow;
+  int src_ld, dst_ld;  // elements between two src or dst pixels
+  int kh, kw;
+  int sh, sw;
+  int t_pad, l_pad;
+  int c_block;  // channels in one vector register
+  int nb_c;
+  int ur_w;  // output pixels computed in registers at once
+  int typesize_bia;
+  memory::dtype bias_dt;
+  round_mode dst_round_mode;
+  bool with_bias;
+  bool multi_c_scale;  // whether use multi scales on channels
+};
+
+struct jit_eltwise_call_s {
+  const void *src;
+  const void *dst;
+  size_t work;  // pixels
+};
+
+struct jit_eltwise_conf_t {
+  int bs, c, h, w;
+  int src_ld, dst_ld;
+  eltwise_kind kind;
+  float alpha, beta;
+  memory::dtype dt;
+  int typesize;
+  int c_block;        // channels in one vector register
+  int nb_c;
+  int nb_c_blocking;  // c blocks computed in registers at once
+  int bits_size;      // 128, 256, 512 : xmm, ymm, zmm
+};
+
+struct jit_binary_call_s {
+  const void *src0;
+  const void *src1;
+  const void *dst;
+  size_t work;  // pixels
+};
+
+struct jit_binary_conf_t {
+  int bs, c, h, w;
+  int src0_ld, src1_ld, dst_ld;
+  bool broadcast;  // src1 only has c, same for all pixels
+  binary_kind kind;
+  bool with_relu;
+  memory::dtype dt;
+  int typesize;
+  int c_block;  // always 16, computed as s32 or f32
+  int nb_c;
+  int nb_c_blocking;
+};
+
+// C = A * B, A is u8 row major, B is s8 packed as [n/16][k/4][16n][4k],
+// which is the same as OIhw4i16o4i of 1x1 weight
+// most srcs of A concatenated on k, such as all the inputs of densenet layer
+enum { max_gemm_srcs = 64 };
+
+struct jit_gemm_call_s {
+  const void *a;  // the first row of this call
+  // the first row of each src of this call, when A has several srcs
+  const void *const *srcs;
+  const void *b;  // the first n block of this call
+  const void *c;
+  const void *bia;
+  const void *scales;
+  // the first row of sum, when fuse sum
+  const void *sum;
+  size_t m;  // rows in this call, times of ur_m and at most one ur_m_tail
+};
+
+struct jit_gemm_conf_t {
+  int m, n, k;
+  int lda;  // elements between two rows of A
+  int ldc;  // elements between two rows of C
+  int n_block, k_block;
+  int nb_n, nb_k;
+  int nb_n_blocking;    // n blocks computed in registers at once
+  int ur_m, ur_m_tail;  // rows computed in registers at once
+  int ld_sum;           // elements between two rows of sum
+  int nb_srcs;          // A is concatenated on k from srcs when > 1
+  int srcs_k[max_gemm_srcs];
+  int srcs_lda[max_gemm_srcs];
+  int typesize_out;
+  int typesize_bia;
+  int typesize_sum;
+  memory::dtype dst_dt, bias_dt, sum_dt;
+  round_mode dst_round_mode;
+  float sum_scale;
+  bool use_vnni;
+  bool with_relu;
+  bool with_bias;
+  bool with_sum;       // whether add sum_scale * sum before relu
+  bool multi_n_scale;  // whether use multi scales on n
 };
 
 struct jit_conv_call_s {
@@ -47,6 +183,7 @@ struct jit_conv_call_s {
   const void *bia;
   const void *scales;
   const void *acc_s32;
+  const void *sum;  // per channel sum of output, when fuse global pooling
 
   const void *wei1x1;
   const void *bia1x1;
@@ -63,6 +200,8 @@ struct jit_conv_conf_t {
   int bs;
   int gp, ic, oc;
   int ih, iw, oh, ow;
+  int src_ld;  // elements between two src pixels
+  int dst_ld;  // elements between two dst pixels
   int kh, kw;
   int sh, sw;
   int l_pad, t_pad;  // left, top padding
@@ -91,6 +230,17 @@ struct jit_conv_conf_t {
   bool conv1_with_bias;
   bool conv0_multi_oc_scale;  // whether use multi channel to scale oc
   bool conv1_multi_oc_scale;
+  /* max pooling after conv0 */
+  bool fuse_pool;
+  int pool_oh, pool_ow;
+  int pool_kh, pool_kw;
+  int pool_sh, pool_sw;
+  int pool_t_pad, pool_l_pad;
+  /* global average pooling after conv0 */
+  bool fuse_global_pool;
+  /* channel shuffle after conv0, such as shufflenet */
+  int shuffle_gp;       // channel i of group g is stored to i * shuffle_gp + g
+  int shuffle_idx[16];  // dst offsets of the channels of one oc block
 };
 }
 }
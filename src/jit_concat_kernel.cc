@@ -33,20 +33,22 @@ void jit_concat_kernel::compute_one_input() {
   mov(reg_ptr_src_i, ptr[reg_ptr_src]);
   L(l_next_block);
   {
-    auto src_addr = EVEX_compress_addr(reg_ptr_src_i, 0);
-    auto dst_addr = EVEX_compress_addr(reg_ptr_dst, 0);
+    auto list_addr = EVEX_compress_addr(reg_ptr_src_i, 0);
+    auto whole_addr = EVEX_compress_addr(reg_ptr_dst, 0);
+    auto src_addr = jcp_.is_split ? whole_addr : list_addr;
+    auto dst_addr = jcp_.is_split ? list_addr : whole_addr;
     // load, relu and store
     switch (jcp_.bits_size) {
       case USE_ZMM:
         vmovups(zmm_src, src_addr);
         if (jcp_.with_relu) {
           if (jcp_.dt == memory::dtype::s32) {
-            vpmaxsw(zmm_src, zmm_src, zmm_zero);
+            vpmaxsd(zmm_src, zmm_src, zmm_zero);
           } else if (jcp_.dt == memory::dtype::f32) {
             vmaxps(zmm_src, zmm_zero, zmm_src);
-          } else {  // s8 or u8
+          } else if (jcp_.dt == memory::dtype::s8) {
             vpmaxsb(zmm_src, zmm_src, zmm_zero);
-          }
+          }  // relu of u8 does nothing
         }
         vmovups(dst_addr, zmm_src);
         break;
@@ -54,12 +56,12 @@ void jit_concat_kernel::compute_one_input() {
         vmovups(ymm_src, src_addr);
         if (jcp_.with_relu) {
           if (jcp_.dt == memory::dtype::s32) {
-            vpmaxsw(ymm_src, ymm_src, ymm_zero);
+            vpmaxsd(ymm_src, ymm_src, ymm_zero);
           } else if (jcp_.dt == memory::dtype::f32) {
             vmaxps(ymm_src, ymm_zero, ymm_src);
-          } else {  // s8 or u8
+          } else if (jcp_.dt == memory::dtype::s8) {
             vpmaxsb(ymm_src, ymm_src, ymm_zero);
-          }
+          }  // relu of u8 does nothing
         }
         vmovups(dst_addr, ymm_src);
         break;
@@ -68,12 +70,12 @@ void jit_concat_kernel::compute_one_input() {
         // maybe relu
         if (jcp_.with_relu) {
           if (jcp_.dt == memory::dtype::s32) {
-            vpmaxsw(xmm_src, xmm_src, xmm_zero);
+            vpmaxsd(xmm_src, xmm_src, xmm_zero);
           } else if (jcp_.dt == memory::dtype::f32) {
             vmaxps(xmm_src, xmm_zero, xmm_src);
-          } else {  // s8 or u8
+          } else if (jcp_.dt == memory::dtype::s8) {
             vpmaxsb(xmm_src, xmm_src, xmm_zero);
-          }
+          }  // relu of u8 does nothing
         }
         vmovups(dst_addr, xmm_src);
         break;
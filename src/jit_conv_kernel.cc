@@ -14,6 +14,7 @@
  * limitations under the License.
 *******************************************************************************/
 #include "jit_conv_kernel.h"
+#include <algorithm>
 #include "util_jitinfer.h"
 
 #define GET_OFF(field) offsetof(jit_conv_call_s, field)
@@ -59,9 +60,7 @@ void jit_conv_kernel::store_1x1output(int ur_w, int ocb1x1) {
   mov(reg_ptr_bia1x1, ptr[param1 + GET_OFF(bia1x1)]);
   mov(reg_ptr_scales1x1, ptr[param1 + GET_OFF(scales1x1)]);
   int scale_offset =
-      jcp.conv1_multi_oc_scale
-          ? sizeof(float) * ocb1x1 * jcp.oc1x1_block * scales_extended_size
-          : 0;
+      jcp.conv1_multi_oc_scale ? sizeof(float) * ocb1x1 * jcp.oc1x1_block : 0;
 
   auto zmm_bias = zmm_tmp;
   if (jcp.conv1_with_bias) {
@@ -91,7 +90,8 @@ void jit_conv_kernel::store_1x1output(int ur_w, int ocb1x1) {
     Zmm zmm = zmm_1x1out(jw);
     Xmm xmm = xmm_1x1out(jw);
     // out format is nhw,c/16,16o
-    int offset = jcp.typesize_out * (jw * jcp.oc1x1 + ocb1x1 * jcp.oc1x1_block);
+    int offset =
+        jcp.typesize_out * (jw * jcp.dst_ld + ocb1x1 * jcp.oc1x1_block);
     auto addr = EVEX_compress_addr(reg_ptr_out1x1, offset);
     // TODO: can optimize more, do not need to cvt2f32 sometimes
     // cvt to f32
@@ -144,15 +144,8 @@ void jit_conv_kernel::store_1x1output(int ur_w, int ocb1x1) {
 }
 
 void jit_conv_kernel::compute1x1_loop(int ur_w) {
-  // this lamda function should be the same with compute_loop
   auto compute = [=](Zmm vreg_acc, Zmm vreg_wei, Zmm vreg_src) {
-    if (jcp.use_vnni) {
-      vpdpbusd(vreg_acc, vreg_src, vreg_wei);
-    } else {
-      vpmaddubsw(zmm_tmp, vreg_src, vreg_wei);
-      vpmaddwd(zmm_tmp, zmm_tmp, zmm_one);
-      vpaddd(vreg_acc, vreg_acc, zmm_tmp);
-    }
+    dot_u8s8s32(vreg_acc, vreg_src, vreg_wei, zmm_tmp, zmm_one, jcp.use_vnni);
   };
   // reg sum_scale, scales, bias, channel are avaible now
   mov(reg_ptr_wei1x1, ptr[param1 + GET_OFF(wei1x1)]);  // ic1x1 offsetted
@@ -218,6 +211,38 @@ void jit_conv_kernel::prepare_output(int ur_w) {
   L(l_ret);
 }
 
+// the oc block k is in the same group as oc block 0 of this call,
+// so its dst channels start from k * 16 * shuffle_gp of stride shuffle_gp
+void jit_conv_kernel::store_shuffled(int j, int k) {
+  using data_type = memory::dtype;
+  Xmm xmm = xmm_out(j, k);
+  Zmm zmm = zmm_out(j, k);
+  int offset = jcp.typesize_out *
+               (k * jcp.oc_block * jcp.shuffle_gp + j * jcp.dst_ld);
+  switch (jcp.dst_dt) {
+    case data_type::f32:
+    case data_type::s32:
+      // the mask is cleared by scatter
+      kxnorw(k_shuffle, k_shuffle, k_shuffle);
+      vpscatterdd(ptr[reg_out + zmm_shuffle_idx * 4 + offset] | k_shuffle,
+                  zmm);
+      break;
+    case data_type::s8:
+    case data_type::u8:
+      if (jcp.dst_dt == data_type::s8) {
+        vpmovsdb(xmm, zmm);
+      } else {
+        vpmovusdb(xmm, zmm);
+      }
+      for (int i = 0; i < jcp.oc_block; ++i) {
+        vpextrb(ptr[reg_out + offset + jcp.shuffle_idx[i]], xmm, i);
+      }
+      break;
+    default:
+      assert(!"unknown dst_dt");
+  }
+}
+
 void jit_conv_kernel::store_output(int ur_w) {
   using data_type = memory::dtype;
   Label l_update_acc, l_ret;
@@ -231,11 +256,27 @@ void jit_conv_kernel::store_output(int ur_w) {
   mov(reg_bias, ptr[param1 + GET_OFF(bia)]);
   mov(reg_ptr_scales, ptr[param1 + GET_OFF(scales)]);
   vpxord(zmm_zero, zmm_zero, zmm_zero);
+  if (jcp.fuse_global_pool) {
+    // saturation bounds of s8 and u8 in float, set here since compute_loop
+    // broadcasts the src to them when ur_w is large
+    if (jcp.dst_dt == data_type::s8) {
+      mov(reg_tmp_32, 0xc3000000);  // -128.f
+      vpbroadcastd(zmm_lbound, reg_tmp_32);
+      mov(reg_tmp_32, 0x42fe0000);  // 127.f
+      vpbroadcastd(zmm_ubound, reg_tmp_32);
+    } else if (jcp.dst_dt == data_type::u8) {
+      vpxord(zmm_lbound, zmm_lbound, zmm_lbound);
+      mov(reg_tmp_32, 0x437f0000);  // 255.f
+      vpbroadcastd(zmm_ubound, reg_tmp_32);
+    }
+  }
+  if (jcp.shuffle_gp > 0 && jcp.typesize_out == 4) {
+    mov(reg_ptr_shuffle, reinterpret_cast<size_t>(jcp.shuffle_idx));
+    vmovups(zmm_shuffle_idx, ptr[reg_ptr_shuffle]);
+  }
   for (int k = 0; k < jcp.nb_oc_blocking; k++) {
     int scale_offset =
-        jcp.conv0_multi_oc_scale
-            ? sizeof(float) * k * jcp.oc_block * scales_extended_size
-            : 0;
+        jcp.conv0_multi_oc_scale ? sizeof(float) * k * jcp.oc_block : 0;
     auto zmm_bias = zmm_tmp;
     if (jcp.conv0_with_bias) {
       int bias_offset = jcp.typesize_conv0_bia * k * jcp.oc_block;
@@ -258,6 +299,11 @@ void jit_conv_kernel::store_output(int ur_w) {
         vcvtdq2ps(zmm_bias, zmm_bias);
       }
     }
+    auto sum_addr =
+        EVEX_compress_addr(reg_ptr_sum, sizeof(float) * k * jcp.oc_block);
+    if (jcp.fuse_global_pool) {
+      vmovups(zmm_sum, sum_addr);
+    }
     for (int j = 0; j < ur_w; j++) {
       Xmm xmm = xmm_out(j, k);
       Zmm zmm = zmm_out(j, k);
@@ -270,6 +316,20 @@ void jit_conv_kernel::store_output(int ur_w) {
           jcp.fuse_conv1x1) {
         vmaxps(zmm, zmm_zero, zmm);
       }
+      if (jcp.fuse_global_pool) {
+        // sum the value as it would be saved in dst
+        if (util::one_of(jcp.dst_dt, data_type::s8, data_type::u8)) {
+          vminps(zmm, zmm, zmm_ubound);
+          vmaxps(zmm, zmm, zmm_lbound);
+        }
+        if (jcp.dst_dt != data_type::f32) {
+          // imm 0 is round to nearest even, 1 is round down
+          vrndscaleps(
+              zmm, zmm, jcp.conv0_round_mode == round_mode::nearest ? 0 : 1);
+        }
+        vaddps(zmm_sum, zmm_sum, zmm);
+        continue;
+      }
       if (jcp.dst_dt != data_type::f32) {
         if (jcp.conv0_round_mode == round_mode::nearest) {
           vcvtps2dq(zmm | T_rn_sae, zmm);
@@ -282,9 +342,11 @@ void jit_conv_kernel::store_output(int ur_w) {
       if (jcp.fuse_conv1x1) {
         // always convert to u8, as src of 1x1 conv
         vpmovusdb(xmm, zmm);
+      } else if (jcp.shuffle_gp > 0) {
+        store_shuffled(j, k);
       } else {
         int aux_output_offset =
-            jcp.typesize_out * (k * jcp.oc_block + j * jcp.oc * jcp.gp);
+            jcp.typesize_out * (k * jcp.oc_block + j * jcp.dst_ld);
         auto addr = EVEX_compress_addr(reg_out, aux_output_offset);
         switch (jcp.dst_dt) {
           case data_type::f32:
@@ -304,6 +366,9 @@ void jit_conv_kernel::store_output(int ur_w) {
         }
       }
     }
+    if (jcp.fuse_global_pool) {
+      vmovups(sum_addr, zmm_sum);
+    }
   }
 
   if (jcp.fuse_conv1x1) {
@@ -331,10 +396,10 @@ void jit_conv_kernel::compute_loop(int ur_w, int pad_l, int pad_r) {
 
   Label kh_label, skip_kh_loop;
   int shift_kernel_ptr = jcp.typesize_in * jcp.kw * jcp.oc_block * jcp.ic_block;
-  int shift_input_ptr = jcp.typesize_in * jcp.iw * jcp.ic * jcp.gp;
+  int shift_input_ptr = jcp.typesize_in * jcp.iw * jcp.src_ld;
 
   auto input_offset = [=](int oi, int nb_ic, int ic, int ki) {
-    return jcp.typesize_in * ((ki + oi * stride_w - pad_l) * jcp.ic * jcp.gp +
+    return jcp.typesize_in * ((ki + oi * stride_w - pad_l) * jcp.src_ld +
                               4 * ic + nb_ic * jcp.ic_block);
   };
   auto kernel_offset = [=](int ii, int nb_ic, int ic, int ki) {
@@ -344,13 +409,7 @@ void jit_conv_kernel::compute_loop(int ur_w, int pad_l, int pad_r) {
             jcp.kh * jcp.kw * nb_ic * jcp.ic_block * oc_block);
   };
   auto compute = [=](Zmm vreg_acc, Zmm vreg_wei, Zmm vreg_src) {
-    if (jcp.use_vnni) {
-      vpdpbusd(vreg_acc, vreg_src, vreg_wei);
-    } else {
-      vpmaddubsw(zmm_tmp, vreg_src, vreg_wei);
-      vpmaddwd(zmm_tmp, zmm_tmp, zmm_one);
-      vpaddd(vreg_acc, vreg_acc, zmm_tmp);
-    }
+    dot_u8s8s32(vreg_acc, vreg_src, vreg_wei, zmm_tmp, zmm_one, jcp.use_vnni);
   };
 
   prepare_output(ur_w);
@@ -401,18 +460,18 @@ void jit_conv_kernel::compute_loop(int ur_w, int pad_l, int pad_r) {
 
 void jit_conv_kernel::generate() {
   int inp_shift_pad =
-      jcp.typesize_in * (jcp.ur_w * jcp.sw - jcp.l_pad) * jcp.ic * jcp.gp;
-  int inp_shift = jcp.typesize_in * (jcp.ur_w * jcp.sw * jcp.ic * jcp.gp);
+      jcp.typesize_in * (jcp.ur_w * jcp.sw - jcp.l_pad) * jcp.src_ld;
+  int inp_shift = jcp.typesize_in * (jcp.ur_w * jcp.sw * jcp.src_ld);
   int acc_shift =
       jcp.typesize_acc * (jcp.ur_w * jcp.oc_block * jcp.nb_oc_blocking);
   int out_shift = 0, out1x1_shift = 0, acc1x1_shift = 0;
   if (jcp.fuse_conv1x1) {
     // here is for shifting ur_w
-    out1x1_shift = jcp.typesize_out * (jcp.ur_w * jcp.oc1x1);
+    out1x1_shift = jcp.typesize_out * (jcp.ur_w * jcp.dst_ld);
     // acc1x1 format is oc/16, ow, 16
     acc1x1_shift = jcp.typesize_acc * (jcp.ur_w * jcp.oc1x1_block);
   } else {
-    out_shift = jcp.typesize_out * (jcp.ur_w * jcp.oc * jcp.gp);
+    out_shift = jcp.typesize_out * (jcp.ur_w * jcp.dst_ld);
   }
 
   preamble();
@@ -428,6 +487,9 @@ void jit_conv_kernel::generate() {
     mov(_t, 0x1);
     vpbroadcastw(zmm_one, _t);
   }
+  if (jcp.fuse_global_pool) {
+    mov(reg_ptr_sum, ptr[param1 + GET_OFF(sum)]);
+  }
 
   mov(reg_inp, ptr[param1 + GET_OFF(src)]);
   if (jcp.fuse_conv1x1) {
@@ -531,7 +593,12 @@ bool jit_conv_kernel::init_conf(jit_conv_conf_t &jcp,
                                 bool conv0_relu,
                                 bool conv1_relu,
                                 round_mode conv0_round_mode,
-                                round_mode conv1_round_mode) {
+                                round_mode conv1_round_mode,
+                                std::array<int, 2> sz_pool_kernel,
+                                std::array<int, 2> sz_pool_stride,
+                                std::array<int, 2> sz_pool_padding,
+                                bool global_avg_pool,
+                                int shuffle_groups) {
   using namespace util;
   jcp = zero<decltype(jcp)>();
   // Check data type
@@ -584,10 +651,40 @@ bool jit_conv_kernel::init_conf(jit_conv_conf_t &jcp,
   jcp.ow = dst_dims[3];
   jcp.kh = wei_dims[2];
   jcp.kw = wei_dims[3];
+  jcp.src_ld = src->ld();  // larger than ic * gp when src is a view
   jcp.sh = sz_stride[0];
   jcp.sw = sz_stride[1];
   jcp.t_pad = sz_padding[0];
   jcp.l_pad = sz_padding[1];
+  jcp.fuse_pool = sz_pool_kernel[0] > 0 && sz_pool_kernel[1] > 0;
+  if (jcp.fuse_pool) {
+    // dst is the pooled output, conv output size comes from src
+    jcp.pool_oh = dst_dims[2];
+    jcp.pool_ow = dst_dims[3];
+    jcp.pool_kh = sz_pool_kernel[0];
+    jcp.pool_kw = sz_pool_kernel[1];
+    jcp.pool_sh = sz_pool_stride[0];
+    jcp.pool_sw = sz_pool_stride[1];
+    jcp.pool_t_pad = sz_pool_padding[0];
+    jcp.pool_l_pad = sz_pool_padding[1];
+    jcp.oh = conv_output_size(jcp.ih, jcp.kh, jcp.sh, jcp.t_pad);
+    jcp.ow = conv_output_size(jcp.iw, jcp.kw, jcp.sw, jcp.l_pad);
+    if (wei1x1 != nullptr) {
+      return false;
+    }
+  }
+  jcp.fuse_global_pool = global_avg_pool;
+  if (jcp.fuse_global_pool) {
+    // dst is n x c, conv output size comes from src
+    if (!all_true(wei1x1 == nullptr,
+                  !jcp.fuse_pool,
+                  dst_dims[2] == 1,
+                  dst_dims[3] == 1)) {
+      return false;
+    }
+    jcp.oh = conv_output_size(jcp.ih, jcp.kh, jcp.sh, jcp.t_pad);
+    jcp.ow = conv_output_size(jcp.iw, jcp.kw, jcp.sw, jcp.l_pad);
+  }
   jcp.ic_block = 16;
   jcp.oc_block = 16;
   jcp.nb_ic = jcp.ic / jcp.ic_block;
@@ -665,14 +762,42 @@ bool jit_conv_kernel::init_conf(jit_conv_conf_t &jcp,
   if (jcp.nb_oc % jcp.nb_oc_blocking != 0) {
     jcp.nb_oc_blocking = find_dividable(jcp.nb_oc, jcp.nb_oc_blocking);
   }
+  // when fuse pool, the output is the rows buffer of one oc chunk
+  jcp.dst_ld =
+      jcp.fuse_pool ? jcp.oc_block * jcp.nb_oc_blocking : dst->ld();
 
   // the rest 1 size of ur_w is for src input zmm
   jcp.ur_w = ker_reg_base_idx / (jcp.nb_oc_blocking + 1);
   if (jcp.ow < jcp.ur_w) {
     jcp.ur_w = jcp.ow;
   }
+  if (jcp.fuse_global_pool) {
+    // zmm_out should not overlap with zmm_ubound
+    jcp.ur_w = std::min(jcp.ur_w, 25 / jcp.nb_oc_blocking);
+  }
   jcp.ur_w_tail = jcp.ow % jcp.ur_w;
 
+  jcp.shuffle_gp = shuffle_groups > 1 ? shuffle_groups : 0;
+  if (jcp.shuffle_gp > 0) {
+    // the oc blocks of one call must be in one group,
+    // then the dst of one oc block is 16 channels of stride shuffle_gp
+    const int oc_per_gp = jcp.oc / jcp.shuffle_gp;
+    if (!all_true(!jcp.fuse_conv1x1,
+                  !jcp.fuse_pool,
+                  !jcp.fuse_global_pool,
+                  jcp.oc % jcp.shuffle_gp == 0,
+                  oc_per_gp % jcp.oc_block == 0)) {
+      return false;
+    }
+    jcp.nb_oc_blocking =
+        find_dividable(oc_per_gp / jcp.oc_block, jcp.nb_oc_blocking);
+    jcp.ur_w = std::min(ker_reg_base_idx / (jcp.nb_oc_blocking + 1), jcp.ow);
+    jcp.ur_w_tail = jcp.ow % jcp.ur_w;
+    for (int i = 0; i < jcp.oc_block; ++i) {
+      jcp.shuffle_idx[i] = i * jcp.shuffle_gp;
+    }
+  }
+
   int r_pad_no_tail = std::max(
       0, (jcp.ow - jcp.ur_w_tail - 1) * jcp.sw + jcp.kw - jcp.iw - jcp.l_pad);
   if (jcp.l_pad > jcp.ur_w || r_pad_no_tail > jcp.ur_w) {
@@ -48,7 +48,12 @@ struct jit_conv_kernel : public jit_generator {
                         bool conv0_relu,
                         bool conv1_relu,
                         round_mode conv0_round_mode,
-                        round_mode conv1_round_mode);
+                        round_mode conv1_round_mode,
+                        std::array<int, 2> sz_pool_kernel,
+                        std::array<int, 2> sz_pool_stride,
+                        std::array<int, 2> sz_pool_padding,
+                        bool global_avg_pool,
+                        int shuffle_groups = 0);
 
   jit_conv_conf_t jcp;
   void (*jit_ker_)(jit_conv_call_s *);
@@ -102,6 +107,20 @@ private:
   zmm_t zmm_1x1_src_bcast_u8 = zmm_t(31);  // use use zero zmm
   zmm_t zmm_1x1_wei = zmm_t(30);           // use zmm_bcast zmm
 
+  // for global pooling, conv1x1 can not be fused at the same time
+  reg64_t reg_ptr_sum = r14;  // use reg_scratch_3x3, only used at beginning
+  reg32_t reg_tmp_32 = r15d;  // use reg_channel, only used in store_output
+  // zmm_out do not reach these in store_output, see init_conf,
+  // while zmm_inp can, so they are set in store_output
+  zmm_t zmm_sum = zmm_t(27);
+  zmm_t zmm_lbound = zmm_t(26);
+  zmm_t zmm_ubound = zmm_t(25);
+
+  // for channel shuffle, pooling can not be fused at the same time
+  reg64_t reg_ptr_shuffle = r15;  // use reg_channel, only used when store
+  zmm_t zmm_shuffle_idx = zmm_t(27);
+  Xbyak::Opmask k_shuffle = Xbyak::Opmask(1);
+
   zmm_t zmm_out(int i_ur, int i_oc) {
     int idx = i_ur + i_oc * jcp.ur_w;
     assert(idx < ker_reg_base_idx);
@@ -126,6 +145,7 @@ private:
   }
   bool maybe_relu(int position);
   void prepare_output(int ur_w);
+  void store_shuffled(int j, int k);
   void store_output(int ur_w);
   void compute_loop(int ur_w, int pad_l, int pad_r);
 
@@ -0,0 +1,208 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "jit_dw_kernel.h"
+#include "util_jitinfer.h"
+
+#define GET_OFF(field) offsetof(jit_dw_call_s, field)
+
+namespace jitinfer {
+namespace jit {
+
+using namespace Xbyak;
+
+void jit_dw_kernel::store_output(int ow_s, int ur) {
+  using data_type = memory::dtype;
+  if (jcp_.with_bias) {
+    switch (jcp_.bias_dt) {
+      case data_type::f32:
+      case data_type::s32:
+        vmovups(zmm_bias, ptr[reg_ptr_bia]);
+        break;
+      case data_type::s8:
+        vpmovsxbd(zmm_bias, ptr[reg_ptr_bia]);
+        break;
+      case data_type::u8:
+        vpmovzxbd(zmm_bias, ptr[reg_ptr_bia]);
+        break;
+      default:
+        assert(!"unsupported bias data type");
+    }
+    if (jcp_.bias_dt != data_type::f32) {
+      vcvtdq2ps(zmm_bias, zmm_bias);
+    }
+  }
+  for (int i = 0; i < ur; i++) {
+    Zmm zmm = zmm_out(i);
+    Xmm xmm = xmm_out(i);
+    vcvtdq2ps(zmm, zmm);
+    if (jcp_.with_bias) {
+      vaddps(zmm, zmm, zmm_bias);
+    }
+    vmulps(zmm, zmm, ptr[reg_ptr_scales]);
+    vmaxps(zmm, zmm_zero, zmm);
+    if (jcp_.dst_round_mode == round_mode::nearest) {
+      vcvtps2dq(zmm | T_rn_sae, zmm);
+    } else if (jcp_.dst_round_mode == round_mode::down) {
+      vcvtps2dq(zmm | T_rd_sae, zmm);
+    } else {
+      assert(!"unimplemented");
+    }
+    vpmovusdb(xmm, zmm);
+    vmovups(ptr[reg_ptr_dst + (ow_s + i) * jcp_.dst_ld], xmm);
+  }
+}
+
+void jit_dw_kernel::compute_block(int ow_s, int ur) {
+  for (int i = 0; i < ur; i++) {
+    Zmm zmm = zmm_out(i);
+    vpxord(zmm, zmm, zmm);
+  }
+
+  Label l_kh, l_skip;
+  mov(aux_reg_src, reg_ptr_src);
+  mov(aux_reg_wei, reg_ptr_wei);
+  mov(reg_kj, reg_kh);
+  cmp(reg_kj, 0);
+  je(l_skip, T_NEAR);
+  L(l_kh);
+  {
+    for (int ki = 0; ki < jcp_.kw; ki++) {
+      vmovups(zmm_wei, ptr[aux_reg_wei + ki * jcp_.c_block * sizeof(s32)]);
+      for (int i = 0; i < ur; i++) {
+        // the left and right padding is skipped at generating time
+        int iw = (ow_s + i) * jcp_.sw - jcp_.l_pad + ki;
+        if (iw < 0 || iw >= jcp_.iw) {
+          continue;
+        }
+        vpmovzxbd(zmm_src, ptr[aux_reg_src + iw * jcp_.src_ld]);
+        vpmaddwd(zmm_src, zmm_src, zmm_wei);
+        vpaddd(zmm_out(i), zmm_out(i), zmm_src);
+      }
+    }
+    add(aux_reg_src, jcp_.iw * jcp_.src_ld);
+    add(aux_reg_wei, jcp_.kw * jcp_.c_block * sizeof(s32));
+    dec(reg_kj);
+    cmp(reg_kj, 0);
+    jg(l_kh, T_NEAR);
+  }
+  L(l_skip);
+
+  store_output(ow_s, ur);
+}
+
+void jit_dw_kernel::generate() {
+  preamble();
+
+  mov(reg_ptr_src, ptr[param + GET_OFF(src)]);
+  mov(reg_ptr_wei, ptr[param + GET_OFF(wei)]);
+  mov(reg_ptr_dst, ptr[param + GET_OFF(dst)]);
+  mov(reg_ptr_bia, ptr[param + GET_OFF(bia)]);
+  mov(reg_ptr_scales, ptr[param + GET_OFF(scales)]);
+  mov(reg_kh, ptr[param + GET_OFF(kh_padding)]);
+  vpxord(zmm_zero, zmm_zero, zmm_zero);
+
+  Label l_c;
+  mov(reg_cb, jcp_.nb_c);
+  L(l_c);
+  {
+    for (int ow_s = 0; ow_s < jcp_.ow; ow_s += jcp_.ur_w) {
+      compute_block(ow_s, std::min(jcp_.ur_w, jcp_.ow - ow_s));
+    }
+    add(reg_ptr_src, jcp_.c_block);
+    add(reg_ptr_wei, jcp_.kh * jcp_.kw * jcp_.c_block * sizeof(s32));
+    add(reg_ptr_dst, jcp_.c_block);
+    if (jcp_.with_bias) {
+      add(reg_ptr_bia, jcp_.c_block * jcp_.typesize_bia);
+    }
+    if (jcp_.multi_c_scale) {
+      add(reg_ptr_scales, jcp_.c_block * sizeof(float));
+    }
+    dec(reg_cb);
+    cmp(reg_cb, 0);
+    jg(l_c, T_NEAR);
+  }
+
+  postamble();
+}
+
+bool jit_dw_kernel::init_conf(jit_dw_conf_t &jcp,
+                              const std::unique_ptr<memory> &src,
+                              const std::unique_ptr<memory> &wei,
+                              const std::unique_ptr<memory> &bia,
+                              std::array<int, 2> sz_stride,
+                              std::array<int, 2> sz_padding,
+                              const std::unique_ptr<memory> &dst,
+                              size_t scales_size,
+                              round_mode rmode) {
+  using namespace util;
+  jcp = zero<decltype(jcp)>();
+  if (!all_true(src->data_type() == memory::dtype::u8,
+                src->dim_format() == memory::format::nhwc,
+                wei->data_type() == memory::dtype::s8,
+                wei->dim_format() == memory::format::oihw,
+                dst->data_type() == memory::dtype::u8,
+                dst->dim_format() == memory::format::nhwc,
+                bia == nullptr || bia->dim_format() == memory::format::x)) {
+    return false;
+  }
+  if (!mayiuse(avx512_core)) {
+    return false;
+  }
+  auto src_dims = src->std_dims();  // nchw
+  auto wei_dims = wei->std_dims();  // oihw
+  auto dst_dims = dst->std_dims();  // nchw
+  jcp.bs = src_dims[0];
+  jcp.c = src_dims[1];
+  jcp.ih = src_dims[2];
+  jcp.iw = src_dims[3];
+  jcp.oh = dst_dims[2];
+  jcp.ow = dst_dims[3];
+  jcp.src_ld = src->ld();
+  jcp.dst_ld = dst->ld();
+  jcp.kh = wei_dims[2];
+  jcp.kw = wei_dims[3];
+  jcp.sh = sz_stride[0];
+  jcp.sw = sz_stride[1];
+  jcp.t_pad = sz_padding[0];
+  jcp.l_pad = sz_padding[1];
+  jcp.c_block = 16;
+  int oh = conv_output_size(jcp.ih, jcp.kh, jcp.sh, jcp.t_pad);
+  int ow = conv_output_size(jcp.iw, jcp.kw, jcp.sw, jcp.l_pad);
+  if (!all_true(jcp.c % jcp.c_block == 0,
+                wei_dims[0] == jcp.c,
+                wei_dims[1] == 1,
+                dst_dims[0] == jcp.bs,
+                dst_dims[1] == jcp.c,
+                bia == nullptr || bia->std_dims()[0] == jcp.c,
+                jcp.oh == oh,
+                jcp.ow == ow)) {
+    return false;
+  }
+  jcp.nb_c = jcp.c / jcp.c_block;
+  jcp.ur_w = std::min(jcp.ow, int(ker_reg_base_idx));
+
+  jcp.with_bias = bia != nullptr;
+  jcp.bias_dt = jcp.with_bias ? bia->data_type() : memory::dtype::undef;
+  jcp.typesize_bia = jcp.with_bias ? dtype_size(jcp.bias_dt) : 0;
+  jcp.dst_round_mode = rmode;
+  jcp.multi_c_scale = scales_size > 1;
+  if (!one_of(scales_size, 1, jcp.c)) {
+    return false;
+  }
+  return true;
+}
+}
+}
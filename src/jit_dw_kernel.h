@@ -0,0 +1,90 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#pragma once
+
+#include "jit_call_conf.h"
+#include "jit_generator.h"
+
+namespace jitinfer {
+
+namespace jit {
+
+// depthwise conv of u8 src and s8 wei, one output row of all channels,
+// the output is u8 with relu.
+// wei is packed as s32 of [c/16][kh][kw][16c], then vpmaddwd of zero
+// extended u8 src and s32 wei gives the exact product in each dword.
+struct jit_dw_kernel : public jit_generator {
+  DECLARE_JIT_KERNEL(jit_dw_kernel);
+
+  jit_dw_kernel(jit_dw_conf_t ajcp) : jcp_(ajcp) {
+    generate();
+    jit_ker_ = (void (*)(jit_dw_call_s *))getCode();
+  }
+
+  // wei is oihw of {c, 1, kh, kw}, dst is u8 nhwc of {n, c, oh, ow}
+  static bool init_conf(jit_dw_conf_t &jcp,
+                        const std::unique_ptr<memory> &src,
+                        const std::unique_ptr<memory> &wei,
+                        const std::unique_ptr<memory> &bia,
+                        std::array<int, 2> sz_stride,
+                        std::array<int, 2> sz_padding,
+                        const std::unique_ptr<memory> &dst,
+                        size_t scales_size,
+                        round_mode rmode);
+
+  jit_dw_conf_t jcp_;
+  void (*jit_ker_)(jit_dw_call_s *);
+
+private:
+  enum {
+    ker_reg_base_idx = 28,
+  };
+  using reg64_t = const Xbyak::Reg64;
+  using zmm_t = const Xbyak::Zmm;
+  using xmm_t = const Xbyak::Xmm;
+
+  reg64_t param = abi_param1;
+  reg64_t reg_ptr_src = r8;
+  reg64_t reg_ptr_wei = r9;
+  reg64_t reg_ptr_dst = r10;
+  reg64_t reg_ptr_bia = r11;
+  reg64_t reg_ptr_scales = r12;
+  reg64_t aux_reg_src = r13;
+  reg64_t aux_reg_wei = r14;
+  reg64_t reg_kj = r15;
+  reg64_t reg_kh = rax;
+  reg64_t reg_cb = rdx;
+
+  zmm_t zmm_bias = zmm_t(28);
+  zmm_t zmm_src = zmm_t(29);
+  zmm_t zmm_wei = zmm_t(30);
+  zmm_t zmm_zero = zmm_t(31);
+
+  zmm_t zmm_out(int i_ur) {
+    assert(i_ur < ker_reg_base_idx);
+    return zmm_t(i_ur);
+  }
+  xmm_t xmm_out(int i_ur) {
+    assert(i_ur < ker_reg_base_idx);
+    return xmm_t(i_ur);
+  }
+
+  void store_output(int ow_s, int ur);
+  void compute_block(int ow_s, int ur);
+  void generate();
+};
+}
+}
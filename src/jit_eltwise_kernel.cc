@@ -0,0 +1,193 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "jit_eltwise_kernel.h"
+#include <cmath>
+#include "util_jitinfer.h"
+
+#define GET_OFF(field) offsetof(jit_eltwise_call_s, field)
+
+namespace jitinfer {
+namespace jit {
+
+using namespace Xbyak;
+
+void jit_eltwise_kernel::broadcast_bound(zmm_t zmm, float bound, bool lower) {
+  using data_type = memory::dtype;
+  uint32_t bits = 0;
+  if (jcp_.dt == data_type::f32) {
+    memcpy(&bits, &bound, sizeof(bits));
+  } else {
+    // integer x >= bound equals x >= ceil(bound)
+    double v = lower ? std::ceil(bound) : std::floor(bound);
+    switch (jcp_.dt) {
+      case data_type::s32:
+        v = std::min(std::max(v, double(INT32_MIN)), double(INT32_MAX));
+        bits = uint32_t(int32_t(v));
+        break;
+      case data_type::s8:
+        v = std::min(std::max(v, -128.), 127.);
+        // repeat the byte in 4 lanes, unsigned to not overflow
+        bits = uint32_t(uint8_t(int8_t(v))) * 0x01010101u;
+        break;
+      case data_type::u8:
+        v = std::min(std::max(v, 0.), 255.);
+        bits = uint32_t(uint8_t(v)) * 0x01010101u;
+        break;
+      default:
+        assert(!"unsupported data type");
+    }
+  }
+  mov(reg_tmp32, bits);
+  vpbroadcastd(zmm, reg_tmp32);
+}
+
+void jit_eltwise_kernel::compute() {
+  using data_type = memory::dtype;
+  Xmm lbound = vreg(zmm_lbound.getIdx());
+  Xmm ubound = vreg(zmm_ubound.getIdx());
+  for (int i = 0; i < jcp_.nb_c_blocking; ++i) {
+    Xmm v = vreg(i);
+    int offset = jcp_.typesize * i * jcp_.c_block;
+    vmovups(v, EVEX_compress_addr(aux_reg_src, offset));
+    switch (jcp_.dt) {
+      case data_type::f32:
+        vmaxps(v, v, lbound);
+        if (jcp_.kind == eltwise_clip) {
+          vminps(v, v, ubound);
+        }
+        break;
+      case data_type::s32:
+        vpmaxsd(v, v, lbound);
+        if (jcp_.kind == eltwise_clip) {
+          vpminsd(v, v, ubound);
+        }
+        break;
+      case data_type::s8:
+        vpmaxsb(v, v, lbound);
+        if (jcp_.kind == eltwise_clip) {
+          vpminsb(v, v, ubound);
+        }
+        break;
+      case data_type::u8:
+        // relu of u8 is only a copy
+        if (jcp_.kind == eltwise_clip) {
+          vpmaxub(v, v, lbound);
+          vpminub(v, v, ubound);
+        }
+        break;
+      default:
+        assert(!"unsupported data type");
+    }
+    vmovups(EVEX_compress_addr(aux_reg_dst, offset), v);
+  }
+}
+
+void jit_eltwise_kernel::generate() {
+  const int shift_c = jcp_.typesize * jcp_.c_block * jcp_.nb_c_blocking;
+  preamble();
+
+  mov(reg_ptr_src, ptr[param + GET_OFF(src)]);
+  mov(reg_ptr_dst, ptr[param + GET_OFF(dst)]);
+  mov(reg_work, ptr[param + GET_OFF(work)]);
+
+  if (jcp_.kind == eltwise_relu) {
+    vpxord(zmm_lbound, zmm_lbound, zmm_lbound);
+  } else {
+    broadcast_bound(zmm_lbound, jcp_.alpha, true);
+    broadcast_bound(zmm_ubound, jcp_.beta, false);
+  }
+
+  Label l_pixel, l_chunk, l_ret;
+  cmp(reg_work, 0);
+  jle(l_ret, T_NEAR);
+  L(l_pixel);
+  {
+    mov(aux_reg_src, reg_ptr_src);
+    mov(aux_reg_dst, reg_ptr_dst);
+    mov(reg_nb, jcp_.nb_c / jcp_.nb_c_blocking);
+    L(l_chunk);
+    {
+      compute();
+      add(aux_reg_src, shift_c);
+      add(aux_reg_dst, shift_c);
+      dec(reg_nb);
+      cmp(reg_nb, 0);
+      jg(l_chunk, T_NEAR);
+    }
+    add(reg_ptr_src, jcp_.typesize * jcp_.src_ld);
+    add(reg_ptr_dst, jcp_.typesize * jcp_.dst_ld);
+    dec(reg_work);
+    cmp(reg_work, 0);
+    jg(l_pixel, T_NEAR);
+  }
+  L(l_ret);
+
+  postamble();
+}
+
+bool jit_eltwise_kernel::init_conf(jit_eltwise_conf_t& jcp,
+                                   const std::unique_ptr<memory>& src,
+                                   const std::unique_ptr<memory>& dst,
+                                   eltwise_kind kind,
+                                   float alpha,
+                                   float beta) {
+  using namespace util;
+  jcp = zero<decltype(jcp)>();
+  if (!all_true(one_of(src->dim_format(), memory::format::nhwc),
+                one_of(dst->dim_format(), memory::format::nhwc),
+                src->data_type() == dst->data_type(),
+                src->std_dims() == dst->std_dims(),
+                one_of(kind, eltwise_relu, eltwise_clip))) {
+    return false;
+  }
+  if (!mayiuse(avx512_core)) {
+    return false;
+  }
+  if (kind == eltwise_clip && alpha > beta) {
+    return false;
+  }
+
+  auto dims = src->std_dims();  // nchw
+  jcp.bs = dims[0];
+  jcp.c = dims[1];
+  jcp.h = dims[2];
+  jcp.w = dims[3];
+  jcp.src_ld = src->ld();
+  jcp.dst_ld = dst->ld();
+  jcp.kind = kind;
+  jcp.alpha = alpha;
+  jcp.beta = beta;
+  jcp.dt = src->data_type();
+  jcp.typesize = dtype_size(jcp.dt);
+  if (!one_of(jcp.typesize, 1, 4)) {
+    return false;
+  }
+  if (jcp.c % 16 != 0) {
+    return false;
+  }
+
+  // 1byte works on 64x, 32x or 16x channels
+  jcp.c_block = jcp.typesize == 1 ? dividable_of(jcp.c, 64, 32, 16) : 16;
+  jcp.nb_c = jcp.c / jcp.c_block;
+  jcp.nb_c_blocking = dividable_of(jcp.nb_c, 8, 4, 2, 1);
+  jcp.bits_size = 8 * jcp.typesize * jcp.c_block;
+  if (!one_of(jcp.bits_size, USE_XMM, USE_YMM, USE_ZMM)) {
+    return false;
+  }
+  return true;
+}
+}
+}
@@ -0,0 +1,82 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#pragma once
+
+#include "jit_call_conf.h"
+#include "jit_generator.h"
+
+namespace jitinfer {
+
+namespace jit {
+
+struct jit_eltwise_kernel : public jit_generator {
+  DECLARE_JIT_KERNEL(jit_eltwise_kernel);
+
+  jit_eltwise_kernel(jit_eltwise_conf_t ajcp) : jcp_(ajcp) {
+    generate();
+    jit_ker_ = (void (*)(jit_eltwise_call_s*))getCode();
+  }
+
+  static bool init_conf(jit_eltwise_conf_t& jcp,
+                        const std::unique_ptr<memory>& src,
+                        const std::unique_ptr<memory>& dst,
+                        eltwise_kind kind,
+                        float alpha,
+                        float beta);
+
+  jit_eltwise_conf_t jcp_;
+  void (*jit_ker_)(jit_eltwise_call_s*);
+
+private:
+  enum {
+    USE_ZMM = 512,
+    USE_YMM = 256,
+    USE_XMM = 128,
+  };
+  using reg64_t = const Xbyak::Reg64;
+  using reg32_t = const Xbyak::Reg32;
+  using zmm_t = const Xbyak::Zmm;
+  using xmm_t = const Xbyak::Xmm;
+
+  reg64_t param = abi_param1;
+  reg64_t reg_ptr_src = r8;
+  reg64_t reg_ptr_dst = r9;
+  reg64_t reg_work = r10;
+  reg64_t aux_reg_src = r11;
+  reg64_t aux_reg_dst = r12;
+  reg64_t reg_nb = r13;
+  reg32_t reg_tmp32 = r14d;
+
+  zmm_t zmm_lbound = zmm_t(30);  // zero when relu
+  zmm_t zmm_ubound = zmm_t(31);
+
+  xmm_t vreg(int idx) {
+    switch (jcp_.bits_size) {
+      case USE_ZMM:
+        return Xbyak::Zmm(idx);
+      case USE_YMM:
+        return Xbyak::Ymm(idx);
+      default:
+        return Xbyak::Xmm(idx);
+    }
+  }
+
+  void broadcast_bound(zmm_t zmm, float bound, bool lower);
+  void compute();
+  void generate();
+};
+}
+}
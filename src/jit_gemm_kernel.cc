@@ -0,0 +1,370 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "jit_gemm_kernel.h"
+#include "util_jitinfer.h"
+
+#define GET_OFF(field) offsetof(jit_gemm_call_s, field)
+
+namespace jitinfer {
+namespace jit {
+
+using namespace Xbyak;
+
+void jit_gemm_kernel::store_output(int ur) {
+  using data_type = memory::dtype;
+  if (jcp_.with_sum && jcp_.sum_scale != 1.f) {
+    mov(reg_tmp, (size_t)&jcp_.sum_scale);
+  }
+  for (int j = 0; j < jcp_.nb_n_blocking; j++) {
+    int scale_offset =
+        jcp_.multi_n_scale ? sizeof(float) * j * jcp_.n_block : 0;
+    auto zmm_bias = zmm_tmp;
+    if (jcp_.with_bias) {
+      int bias_offset = jcp_.typesize_bia * j * jcp_.n_block;
+      auto bias_addr = EVEX_compress_addr(reg_ptr_bia, bias_offset);
+      switch (jcp_.bias_dt) {
+        case data_type::f32:
+        case data_type::s32:
+          vmovups(zmm_bias, bias_addr);
+          break;
+        case data_type::s8:
+          vpmovsxbd(zmm_bias, bias_addr);
+          break;
+        case data_type::u8:
+          vpmovzxbd(zmm_bias, bias_addr);
+          break;
+        default:
+          assert(!"unsupported bias data type");
+      }
+      if (jcp_.bias_dt != data_type::f32) {
+        vcvtdq2ps(zmm_bias, zmm_bias);
+      }
+    }
+    for (int i = 0; i < ur; i++) {
+      Zmm zmm = zmm_out(i, j, ur);
+      Xmm xmm = xmm_out(i, j, ur);
+      vcvtdq2ps(zmm, zmm);
+      if (jcp_.with_bias) {
+        vaddps(zmm, zmm, zmm_bias);
+      }
+      vmulps(zmm, zmm, EVEX_compress_addr(reg_ptr_scales, scale_offset));
+      if (jcp_.with_sum) {
+        int sum_offset =
+            jcp_.typesize_sum * (i * jcp_.ld_sum + j * jcp_.n_block);
+        auto sum_addr = EVEX_compress_addr(reg_ptr_sum, sum_offset);
+        switch (jcp_.sum_dt) {
+          case data_type::f32:
+          case data_type::s32:
+            vmovups(zmm_sum, sum_addr);
+            break;
+          case data_type::s8:
+            vpmovsxbd(zmm_sum, sum_addr);
+            break;
+          case data_type::u8:
+            vpmovzxbd(zmm_sum, sum_addr);
+            break;
+          default:
+            assert(!"unsupported sum data type");
+        }
+        if (jcp_.sum_dt != data_type::f32) {
+          vcvtdq2ps(zmm_sum, zmm_sum);
+        }
+        if (jcp_.sum_scale == 1.f) {
+          vaddps(zmm, zmm, zmm_sum);
+        } else {
+          vfmadd231ps(zmm, zmm_sum, zword_b[reg_tmp]);
+        }
+      }
+      if (jcp_.with_relu || jcp_.dst_dt == data_type::u8) {
+        vmaxps(zmm, zmm_zero, zmm);
+      }
+      if (jcp_.dst_dt != data_type::f32) {
+        if (jcp_.dst_round_mode == round_mode::nearest) {
+          vcvtps2dq(zmm | T_rn_sae, zmm);
+        } else if (jcp_.dst_round_mode == round_mode::down) {
+          vcvtps2dq(zmm | T_rd_sae, zmm);
+        } else {
+          assert(!"unimplemented");
+        }
+      }
+      int offset = jcp_.typesize_out * (i * jcp_.ldc + j * jcp_.n_block);
+      auto addr = EVEX_compress_addr(reg_ptr_c, offset);
+      switch (jcp_.dst_dt) {
+        case data_type::f32:
+        case data_type::s32:
+          vmovups(addr, zmm);
+          break;
+        case data_type::s8:
+          vpmovsdb(xmm, zmm);
+          vmovups(addr, xmm);
+          break;
+        case data_type::u8:
+          vpmovusdb(xmm, zmm);
+          vmovups(addr, xmm);
+          break;
+        default:
+          assert(!"unknown dst_dt");
+      }
+    }
+  }
+}
+
+// one k block of ur rows from aux_reg_a with lda
+void jit_gemm_kernel::compute_k(int ur, int lda) {
+  // one n block of B is [k/4][16n][4k]
+  const int b_n_stride = jcp_.k * jcp_.n_block;
+  for (int k4 = 0; k4 < jcp_.k_block / 4; k4++) {
+    for (int i = 0; i < ur; i++) {
+      vpbroadcastd(zmm_a(i, ur), ptr[aux_reg_a + i * lda + 4 * k4]);
+    }
+    for (int j = 0; j < jcp_.nb_n_blocking; j++) {
+      int offset = j * b_n_stride + 4 * k4 * jcp_.n_block;
+      vmovups(zmm_b, EVEX_compress_addr(aux_reg_b, offset));
+      for (int i = 0; i < ur; i++) {
+        dot_u8s8s32(zmm_out(i, j, ur),
+                    zmm_a(i, ur),
+                    zmm_b,
+                    zmm_tmp,
+                    zmm_one,
+                    jcp_.use_vnni);
+      }
+    }
+  }
+}
+
+void jit_gemm_kernel::compute_loop(int ur) {
+  const int b_k_shift = jcp_.k_block * jcp_.n_block;
+
+  for (int j = 0; j < jcp_.nb_n_blocking; j++) {
+    for (int i = 0; i < ur; i++) {
+      Zmm zmm = zmm_out(i, j, ur);
+      vpxord(zmm, zmm, zmm);
+    }
+  }
+
+  mov(aux_reg_b, reg_ptr_b);
+  // B is concatenated on k as well, so it goes on through all srcs
+  const int nb_srcs = jcp_.nb_srcs > 1 ? jcp_.nb_srcs : 1;
+  for (int s = 0; s < nb_srcs; s++) {
+    int lda = jcp_.nb_srcs > 1 ? jcp_.srcs_lda[s] : jcp_.lda;
+    int nb_k = jcp_.nb_srcs > 1 ? jcp_.srcs_k[s] / jcp_.k_block : jcp_.nb_k;
+    if (jcp_.nb_srcs > 1) {
+      mov(aux_reg_a, ptr[reg_ptr_srcs + s * sizeof(void *)]);
+      imul(reg_tmp, reg_rows, lda);
+      add(aux_reg_a, reg_tmp);
+    } else {
+      mov(aux_reg_a, reg_ptr_a);
+    }
+
+    Label l_k;
+    mov(reg_kb, nb_k);
+    L(l_k);
+    {
+      compute_k(ur, lda);
+      add(aux_reg_a, jcp_.k_block);
+      add(aux_reg_b, b_k_shift);
+      dec(reg_kb);
+      cmp(reg_kb, 0);
+      jg(l_k, T_NEAR);
+    }
+  }
+
+  store_output(ur);
+}
+
+void jit_gemm_kernel::generate() {
+  preamble();
+
+  if (!jcp_.use_vnni) {
+    xor_(reg_tmp, reg_tmp);
+    Reg16 _t = reg_tmp.cvt16();
+    mov(_t, 0x1);
+    vpbroadcastw(zmm_one, _t);
+  }
+  vpxord(zmm_zero, zmm_zero, zmm_zero);
+
+  mov(reg_ptr_a, ptr[param + GET_OFF(a)]);
+  mov(reg_ptr_b, ptr[param + GET_OFF(b)]);
+  mov(reg_ptr_c, ptr[param + GET_OFF(c)]);
+  mov(reg_ptr_bia, ptr[param + GET_OFF(bia)]);
+  mov(reg_ptr_scales, ptr[param + GET_OFF(scales)]);
+  mov(reg_m, ptr[param + GET_OFF(m)]);
+  if (jcp_.with_sum) {
+    mov(reg_ptr_sum, ptr[param + GET_OFF(sum)]);
+  }
+  if (jcp_.nb_srcs > 1) {
+    mov(reg_ptr_srcs, ptr[param + GET_OFF(srcs)]);
+    xor_(reg_rows, reg_rows);
+  }
+
+  Label l_m, l_tail, l_ret;
+  cmp(reg_m, jcp_.ur_m);
+  jl(l_tail, T_NEAR);
+  L(l_m);
+  {
+    compute_loop(jcp_.ur_m);
+    if (jcp_.nb_srcs > 1) {
+      add(reg_rows, jcp_.ur_m);
+    } else {
+      add(reg_ptr_a, jcp_.ur_m * jcp_.lda);
+    }
+    add(reg_ptr_c, jcp_.typesize_out * jcp_.ur_m * jcp_.ldc);
+    if (jcp_.with_sum) {
+      add(reg_ptr_sum, jcp_.typesize_sum * jcp_.ur_m * jcp_.ld_sum);
+    }
+    sub(reg_m, jcp_.ur_m);
+    cmp(reg_m, jcp_.ur_m);
+    jge(l_m, T_NEAR);
+  }
+  L(l_tail);
+  if (jcp_.ur_m_tail > 0) {
+    cmp(reg_m, 0);
+    jle(l_ret, T_NEAR);
+    compute_loop(jcp_.ur_m_tail);
+  }
+  L(l_ret);
+
+  postamble();
+}
+
+bool jit_gemm_kernel::init_conf(jit_gemm_conf_t &jcp,
+                                int m,
+                                int n,
+                                int k,
+                                int lda,
+                                int ldc,
+                                memory::dtype dst_dt,
+                                memory::dtype bias_dt,
+                                size_t scales_size,
+                                bool post_relu,
+                                round_mode rmode,
+                                int nthreads,
+                                memory::dtype sum_dt,
+                                int ld_sum,
+                                float sum_scale,
+                                int n_group) {
+  using namespace util;
+  jcp = zero<decltype(jcp)>();
+  if (!all_true(one_of(dst_dt,
+                       memory::dtype::f32,
+                       memory::dtype::s32,
+                       memory::dtype::s8,
+                       memory::dtype::u8),
+                one_of(bias_dt,
+                       memory::dtype::undef,
+                       memory::dtype::f32,
+                       memory::dtype::s32,
+                       memory::dtype::s8,
+                       memory::dtype::u8),
+                one_of(sum_dt,
+                       memory::dtype::undef,
+                       memory::dtype::f32,
+                       memory::dtype::s32,
+                       memory::dtype::s8,
+                       memory::dtype::u8))) {
+    return false;
+  }
+  if (!mayiuse(avx512_core)) {
+    return false;
+  }
+  jcp.m = m;
+  jcp.n = n;
+  jcp.k = k;
+  jcp.lda = lda;
+  jcp.ldc = ldc;
+  jcp.n_block = 16;
+  jcp.k_block = 16;
+  if (n_group <= 0) {
+    n_group = n;
+  }
+  if (!all_true(m > 0,
+                n % jcp.n_block == 0,
+                k % jcp.k_block == 0,
+                n_group % jcp.n_block == 0,
+                n % n_group == 0,
+                lda >= k,
+                ldc >= n_group)) {
+    return false;
+  }
+  jcp.nb_n = n / jcp.n_block;
+  jcp.nb_k = k / jcp.k_block;
+  jcp.use_vnni = mayiuse(avx512_core_vnni);
+
+  jcp.with_bias = bias_dt != memory::dtype::undef;
+  jcp.bias_dt = bias_dt;
+  jcp.dst_dt = dst_dt;
+  jcp.typesize_out = dtype_size(dst_dt);
+  jcp.typesize_bia = jcp.with_bias ? dtype_size(bias_dt) : 0;
+  jcp.with_sum = sum_dt != memory::dtype::undef;
+  jcp.sum_dt = sum_dt;
+  jcp.typesize_sum = jcp.with_sum ? dtype_size(sum_dt) : 0;
+  jcp.ld_sum = ld_sum;
+  jcp.sum_scale = sum_scale;
+  if (jcp.with_sum && ld_sum < n) {
+    return false;
+  }
+  jcp.with_relu = post_relu;
+  jcp.dst_round_mode = rmode;
+  assert(one_of(jcp.dst_round_mode, round_mode::nearest, round_mode::down));
+  jcp.multi_n_scale = scales_size > 1;
+  if (!one_of(scales_size, 1, n)) {
+    return false;
+  }
+
+  // the rest 1 size of ur_m is for A input zmm
+  auto ur_of = [&](int nb_n_blocking) {
+    return std::min(m, ker_reg_base_idx / (nb_n_blocking + 1));
+  };
+  auto chunks_of = [&](int nb_n_blocking) {
+    return div_up(m, ur_of(nb_n_blocking)) * (jcp.nb_n / nb_n_blocking);
+  };
+  // small m, such as batch 1 of inner product, is split over n,
+  // so reduce the n blocking until every thread has some work
+  const int nb_n_group = n_group / jcp.n_block;
+  jcp.nb_n_blocking = dividable_of(nb_n_group, 4, 2, 1);
+  while (jcp.nb_n_blocking > 1 && chunks_of(jcp.nb_n_blocking) < nthreads) {
+    jcp.nb_n_blocking = find_dividable(nb_n_group, jcp.nb_n_blocking - 1);
+  }
+  jcp.ur_m = ur_of(jcp.nb_n_blocking);
+  jcp.ur_m_tail = m % jcp.ur_m;
+
+  return true;
+}
+
+bool jit_gemm_kernel::init_srcs(jit_gemm_conf_t &jcp,
+                                const std::vector<int> &srcs_k,
+                                const std::vector<int> &srcs_lda) {
+  using namespace util;
+  const int nb_srcs = srcs_k.size();
+  if (!all_true(nb_srcs > 0,
+                nb_srcs <= max_gemm_srcs,
+                srcs_lda.size() == srcs_k.size())) {
+    return false;
+  }
+  int k = 0;
+  for (int s = 0; s < nb_srcs; s++) {
+    if (!all_true(srcs_k[s] % jcp.k_block == 0, srcs_lda[s] >= srcs_k[s])) {
+      return false;
+    }
+    jcp.srcs_k[s] = srcs_k[s];
+    jcp.srcs_lda[s] = srcs_lda[s];
+    k += srcs_k[s];
+  }
+  jcp.nb_srcs = nb_srcs;
+  return k == jcp.k;
+}
+}
+}
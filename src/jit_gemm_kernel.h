@@ -0,0 +1,117 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#pragma once
+
+#include "jit_call_conf.h"
+#include "jit_generator.h"
+
+namespace jitinfer {
+
+namespace jit {
+
+// u8 x s8 -> s32 GEMM micro-kernel with the same epilogue as conv:
+// bias, scales, sum, relu, round and convert to dst data type
+struct jit_gemm_kernel : public jit_generator {
+  DECLARE_JIT_KERNEL(jit_gemm_kernel);
+
+  jit_gemm_kernel(jit_gemm_conf_t ajcp)
+      : jit_generator(nullptr, ajcp.nb_srcs > 1 ? 1024 * 1024 : 256 * 1024),
+        jcp_(ajcp) {
+    generate();
+    jit_ker_ = (void (*)(jit_gemm_call_s *))getCode();
+  }
+
+  // bias_dt is undef when without bias, sum_dt is undef when without sum
+  // when n_group > 0, each n chunk of one call stays in one group of n_group,
+  // then ldc only needs to cover one group
+  static bool init_conf(jit_gemm_conf_t &jcp,
+                        int m,
+                        int n,
+                        int k,
+                        int lda,
+                        int ldc,
+                        memory::dtype dst_dt,
+                        memory::dtype bias_dt,
+                        size_t scales_size,
+                        bool post_relu,
+                        round_mode rmode,
+                        int nthreads,
+                        memory::dtype sum_dt = memory::dtype::undef,
+                        int ld_sum = 0,
+                        float sum_scale = 1.f,
+                        int n_group = 0);
+  // A is concatenated on k from srcs of srcs_k and srcs_lda,
+  // called after init_conf, then srcs is used instead of a in call
+  static bool init_srcs(jit_gemm_conf_t &jcp,
+                        const std::vector<int> &srcs_k,
+                        const std::vector<int> &srcs_lda);
+
+  jit_gemm_conf_t jcp_;
+  void (*jit_ker_)(jit_gemm_call_s *);
+
+private:
+  enum {
+    ker_reg_base_idx = 28,
+  };
+  using reg64_t = const Xbyak::Reg64;
+  using zmm_t = const Xbyak::Zmm;
+  using xmm_t = const Xbyak::Xmm;
+
+  reg64_t param = abi_param1;
+  reg64_t reg_ptr_a = r8;
+  reg64_t reg_ptr_b = r9;
+  reg64_t reg_ptr_c = r10;
+  reg64_t aux_reg_a = r11;
+  reg64_t aux_reg_b = r12;
+  reg64_t reg_kb = r13;
+  reg64_t reg_m = r14;
+  reg64_t reg_ptr_bia = r15;
+  reg64_t reg_ptr_scales = rax;
+  reg64_t reg_tmp = rdx;
+  reg64_t reg_ptr_sum = rbx;
+  reg64_t reg_ptr_srcs = rsi;
+  reg64_t reg_rows = abi_not_param1;  // rows done in this call, of srcs
+
+  zmm_t zmm_tmp = zmm_t(28);
+  zmm_t zmm_one = zmm_t(29);
+  zmm_t zmm_zero = zmm_t(30);
+  zmm_t zmm_b = zmm_t(31);
+  zmm_t zmm_sum = zmm_b;  // B is not used in store output
+
+  zmm_t zmm_out(int i_ur, int i_n, int ur) {
+    int idx = i_ur + i_n * ur;
+    assert(idx < ker_reg_base_idx);
+    return zmm_t(idx);
+  }
+  xmm_t xmm_out(int i_ur, int i_n, int ur) {
+    int idx = i_ur + i_n * ur;
+    assert(idx < ker_reg_base_idx);
+    return xmm_t(idx);
+  }
+  // the broadcasted 4 u8 of i-th row of A
+  zmm_t zmm_a(int i_ur, int ur) {
+    int idx = i_ur + jcp_.nb_n_blocking * ur;
+    assert(idx < ker_reg_base_idx);
+    return zmm_t(idx);
+  }
+
+  void store_output(int ur);
+  void compute_k(int ur, int lda);
+  void compute_loop(int ur);
+  void generate();
+};
+}
+}
@@ -32,6 +32,11 @@
 *******************************************************************************/
 #pragma once
 
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <type_traits>
 
 #define XBYAK64
@@ -46,6 +51,7 @@
  * FIXME: replace size_t parameters with the appropriate ones */
 #pragma warning(disable : 4267)
 #endif
+#include "thread_pool.h"
 #include "util_jitinfer.h"
 #include "xbyak/xbyak.h"
 #include "xbyak/xbyak_util.h"
@@ -136,7 +142,7 @@ inline unsigned int get_cache_size(int level, bool per_core = true) {
     const int L1_cache_per_core = 32000;
     const int L2_cache_per_core = 512000;
     const int L3_cache_per_core = 1024000;
-    int num_cores = per_core ? 1 : omp_get_max_threads();
+    int num_cores = per_core ? 1 : get_max_threads();
     switch (l) {
       case (0):
         return L1_cache_per_core * num_cores;
@@ -267,6 +273,23 @@ public:
       return zword[re];
   }
 
+  // acc(s32) += sum of 4 adjacent src(u8) * wei(s8)
+  // without VNNI, tmp is clobbered and one should be s16 ones
+  void dot_u8s8s32(const Xbyak::Zmm &acc,
+                   const Xbyak::Zmm &src,
+                   const Xbyak::Zmm &wei,
+                   const Xbyak::Zmm &tmp,
+                   const Xbyak::Zmm &one,
+                   bool use_vnni) {
+    if (use_vnni) {
+      vpdpbusd(acc, src, wei);
+    } else {
+      vpmaddubsw(tmp, src, wei);
+      vpmaddwd(tmp, tmp, one);
+      vpaddd(acc, acc, tmp);
+    }
+  }
+
   void L(const char *label) { Xbyak::CodeGenerator::L(label); }
   void L(const Xbyak::Label &label) { Xbyak::CodeGenerator::L(label); }
 
@@ -314,5 +337,29 @@ public:
     return (const F)getCode();
   }
 };
+
+// the code of a kernel only depends on its conf and is read only once
+// generated, so the ops of the same conf, such as the ops of a network in
+// each stream, share one kernel instead of generating the code again
+template <typename kernel_t, typename conf_t>
+std::shared_ptr<kernel_t> get_kernel(const conf_t &conf) {
+  static std::mutex mu;
+  static std::map<std::string, std::weak_ptr<kernel_t>> kernels;
+  std::string key(reinterpret_cast<const char *>(&conf), sizeof(conf));
+  std::lock_guard<std::mutex> lock(mu);
+  auto it = kernels.find(key);
+  auto kernel = it != kernels.end() ? it->second.lock() : nullptr;
+  if (kernel) {
+    return kernel;
+  }
+  // the kernels of released ops are dropped before a new one is added,
+  // so only the live kernels are kept
+  for (auto i = kernels.begin(); i != kernels.end();) {
+    i = i->second.expired() ? kernels.erase(i) : std::next(i);
+  }
+  kernel = std::make_shared<kernel_t>(conf);
+  kernels[key] = kernel;
+  return kernel;
+}
 }
 }
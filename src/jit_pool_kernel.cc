@@ -0,0 +1,273 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "jit_pool_kernel.h"
+#include "util_jitinfer.h"
+
+#define GET_OFF(field) offsetof(jit_pool_call_s, field)
+
+namespace jitinfer {
+namespace jit {
+
+using namespace Xbyak;
+
+void jit_pool_kernel::prepare_output() {
+  for (int i = 0; i < jcp_.nb_c_blocking; ++i) {
+    Xmm acc = vreg_acc(i);
+    if (jcp_.kind == pooling_max) {
+      vmovups(acc, vreg(zmm_lowest.getIdx()));
+    } else {
+      vpxord(acc, acc, acc);
+    }
+  }
+}
+
+void jit_pool_kernel::accumulate() {
+  using data_type = memory::dtype;
+  Xmm tmp = vreg_tmp();
+  for (int i = 0; i < jcp_.nb_c_blocking; ++i) {
+    Xmm acc = vreg_acc(i);
+    int offset = jcp_.typesize * i * jcp_.c_block;
+    auto addr = EVEX_compress_addr(aux_reg_src_w, offset);
+    if (jcp_.kind == pooling_max) {
+      vmovups(tmp, addr);
+      switch (jcp_.dt) {
+        case data_type::f32:
+          vmaxps(acc, acc, tmp);
+          break;
+        case data_type::s32:
+          vpmaxsd(acc, acc, tmp);
+          break;
+        case data_type::s8:
+          vpmaxsb(acc, acc, tmp);
+          break;
+        case data_type::u8:
+          vpmaxub(acc, acc, tmp);
+          break;
+        default:
+          assert(!"unsupported data type");
+      }
+    } else {
+      switch (jcp_.dt) {
+        case data_type::f32:
+          vaddps(acc, acc, addr);
+          break;
+        case data_type::s32:
+          vpaddd(acc, acc, addr);
+          break;
+        case data_type::s8:
+          vpmovsxbd(tmp, addr);
+          vpaddd(acc, acc, tmp);
+          break;
+        case data_type::u8:
+          vpmovzxbd(tmp, addr);
+          vpaddd(acc, acc, tmp);
+          break;
+        default:
+          assert(!"unsupported data type");
+      }
+    }
+  }
+}
+
+void jit_pool_kernel::store_output() {
+  using data_type = memory::dtype;
+  for (int i = 0; i < jcp_.nb_c_blocking; ++i) {
+    Xmm acc = vreg_acc(i);
+    int offset = jcp_.typesize * i * jcp_.c_block;
+    auto addr = EVEX_compress_addr(reg_ptr_dst, offset);
+    if (jcp_.kind == pooling_max) {
+      vmovups(addr, acc);
+      continue;
+    }
+    Zmm zmm = Zmm(acc.getIdx());
+    Xmm xmm = Xmm(acc.getIdx());
+    if (jcp_.dt != data_type::f32) {
+      vcvtdq2ps(zmm, zmm);
+    }
+    vmulps(zmm, zmm, zmm_inv_area);
+    if (jcp_.dt != data_type::f32) {
+      vcvtps2dq(zmm | T_rn_sae, zmm);
+    }
+    switch (jcp_.dt) {
+      case data_type::f32:
+      case data_type::s32:
+        vmovups(addr, zmm);
+        break;
+      case data_type::s8:
+        vpmovsdb(xmm, zmm);
+        vmovups(addr, xmm);
+        break;
+      case data_type::u8:
+        vpmovusdb(xmm, zmm);
+        vmovups(addr, xmm);
+        break;
+      default:
+        assert(!"unsupported data type");
+    }
+  }
+}
+
+void jit_pool_kernel::generate() {
+  using data_type = memory::dtype;
+  const int shift_c = jcp_.typesize * jcp_.c_block * jcp_.nb_c_blocking;
+  const int shift_src_w = jcp_.typesize * jcp_.src_ld;
+  const int shift_src_h = jcp_.typesize * jcp_.src_ld * jcp_.iw;
+
+  preamble();
+
+  mov(reg_ptr_src, ptr[param + GET_OFF(src)]);
+  mov(reg_ptr_dst, ptr[param + GET_OFF(dst)]);
+  mov(reg_kh, ptr[param + GET_OFF(kh_padding)]);
+  mov(reg_kw, ptr[param + GET_OFF(kw_padding)]);
+
+  if (jcp_.kind == pooling_max) {
+    // the lowest value of each data type, broadcast by 4 bytes
+    switch (jcp_.dt) {
+      case data_type::f32:
+        mov(reg_tmp32, 0xff7fffff);  // -FLT_MAX
+        break;
+      case data_type::s32:
+        mov(reg_tmp32, 0x80000000);
+        break;
+      case data_type::s8:
+        mov(reg_tmp32, 0x80808080);
+        break;
+      case data_type::u8:
+        mov(reg_tmp32, 0);
+        break;
+      default:
+        assert(!"unsupported data type");
+    }
+    vpbroadcastd(zmm_lowest, reg_tmp32);
+  } else {
+    vbroadcastss(zmm_inv_area, ptr[param + GET_OFF(inv_area)]);
+  }
+
+  mov(reg_nb, jcp_.nb_c / jcp_.nb_c_blocking);
+  Label l_next_chunk;
+  L(l_next_chunk);
+  {
+    Label l_kh, l_kw, l_skip_kh, l_skip_kw;
+    prepare_output();
+
+    // the window could be empty when ceil output size
+    mov(aux_reg_src_h, reg_ptr_src);
+    mov(reg_kj, reg_kh);
+    cmp(reg_kj, 0);
+    jle(l_skip_kh, T_NEAR);
+    L(l_kh);
+    {
+      mov(aux_reg_src_w, aux_reg_src_h);
+      mov(reg_ki, reg_kw);
+      cmp(reg_ki, 0);
+      jle(l_skip_kw, T_NEAR);
+      L(l_kw);
+      {
+        accumulate();
+        add(aux_reg_src_w, shift_src_w);
+        dec(reg_ki);
+        cmp(reg_ki, 0);
+        jg(l_kw, T_NEAR);
+      }
+      L(l_skip_kw);
+      add(aux_reg_src_h, shift_src_h);
+      dec(reg_kj);
+      cmp(reg_kj, 0);
+      jg(l_kh, T_NEAR);
+    }
+    L(l_skip_kh);
+
+    store_output();
+
+    add(reg_ptr_src, shift_c);
+    add(reg_ptr_dst, shift_c);
+    dec(reg_nb);
+    cmp(reg_nb, 0);
+    jg(l_next_chunk, T_NEAR);
+  }
+
+  postamble();
+}
+
+bool jit_pool_kernel::init_conf(jit_pool_conf_t& jcp,
+                                const std::unique_ptr<memory>& src,
+                                const std::unique_ptr<memory>& dst,
+                                std::array<int, 2> sz_kernel,
+                                std::array<int, 2> sz_stride,
+                                std::array<int, 2> sz_padding,
+                                pooling_kind kind) {
+  using namespace util;
+  jcp = zero<decltype(jcp)>();
+  if (!all_true(one_of(src->dim_format(), memory::format::nhwc),
+                one_of(dst->dim_format(), memory::format::nhwc),
+                src->data_type() == dst->data_type(),
+                one_of(kind,
+                       pooling_max,
+                       pooling_avg_include_padding,
+                       pooling_avg_exclude_padding))) {
+    return false;
+  }
+  auto src_dims = src->std_dims();  // nchw
+  auto dst_dims = dst->std_dims();  // nchw
+  jcp.bs = src_dims[0];
+  jcp.c = src_dims[1];
+  jcp.ih = src_dims[2];
+  jcp.iw = src_dims[3];
+  jcp.oh = dst_dims[2];
+  jcp.ow = dst_dims[3];
+  jcp.src_ld = src->ld();
+  jcp.kh = sz_kernel[0];
+  jcp.kw = sz_kernel[1];
+  jcp.sh = sz_stride[0];
+  jcp.sw = sz_stride[1];
+  jcp.t_pad = sz_padding[0];
+  jcp.l_pad = sz_padding[1];
+  jcp.kind = kind;
+  jcp.dt = src->data_type();
+  return init_blocking(jcp);
+}
+
+bool jit_pool_kernel::init_blocking(jit_pool_conf_t& jcp) {
+  using namespace util;
+  jcp.typesize = dtype_size(jcp.dt);
+  if (!one_of(jcp.typesize, 1, 4)) {
+    // only s8, u8, s32, f32
+    return false;
+  }
+  if (jcp.c % 16 != 0) {
+    return false;
+  }
+  if (!mayiuse(avx512_core)) {
+    return false;
+  }
+
+  // 4bytes or avg pooling work on 16x channels,
+  // 1byte max pooling work on 64x, 32x or 16x channels
+  if (jcp.typesize == 1 && jcp.kind == pooling_max) {
+    jcp.c_block = dividable_of(jcp.c, 64, 32, 16);
+  } else {
+    jcp.c_block = 16;
+  }
+  jcp.nb_c = jcp.c / jcp.c_block;
+  jcp.nb_c_blocking = dividable_of(jcp.nb_c, 16, 8, 4, 2, 1);
+  jcp.bits_size = 8 * jcp.typesize * jcp.c_block;
+  if (!one_of(jcp.bits_size, USE_XMM, USE_YMM, USE_ZMM)) {
+    return false;
+  }
+  return true;
+}
+}
+}
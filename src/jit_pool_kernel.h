@@ -0,0 +1,98 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#pragma once
+
+#include "jit_call_conf.h"
+#include "jit_generator.h"
+
+namespace jitinfer {
+
+namespace jit {
+
+struct jit_pool_kernel : public jit_generator {
+  DECLARE_JIT_KERNEL(jit_pool_kernel);
+
+  jit_pool_kernel(jit_pool_conf_t ajcp) : jcp_(ajcp) {
+    generate();
+    jit_ker_ = (void (*)(jit_pool_call_s*))getCode();
+  }
+
+  static bool init_conf(jit_pool_conf_t& jcp,
+                        const std::unique_ptr<memory>& src,
+                        const std::unique_ptr<memory>& dst,
+                        std::array<int, 2> sz_kernel,
+                        std::array<int, 2> sz_stride,
+                        std::array<int, 2> sz_padding,
+                        pooling_kind kind);
+  // blocking of channels, needs c, kind and dt
+  static bool init_blocking(jit_pool_conf_t& jcp);
+
+  jit_pool_conf_t jcp_;
+  void (*jit_ker_)(jit_pool_call_s*);
+
+private:
+  enum {
+    USE_ZMM = 512,
+    USE_YMM = 256,
+    USE_XMM = 128,
+  };
+  using reg64_t = const Xbyak::Reg64;
+  using reg32_t = const Xbyak::Reg32;
+  using zmm_t = const Xbyak::Zmm;
+  using xmm_t = const Xbyak::Xmm;
+
+  reg64_t param = abi_param1;
+  reg64_t reg_ptr_src = r8;
+  reg64_t reg_ptr_dst = r9;
+  reg64_t reg_kh = r10;
+  reg64_t reg_kw = r11;
+  reg64_t aux_reg_src_h = r12;
+  reg64_t aux_reg_src_w = r13;
+  reg64_t reg_kj = r14;
+  reg64_t reg_ki = r15;
+  reg64_t reg_nb = rax;
+  reg32_t reg_tmp32 = edx;
+
+  zmm_t zmm_tmp = zmm_t(29);
+  zmm_t zmm_lowest = zmm_t(30);  // the init value of max pooling
+  zmm_t zmm_inv_area = zmm_t(31);
+
+  // accumulator of the i-th c block, max pooling works on the src width
+  // while avg pooling always accumulates 16 channels of s32 or f32
+  xmm_t vreg_acc(int i) {
+    assert(i < zmm_tmp.getIdx());
+    return vreg(i);
+  }
+  xmm_t vreg_tmp() { return vreg(zmm_tmp.getIdx()); }
+  xmm_t vreg(int idx) {
+    int bits = jcp_.kind == pooling_max ? jcp_.bits_size : int(USE_ZMM);
+    switch (bits) {
+      case USE_ZMM:
+        return Xbyak::Zmm(idx);
+      case USE_YMM:
+        return Xbyak::Ymm(idx);
+      default:
+        return Xbyak::Xmm(idx);
+    }
+  }
+
+  void prepare_output();
+  void accumulate();
+  void store_output();
+  void generate();
+};
+}
+}
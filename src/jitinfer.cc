@@ -14,8 +14,21 @@
 * limitations under the License.
 *******************************************************************************/
 #include "jitinfer.h"
+#include <cmath>
+#include "op_binary.h"
 #include "op_concat.h"
+#include "op_concat_conv1x1.h"
 #include "op_conv.h"
+#include "op_conv1x1_conv.h"
+#include "op_conv1x1_multi.h"
+#include "op_conv_conv.h"
+#include "op_dwconv_conv1x1.h"
+#include "op_eltwise.h"
+#include "op_inner_product.h"
+#include "op_pool.h"
+#include "op_resize.h"
+#include "op_split.h"
+#include "thread_pool.h"
 #include "util_jitinfer.h"
 
 namespace jitinfer {
@@ -25,6 +38,10 @@ memory::dims nchw2format(const memory::nchw_dims &dm,
   using format = memory::format;
   memory::dims out;
   switch (fmt) {
+    case format::x:
+      out.resize(1);
+      out[0] = dm[0];
+      break;
     case format::nhwc:
       out.resize(4);
       out[0] = dm[0];
@@ -50,6 +67,17 @@ memory::dims nchw2format(const memory::nchw_dims &dm,
       out[5] = 16;
       out[6] = 4;
       break;
+    case format::OhwI4i16o4i:
+      // o/16, h, w, i/16, 4i, 16o, 4i
+      out.resize(7);
+      out[0] = dm[0] / 16;
+      out[1] = dm[2];
+      out[2] = dm[3];
+      out[3] = dm[1] / 16;
+      out[4] = 4;
+      out[5] = 16;
+      out[6] = 4;
+      break;
     default:
       error_and_exit("bad type");
   }
@@ -62,20 +90,53 @@ memory::memory(const nchw_dims &dm,
                const format fmt,
                const dtype dt,
                int alignment)
-    : std_dims_(dm), fmt_(fmt), dt_(dt) {
+    : std_dims_(dm), fmt_(fmt), dt_(dt), ld_(dm[1]), own_buffer_(true) {
   dims_ = nchw2format(dm, fmt);
   allocate_buffer(alignment);
 }
 
+memory::memory(const nchw_dims &dm,
+               const format fmt,
+               const dtype dt,
+               void *data)
+    : data_(data),
+      std_dims_(dm),
+      fmt_(fmt),
+      dt_(dt),
+      ld_(dm[1]),
+      own_buffer_(false) {
+  dims_ = nchw2format(dm, fmt);
+}
+
 memory::memory(const std::array<int, 1> &dm, const dtype dt, int alignment)
-    : dt_(dt) {
+    : dt_(dt), ld_(1), own_buffer_(true) {
   std_dims_ = {dm[0], 1, 1, 1};
   fmt_ = format::x;
   dims_ = {dm[0]};
   allocate_buffer(alignment);
 }
 
-memory::~memory() { free(data_); }
+memory::memory(const std::unique_ptr<memory> &base, int c_offset, int c)
+    : fmt_(base->dim_format()),
+      dt_(base->data_type()),
+      ld_(base->ld()),
+      own_buffer_(false) {
+  check_eq(fmt_, format::nhwc);
+  check_ge(c_offset, 0);
+  check_gt(c, 0);
+  auto dm = base->std_dims();
+  check_le(c_offset + c, dm[1]);
+  std_dims_ = {dm[0], c, dm[2], dm[3]};
+  dims_ = nchw2format(std_dims_, fmt_);
+  data_ = reinterpret_cast<char *>(base->data()) +
+          c_offset * util::dtype_size(dt_);
+}
+
+memory::~memory() {
+  if (own_buffer_) {
+    free(data_);
+  }
+}
 
 void memory::allocate_buffer(int alignment) {
   assert(buffer_size() > 0);
@@ -89,14 +150,22 @@ size_t memory::size() {
 
 size_t memory::buffer_size() { return size() * util::dtype_size(dt_); }
 
-void op::submit() {
+void op::infer(const exec_ctx &ctx) {
+  parallel(ctx, [&](int ithr, int nthr) { infer_thread(ithr, nthr); });
+}
+
+op::op() : queue_(new async_queue()) {}
+
+op::~op() {}
+
+void op::submit(const exec_ctx &ctx) {
 #ifdef WITH_VERBOSE
   double t_start = 0;
   if (util::env::profiling_time()) {
     t_start = util::timer::get_current_ms();
   }
 #endif
-  infer();
+  infer(ctx);
 #ifdef WITH_VERBOSE
   if (util::env::profiling_time()) {
     info("%s infer %f", this->name(), util::timer::get_current_ms() - t_start);
@@ -104,6 +173,17 @@ void op::submit() {
 #endif
 }
 
+std::shared_future<void> op::submit_async(const exec_ctx &ctx) {
+  last_ = queue_->enqueue([this, ctx] { submit(ctx); });
+  return last_;
+}
+
+void op::wait() {
+  if (last_.valid()) {
+    last_.wait();
+  }
+}
+
 std::unique_ptr<op> concat(const std::vector<std::unique_ptr<memory>> &srcs,
                            std::unique_ptr<memory> &dst,
                            bool post_relu) {
@@ -122,6 +202,117 @@ std::unique_ptr<op> concat(const std::vector<std::unique_ptr<memory>> &srcs,
   return nullptr;
 }
 
+std::unique_ptr<op> split(const std::unique_ptr<memory> &src,
+                          std::vector<std::unique_ptr<memory>> &dsts,
+                          bool post_relu) {
+  switch (src->data_type()) {
+#define CASE(tp)          \
+  case memory::dtype::tp: \
+    return std::unique_ptr<op>(new op_split<tp>(src, dsts, post_relu))
+    CASE(f32);
+    CASE(s32);
+    CASE(s8);
+    CASE(u8);
+#undef CASE
+    default:
+      assert(!"bad data_type");
+  }
+  return nullptr;
+}
+
+std::unique_ptr<op> pool(const std::unique_ptr<memory> &src,
+                         std::unique_ptr<memory> &dst,
+                         std::array<int, 2> sz_kernel,
+                         std::array<int, 2> sz_stride,
+                         std::array<int, 2> sz_padding,
+                         pooling_kind kind) {
+  switch (dst->data_type()) {
+#define CASE(tp)                                  \
+  case memory::dtype::tp:                         \
+    return std::unique_ptr<op>(new op_pool<tp>(   \
+        src, dst, sz_kernel, sz_stride, sz_padding, kind))
+    CASE(f32);
+    CASE(s32);
+    CASE(s8);
+    CASE(u8);
+#undef CASE
+    default:
+      assert(!"bad data_type");
+  }
+  return nullptr;
+}
+
+std::unique_ptr<op> resize(const std::unique_ptr<memory> &src,
+                           std::unique_ptr<memory> &dst,
+                           resize_kind kind) {
+  // resize is the concat of one src
+  std::vector<std::unique_ptr<memory>> srcs;
+  srcs.emplace_back(new memory(src, 0, src->std_dims()[1]));
+  return resize_concat(srcs, dst, kind, false);
+}
+
+std::unique_ptr<op> resize_concat(
+    const std::vector<std::unique_ptr<memory>> &srcs,
+    std::unique_ptr<memory> &dst,
+    resize_kind kind,
+    bool post_relu) {
+  switch (dst->data_type()) {
+#define CASE(tp)          \
+  case memory::dtype::tp: \
+    return std::unique_ptr<op>(new op_resize<tp>(srcs, dst, kind, post_relu))
+    CASE(f32);
+    CASE(s32);
+    CASE(s8);
+    CASE(u8);
+#undef CASE
+    default:
+      assert(!"bad data_type");
+  }
+  return nullptr;
+}
+
+std::unique_ptr<op> eltwise(const std::unique_ptr<memory> &src,
+                            std::unique_ptr<memory> &dst,
+                            eltwise_kind kind,
+                            float alpha,
+                            float beta) {
+  switch (dst->data_type()) {
+#define CASE(tp)                 \
+  case memory::dtype::tp:        \
+    return std::unique_ptr<op>(  \
+        new op_eltwise<tp>(src, dst, kind, alpha, beta))
+    CASE(f32);
+    CASE(s32);
+    CASE(s8);
+    CASE(u8);
+#undef CASE
+    default:
+      assert(!"bad data_type");
+  }
+  return nullptr;
+}
+
+std::unique_ptr<op> binary(const std::unique_ptr<memory> &src0,
+                           const std::unique_ptr<memory> &src1,
+                           std::unique_ptr<memory> &dst,
+                           binary_kind kind,
+                           bool post_relu) {
+  switch (dst->data_type()) {
+#define CASE(tp)                 \
+  case memory::dtype::tp:        \
+    return std::unique_ptr<op>(  \
+        new op_binary<tp>(src0, src1, dst, kind, post_relu))
+    CASE(f32);
+    CASE(s32);
+    CASE(s8);
+    CASE(u8);
+#undef CASE
+    default:
+      assert(!"bad data_type");
+  }
+  return nullptr;
+}
+
 std::unique_ptr<op> conv(const std::unique_ptr<memory> &src,
                          const std::unique_ptr<memory> &wei,
                          const std::unique_ptr<memory> &bia,
@@ -172,17 +363,459 @@ std::unique_ptr<op> conv(const std::unique_ptr<memory> &src,
                          std::unique_ptr<memory> &dst,
                          bool conv0_relu,
                          std::vector<float> conv0_scales,
+                         round_mode conv0_round_mode,
+                         bool global_avg_pool) {
+  switch (dst->data_type()) {
+#define CASE(tp)                                                    \
+  case memory::dtype::tp:                                           \
+    return std::unique_ptr<op>(new op_conv<tp>(src,                 \
+                                               wei,                 \
+                                               bia,                 \
+                                               sz_stride,           \
+                                               sz_padding,          \
+                                               dst,                 \
+                                               conv0_scales,        \
+                                               {1.f},               \
+                                               nullptr,             \
+                                               nullptr,             \
+                                               conv0_relu,          \
+                                               false,               \
+                                               conv0_round_mode,    \
+                                               round_mode::nearest, \
+                                               {0, 0},              \
+                                               {0, 0},              \
+                                               {0, 0},              \
+                                               global_avg_pool))
+    CASE(f32);
+    CASE(s32);
+    CASE(s8);
+    CASE(u8);
+#undef CASE
+    default:
+      assert(!"bad data_type");
+  }
+  return nullptr;
+}
+
+std::unique_ptr<op> conv(const std::unique_ptr<memory> &src,
+                         const std::unique_ptr<memory> &wei,
+                         const std::unique_ptr<memory> &bia,
+                         std::array<int, 2> sz_stride,
+                         std::array<int, 2> sz_padding,
+                         std::array<int, 2> sz_pool_kernel,
+                         std::array<int, 2> sz_pool_stride,
+                         std::array<int, 2> sz_pool_padding,
+                         std::unique_ptr<memory> &dst,
+                         bool conv0_relu,
+                         std::vector<float> conv0_scales,
+                         round_mode conv0_round_mode) {
+  switch (dst->data_type()) {
+#define CASE(tp)                                                    \
+  case memory::dtype::tp:                                           \
+    return std::unique_ptr<op>(new op_conv<tp>(src,                 \
+                                               wei,                 \
+                                               bia,                 \
+                                               sz_stride,           \
+                                               sz_padding,          \
+                                               dst,                 \
+                                               conv0_scales,        \
+                                               {1.f},               \
+                                               nullptr,             \
+                                               nullptr,             \
+                                               conv0_relu,          \
+                                               false,               \
+                                               conv0_round_mode,    \
+                                               round_mode::nearest, \
+                                               sz_pool_kernel,      \
+                                               sz_pool_stride,      \
+                                               sz_pool_padding))
+    CASE(f32);
+    CASE(s32);
+    CASE(s8);
+    CASE(u8);
+#undef CASE
+    default:
+      assert(!"bad data_type");
+  }
+  return nullptr;
+}
+
+std::unique_ptr<op> conv(const std::unique_ptr<memory> &src,
+                         const std::unique_ptr<memory> &wei,
+                         const std::unique_ptr<memory> &bia,
+                         std::array<int, 2> sz_stride,
+                         std::array<int, 2> sz_padding,
+                         int shuffle_groups,
+                         std::unique_ptr<memory> &dst,
+                         bool conv0_relu,
+                         std::vector<float> conv0_scales,
                          round_mode conv0_round_mode) {
-  return conv(src,
-              wei,
-              bia,
-              sz_stride,
-              sz_padding,
-              nullptr,
-              nullptr,
-              dst,
-              conv0_relu,
-              conv0_scales,
-              conv0_round_mode);
+  switch (dst->data_type()) {
+#define CASE(tp)                                                    \
+  case memory::dtype::tp:                                           \
+    return std::unique_ptr<op>(new op_conv<tp>(src,                 \
+                                               wei,                 \
+                                               bia,                 \
+                                               sz_stride,           \
+                                               sz_padding,          \
+                                               dst,                 \
+                                               conv0_scales,        \
+                                               {1.f},               \
+                                               nullptr,             \
+                                               nullptr,             \
+                                               conv0_relu,          \
+                                               false,               \
+                                               conv0_round_mode,    \
+                                               round_mode::nearest, \
+                                               {0, 0},              \
+                                               {0, 0},              \
+                                               {0, 0},              \
+                                               false,               \
+                                               shuffle_groups))
+    CASE(f32);
+    CASE(s32);
+    CASE(s8);
+    CASE(u8);
+#undef CASE
+    default:
+      assert(!"bad data_type");
+  }
+  return nullptr;
+}
+
+std::unique_ptr<op> conv_sum(const std::unique_ptr<memory> &src,
+                             const std::unique_ptr<memory> &wei,
+                             const std::unique_ptr<memory> &bia,
+                             const std::unique_ptr<memory> &sum,
+                             std::unique_ptr<memory> &dst,
+                             bool post_relu,
+                             std::vector<float> scales,
+                             round_mode rmode,
+                             float sum_scale) {
+  switch (dst->data_type()) {
+#define CASE(tp)                                                    \
+  case memory::dtype::tp:                                           \
+    return std::unique_ptr<op>(new op_conv<tp>(src,                 \
+                                               wei,                 \
+                                               bia,                 \
+                                               {1, 1},              \
+                                               {0, 0},              \
+                                               dst,                 \
+                                               scales,              \
+                                               {1.f},               \
+                                               nullptr,             \
+                                               nullptr,             \
+                                               post_relu,           \
+                                               false,               \
+                                               rmode,               \
+                                               round_mode::nearest, \
+                                               {0, 0},              \
+                                               {0, 0},              \
+                                               {0, 0},              \
+                                               false,               \
+                                               0,                   \
+                                               sum,                 \
+                                               sum_scale))
+    CASE(f32);
+    CASE(s32);
+    CASE(s8);
+    CASE(u8);
+#undef CASE
+    default:
+      assert(!"bad data_type");
+  }
+  return nullptr;
+}
+
+std::unique_ptr<op> conv1x1_conv(const std::unique_ptr<memory> &src,
+                                 const std::unique_ptr<memory> &wei1x1,
+                                 const std::unique_ptr<memory> &bia1x1,
+                                 const std::unique_ptr<memory> &wei,
+                                 const std::unique_ptr<memory> &bia,
+                                 std::array<int, 2> sz_stride,
+                                 std::array<int, 2> sz_padding,
+                                 std::unique_ptr<memory> &dst,
+                                 std::vector<float> conv1x1_scales,
+                                 bool conv0_relu,
+                                 std::vector<float> conv0_scales,
+                                 round_mode conv0_round_mode) {
+  switch (dst->data_type()) {
+#define CASE(tp)                                              \
+  case memory::dtype::tp:                                     \
+    return std::unique_ptr<op>(                               \
+        new op_conv1x1_conv<tp>(src,                          \
+                                wei1x1,                       \
+                                bia1x1,                       \
+                                wei,                          \
+                                bia,                          \
+                                sz_stride,                    \
+                                sz_padding,                   \
+                                dst,                          \
+                                conv1x1_scales,               \
+                                conv0_scales,                 \
+                                conv0_relu,                   \
+                                conv0_round_mode))
+    CASE(f32);
+    CASE(s32);
+    CASE(s8);
+    CASE(u8);
+#undef CASE
+    default:
+      assert(!"bad data_type");
+  }
+  return nullptr;
+}
+
+std::unique_ptr<op> bottleneck(const std::unique_ptr<memory> &src,
+                               const std::unique_ptr<memory> &wei1x1,
+                               const std::unique_ptr<memory> &bia1x1,
+                               const std::unique_ptr<memory> &wei,
+                               const std::unique_ptr<memory> &bia,
+                               std::array<int, 2> sz_stride,
+                               std::array<int, 2> sz_padding,
+                               const std::unique_ptr<memory> &wei1,
+                               const std::unique_ptr<memory> &bia1,
+                               const std::unique_ptr<memory> &sum,
+                               std::unique_ptr<memory> &dst,
+                               std::vector<float> conv1x1_scales,
+                               std::vector<float> conv0_scales,
+                               std::vector<float> conv1_scales,
+                               float sum_scale) {
+  switch (dst->data_type()) {
+#define CASE(tp)                                              \
+  case memory::dtype::tp:                                     \
+    return std::unique_ptr<op>(                               \
+        new op_conv1x1_conv<tp>(src,                          \
+                                wei1x1,                       \
+                                bia1x1,                       \
+                                wei,                          \
+                                bia,                          \
+                                sz_stride,                    \
+                                sz_padding,                   \
+                                dst,                          \
+                                conv1x1_scales,               \
+                                conv0_scales,                 \
+                                true,                         \
+                                round_mode::nearest,          \
+                                wei1,                         \
+                                bia1,                         \
+                                sum,                          \
+                                conv1_scales,                 \
+                                sum_scale,                    \
+                                true))
+    CASE(f32);
+    CASE(s32);
+    CASE(s8);
+    CASE(u8);
+#undef CASE
+    default:
+      assert(!"bad data_type");
+  }
+  return nullptr;
+}
+
+std::unique_ptr<op> conv1x1_multi(
+    const std::unique_ptr<memory> &src,
+    const std::vector<std::unique_ptr<memory>> &weis,
+    const std::vector<std::unique_ptr<memory>> &bias,
+    std::vector<std::unique_ptr<memory>> &dsts,
+    bool post_relu,
+    std::vector<std::vector<float>> scales,
+    round_mode rmode) {
+  assert(!dsts.empty());
+  switch (dsts[0]->data_type()) {
+#define CASE(tp)                                         \
+  case memory::dtype::tp:                                \
+    return std::unique_ptr<op>(new op_conv1x1_multi<tp>( \
+        src, weis, bias, dsts, post_relu, scales, rmode))
+    CASE(f32);
+    CASE(s32);
+    CASE(s8);
+    CASE(u8);
+#undef CASE
+    default:
+      assert(!"bad data_type");
+  }
+  return nullptr;
+}
+
+std::unique_ptr<op> concat_conv1x1(
+    const std::vector<std::unique_ptr<memory>> &srcs,
+    const std::unique_ptr<memory> &wei,
+    const std::unique_ptr<memory> &bia,
+    std::unique_ptr<memory> &dst,
+    bool post_relu,
+    std::vector<float> scales,
+    round_mode rmode) {
+  switch (dst->data_type()) {
+#define CASE(tp)                                          \
+  case memory::dtype::tp:                                 \
+    return std::unique_ptr<op>(new op_concat_conv1x1<tp>( \
+        srcs, wei, bia, dst, post_relu, scales, rmode))
+    CASE(f32);
+    CASE(s32);
+    CASE(s8);
+    CASE(u8);
+#undef CASE
+    default:
+      assert(!"bad data_type");
+  }
+  return nullptr;
+}
+
+std::unique_ptr<op> conv_conv(const std::unique_ptr<memory> &src,
+                              const std::unique_ptr<memory> &wei0,
+                              const std::unique_ptr<memory> &bia0,
+                              std::array<int, 2> sz_stride0,
+                              std::array<int, 2> sz_padding0,
+                              const std::unique_ptr<memory> &wei1,
+                              const std::unique_ptr<memory> &bia1,
+                              std::array<int, 2> sz_stride1,
+                              std::array<int, 2> sz_padding1,
+                              std::unique_ptr<memory> &dst,
+                              std::vector<float> conv0_scales,
+                              bool conv1_relu,
+                              std::vector<float> conv1_scales,
+                              round_mode conv1_round_mode) {
+  switch (dst->data_type()) {
+#define CASE(tp)                                                  \
+  case memory::dtype::tp:                                         \
+    return std::unique_ptr<op>(new op_conv_conv<tp>(src,          \
+                                                    wei0,         \
+                                                    bia0,         \
+                                                    sz_stride0,   \
+                                                    sz_padding0,  \
+                                                    wei1,         \
+                                                    bia1,         \
+                                                    sz_stride1,   \
+                                                    sz_padding1,  \
+                                                    dst,          \
+                                                    conv0_scales, \
+                                                    conv1_relu,   \
+                                                    conv1_scales, \
+                                                    conv1_round_mode))
+    CASE(f32);
+    CASE(s32);
+    CASE(s8);
+    CASE(u8);
+#undef CASE
+    default:
+      assert(!"bad data_type");
+  }
+  return nullptr;
+}
+
+std::unique_ptr<op> dwconv_conv1x1(const std::unique_ptr<memory> &src,
+                                   const std::unique_ptr<memory> &wei,
+                                   const std::unique_ptr<memory> &bia,
+                                   std::array<int, 2> sz_stride,
+                                   std::array<int, 2> sz_padding,
+                                   const std::unique_ptr<memory> &wei1x1,
+                                   const std::unique_ptr<memory> &bia1x1,
+                                   std::unique_ptr<memory> &dst,
+                                   std::vector<float> dw_scales,
+                                   bool conv1x1_relu,
+                                   std::vector<float> conv1x1_scales,
+                                   round_mode conv1x1_round_mode) {
+  switch (dst->data_type()) {
+#define CASE(tp)                                                  \
+  case memory::dtype::tp:                                         \
+    return std::unique_ptr<op>(                                   \
+        new op_dwconv_conv1x1<tp>(src,                            \
+                                  wei,                            \
+                                  bia,                            \
+                                  sz_stride,                      \
+                                  sz_padding,                     \
+                                  wei1x1,                         \
+                                  bia1x1,                         \
+                                  dst,                            \
+                                  dw_scales,                      \
+                                  conv1x1_scales,                 \
+                                  conv1x1_relu,                   \
+                                  conv1x1_round_mode))
+    CASE(f32);
+    CASE(s32);
+    CASE(s8);
+    CASE(u8);
+#undef CASE
+    default:
+      assert(!"bad data_type");
+  }
+  return nullptr;
+}
+
+std::unique_ptr<op> inner_product(const std::unique_ptr<memory> &src,
+                                  const std::unique_ptr<memory> &wei,
+                                  const std::unique_ptr<memory> &bia,
+                                  std::unique_ptr<memory> &dst,
+                                  bool post_relu,
+                                  std::vector<float> scales,
+                                  round_mode rmode) {
+  switch (dst->data_type()) {
+#define CASE(tp)                \
+  case memory::dtype::tp:       \
+    return std::unique_ptr<op>( \
+        new op_inner_product<tp>(src, wei, bia, dst, post_relu, scales, rmode))
+    CASE(f32);
+    CASE(s32);
+    CASE(s8);
+    CASE(u8);
+#undef CASE
+    default:
+      assert(!"bad data_type");
+  }
+  return nullptr;
+}
+
+void fold_batch_norm(const std::vector<float> &gamma,
+                     const std::vector<float> &beta,
+                     const std::vector<float> &mean,
+                     const std::vector<float> &var,
+                     float eps,
+                     const std::unique_ptr<memory> &bia,
+                     const std::vector<float> &conv0_scales,
+                     std::unique_ptr<memory> &folded_bia,
+                     std::vector<float> &folded_scales) {
+  const int oc = gamma.size();
+  check_eq(beta.size(), size_t(oc));
+  check_eq(mean.size(), var.size());
+  check_eq(mean.empty() || mean.size() == size_t(oc), true);
+  check_eq(util::one_of(conv0_scales.size(), 1UL, size_t(oc)), true);
+  check_eq(bia == nullptr || bia->std_dims()[0] == oc, true);
+
+  // conv0 is scale * (acc + bias), then
+  // bn = a * scale * (acc + bias) + b, where a = gamma / sqrt(var + eps),
+  //    = (a * scale) * (acc + bias + b / (a * scale)), b = beta - a * mean
+  folded_bia.reset(new memory({oc}, memory::dtype::f32));
+  folded_scales.resize(oc);
+  float *pbia = reinterpret_cast<float *>(folded_bia->data());
+  for (int i = 0; i < oc; ++i) {
+    float a = mean.empty() ? gamma[i] : gamma[i] / std::sqrt(var[i] + eps);
+    float b = mean.empty() ? beta[i] : beta[i] - a * mean[i];
+    float scale = conv0_scales.size() > 1 ? conv0_scales[i] : conv0_scales[0];
+    float bias = 0.f;
+    if (bia != nullptr) {
+      switch (bia->data_type()) {
+#define CASE(tp)                                            \
+  case memory::dtype::tp:                                   \
+    bias = static_cast<float>(                              \
+        reinterpret_cast<const tp *>(bia->data())[i]);      \
+    break
+        CASE(f32);
+        CASE(s32);
+        CASE(s8);
+        CASE(u8);
+#undef CASE
+        default:
+          assert(!"bad data_type");
+      }
+    }
+    folded_scales[i] = a * scale;
+    if (folded_scales[i] == 0.f) {
+      error_and_exit("Can not fold batch norm with zero scale at channel %d",
+                     i);
+    }
+    pbia[i] = bias + b / folded_scales[i];
+  }
 }
 }
@@ -0,0 +1,755 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "network.h"
+#include <sys/mman.h>
+#include <algorithm>
+#include <map>
+#include <utility>
+#include "log.h"
+#include "op_inner_product.h"
+#include "thread_pool.h"
+#include "util_jitinfer.h"
+
+namespace jitinfer {
+
+// the offset of each intermediate tensor in arena
+constexpr size_t arena_alignment = 64;
+
+static size_t tensor_size(const memory::nchw_dims &dims, memory::dtype dt) {
+  size_t sz = util::array_product<int>(dims.data(), dims.size()) *
+              util::dtype_size(dt);
+  return (sz + arena_alignment - 1) / arena_alignment * arena_alignment;
+}
+
+static const std::unique_ptr<memory> &weights(
+    const std::unique_ptr<memory> *p) {
+  static const std::unique_ptr<memory> none;
+  return p ? *p : none;
+}
+
+network::network()
+    : queue_(new async_queue()),
+      arena_size_(0),
+      built_(false),
+      map_(nullptr),
+      map_size_(0) {}
+
+network::~network() {
+  wait();
+  // ops and memories should be released before their buffers
+  inst_.reset();
+  weights_.clear();
+  if (map_) {
+    munmap(map_, map_size_);
+  }
+}
+
+int network::input(const memory::nchw_dims &dims, memory::dtype dt) {
+  check(!built_);
+  std::unique_ptr<tensor> t(new tensor());
+  t->dims = dims;
+  t->dt = dt;
+  t->producer = -1;
+  t->last_reader = -1;
+  t->view_of = -1;
+  tensors_.push_back(std::move(t));
+  inputs_.push_back(tensors_.size() - 1);
+  return tensors_.size() - 1;
+}
+
+int network::add_layer(std::unique_ptr<layer> l,
+                       const memory::nchw_dims &dims,
+                       memory::dtype dt) {
+  check(!built_);
+  for (int src : l->srcs) {
+    check_ge(src, 0);
+    check_lt(src, (int)tensors_.size());
+  }
+  std::unique_ptr<tensor> t(new tensor());
+  t->dims = dims;
+  t->dt = dt;
+  t->producer = layers_.size();
+  t->last_reader = layers_.size();
+  t->view_of = -1;
+  tensors_.push_back(std::move(t));
+  l->dst = tensors_.size() - 1;
+  layers_.push_back(std::move(l));
+  return tensors_.size() - 1;
+}
+
+int network::conv(int src,
+                  const std::unique_ptr<memory> &wei,
+                  const std::unique_ptr<memory> &bia,
+                  std::array<int, 2> sz_stride,
+                  std::array<int, 2> sz_padding,
+                  bool post_relu,
+                  std::vector<float> scales,
+                  round_mode rmode,
+                  memory::dtype dt) {
+  auto src_dims = dims(src);
+  auto wei_dims = wei->std_dims();  // oihw
+  check_eq(wei_dims[1], src_dims[1]);
+  std::unique_ptr<layer> l(new layer());
+  l->kind = layer::layer_conv;
+  l->srcs = {src};
+  l->wei = &wei;
+  l->bia = bia ? &bia : nullptr;
+  l->sz_stride = sz_stride;
+  l->sz_padding = sz_padding;
+  l->post_relu = post_relu;
+  l->scales = scales;
+  l->rmode = rmode;
+  memory::nchw_dims dst_dims = {
+      src_dims[0],
+      wei_dims[0],
+      util::conv_output_size(
+          src_dims[2], wei_dims[2], sz_stride[0], sz_padding[0]),
+      util::conv_output_size(
+          src_dims[3], wei_dims[3], sz_stride[1], sz_padding[1])};
+  return add_layer(std::move(l), dst_dims, dt);
+}
+
+int network::pool(int src,
+                  std::array<int, 2> sz_kernel,
+                  std::array<int, 2> sz_stride,
+                  std::array<int, 2> sz_padding,
+                  pooling_kind kind) {
+  auto src_dims = dims(src);
+  std::unique_ptr<layer> l(new layer());
+  l->kind = layer::layer_pool;
+  l->srcs = {src};
+  l->sz_kernel = sz_kernel;
+  l->sz_stride = sz_stride;
+  l->sz_padding = sz_padding;
+  l->pkind = kind;
+  memory::nchw_dims dst_dims = {
+      src_dims[0],
+      src_dims[1],
+      util::pool_output_size(
+          src_dims[2], sz_kernel[0], sz_stride[0], sz_padding[0]),
+      util::pool_output_size(
+          src_dims[3], sz_kernel[1], sz_stride[1], sz_padding[1])};
+  return add_layer(std::move(l), dst_dims, data_type(src));
+}
+
+int network::concat(const std::vector<int> &srcs, bool post_relu) {
+  check_gt(srcs.size(), 0UL);
+  auto dst_dims = dims(srcs[0]);
+  dst_dims[1] = 0;
+  for (int src : srcs) {
+    auto src_dims = dims(src);
+    check_eq(src_dims[0], dst_dims[0]);
+    check_eq(src_dims[2], dst_dims[2]);
+    check_eq(src_dims[3], dst_dims[3]);
+    check_eq(data_type(src), data_type(srcs[0]));
+    dst_dims[1] += src_dims[1];
+  }
+  std::unique_ptr<layer> l(new layer());
+  l->kind = layer::layer_concat;
+  l->srcs = srcs;
+  l->post_relu = post_relu;
+  return add_layer(std::move(l), dst_dims, data_type(srcs[0]));
+}
+
+int network::eltwise(int src, eltwise_kind kind, float alpha, float beta) {
+  std::unique_ptr<layer> l(new layer());
+  l->kind = layer::layer_eltwise;
+  l->srcs = {src};
+  l->ekind = kind;
+  l->alpha = alpha;
+  l->beta = beta;
+  return add_layer(std::move(l), dims(src), data_type(src));
+}
+
+int network::binary(int src0, int src1, binary_kind kind, bool post_relu) {
+  check(dims(src0) == dims(src1));
+  std::unique_ptr<layer> l(new layer());
+  l->kind = layer::layer_binary;
+  l->srcs = {src0, src1};
+  l->bkind = kind;
+  l->post_relu = post_relu;
+  return add_layer(std::move(l), dims(src0), data_type(src0));
+}
+
+int network::resize(int src, std::array<int, 2> sz_out, resize_kind kind) {
+  auto src_dims = dims(src);
+  std::unique_ptr<layer> l(new layer());
+  l->kind = layer::layer_resize;
+  l->srcs = {src};
+  l->rkind = kind;
+  memory::nchw_dims dst_dims = {src_dims[0], src_dims[1], sz_out[0], sz_out[1]};
+  return add_layer(std::move(l), dst_dims, data_type(src));
+}
+
+int network::inner_product(int src,
+                           const std::unique_ptr<memory> &wei,
+                           const std::unique_ptr<memory> &bia,
+                           bool post_relu,
+                           std::vector<float> scales,
+                           round_mode rmode,
+                           memory::dtype dt) {
+  auto src_dims = dims(src);
+  auto wei_dims = wei->std_dims();  // oihw
+  check_eq(wei_dims[1], src_dims[1]);
+  check_eq(wei_dims[2], src_dims[2]);
+  check_eq(wei_dims[3], src_dims[3]);
+  std::unique_ptr<layer> l(new layer());
+  l->kind = layer::layer_inner_product;
+  l->srcs = {src};
+  l->wei = &wei;
+  l->bia = bia ? &bia : nullptr;
+  l->post_relu = post_relu;
+  l->scales = scales;
+  l->rmode = rmode;
+  memory::nchw_dims dst_dims = {src_dims[0], wei_dims[0], 1, 1};
+  return add_layer(std::move(l), dst_dims, dt);
+}
+
+void network::output(int id) {
+  check(!built_);
+  check_ge(producer_of(id), 0);
+  check(!tensors_[id]->is_output);
+  tensors_[id]->is_output = true;
+  outputs_.push_back(id);
+}
+
+memory::nchw_dims network::dims(int id) {
+  check_ge(id, 0);
+  check_lt(id, (int)tensors_.size());
+  return tensors_[id]->dims;
+}
+
+memory::dtype network::data_type(int id) {
+  check_ge(id, 0);
+  check_lt(id, (int)tensors_.size());
+  return tensors_[id]->dt;
+}
+
+int network::producer_of(int id) {
+  for (size_t i = 0; i < layers_.size(); ++i) {
+    if (layers_[i] && layers_[i]->dst == id) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int network::readers_of(int id) {
+  int n = 0;
+  for (auto &l : layers_) {
+    if (l) {
+      n += std::count(l->srcs.begin(), l->srcs.end(), id);
+    }
+  }
+  return n;
+}
+
+bool network::only_read_once(int id) {
+  auto &t = tensors_[id];
+  return readers_of(id) == 1 && !t->is_output && t->view_of < 0;
+}
+
+std::vector<std::string> network::fuse() {
+  using util::one_of;
+  check(!built_);
+  std::vector<std::string> fused;
+  auto can_relu = [](const layer &l) {
+    return one_of(
+        l.kind, layer::layer_conv, layer::layer_concat, layer::layer_binary);
+  };
+  auto set_relu = [](layer &l) {
+    if (l.wei1x1) {
+      l.conv1_relu = true;
+    } else {
+      l.post_relu = true;
+    }
+  };
+  // conv without any fusion yet
+  auto is_plain_conv = [](const layer &l) {
+    return l.kind == layer::layer_conv && l.wei1x1 == nullptr &&
+           l.srcs.size() == 1;
+  };
+  // 1x1 conv with stride 1 and without padding
+  auto is_conv1x1 = [](const layer &l) {
+    auto wei_dims = (*l.wei)->std_dims();  // oihw
+    return util::all_true(wei_dims[2] == 1,
+                          wei_dims[3] == 1,
+                          l.sz_stride[0] == 1,
+                          l.sz_stride[1] == 1,
+                          l.sz_padding[0] == 0,
+                          l.sz_padding[1] == 0);
+  };
+
+  // relu into the layer writing its src
+  for (auto &l : layers_) {
+    if (!(l->kind == layer::layer_eltwise && l->ekind == eltwise_relu)) {
+      continue;
+    }
+    int p = producer_of(l->srcs[0]);
+    if (p < 0 || !only_read_once(l->srcs[0]) || !can_relu(*layers_[p])) {
+      continue;
+    }
+    set_relu(*layers_[p]);
+    layers_[p]->dst = l->dst;
+    fused.push_back(std::string(layers_[p]->name()) + " + relu");
+    l.reset();
+  }
+
+  // conv1x1 of integer dst into the conv writing its u8 src
+  for (auto &l : layers_) {
+    if (!l || !is_plain_conv(*l) || !is_conv1x1(*l) ||
+        tensors_[l->dst]->dt == memory::dtype::f32) {
+      continue;
+    }
+    int src = l->srcs[0];
+    int p = producer_of(src);
+    if (p < 0 || !only_read_once(src) || !is_plain_conv(*layers_[p]) ||
+        tensors_[src]->dt != memory::dtype::u8) {
+      continue;
+    }
+    auto &c = layers_[p];
+    c->wei1x1 = l->wei;
+    c->bia1x1 = l->bia;
+    c->conv1_relu = l->post_relu;
+    c->conv1_scales = l->scales;
+    c->conv1_rmode = l->rmode;
+    c->dst = l->dst;
+    fused.push_back("conv + conv1x1");
+    l.reset();
+  }
+
+  // the add after conv1x1 into the conv as sum, only on f32 dst,
+  // since integer dst would be rounded and saturated once instead of twice
+  for (auto &l : layers_) {
+    if (!l || l->kind != layer::layer_binary || l->bkind != binary_add ||
+        tensors_[l->dst]->dt != memory::dtype::f32) {
+      continue;
+    }
+    for (int i : {0, 1}) {
+      int src = l->srcs[i], sum = l->srcs[1 - i];
+      int p = producer_of(src);
+      if (src == sum || p < 0 || !only_read_once(src)) {
+        continue;
+      }
+      auto &c = layers_[p];
+      if (!is_plain_conv(*c) || !is_conv1x1(*c) || c->post_relu) {
+        continue;
+      }
+      c->srcs.push_back(sum);
+      c->post_relu = l->post_relu;
+      c->dst = l->dst;
+      fused.push_back(l->post_relu ? "conv + sum + relu" : "conv + sum");
+      // sum can be written after conv, so run the fused conv at this place
+      l = std::move(c);
+      break;
+    }
+  }
+
+  // the layers writing the srcs of concat write to the views of its dst
+  for (auto &l : layers_) {
+    if (!l || l->kind != layer::layer_concat) {
+      continue;
+    }
+    bool ok = true;
+    for (int src : l->srcs) {
+      int p = producer_of(src);
+      ok = ok && p >= 0 && only_read_once(src) &&
+           layers_[p]->kind != layer::layer_inner_product &&
+           (!l->post_relu || can_relu(*layers_[p]));
+    }
+    if (!ok) {
+      continue;
+    }
+    std::string name;
+    int c_offset = 0;
+    for (int src : l->srcs) {
+      auto &p = layers_[producer_of(src)];
+      if (l->post_relu) {
+        set_relu(*p);
+      }
+      tensors_[src]->view_of = l->dst;
+      tensors_[src]->c_offset = c_offset;
+      c_offset += tensors_[src]->dims[1];
+      name += std::string(name.empty() ? "" : ", ") + p->name();
+    }
+    fused.push_back(name + " -> concat views");
+    l.reset();
+  }
+
+  layers_.erase(std::remove(layers_.begin(), layers_.end(), nullptr),
+                layers_.end());
+  return fused;
+}
+
+void network::update_lifetimes() {
+  for (auto &t : tensors_) {
+    t->producer = -1;
+    t->last_reader = -1;
+  }
+  for (size_t i = 0; i < layers_.size(); ++i) {
+    for (int src : layers_[i]->srcs) {
+      tensors_[src]->last_reader = i;
+    }
+    auto &t = tensors_[layers_[i]->dst];
+    t->producer = i;
+    t->last_reader = std::max(t->last_reader, (int)i);
+  }
+  // the dst of fused concat is alive from its first view written
+  for (auto &t : tensors_) {
+    if (t->view_of < 0 || t->producer < 0) {
+      continue;
+    }
+    auto &base = tensors_[t->view_of];
+    base->producer = base->producer < 0
+                         ? t->producer
+                         : std::min(base->producer, t->producer);
+    base->last_reader = std::max(base->last_reader, t->last_reader);
+  }
+}
+
+void network::pack_weights() {
+  // at most one for each layer, so the addresses in layers stay valid
+  packed_weights_.reserve(layers_.size());
+  std::map<const memory *, const std::unique_ptr<memory> *> packed;
+  for (auto &l : layers_) {
+    if (l->kind != layer::layer_inner_product) {
+      continue;
+    }
+    auto &wei = weights(l->wei);
+    auto dims = wei->std_dims();
+    if (dims[2] * dims[3] == 1 ||
+        wei->dim_format() != memory::format::OIhw4i16o4i) {
+      continue;
+    }
+    auto it = packed.find(wei.get());
+    if (it == packed.end()) {
+      packed_weights_.push_back(pack_inner_product_weights(wei));
+      it = packed.emplace(wei.get(), &packed_weights_.back()).first;
+    }
+    l->wei = it->second;
+  }
+}
+
+// the multiply-adds of conv and inner product, or the dst elements of others
+double network::work_of(const layer &l) {
+  auto &d = tensors_[l.dst]->dims;
+  double pixels = double(d[0]) * d[2] * d[3];
+  switch (l.kind) {
+    case layer::layer_conv:
+    case layer::layer_inner_product: {
+      auto w = weights(l.wei)->std_dims();
+      double work = pixels * util::array_product<int>(w.data(), w.size());
+      if (l.wei1x1) {
+        auto w1 = weights(l.wei1x1)->std_dims();
+        work += pixels * util::array_product<int>(w1.data(), w1.size());
+      }
+      return work;
+    }
+    case layer::layer_pool:
+      return pixels * d[1] * l.sz_kernel[0] * l.sz_kernel[1];
+    default:
+      return pixels * d[1];
+  }
+}
+
+void network::build() {
+  check(!built_);
+  check_gt(outputs_.size(), 0UL);
+  update_lifetimes();
+  pack_weights();
+  // a layer starts a new stage if it reads a tensor written in the stage,
+  // or a concat output one of its views is written in the stage
+  stages_.clear();
+  std::vector<int> stage_of(layers_.size()), written;
+  for (size_t i = 0; i < layers_.size(); ++i) {
+    auto &l = layers_[i];
+    bool depends = stages_.empty();
+    for (int src : l->srcs) {
+      depends = depends || std::find(written.begin(), written.end(), src) !=
+                               written.end();
+    }
+    if (depends) {
+      stages_.push_back(i);
+      written.clear();
+    }
+    stage_of[i] = stages_.size() - 1;
+    written.push_back(l->dst);
+    if (tensors_[l->dst]->view_of >= 0) {
+      written.push_back(tensors_[l->dst]->view_of);
+    }
+    l->work = work_of(*l);
+  }
+  stages_.push_back(layers_.size());
+  // place the intermediate tensors from the largest one, each at the lowest
+  // offset not used by the placed tensors alive in the same stages
+  std::vector<int> order;
+  for (size_t i = 0; i < tensors_.size(); ++i) {
+    auto &t = tensors_[i];
+    if (t->producer >= 0 && !t->is_output && t->view_of < 0) {
+      order.push_back(i);
+    }
+  }
+  auto size = [&](int i) {
+    return tensor_size(tensors_[i]->dims, tensors_[i]->dt);
+  };
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    return size(a) > size(b);
+  });
+  std::vector<int> placed;
+  for (int i : order) {
+    auto &t = tensors_[i];
+    std::vector<std::pair<size_t, size_t>> used;
+    for (int j : placed) {
+      auto &p = tensors_[j];
+      if (stage_of[t->producer] <= stage_of[p->last_reader] &&
+          stage_of[p->producer] <= stage_of[t->last_reader]) {
+        used.push_back({p->offset, p->offset + size(j)});
+      }
+    }
+    std::sort(used.begin(), used.end());
+    size_t offset = 0;
+    for (auto &u : used) {
+      if (offset + size(i) <= u.first) {
+        break;
+      }
+      offset = std::max(offset, u.second);
+    }
+    t->offset = offset;
+    arena_size_ = std::max(arena_size_, offset + size(i));
+    placed.push_back(i);
+  }
+  built_ = true;
+  inst_ = create_instance();
+}
+
+network::instance::~instance() {
+  // ops and memories should be released before their buffers
+  ops.clear();
+  mems.clear();
+  if (arena) {
+    free(arena);
+  }
+}
+
+std::unique_ptr<network::instance> network::create_instance() {
+  check(built_);
+  std::unique_ptr<instance> inst(new instance());
+  if (arena_size_ > 0) {
+    inst->arena = aligned_malloc(arena_size_, 4096);
+  }
+  inst->mems.resize(tensors_.size());
+  for (size_t i = 0; i < tensors_.size(); ++i) {
+    auto &t = tensors_[i];
+    if (t->producer >= 0 && !t->is_output && t->view_of < 0) {
+      inst->mems[i].reset(
+          new memory(t->dims,
+                     memory::format::nhwc,
+                     t->dt,
+                     reinterpret_cast<char *>(inst->arena) + t->offset));
+    }
+  }
+  return inst;
+}
+
+bool network::bind(instance &inst,
+                   const std::vector<int> &ids,
+                   const std::vector<std::unique_ptr<memory>> &mems) {
+  check_eq(ids.size(), mems.size());
+  bool changed = false;
+  for (size_t i = 0; i < ids.size(); ++i) {
+    auto &t = tensors_[ids[i]];
+    auto &m = mems[i];
+    check(m->std_dims() == t->dims);
+    check_eq(m->data_type(), t->dt);
+    check_eq(m->dim_format(), memory::format::nhwc);
+    check_eq(m->ld(), t->dims[1]);
+    auto &mem = inst.mems[ids[i]];
+    if (mem && mem->data() == m->data()) {
+      continue;
+    }
+    mem.reset(new memory(t->dims, memory::format::nhwc, t->dt, m->data()));
+    changed = true;
+  }
+  return changed;
+}
+
+void network::create_ops(instance &inst) {
+  auto &ops = inst.ops;
+  auto &mems = inst.mems;
+  ops.clear();
+  // views are created again since their base can be rebound
+  for (int i = tensors_.size() - 1; i >= 0; --i) {
+    auto &t = tensors_[i];
+    if (t->view_of >= 0) {
+      mems[i].reset(new memory(mems[t->view_of], t->c_offset, t->dims[1]));
+    }
+  }
+  for (auto &l : layers_) {
+    auto &src = mems[l->srcs[0]];
+    auto &dst = mems[l->dst];
+    switch (l->kind) {
+      case layer::layer_conv:
+        if (l->wei1x1) {
+          ops.push_back(jitinfer::conv(src,
+                                       weights(l->wei),
+                                       weights(l->bia),
+                                       l->sz_stride,
+                                       l->sz_padding,
+                                       weights(l->wei1x1),
+                                       weights(l->bia1x1),
+                                       dst,
+                                       l->post_relu,
+                                       l->scales,
+                                       l->rmode,
+                                       l->conv1_relu,
+                                       l->conv1_scales,
+                                       l->conv1_rmode));
+        } else if (l->srcs.size() > 1) {
+          ops.push_back(jitinfer::conv_sum(src,
+                                           weights(l->wei),
+                                           weights(l->bia),
+                                           mems[l->srcs[1]],
+                                           dst,
+                                           l->post_relu,
+                                           l->scales,
+                                           l->rmode));
+        } else {
+          ops.push_back(jitinfer::conv(src,
+                                       weights(l->wei),
+                                       weights(l->bia),
+                                       l->sz_stride,
+                                       l->sz_padding,
+                                       dst,
+                                       l->post_relu,
+                                       l->scales,
+                                       l->rmode));
+        }
+        break;
+      case layer::layer_pool:
+        ops.push_back(jitinfer::pool(src,
+                                     dst,
+                                     l->sz_kernel,
+                                     l->sz_stride,
+                                     l->sz_padding,
+                                     l->pkind));
+        break;
+      case layer::layer_concat: {
+        // the ops only keep the buffers, so the src views can be released
+        std::vector<std::unique_ptr<memory>> srcs;
+        for (int i : l->srcs) {
+          srcs.emplace_back(new memory(mems[i], 0, tensors_[i]->dims[1]));
+        }
+        ops.push_back(jitinfer::concat(srcs, dst, l->post_relu));
+        break;
+      }
+      case layer::layer_eltwise:
+        ops.push_back(jitinfer::eltwise(src, dst, l->ekind, l->alpha, l->beta));
+        break;
+      case layer::layer_binary:
+        ops.push_back(jitinfer::binary(src,
+                                       mems[l->srcs[1]],
+                                       dst,
+                                       l->bkind,
+                                       l->post_relu));
+        break;
+      case layer::layer_resize:
+        ops.push_back(jitinfer::resize(src, dst, l->rkind));
+        break;
+      case layer::layer_inner_product:
+        ops.push_back(jitinfer::inner_product(src,
+                                              weights(l->wei),
+                                              weights(l->bia),
+                                              dst,
+                                              l->post_relu,
+                                              l->scales,
+                                              l->rmode));
+        break;
+      default:
+        assert(!"bad layer kind");
+    }
+  }
+}
+
+void network::run(const std::vector<std::unique_ptr<memory>> &inputs,
+                  std::vector<std::unique_ptr<memory>> &outputs,
+                  const exec_ctx &ctx) {
+  check(built_);
+  prepare(*inst_, inputs, outputs);
+  // all ops run in one parallel region instead of one region for each
+  parallel(ctx,
+           [&](int ithr, int nthr) { infer_thread(*inst_, ithr, nthr); });
+}
+
+std::shared_future<void> network::run_async(
+    const std::vector<std::unique_ptr<memory>> &inputs,
+    std::vector<std::unique_ptr<memory>> &outputs,
+    const exec_ctx &ctx) {
+  last_ = queue_->enqueue(
+      [this, &inputs, &outputs, ctx] { run(inputs, outputs, ctx); });
+  return last_;
+}
+
+void network::wait() {
+  if (last_.valid()) {
+    last_.wait();
+  }
+}
+
+void network::prepare(instance &inst,
+                      const std::vector<std::unique_ptr<memory>> &inputs,
+                      std::vector<std::unique_ptr<memory>> &outputs) {
+  bool changed = bind(inst, inputs_, inputs);
+  changed = bind(inst, outputs_, outputs) || changed;
+  if (changed || inst.ops.empty()) {
+    create_ops(inst);
+  }
+}
+
+void network::infer_thread(instance &inst, int ithr, int nthr) {
+  for (size_t s = 0; s + 1 < stages_.size(); ++s) {
+    // the srcs of next stage are written by all threads
+    if (s > 0) {
+      barrier();
+    }
+    const int first = stages_[s], nops = stages_[s + 1] - first;
+    if (nops == 1 || nthr < nops) {
+      // the ops are independent, so no barrier between them
+      for (int i = first; i < first + nops; ++i) {
+        inst.ops[i]->infer_thread(ithr, nthr);
+      }
+      continue;
+    }
+    // each op runs on its own threads, one and the rest in proportion to
+    // its work, which is rounded on the running sum to add up to nthr.
+    // No op of a network waits at barrier() inside.
+    double total = 0, sum = 0;
+    for (int i = first; i < first + nops; ++i) {
+      total += layers_[i]->work;
+    }
+    const int extra = nthr - nops;
+    int begin = 0;
+    for (int i = 0; i < nops; ++i) {
+      sum += layers_[first + i]->work;
+      int end = i == nops - 1 ? nthr : i + 1 + int(extra * sum / total);
+      if (ithr < end) {
+        inst.ops[first + i]->infer_thread(ithr - begin, end - begin);
+        break;
+      }
+      begin = end;
+    }
+  }
+}
+}
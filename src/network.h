@@ -0,0 +1,95 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#pragma once
+
+#include <jitinfer.h>
+
+namespace jitinfer {
+
+struct network::tensor {
+  memory::nchw_dims dims;
+  memory::dtype dt;
+  int producer;     // index of the first layer writing it, -1 for input
+  int last_reader;  // index of the last layer reading it
+  bool is_output;
+  int view_of;  // the concat output it is a channel view of, -1 if not
+  int c_offset;
+  size_t offset;  // in arena, only for intermediate tensors
+};
+
+struct network::layer {
+  enum layer_kind {
+    layer_conv = 0,
+    layer_pool,
+    layer_concat,
+    layer_eltwise,
+    layer_binary,
+    layer_resize,
+    layer_inner_product,
+  };
+  layer_kind kind;
+  std::vector<int> srcs;  // the second src of conv is the fused sum
+  int dst;
+  // the weights of user, nullptr if not given
+  const std::unique_ptr<memory> *wei, *bia;
+  std::array<int, 2> sz_kernel, sz_stride, sz_padding;
+  bool post_relu;
+  std::vector<float> scales;
+  round_mode rmode;
+  // the fused conv1x1 after conv
+  const std::unique_ptr<memory> *wei1x1, *bia1x1;
+  bool conv1_relu;
+  std::vector<float> conv1_scales;
+  round_mode conv1_rmode;
+  pooling_kind pkind;
+  eltwise_kind ekind;
+  float alpha, beta;
+  binary_kind bkind;
+  resize_kind rkind;
+  double work;  // to split the threads of a stage, set by build
+
+  const char *name() const {
+    switch (kind) {
+      case layer_conv:
+        return "conv";
+      case layer_pool:
+        return "pool";
+      case layer_concat:
+        return "concat";
+      case layer_eltwise:
+        return "eltwise";
+      case layer_binary:
+        return "binary";
+      case layer_resize:
+        return "resize";
+      case layer_inner_product:
+        return "inner_product";
+      default:
+        return "unknown";
+    }
+  }
+};
+
+// the memories, arena and ops to run a network, each stream has its own
+// while the layers and weights are shared
+struct network::instance {
+  instance() : arena(nullptr) {}
+  ~instance();
+  std::vector<std::unique_ptr<memory>> mems;  // of each tensor
+  std::vector<std::unique_ptr<op>> ops;
+  void *arena;
+};
+}
@@ -0,0 +1,326 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+/**
+ * Model file of network, all numbers are in the byte order of the host:
+ *   header:  magic "JITINFER", version, page size,
+ *            offset and size of graph, offset and size of weights
+ *   graph:   tensors, inputs, outputs, layers and the table of weights
+ *   weights: the buffer of each weight starts at a page of the file
+ */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include <map>
+#include "log.h"
+#include "network.h"
+#include "util_jitinfer.h"
+
+namespace jitinfer {
+
+static const char model_magic[8] = {'J', 'I', 'T', 'I', 'N', 'F', 'E', 'R'};
+// increase it when the layout of graph changes
+constexpr uint32_t model_version = 1;
+constexpr size_t model_page_size = 4096;
+
+struct model_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t page_size;
+  uint64_t graph_offset, graph_size;
+  uint64_t weights_offset, weights_size;
+};
+
+static size_t page_align(size_t sz) {
+  return (sz + model_page_size - 1) / model_page_size * model_page_size;
+}
+
+// append plain values and vectors of them to a byte buffer
+class model_writer {
+public:
+  template <typename T>
+  void put(const T &v) {
+    buf_.append(reinterpret_cast<const char *>(&v), sizeof(T));
+  }
+  template <typename T>
+  void put(const std::vector<T> &v) {
+    put<uint32_t>(v.size());
+    buf_.append(reinterpret_cast<const char *>(v.data()), v.size() * sizeof(T));
+  }
+  const std::string &data() { return buf_; }
+
+private:
+  std::string buf_;
+};
+
+// read what model_writer puts, exit if out of the buffer
+class model_reader {
+public:
+  explicit model_reader(const char *p, size_t size) : p_(p), end_(p + size) {}
+  template <typename T>
+  T get() {
+    T v;
+    if (sizeof(T) > size_t(end_ - p_)) {
+      error_and_exit("Bad model file, graph is truncated");
+    }
+    memcpy(&v, p_, sizeof(T));
+    p_ += sizeof(T);
+    return v;
+  }
+  template <typename T>
+  std::vector<T> get_vector() {
+    // the count is checked before the vector is allocated by it
+    uint32_t count = get<uint32_t>();
+    if (count > size_t(end_ - p_) / sizeof(T)) {
+      error_and_exit("Bad model file, graph is truncated");
+    }
+    std::vector<T> v(count);
+    for (auto &i : v) {
+      i = get<T>();
+    }
+    return v;
+  }
+
+private:
+  const char *p_;
+  const char *end_;
+};
+
+void network::save(const std::string &path) {
+  // the weights are given as the addresses of user memories
+  std::map<const memory *, int> index;
+  std::vector<memory *> weights;
+  auto weight_index = [&](const std::unique_ptr<memory> *p) {
+    if (p == nullptr) {
+      return -1;
+    }
+    auto it = index.find(p->get());
+    if (it != index.end()) {
+      return it->second;
+    }
+    weights.push_back(p->get());
+    index[p->get()] = weights.size() - 1;
+    return int(weights.size() - 1);
+  };
+
+  model_writer w;
+  w.put<uint32_t>(tensors_.size());
+  for (auto &t : tensors_) {
+    w.put(t->dims);
+    w.put<int32_t>(t->dt);
+    w.put<int32_t>(t->view_of);
+    w.put<int32_t>(t->c_offset);
+  }
+  w.put(inputs_);
+  w.put(outputs_);
+  w.put<uint32_t>(layers_.size());
+  for (auto &l : layers_) {
+    w.put<int32_t>(l->kind);
+    w.put(l->srcs);
+    w.put<int32_t>(l->dst);
+    w.put<int32_t>(weight_index(l->wei));
+    w.put<int32_t>(weight_index(l->bia));
+    w.put(l->sz_kernel);
+    w.put(l->sz_stride);
+    w.put(l->sz_padding);
+    w.put<int32_t>(l->post_relu);
+    w.put(l->scales);
+    w.put<int32_t>(l->rmode);
+    w.put<int32_t>(weight_index(l->wei1x1));
+    w.put<int32_t>(weight_index(l->bia1x1));
+    w.put<int32_t>(l->conv1_relu);
+    w.put(l->conv1_scales);
+    w.put<int32_t>(l->conv1_rmode);
+    w.put<int32_t>(l->pkind);
+    w.put<int32_t>(l->ekind);
+    w.put(l->alpha);
+    w.put(l->beta);
+    w.put<int32_t>(l->bkind);
+    w.put<int32_t>(l->rkind);
+  }
+  uint64_t weights_size = 0;
+  w.put<uint32_t>(weights.size());
+  for (auto *m : weights) {
+    w.put(m->std_dims());
+    w.put<int32_t>(m->dim_format());
+    w.put<int32_t>(m->data_type());
+    w.put<uint64_t>(weights_size);  // offset in weights
+    w.put<uint64_t>(m->buffer_size());
+    weights_size += page_align(m->buffer_size());
+  }
+
+  model_header h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, model_magic, sizeof(h.magic));
+  h.version = model_version;
+  h.page_size = model_page_size;
+  h.graph_offset = sizeof(h);
+  h.graph_size = w.data().size();
+  h.weights_offset = page_align(h.graph_offset + h.graph_size);
+  h.weights_size = weights_size;
+
+  FILE *fp = fopen(path.c_str(), "wb");
+  if (fp == nullptr) {
+    error_and_exit("Can not open %s", path.c_str());
+  }
+  bool ok = fwrite(&h, sizeof(h), 1, fp) == 1 &&
+            fwrite(w.data().data(), 1, h.graph_size, fp) == h.graph_size;
+  // zeros padding each weight to the next page
+  const std::vector<char> zeros(model_page_size, 0);
+  size_t pos = h.graph_offset + h.graph_size;
+  ok = ok && fwrite(zeros.data(), 1, h.weights_offset - pos, fp) ==
+                 h.weights_offset - pos;
+  for (auto *m : weights) {
+    size_t sz = m->buffer_size();
+    size_t pad = page_align(sz) - sz;
+    ok = ok && fwrite(m->data(), 1, sz, fp) == sz &&
+         fwrite(zeros.data(), 1, pad, fp) == pad;
+  }
+  if (fclose(fp) != 0 || !ok) {
+    error_and_exit("Write %s failed", path.c_str());
+  }
+}
+
+std::unique_ptr<network> network::load(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    error_and_exit("Can not open %s", path.c_str());
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(model_header)) {
+    error_and_exit("Bad model file %s", path.c_str());
+  }
+  const size_t size = st.st_size;
+  // read only and shared, so the pages of weights are shared by processes
+  void *map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    error_and_exit("Can not map %s", path.c_str());
+  }
+  std::unique_ptr<network> net(new network());
+  net->map_ = map;
+  net->map_size_ = size;
+
+  const char *base = reinterpret_cast<const char *>(map);
+  model_header h;
+  memcpy(&h, base, sizeof(h));
+  if (memcmp(h.magic, model_magic, sizeof(h.magic)) != 0) {
+    error_and_exit("%s is not a jitinfer model", path.c_str());
+  }
+  if (h.version != model_version) {
+    error_and_exit("Model version %u is not supported, expected %u",
+                   h.version,
+                   model_version);
+  }
+  if (h.page_size != model_page_size ||
+      h.graph_offset + h.graph_size > size ||
+      h.weights_offset + h.weights_size > size) {
+    error_and_exit("Bad model file %s", path.c_str());
+  }
+
+  model_reader r(base + h.graph_offset, h.graph_size);
+  const uint32_t n_tensors = r.get<uint32_t>();
+  for (uint32_t i = 0; i < n_tensors; ++i) {
+    std::unique_ptr<tensor> t(new tensor());
+    t->dims = r.get<memory::nchw_dims>();
+    t->dt = static_cast<memory::dtype>(r.get<int32_t>());
+    t->view_of = r.get<int32_t>();
+    t->c_offset = r.get<int32_t>();
+    net->tensors_.push_back(std::move(t));
+  }
+  auto check_id = [&](int id) {
+    if (id < 0 || id >= int(n_tensors)) {
+      error_and_exit("Bad tensor id %d in model", id);
+    }
+  };
+  net->inputs_ = r.get_vector<int>();
+  net->outputs_ = r.get_vector<int>();
+  for (int id : net->inputs_) {
+    check_id(id);
+  }
+  for (int id : net->outputs_) {
+    check_id(id);
+    net->tensors_[id]->is_output = true;
+  }
+
+  // the weights are read after layers, keep their indices first
+  std::vector<std::array<int, 4>> layer_weights;
+  const uint32_t n_layers = r.get<uint32_t>();
+  for (uint32_t i = 0; i < n_layers; ++i) {
+    std::unique_ptr<layer> l(new layer());
+    std::array<int, 4> wi;
+    l->kind = static_cast<layer::layer_kind>(r.get<int32_t>());
+    l->srcs = r.get_vector<int>();
+    l->dst = r.get<int32_t>();
+    wi[0] = r.get<int32_t>();
+    wi[1] = r.get<int32_t>();
+    l->sz_kernel = r.get<std::array<int, 2>>();
+    l->sz_stride = r.get<std::array<int, 2>>();
+    l->sz_padding = r.get<std::array<int, 2>>();
+    l->post_relu = r.get<int32_t>();
+    l->scales = r.get_vector<float>();
+    l->rmode = static_cast<round_mode>(r.get<int32_t>());
+    wi[2] = r.get<int32_t>();
+    wi[3] = r.get<int32_t>();
+    l->conv1_relu = r.get<int32_t>();
+    l->conv1_scales = r.get_vector<float>();
+    l->conv1_rmode = static_cast<round_mode>(r.get<int32_t>());
+    l->pkind = static_cast<pooling_kind>(r.get<int32_t>());
+    l->ekind = static_cast<eltwise_kind>(r.get<int32_t>());
+    l->alpha = r.get<float>();
+    l->beta = r.get<float>();
+    l->bkind = static_cast<binary_kind>(r.get<int32_t>());
+    l->rkind = static_cast<resize_kind>(r.get<int32_t>());
+    for (int src : l->srcs) {
+      check_id(src);
+    }
+    check_id(l->dst);
+    layer_weights.push_back(wi);
+    net->layers_.push_back(std::move(l));
+  }
+
+  const uint32_t n_weights = r.get<uint32_t>();
+  for (uint32_t i = 0; i < n_weights; ++i) {
+    auto dims = r.get<memory::nchw_dims>();
+    auto fmt = static_cast<memory::format>(r.get<int32_t>());
+    auto dt = static_cast<memory::dtype>(r.get<int32_t>());
+    auto offset = r.get<uint64_t>();
+    auto bytes = r.get<uint64_t>();
+    if (offset % model_page_size != 0 || offset + bytes > h.weights_size) {
+      error_and_exit("Bad weight %u in model", i);
+    }
+    // the ops only read weights, so they can be on the read only pages
+    void *data = const_cast<char *>(base + h.weights_offset + offset);
+    net->weights_.emplace_back(new memory(dims, fmt, dt, data));
+    check_eq(net->weights_.back()->buffer_size(), bytes);
+  }
+  auto weight = [&](int idx) -> const std::unique_ptr<memory> * {
+    if (idx < -1 || idx >= int(n_weights)) {
+      error_and_exit("Bad weight index %d in model", idx);
+    }
+    return idx < 0 ? nullptr : &net->weights_[idx];
+  };
+  for (size_t i = 0; i < net->layers_.size(); ++i) {
+    auto &l = net->layers_[i];
+    l->wei = weight(layer_weights[i][0]);
+    l->bia = weight(layer_weights[i][1]);
+    l->wei1x1 = weight(layer_weights[i][2]);
+    l->bia1x1 = weight(layer_weights[i][3]);
+  }
+  return net;
+}
+}
@@ -0,0 +1,60 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#pragma once
+
+#include <jitinfer.h>
+#include "jit_binary_kernel.h"
+#include "log.h"
+#include "thread_pool.h"
+
+namespace jitinfer {
+
+template <typename dtype>
+class op_binary : public op {
+public:
+  explicit op_binary(const std::unique_ptr<memory> &src0,
+                     const std::unique_ptr<memory> &src1,
+                     std::unique_ptr<memory> &dst,
+                     binary_kind kind,
+                     bool post_relu = false)
+      : op() {
+    auto conf = util::zero<jit::jit_binary_conf_t>();
+    if (!init_conf(conf, src0, src1, dst, kind, post_relu)) {
+      error_and_exit("Init Binary op failed!");
+    }
+    kernel_ = jit::get_kernel<jit::jit_binary_kernel>(conf);
+    src0_data_ = reinterpret_cast<const dtype *>(src0->data());
+    src1_data_ = reinterpret_cast<const dtype *>(src1->data());
+    dst_data_ = reinterpret_cast<dtype *>(dst->data());
+  }
+
+protected:
+  bool init_conf(jit::jit_binary_conf_t &conf,
+                 const std::unique_ptr<memory> &src0,
+                 const std::unique_ptr<memory> &src1,
+                 const std::unique_ptr<memory> &dst,
+                 binary_kind kind,
+                 bool post_relu);
+  void infer_thread(int ithr, int nthr) override;
+  const char *name() { return "binary"; }
+
+private:
+  std::shared_ptr<jit::jit_binary_kernel> kernel_;
+  const dtype *src0_data_;
+  const dtype *src1_data_;
+  dtype *dst_data_;
+};
+}
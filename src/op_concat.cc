@@ -19,53 +19,28 @@
 namespace jitinfer {
 
 template <typename dtype>
-void op_concat<dtype>::infer() {
+void op_concat<dtype>::infer_thread(int ithr, int nthr) {
   using namespace util;
   const auto &jcp = kernel_->jcp_;
 
   const int work_amount = jcp.bs * jcp.h * jcp.w;
-  const int max = omp_get_max_threads();
-
-  if (work_amount < max) {
-#pragma omp parallel for schedule(static) collapse(1)
-    for (int iwork = 0; iwork < max; ++iwork) {
-      int n{0}, h{0}, w{0};
-      nd_iterator_init(iwork, n, jcp.bs, h, jcp.h, w, jcp.w);
-      int nhw = n * (jcp.h * jcp.w) + h * (jcp.w) + w;
-      auto srcs = src_with_offset_ + iwork * jcp.n_inputs;
-      for (int i = 0; i < jcp.n_inputs; ++i) {
-        srcs[i] = srcs_data_[i] + (nhw * ic_[i]);
-      }
-      jit::jit_concat_call_s p = {0};
-      p.src = reinterpret_cast<const void **>(srcs);
-      p.nb_ic = reinterpret_cast<const int *>(nb_ic_);
-      p.dst = reinterpret_cast<void *>(dst_data_ + nhw * jcp.oc);
-      kernel_->jit_ker_(&p);
-    }
-  } else {
-// if work amount > max omp threads, need balance
-#pragma omp parallel
-    {
-      int ithr = omp_get_thread_num(), nthr = omp_get_num_threads();
-      int start{0}, end{0};
-      balance211(work_amount, nthr, ithr, start, end);
-      int n{0}, h{0}, w{0};
-      nd_iterator_init(start, n, jcp.bs, h, jcp.h, w, jcp.w);
-      auto srcs = src_with_offset_ + ithr * jcp.n_inputs;
-      jit::jit_concat_call_s p = {0};
-      for (int iwork = start; iwork < end; ++iwork) {
-        int nhw = n * (jcp.h * jcp.w) + h * (jcp.w) + w;
-        for (int i = 0; i < jcp.n_inputs; ++i) {
-          srcs[i] = srcs_data_[i] + (nhw * ic_[i]);
-        }
-        p.src = reinterpret_cast<const void **>(srcs);
-        p.nb_ic = reinterpret_cast<const int *>(nb_ic_);
-        p.dst = reinterpret_cast<void *>(dst_data_ + nhw * jcp.oc);
-        // one kernel move one dst oc from all srcs
-        kernel_->jit_ker_(&p);
-        nd_iterator_step(n, jcp.bs, h, jcp.h, w, jcp.w);
-      }
+  int start{0}, end{0};
+  balance211(work_amount, nthr, ithr, start, end);
+  int n{0}, h{0}, w{0};
+  nd_iterator_init(start, n, jcp.bs, h, jcp.h, w, jcp.w);
+  auto srcs = src_with_offset_ + ithr * jcp.n_inputs;
+  jit::jit_concat_call_s p = {0};
+  for (int iwork = start; iwork < end; ++iwork) {
+    int nhw = n * (jcp.h * jcp.w) + h * (jcp.w) + w;
+    for (int i = 0; i < jcp.n_inputs; ++i) {
+      srcs[i] = srcs_data_[i] + (nhw * ld_[i]);
     }
+    p.src = reinterpret_cast<const void **>(srcs);
+    p.nb_ic = reinterpret_cast<const int *>(nb_ic_);
+    p.dst = reinterpret_cast<void *>(dst_data_ + nhw * dst_ld_);
+    // one kernel move one dst oc from all srcs
+    kernel_->jit_ker_(&p);
+    nd_iterator_step(n, jcp.bs, h, jcp.h, w, jcp.w);
   }
 }
 
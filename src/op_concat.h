@@ -18,7 +18,7 @@
 #include <jitinfer.h>
 #include "jit_concat_kernel.h"
 #include "log.h"
-#include "omp_thread.h"
+#include "thread_pool.h"
 
 namespace jitinfer {
 
@@ -29,12 +29,12 @@ public:
                      std::unique_ptr<memory> &dst,
                      bool post_relu = false)
       : op() {
-    jit::jit_concat_conf_t conf;
+    auto conf = util::zero<jit::jit_concat_conf_t>();
     if (!init_conf(conf, srcs, dst, post_relu)) {
       error_and_exit("Init Concat op failed!");
     }
 
-    kernel_ = new jit::jit_concat_kernel(conf);
+    kernel_ = jit::get_kernel<jit::jit_concat_kernel>(conf);
 
     const auto &jcp = kernel_->jcp_;
     const int num_srcs = jcp.n_inputs;
@@ -43,20 +43,23 @@ public:
     srcs_data_ = (const dtype **)aligned_malloc(num_srcs * sizeof(dtype *), 64);
     ic_ = (int *)aligned_malloc(num_srcs * sizeof(int), 64);
     nb_ic_ = (int *)aligned_malloc(num_srcs * sizeof(int), 64);
+    ld_ = (int *)aligned_malloc(num_srcs * sizeof(int), 64);
 
     for (int i = 0; i < num_srcs; ++i) {
       auto dim = srcs[i]->actual_dims();
       assert(srcs[i]->dim_format() == memory::format::nhwc);
       ic_[i] = dim[3];
       nb_ic_[i] = ic_[i] / jcp.block;
+      ld_[i] = srcs[i]->ld();  // srcs can be views
       check_eq(nb_ic_[i] * jcp.block, ic_[i]);
       // the src data is load here, if need update whe infer should change API
       srcs_data_[i] = reinterpret_cast<const dtype *>(srcs[i]->data());
     }
     dst_data_ = (dtype *)dst->data();
+    dst_ld_ = dst->ld();
 
-    const int nthreads = omp_get_max_threads();
-    debug("Concat: Max OMP threads: %d", nthreads);
+    const int nthreads = get_max_threads();
+    debug("Concat: Max threads: %d", nthreads);
     src_with_offset_ = (const dtype **)aligned_malloc(
         nthreads * num_srcs * sizeof(dtype *), 4096);
   }
@@ -64,9 +67,9 @@ public:
   ~op_concat() {
     free(ic_);
     free(nb_ic_);
+    free(ld_);
     free(srcs_data_);
     free(src_with_offset_);
-    delete kernel_;
   }
 
 protected:
@@ -78,15 +81,17 @@ protected:
     // before run into kernel init_conf
     return jit::jit_concat_kernel::init_conf(conf, srcs, dst, post_relu);
   }
-  void infer() override;
+  void infer_thread(int ithr, int nthr) override;
   const char *name() { return "concat"; }
 
 private:
-  jit::jit_concat_kernel *kernel_;
+  std::shared_ptr<jit::jit_concat_kernel> kernel_;
   dtype *dst_data_;
   const dtype **srcs_data_;
   const dtype **src_with_offset_;
   int *ic_;
   int *nb_ic_;
+  int *ld_;
+  int dst_ld_;
 };
 }
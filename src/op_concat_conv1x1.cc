@@ -0,0 +1,176 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "op_concat_conv1x1.h"
+#include "jit_conv_kernel.h"  // scales_extended_size
+#include "log.h"
+#include "thread_pool.h"
+#include "util_jitinfer.h"
+
+namespace jitinfer {
+
+template <typename dst_data_t>
+op_concat_conv1x1<dst_data_t>::op_concat_conv1x1(
+    const std::vector<std::unique_ptr<memory>> &srcs,
+    const std::unique_ptr<memory> &wei,
+    const std::unique_ptr<memory> &bia,
+    std::unique_ptr<memory> &dst,
+    bool post_relu,
+    const std::vector<float> &scales,
+    round_mode rmode)
+    : op() {
+  using namespace util;
+  if (!init_conf(srcs, wei, bia, dst, scales)) {
+    error_and_exit("Init ConcatConv1x1 op failed!");
+  }
+  auto dst_dims = dst->std_dims();  // nchw
+  auto wei_dims = wei->std_dims();  // oihw
+  const int m = dst_dims[0] * dst_dims[2] * dst_dims[3];
+  const int n = wei_dims[0];
+  const int k = wei_dims[1];
+
+  std::vector<int> srcs_k;
+  for (size_t i = 0; i < srcs.size(); ++i) {
+    srcs_data_.push_back(reinterpret_cast<const src_data_t *>(srcs[i]->data()));
+    srcs_k.push_back(srcs[i]->std_dims()[1]);
+    ld_.push_back(srcs[i]->ld());
+  }
+
+  auto conf = util::zero<jit::jit_gemm_conf_t>();
+  if (!jit::jit_gemm_kernel::init_conf(
+          conf,
+          m,
+          n,
+          k,
+          srcs.size() > 1 ? k : ld_[0],
+          dst->ld(),
+          type2dtype<dst_data_t>::dtype,
+          bia != nullptr ? bia->data_type() : memory::dtype::undef,
+          scales.size(),
+          post_relu,
+          rmode,
+          get_max_threads())) {
+    error_and_exit("Init ConcatConv1x1 op failed!");
+  }
+  if (srcs.size() > 1 && !jit::jit_gemm_kernel::init_srcs(conf, srcs_k, ld_)) {
+    error_and_exit("Init ConcatConv1x1 op failed!");
+  }
+  kernel_ = jit::get_kernel<jit::jit_gemm_kernel>(conf);
+
+  scales_data_ = util::extend_scales(scales, scales_extended_size);
+
+  wei_data_ = reinterpret_cast<const wei_data_t *>(wei->data());
+  bia_data_ =
+      bia != nullptr ? reinterpret_cast<const char *>(bia->data()) : nullptr;
+  dst_data_ = reinterpret_cast<dst_data_t *>(dst->data());
+}
+
+template <typename dst_data_t>
+op_concat_conv1x1<dst_data_t>::~op_concat_conv1x1() {
+  free(scales_data_);
+}
+
+template <typename dst_data_t>
+bool op_concat_conv1x1<dst_data_t>::init_conf(
+    const std::vector<std::unique_ptr<memory>> &srcs,
+    const std::unique_ptr<memory> &wei,
+    const std::unique_ptr<memory> &bia,
+    std::unique_ptr<memory> &dst,
+    const std::vector<float> &scales) {
+  using namespace util;
+  if (!all_true(!srcs.empty(), (int)srcs.size() <= jit::max_gemm_srcs)) {
+    info("Size of srcs is not supported");
+    return false;
+  }
+  if (!all_true(wei->data_type() == memory::dtype::s8,
+                wei->dim_format() == memory::format::OIhw4i16o4i,
+                dst->data_type() == type2dtype<dst_data_t>::dtype,
+                dst->dim_format() == memory::format::nhwc,
+                bia == nullptr || bia->dim_format() == memory::format::x)) {
+    info("Data type or format do not match");
+    return false;
+  }
+  auto wei_dims = wei->std_dims();  // oihw
+  auto dst_dims = dst->std_dims();  // nchw
+  int ic = 0;
+  for (size_t i = 0; i < srcs.size(); ++i) {
+    auto src_dims = srcs[i]->std_dims();  // nchw
+    if (!all_true(srcs[i]->data_type() == memory::dtype::u8,
+                  srcs[i]->dim_format() == memory::format::nhwc,
+                  src_dims[0] == dst_dims[0],
+                  src_dims[2] == dst_dims[2],
+                  src_dims[3] == dst_dims[3])) {
+      info("Src %d does not match", (int)i);
+      return false;
+    }
+    ic += src_dims[1];
+  }
+  if (!all_true(wei_dims[1] == ic,
+                wei_dims[2] == 1,
+                wei_dims[3] == 1,
+                dst_dims[1] == wei_dims[0],
+                bia == nullptr || bia->std_dims()[0] == wei_dims[0],
+                scales.size() == 1 || (int)scales.size() == wei_dims[0])) {
+    info("Dims do not match");
+    return false;
+  }
+  return true;
+}
+
+template <typename dst_data_t>
+void op_concat_conv1x1<dst_data_t>::infer_thread(int ithr, int nthr) {
+  using namespace util;
+  const auto &jcp = kernel_->jcp_;
+  const int nb_srcs = srcs_data_.size();
+
+  int n_chunks = jcp.nb_n / jcp.nb_n_blocking;
+  int m_chunks = div_up(jcp.m, jcp.ur_m);
+
+  // n is the outer loop, so the B chunk stays in cache along m
+  int start{0}, end{0};
+  int work_amount = n_chunks * m_chunks;
+  balance211(work_amount, nthr, ithr, start, end);
+
+  // the first row of each src of this call
+  const void *srcs[jit::max_gemm_srcs];
+  jit::jit_gemm_call_s p = {0};
+  p.srcs = srcs;
+  int iwork = start;
+  while (iwork < end) {
+    int nc = iwork / m_chunks;
+    int mc = iwork % m_chunks;
+    // all the m chunks of this n chunk are done in one call
+    int mc_end = std::min(m_chunks, mc + end - iwork);
+    int n_off = nc * jcp.nb_n_blocking * jcp.n_block;
+    int m_off = mc * jcp.ur_m;
+    for (int s = 0; s < nb_srcs; ++s) {
+      srcs[s] = srcs_data_[s] + (size_t)m_off * ld_[s];
+    }
+    p.a = srcs[0];
+    p.b = wei_data_ + (size_t)n_off * jcp.k;
+    p.c = dst_data_ + (size_t)m_off * jcp.ldc + n_off;
+    p.bia = bia_data_ ? bia_data_ + n_off * jcp.typesize_bia : nullptr;
+    p.scales = jcp.multi_n_scale ? scales_data_ + n_off : scales_data_;
+    p.m = std::min(mc_end * jcp.ur_m, jcp.m) - m_off;
+    kernel_->jit_ker_(&p);
+    iwork += mc_end - mc;
+  }
+}
+
+template class op_concat_conv1x1<f32>;
+template class op_concat_conv1x1<s32>;
+template class op_concat_conv1x1<s8>;
+template class op_concat_conv1x1<u8>;
+}
@@ -0,0 +1,60 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#pragma once
+
+#include <jitinfer.h>
+#include "jit_gemm_kernel.h"
+
+namespace jitinfer {
+
+// conv1x1 on the concat of srcs, such as the layers of densenet.
+// The gemm kernel reads A from all srcs on k, so the concat is never written,
+// and each src can be a channel view of a bigger memory.
+template <typename dst_data_t>
+class op_concat_conv1x1 : public op {
+  typedef u8 src_data_t;
+  typedef s8 wei_data_t;
+
+public:
+  explicit op_concat_conv1x1(const std::vector<std::unique_ptr<memory>> &srcs,
+                             const std::unique_ptr<memory> &wei,
+                             const std::unique_ptr<memory> &bia,
+                             std::unique_ptr<memory> &dst,
+                             bool post_relu,
+                             const std::vector<float> &scales,
+                             round_mode rmode);
+
+  ~op_concat_conv1x1();
+
+protected:
+  bool init_conf(const std::vector<std::unique_ptr<memory>> &srcs,
+                 const std::unique_ptr<memory> &wei,
+                 const std::unique_ptr<memory> &bia,
+                 std::unique_ptr<memory> &dst,
+                 const std::vector<float> &scales);
+  void infer_thread(int ithr, int nthr) override;
+  const char *name() { return "concat_conv1x1"; }
+
+private:
+  std::vector<const src_data_t *> srcs_data_;
+  std::vector<int> ld_;  // ld of each src, srcs can be views
+  const wei_data_t *wei_data_;
+  const char *bia_data_;
+  float *scales_data_;
+  dst_data_t *dst_data_;
+  std::shared_ptr<jit::jit_gemm_kernel> kernel_;
+};
+}
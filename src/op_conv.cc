@@ -14,8 +14,12 @@
  * limitations under the License.
 *******************************************************************************/
 #include "op_conv.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
 #include "log.h"
-#include "omp_thread.h"
+#include "thread_pool.h"
 #include "util_jitinfer.h"
 
 namespace jitinfer {
@@ -34,9 +38,27 @@ op_conv<dst_data_t>::op_conv(const std::unique_ptr<memory> &src,
                              bool conv0_relu,
                              bool conv1_relu,
                              round_mode conv0_round_mode,
-                             round_mode conv1_round_mode)
-    : op(), fuse_conv1x1_(wei1x1 != nullptr) {
-  jit::jit_conv_conf_t conf;
+                             round_mode conv1_round_mode,
+                             std::array<int, 2> sz_pool_kernel,
+                             std::array<int, 2> sz_pool_stride,
+                             std::array<int, 2> sz_pool_padding,
+                             bool global_avg_pool,
+                             int shuffle_groups,
+                             const std::unique_ptr<memory> &sum,
+                             float sum_scale)
+    : op(),
+      fuse_conv1x1_(wei1x1 != nullptr),
+      fuse_pool_(sz_pool_kernel[0] > 0 && sz_pool_kernel[1] > 0),
+      fuse_global_pool_(global_avg_pool),
+      sum_data_(sum != nullptr ? sum->data() : nullptr),
+      kernel_(nullptr),
+      pool_kernel_(nullptr),
+      gemm_(nullptr),
+      rows_per_thread_(0),
+      sums_per_thread_(0),
+      rows_(nullptr),
+      sums_(nullptr) {
+  auto conf = util::zero<jit::jit_conv_conf_t>();
   if (!init_conf(conf,
                  src,
                  wei,
@@ -52,13 +74,51 @@ op_conv<dst_data_t>::op_conv(const std::unique_ptr<memory> &src,
                  conv0_relu,
                  conv1_relu,
                  conv0_round_mode,
-                 conv1_round_mode)) {
+                 conv1_round_mode,
+                 sz_pool_kernel,
+                 sz_pool_stride,
+                 sz_pool_padding,
+                 global_avg_pool,
+                 shuffle_groups,
+                 sum)) {
     error_and_exit("Init Conv op failed!");
   }
-  kernel_ = new jit::jit_conv_kernel(conf);
-  const auto &jcp = kernel_->jcp;
-  const int nthreads = omp_get_max_threads();
-  ws_per_thread_ = jcp.oh * jcp.ow * jcp.oc_block * jcp.nb_oc_blocking;
+  const auto &jcp = conf;
+  // plain 1x1 conv is a gemm of (bs*oh*ow) x ic and ic x oc on nhwc
+  if (util::all_true(jcp.kh == 1,
+                     jcp.kw == 1,
+                     jcp.sh == 1,
+                     jcp.sw == 1,
+                     jcp.t_pad == 0,
+                     jcp.l_pad == 0,
+                     jcp.gp == 1,
+                     !fuse_conv1x1_,
+                     !fuse_pool_,
+                     !fuse_global_pool_,
+                     jcp.shuffle_gp == 0)) {
+    gemm_ = new gemm_u8s8s32<dst_data_t>(
+        jcp.bs * jcp.oh * jcp.ow,
+        jcp.oc,
+        jcp.ic,
+        jcp.src_ld,
+        jcp.dst_ld,
+        reinterpret_cast<const wei_data_t *>(wei->data()),
+        bia != nullptr ? bia->data() : nullptr,
+        jcp.conv0_bias_dt,
+        conv0_scales,
+        conv0_relu,
+        conv0_round_mode,
+        false,
+        sum != nullptr ? sum->data_type() : memory::dtype::undef,
+        sum != nullptr ? sum->ld() : 0,
+        sum_scale);
+  } else {
+    kernel_ = jit::get_kernel<jit::jit_conv_kernel>(conf);
+  }
+  const int nthreads = get_max_threads();
+  // fused pool only needs the acc of the rows in one pooling window
+  ws_per_thread_ = (fuse_pool_ ? jcp.pool_kh : jcp.oh) * jcp.ow *
+                   jcp.oc_block * jcp.nb_oc_blocking;
   ws_ = (acc_data_t *)aligned_malloc(
       nthreads * ws_per_thread_ * sizeof(acc_data_t), 4096);  // 64??
   // acc format (h, oc/16, ow, 16o)
@@ -66,25 +126,48 @@ op_conv<dst_data_t>::op_conv(const std::unique_ptr<memory> &src,
   ws1x1_ = (acc_data_t *)aligned_malloc(
       nthreads * ws1x1_per_thread_ * sizeof(acc_data_t), 4096);  // 64??
 
-  // prepare scale data, format: scale * 16
-  conv0_scales_data_ = (float *)aligned_malloc(
-      conv0_scales.size() * scales_extended_size * sizeof(float), 64);
-  conv1_scales_data_ = (float *)aligned_malloc(
-      conv1_scales.size() * scales_extended_size * sizeof(float), 64);
-  auto prepare_scale = [&](float *pdst, const float *psrc, size_t sz) {
-    for (size_t i = 0; i < sz; ++i) {
-      util::set_array(pdst, psrc[i], scales_extended_size);
-      pdst += scales_extended_size;
+  conv0_scales_data_ = util::extend_scales(conv0_scales, scales_extended_size);
+  conv1_scales_data_ = util::extend_scales(conv1_scales, scales_extended_size);
+
+  if (fuse_pool_) {
+    // max pooling on the rows buffer, which is nhwc of one oc chunk
+    auto pconf = util::zero<jit::jit_pool_conf_t>();
+    pconf.bs = jcp.bs;
+    pconf.c = jcp.dst_ld;
+    pconf.ih = jcp.pool_kh;
+    pconf.iw = jcp.ow;
+    pconf.oh = jcp.pool_oh;
+    pconf.ow = jcp.pool_ow;
+    pconf.src_ld = jcp.dst_ld;
+    pconf.kh = jcp.pool_kh;
+    pconf.kw = jcp.pool_kw;
+    pconf.sh = jcp.pool_sh;
+    pconf.sw = jcp.pool_sw;
+    pconf.t_pad = jcp.pool_t_pad;
+    pconf.l_pad = jcp.pool_l_pad;
+    pconf.kind = pooling_max;
+    pconf.dt = jcp.dst_dt;
+    if (!jit::jit_pool_kernel::init_blocking(pconf)) {
+      error_and_exit("Init Conv op failed!");
     }
-  };
-  prepare_scale(conv0_scales_data_, conv0_scales.data(), conv0_scales.size());
-  prepare_scale(conv1_scales_data_, conv1_scales.data(), conv1_scales.size());
+    pool_kernel_ = jit::get_kernel<jit::jit_pool_kernel>(pconf);
+    rows_per_thread_ = jcp.pool_kh * jcp.ow * jcp.dst_ld;
+    rows_ = (dst_data_t *)aligned_malloc(
+        nthreads * rows_per_thread_ * sizeof(dst_data_t), 4096);
+  }
+  if (fuse_global_pool_) {
+    // partial sums of (bs, oc) in each thread
+    sums_per_thread_ = jcp.bs * jcp.oc;
+    sums_ = (float *)aligned_malloc(
+        nthreads * sums_per_thread_ * sizeof(float), 64);
+  }
 
   // save data point
   // TODO: enable update data handle from outside
   src_data_ = reinterpret_cast<const src_data_t *>(src->data());
   wei_data_ = reinterpret_cast<const wei_data_t *>(wei->data());
   dst_data_ = reinterpret_cast<dst_data_t *>(dst->data());
+  dst_ld_ = dst->ld();
   bia_data_ =
       bia != nullptr ? reinterpret_cast<const void *>(bia->data()) : NULL;
   wei1x1_data_ = wei1x1 != nullptr
@@ -100,65 +183,217 @@ op_conv<dst_data_t>::~op_conv() {
   free(ws1x1_);
   free(conv0_scales_data_);
   free(conv1_scales_data_);
-  delete kernel_;
+  free(rows_);
+  free(sums_);
+  delete gemm_;
 }
 
 template <typename dst_data_t>
-void op_conv<dst_data_t>::infer() {
-  if (fuse_conv1x1_) {
-    infer_conv0conv1();
+void op_conv<dst_data_t>::infer_thread(int ithr, int nthr) {
+  if (gemm_) {
+    gemm_->compute_part(ithr, nthr, src_data_, dst_data_, sum_data_);
+  } else if (fuse_conv1x1_) {
+    infer_conv0conv1(ithr, nthr);
+  } else if (fuse_pool_) {
+    infer_conv0pool(ithr, nthr);
   } else {
-    infer_conv0();
+    infer_conv0(ithr, nthr);
   }
 }
 
 template <typename dst_data_t>
-void op_conv<dst_data_t>::infer_conv0() {
+void op_conv<dst_data_t>::infer_conv0(int ithr, int nthr) {
   using namespace util;
   const auto &jcp = kernel_->jcp;
   assert(jcp.nb_oc % jcp.nb_oc_blocking == 0);
   // bias data type can be any of u8,s8,s32,f32
   auto bias_data = reinterpret_cast<const char *>(bia_data_);
 
-#pragma omp parallel
-  {
-    int ithr = omp_get_thread_num(), nthr = omp_get_num_threads();
-    int oc_chunks = jcp.nb_oc / jcp.nb_oc_blocking;
-    int ic_chunks = jcp.nb_ic / jcp.nb_ic_blocking;
-
-    int start{0}, end{0};
-    int work_amount = jcp.bs * jcp.gp * oc_chunks * jcp.oh;
-    balance211(work_amount, nthr, ithr, start, end);
-
-    jit::jit_conv_call_s p = {0};
-    auto ws_l = ws_ + ithr * ws_per_thread_;
-    // TODO: change this to my dim_stride after adding benchmark to check perf
-    // nhwc
-    size_t src_h_stride = jcp.iw * jcp.ic;
-    size_t dst_h_stride = jcp.ow * jcp.oc;
-    // o/16, i/16, h, w, 4i, 16o, 4i
-    size_t wht_h_stride = jcp.kw * 4 * 16 * 4;
-    size_t wht_ic_stride = jcp.kh * wht_h_stride;
-
-    int n{0}, g{0}, occ{0}, oh_s{0};
-    if (jcp.loop_order == loop_cgn) {  // this is default
-      nd_iterator_init(
-          start, occ, oc_chunks, g, jcp.gp, n, jcp.bs, oh_s, jcp.oh);
+  int oc_chunks = jcp.nb_oc / jcp.nb_oc_blocking;
+  int ic_chunks = jcp.nb_ic / jcp.nb_ic_blocking;
+
+  int start{0}, end{0};
+  int work_amount = jcp.bs * jcp.gp * oc_chunks * jcp.oh;
+  balance211(work_amount, nthr, ithr, start, end);
+
+  jit::jit_conv_call_s p = {0};
+  auto ws_l = ws_ + ithr * ws_per_thread_;
+  auto sums_l = sums_ + ithr * sums_per_thread_;
+  if (jcp.fuse_global_pool) {
+    set_array(sums_l, 0.f, sums_per_thread_);
+  }
+  // TODO: change this to my dim_stride after adding benchmark to check perf
+  // nhwc
+  size_t src_h_stride = jcp.iw * jcp.src_ld;
+  size_t dst_h_stride = jcp.ow * jcp.dst_ld;
+  // o/16, i/16, h, w, 4i, 16o, 4i
+  size_t wht_h_stride = jcp.kw * 4 * 16 * 4;
+  size_t wht_ic_stride = jcp.kh * wht_h_stride;
+
+  int n{0}, g{0}, occ{0}, oh_s{0};
+  if (jcp.loop_order == loop_cgn) {  // this is default
+    nd_iterator_init(start, occ, oc_chunks, g, jcp.gp, n, jcp.bs, oh_s, jcp.oh);
+  } else if (jcp.loop_order == loop_gnc) {
+    nd_iterator_init(start, g, jcp.gp, n, jcp.bs, occ, oc_chunks, oh_s, jcp.oh);
+  } else if (jcp.loop_order == loop_ngc) {
+    nd_iterator_init(start, n, jcp.bs, g, jcp.gp, occ, oc_chunks, oh_s, jcp.oh);
+  } else {
+    assert(!"unsupported loop order");
+  }
+
+  while (start < end) {
+    int ocb = occ * jcp.nb_oc_blocking;
+    int g_oc = (g * jcp.nb_oc + ocb) * jcp.oc_block;
+    int g_ic = g * jcp.nb_ic * jcp.oc_block;
+
+    int work_rem = end - start;
+    int ih_s = -jcp.t_pad + oh_s * jcp.sh;
+    int oh_e = oh_s + work_rem > jcp.oh ? jcp.oh : oh_s + work_rem;
+
+    auto bias_w = bias_data ? bias_data + (g_oc * jcp.typesize_conv0_bia) : 0;
+    // the first dst channel of this oc chunk, when shuffle channels
+    int dst_gc = g_oc;
+    if (jcp.shuffle_gp > 0) {
+      int oc_per_gp = jcp.oc / jcp.shuffle_gp;
+      dst_gc = g_oc % oc_per_gp * jcp.shuffle_gp + g_oc / oc_per_gp;
+    }
+    // mkldnn: dst_d.blk_off(n, g_oc, oh_s);
+    auto dst_w = dst_data_ + n * jcp.dst_ld * jcp.oh * jcp.ow + dst_gc +
+                 oh_s * jcp.ow * jcp.dst_ld;
+    auto src_w = src_data_ + n * jcp.src_ld * jcp.ih * jcp.iw + g_ic +
+                 ih_s * jcp.iw * jcp.src_ld;
+    // mkldnn:  wht_blk_off(weights_d, g, ocb, 0);
+    // g, oc/16/g, i/16/g, h, w, 4i, 16o, 4i
+    // oc/16, i/16, h, w, 4i, 16o, 4i
+    auto wht_w =
+        wei_data_ +
+        (jcp.gp > 1
+             ? (g * jcp.oc * jcp.ic * jcp.kh * jcp.kw / jcp.gp / jcp.gp +
+                ocb * jcp.oc_block * jcp.ic * jcp.kh * jcp.kw / jcp.gp)
+             : (ocb * jcp.oc_block * jcp.ic * jcp.kh * jcp.kw));
+    auto scales = jcp.conv0_multi_oc_scale
+                      ? conv0_scales_data_ + g_oc
+                      : conv0_scales_data_;
+
+    for (int icc = 0; icc < ic_chunks; ++icc) {
+      auto src_c = src_w;
+      auto dst_c = dst_w;
+      auto ws_c = ws_l;
+      int icb = icc * jcp.nb_ic_blocking;
+      for (int oj = oh_s, ij = ih_s; oj < oh_e; ++oj, ij += jcp.sh) {
+        int i_t_overflow = -std::min(0, ij);
+        int i_b_overflow = std::max(jcp.ih, ij + jcp.kh) - jcp.ih;
+        int kh_padding = std::max(0, jcp.kh - i_t_overflow - i_b_overflow);
+
+        p.src = src_c + i_t_overflow * src_h_stride;
+        p.wei = wht_w + i_t_overflow * wht_h_stride;
+        p.bia = bias_w;
+        p.acc_s32 = ws_c;
+        p.channel = icb;
+        p.kh_padding = kh_padding;
+        p.scales = scales;
+        // dst is not touched when fuse global pooling
+        p.dst = jcp.fuse_global_pool ? nullptr : dst_c;
+        p.sum = sums_l + n * jcp.oc + g_oc;
+        kernel_->jit_ker_(&p);
+
+        src_c += src_h_stride * jcp.sh;
+        dst_c += dst_h_stride;
+        ws_c += jcp.ow * jcp.oc_block * jcp.nb_oc_blocking;
+      }
+      src_w += jcp.ic_block * jcp.nb_ic_blocking;
+      wht_w += wht_ic_stride * jcp.nb_ic_blocking;
+    }
+
+    if (jcp.loop_order == loop_cgn) {
+      nd_iterator_jump(
+          start, end, occ, oc_chunks, g, jcp.gp, n, jcp.bs, oh_s, jcp.oh);
     } else if (jcp.loop_order == loop_gnc) {
-      nd_iterator_init(
-          start, g, jcp.gp, n, jcp.bs, occ, oc_chunks, oh_s, jcp.oh);
+      nd_iterator_jump(
+          start, end, g, jcp.gp, n, jcp.bs, occ, oc_chunks, oh_s, jcp.oh);
     } else if (jcp.loop_order == loop_ngc) {
-      nd_iterator_init(
-          start, n, jcp.bs, g, jcp.gp, occ, oc_chunks, oh_s, jcp.oh);
+      nd_iterator_jump(
+          start, end, n, jcp.bs, g, jcp.gp, occ, oc_chunks, oh_s, jcp.oh);
     } else {
       assert(!"unsupported loop order");
     }
+  }
+
+  if (jcp.fuse_global_pool) {
+    // reduce the partial sums of all threads to dst (n, c)
+    barrier();
+    const float inv_area = 1.f / (jcp.oh * jcp.ow);
+    balance211(jcp.bs * jcp.oc, nthr, ithr, start, end);
+    for (int i = start; i < end; ++i) {
+      int in = i / jcp.oc, ic = i % jcp.oc;
+      float sum = 0.f;
+      for (int t = 0; t < nthr; ++t) {
+        sum += sums_[t * sums_per_thread_ + i];
+      }
+      float v = sum * inv_area;
+      if (!std::is_same<dst_data_t, f32>::value) {
+        v = std::nearbyint(v);
+      }
+      if (sizeof(dst_data_t) == 1) {
+        // saturate to s8 or u8
+        v = std::max(v, float(std::numeric_limits<dst_data_t>::lowest()));
+        v = std::min(v, float(std::numeric_limits<dst_data_t>::max()));
+      }
+      dst_data_[in * dst_ld_ + ic] = static_cast<dst_data_t>(v);
+    }
+  }
+}
+
+template <typename dst_data_t>
+void op_conv<dst_data_t>::infer_conv0conv1(int ithr, int nthr) {
+  using namespace util;
+  const auto &jcp = kernel_->jcp;
+  assert(jcp.nb_oc % jcp.nb_oc_blocking == 0);
+  assert(jcp.oc1x1 == jcp.nb_oc1x1 * jcp.oc1x1_block);
+  // bias data type can be any of u8,s8,s32,f32
+  auto bias_data = reinterpret_cast<const char *>(bia_data_);
+
+  int oc_chunks = jcp.nb_oc / jcp.nb_oc_blocking;
+  int ic_chunks = jcp.nb_ic / jcp.nb_ic_blocking;
+  int start{0}, end{0};
+  int work_amount = jcp.bs * jcp.gp * jcp.oh;
+  balance211(work_amount, nthr, ithr, start, end);
+
+  jit::jit_conv_call_s p = {0};
+  auto ws_l = ws_ + ithr * ws_per_thread_;
+  auto ws1x1_l = ws1x1_ + ithr * ws1x1_per_thread_;
+
+  size_t src_h_stride = jcp.iw * jcp.src_ld;
+  size_t out1x1_h_stride = jcp.ow * jcp.dst_ld;
+  size_t acc1x1_h_stride = jcp.ow * jcp.oc1x1;
+  // o/16, i/16, h, w, 4i, 16o, 4i
+  size_t wht_h_stride = jcp.kw * 4 * 16 * 4;
+  size_t wht_ic_stride = jcp.kh * wht_h_stride;
+
+  int n{0}, g{0}, oh_s{0};
+  if (jcp.loop_order == loop_cgn) {  // this is default
+    nd_iterator_init(start, g, jcp.gp, n, jcp.bs, oh_s, jcp.oh);
+  } else if (jcp.loop_order == loop_gnc) {
+    nd_iterator_init(start, g, jcp.gp, n, jcp.bs, oh_s, jcp.oh);
+  } else if (jcp.loop_order == loop_ngc) {
+    nd_iterator_init(start, n, jcp.bs, g, jcp.gp, oh_s, jcp.oh);
+  } else {
+    assert(!"unsupported loop order");
+  }
+
+  while (start < end) {
+    auto out1x1_w = dst_data_ + n * (jcp.oh * out1x1_h_stride) +
+                    oh_s * out1x1_h_stride;  // nhwc
+    auto acc1x1_w = ws1x1_l + oh_s * acc1x1_h_stride;
+    auto scales1x1 = conv1_scales_data_;
+    assert(conv1_scales_data_);
 
-    while (start < end) {
+    for (int occ = 0; occ < oc_chunks; ++occ) {
       int ocb = occ * jcp.nb_oc_blocking;
+      // format is OIhw4i16o4i. [oc1x1/16,ic1x1/16, 4i,16o,4i]
+      auto wei1x1_c = wei1x1_data_ + ocb * 4 * 64;
       int g_oc = (g * jcp.nb_oc + ocb) * jcp.oc_block;
       int g_ic = g * jcp.nb_ic * jcp.oc_block;
-
       int work_rem = end - start;
       int ih_s = -jcp.t_pad + oh_s * jcp.sh;
       int oh_e = oh_s + work_rem > jcp.oh ? jcp.oh : oh_s + work_rem;
@@ -167,8 +402,8 @@ void op_conv<dst_data_t>::infer_conv0() {
       // mkldnn: dst_d.blk_off(n, g_oc, oh_s);
       auto dst_w = dst_data_ + n * jcp.oc * jcp.oh * jcp.ow + g_oc +
                    oh_s * jcp.ow * jcp.oc;
-      auto src_w = src_data_ + n * jcp.ic * jcp.ih * jcp.iw + g_ic +
-                   ih_s * jcp.iw * jcp.ic;
+      auto src_w = src_data_ + n * jcp.src_ld * jcp.ih * jcp.iw + g_ic +
+                   ih_s * jcp.iw * jcp.src_ld;
       // mkldnn:  wht_blk_off(weights_d, g, ocb, 0);
       // g, oc/16/g, i/16/g, h, w, 4i, 16o, 4i
       // oc/16, i/16, h, w, 4i, 16o, 4i
@@ -179,13 +414,15 @@ void op_conv<dst_data_t>::infer_conv0() {
                   ocb * jcp.oc_block * jcp.ic * jcp.kh * jcp.kw / jcp.gp)
                : (ocb * jcp.oc_block * jcp.ic * jcp.kh * jcp.kw));
       auto scales = jcp.conv0_multi_oc_scale
-                        ? conv0_scales_data_ + g_oc * scales_extended_size
+                        ? conv0_scales_data_ + g_oc
                         : conv0_scales_data_;
 
       for (int icc = 0; icc < ic_chunks; ++icc) {
         auto src_c = src_w;
-        auto dst_c = dst_w;
+        auto out1x1_c = out1x1_w;
+        auto acc1x1_c = acc1x1_w;
         auto ws_c = ws_l;
+
         int icb = icc * jcp.nb_ic_blocking;
         for (int oj = oh_s, ij = ih_s; oj < oh_e; ++oj, ij += jcp.sh) {
           int i_t_overflow = -std::min(0, ij);
@@ -199,159 +436,151 @@ void op_conv<dst_data_t>::infer_conv0() {
           p.channel = icb;
           p.kh_padding = kh_padding;
           p.scales = scales;
-          p.dst = dst_c;
+
+          p.ocb3x3 = ocb;
+          p.wei1x1 = wei1x1_c;  // oc1x1/16,ic1x1/4, 16o,4i
+          p.bia1x1 = bia1x1_data_;
+          p.acc1x1 = acc1x1_c;  // acc1x1 format is (oh, oc1x1/16, ow, 16o),
+                                // ow is in kernel, so do not need offset
+          p.dst = out1x1_c;     // shoud have ow offset in kernel
+          p.scales1x1 = scales1x1;
+
           kernel_->jit_ker_(&p);
 
           src_c += src_h_stride * jcp.sh;
-          dst_c += dst_h_stride;
+          out1x1_c += out1x1_h_stride;
+          acc1x1_c += acc1x1_h_stride;
           ws_c += jcp.ow * jcp.oc_block * jcp.nb_oc_blocking;
         }
         src_w += jcp.ic_block * jcp.nb_ic_blocking;
         wht_w += wht_ic_stride * jcp.nb_ic_blocking;
       }
-
-      if (jcp.loop_order == loop_cgn) {
-        nd_iterator_jump(
-            start, end, occ, oc_chunks, g, jcp.gp, n, jcp.bs, oh_s, jcp.oh);
-      } else if (jcp.loop_order == loop_gnc) {
-        nd_iterator_jump(
-            start, end, g, jcp.gp, n, jcp.bs, occ, oc_chunks, oh_s, jcp.oh);
-      } else if (jcp.loop_order == loop_ngc) {
-        nd_iterator_jump(
-            start, end, n, jcp.bs, g, jcp.gp, occ, oc_chunks, oh_s, jcp.oh);
-      } else {
-        assert(!"unsupported loop order");
-      }
+    }
+    if (jcp.loop_order == loop_cgn) {
+      nd_iterator_jump(start, end, g, jcp.gp, n, jcp.bs, oh_s, jcp.oh);
+    } else if (jcp.loop_order == loop_gnc) {
+      nd_iterator_jump(start, end, g, jcp.gp, n, jcp.bs, oh_s, jcp.oh);
+    } else if (jcp.loop_order == loop_ngc) {
+      nd_iterator_jump(start, end, n, jcp.bs, g, jcp.gp, oh_s, jcp.oh);
+    } else {
+      assert(!"unsupported loop order");
     }
   }
 }
 
 template <typename dst_data_t>
-void op_conv<dst_data_t>::infer_conv0conv1() {
+void op_conv<dst_data_t>::infer_conv0pool(int ithr, int nthr) {
   using namespace util;
   const auto &jcp = kernel_->jcp;
   assert(jcp.nb_oc % jcp.nb_oc_blocking == 0);
-  assert(jcp.oc1x1 == jcp.nb_oc1x1 * jcp.oc1x1_block);
+  assert(jcp.dst_ld == jcp.oc_block * jcp.nb_oc_blocking);
   // bias data type can be any of u8,s8,s32,f32
   auto bias_data = reinterpret_cast<const char *>(bia_data_);
 
-#pragma omp parallel
-  {
-    int ithr = omp_get_thread_num(), nthr = omp_get_num_threads();
-    int oc_chunks = jcp.nb_oc / jcp.nb_oc_blocking;
-    int ic_chunks = jcp.nb_ic / jcp.nb_ic_blocking;
-    int start{0}, end{0};
-    int work_amount = jcp.bs * jcp.gp * jcp.oh;
-    balance211(work_amount, nthr, ithr, start, end);
-
-    jit::jit_conv_call_s p = {0};
-    auto ws_l = ws_ + ithr * ws_per_thread_;
-    auto ws1x1_l = ws1x1_ + ithr * ws1x1_per_thread_;
-
-    size_t src_h_stride = jcp.iw * jcp.ic;
-    size_t out1x1_h_stride = jcp.ow * jcp.oc1x1;
-    size_t acc1x1_h_stride = jcp.ow * jcp.oc1x1;
-    // o/16, i/16, h, w, 4i, 16o, 4i
-    size_t wht_h_stride = jcp.kw * 4 * 16 * 4;
-    size_t wht_ic_stride = jcp.kh * wht_h_stride;
-
-    int n{0}, g{0}, oh_s{0};
-    if (jcp.loop_order == loop_cgn) {  // this is default
-      nd_iterator_init(start, g, jcp.gp, n, jcp.bs, oh_s, jcp.oh);
-    } else if (jcp.loop_order == loop_gnc) {
-      nd_iterator_init(start, g, jcp.gp, n, jcp.bs, oh_s, jcp.oh);
-    } else if (jcp.loop_order == loop_ngc) {
-      nd_iterator_init(start, n, jcp.bs, g, jcp.gp, oh_s, jcp.oh);
+  int oc_chunks = jcp.nb_oc / jcp.nb_oc_blocking;
+  int ic_chunks = jcp.nb_ic / jcp.nb_ic_blocking;
+  int start{0}, end{0};
+  int work_amount = jcp.bs * jcp.gp * oc_chunks * jcp.pool_oh;
+  balance211(work_amount, nthr, ithr, start, end);
+
+  jit::jit_conv_call_s p = {0};
+  jit::jit_pool_call_s pp = {0};
+  auto ws_l = ws_ + ithr * ws_per_thread_;
+  auto rows_l = rows_ + ithr * rows_per_thread_;
+
+  size_t src_h_stride = jcp.iw * jcp.src_ld;
+  size_t row_stride = jcp.ow * jcp.dst_ld;
+  // o/16, i/16, h, w, 4i, 16o, 4i
+  size_t wht_h_stride = jcp.kw * 4 * 16 * 4;
+  size_t wht_ic_stride = jcp.kh * wht_h_stride;
+
+  // conv output rows [rows_s, rows_e) of last (n, g, occ) are in rows_l,
+  // the overlapped rows of next pooling window are reused
+  int rows_s{0}, rows_e{0}, last_n{-1}, last_g{-1}, last_occ{-1};
+  int n{0}, g{0}, occ{0}, ph{0};
+  nd_iterator_init(
+      start, occ, oc_chunks, g, jcp.gp, n, jcp.bs, ph, jcp.pool_oh);
+  for (int iwork = start; iwork < end; ++iwork) {
+    int ocb = occ * jcp.nb_oc_blocking;
+    int g_oc = (g * jcp.nb_oc + ocb) * jcp.oc_block;
+    int g_ic = g * jcp.nb_ic * jcp.oc_block;
+    int oh_s = std::max(ph * jcp.pool_sh - jcp.pool_t_pad, 0);
+    int oh_e =
+        std::min(ph * jcp.pool_sh - jcp.pool_t_pad + jcp.pool_kh, jcp.oh);
+
+    if (all_true(n == last_n, g == last_g, occ == last_occ) &&
+        oh_s >= rows_s && oh_s < rows_e) {
+      memmove(rows_l,
+              rows_l + (oh_s - rows_s) * row_stride,
+              (rows_e - oh_s) * row_stride * sizeof(dst_data_t));
     } else {
-      assert(!"unsupported loop order");
+      rows_e = oh_s;
     }
+    rows_s = oh_s;
+    last_n = n;
+    last_g = g;
+    last_occ = occ;
+
+    // compute the conv rows [rows_e, oh_e) which are not in buffer yet
+    if (rows_e < oh_e) {
+      int ih_s = -jcp.t_pad + rows_e * jcp.sh;
+      auto bias_w = bias_data ? bias_data + (g_oc * jcp.typesize_conv0_bia) : 0;
+      auto src_w = src_data_ + n * jcp.src_ld * jcp.ih * jcp.iw + g_ic +
+                   ih_s * jcp.iw * jcp.src_ld;
+      auto wht_w =
+          wei_data_ +
+          (jcp.gp > 1
+               ? (g * jcp.oc * jcp.ic * jcp.kh * jcp.kw / jcp.gp / jcp.gp +
+                  ocb * jcp.oc_block * jcp.ic * jcp.kh * jcp.kw / jcp.gp)
+               : (ocb * jcp.oc_block * jcp.ic * jcp.kh * jcp.kw));
+      auto scales = jcp.conv0_multi_oc_scale
+                        ? conv0_scales_data_ + g_oc
+                        : conv0_scales_data_;
 
-    while (start < end) {
-      auto out1x1_w = dst_data_ + n * (jcp.oh * out1x1_h_stride) +
-                      oh_s * out1x1_h_stride;  // nhwc
-      auto acc1x1_w = ws1x1_l + oh_s * acc1x1_h_stride;
-      auto scales1x1 = conv1_scales_data_;
-      assert(conv1_scales_data_);
-
-      for (int occ = 0; occ < oc_chunks; ++occ) {
-        int ocb = occ * jcp.nb_oc_blocking;
-        // format is OIhw4i16o4i. [oc1x1/16,ic1x1/16, 4i,16o,4i]
-        auto wei1x1_c = wei1x1_data_ + ocb * 4 * 64;
-        int g_oc = (g * jcp.nb_oc + ocb) * jcp.oc_block;
-        int g_ic = g * jcp.nb_ic * jcp.oc_block;
-        int work_rem = end - start;
-        int ih_s = -jcp.t_pad + oh_s * jcp.sh;
-        int oh_e = oh_s + work_rem > jcp.oh ? jcp.oh : oh_s + work_rem;
-
-        auto bias_w =
-            bias_data ? bias_data + (g_oc * jcp.typesize_conv0_bia) : 0;
-        // mkldnn: dst_d.blk_off(n, g_oc, oh_s);
-        auto dst_w = dst_data_ + n * jcp.oc * jcp.oh * jcp.ow + g_oc +
-                     oh_s * jcp.ow * jcp.oc;
-        auto src_w = src_data_ + n * jcp.ic * jcp.ih * jcp.iw + g_ic +
-                     ih_s * jcp.iw * jcp.ic;
-        // mkldnn:  wht_blk_off(weights_d, g, ocb, 0);
-        // g, oc/16/g, i/16/g, h, w, 4i, 16o, 4i
-        // oc/16, i/16, h, w, 4i, 16o, 4i
-        auto wht_w =
-            wei_data_ +
-            (jcp.gp > 1
-                 ? (g * jcp.oc * jcp.ic * jcp.kh * jcp.kw / jcp.gp / jcp.gp +
-                    ocb * jcp.oc_block * jcp.ic * jcp.kh * jcp.kw / jcp.gp)
-                 : (ocb * jcp.oc_block * jcp.ic * jcp.kh * jcp.kw));
-        auto scales = jcp.conv0_multi_oc_scale
-                          ? conv0_scales_data_ + g_oc * scales_extended_size
-                          : conv0_scales_data_;
-
-        for (int icc = 0; icc < ic_chunks; ++icc) {
-          auto src_c = src_w;
-          auto out1x1_c = out1x1_w;
-          auto acc1x1_c = acc1x1_w;
-          auto ws_c = ws_l;
-
-          int icb = icc * jcp.nb_ic_blocking;
-          for (int oj = oh_s, ij = ih_s; oj < oh_e; ++oj, ij += jcp.sh) {
-            int i_t_overflow = -std::min(0, ij);
-            int i_b_overflow = std::max(jcp.ih, ij + jcp.kh) - jcp.ih;
-            int kh_padding = std::max(0, jcp.kh - i_t_overflow - i_b_overflow);
-
-            p.src = src_c + i_t_overflow * src_h_stride;
-            p.wei = wht_w + i_t_overflow * wht_h_stride;
-            p.bia = bias_w;
-            p.acc_s32 = ws_c;
-            p.channel = icb;
-            p.kh_padding = kh_padding;
-            p.scales = scales;
-
-            p.ocb3x3 = ocb;
-            p.wei1x1 = wei1x1_c;  // oc1x1/16,ic1x1/4, 16o,4i
-            p.bia1x1 = bia1x1_data_;
-            p.acc1x1 = acc1x1_c;  // acc1x1 format is (oh, oc1x1/16, ow, 16o),
-                                  // ow is in kernel, so do not need offset
-            p.dst = out1x1_c;     // shoud have ow offset in kernel
-            p.scales1x1 = scales1x1;
-
-            kernel_->jit_ker_(&p);
-
-            src_c += src_h_stride * jcp.sh;
-            out1x1_c += out1x1_h_stride;
-            acc1x1_c += acc1x1_h_stride;
-            ws_c += jcp.ow * jcp.oc_block * jcp.nb_oc_blocking;
-          }
-          src_w += jcp.ic_block * jcp.nb_ic_blocking;
-          wht_w += wht_ic_stride * jcp.nb_ic_blocking;
+      for (int icc = 0; icc < ic_chunks; ++icc) {
+        auto src_c = src_w;
+        auto dst_c = rows_l + (rows_e - rows_s) * row_stride;
+        auto ws_c = ws_l;
+        int icb = icc * jcp.nb_ic_blocking;
+        for (int oj = rows_e, ij = ih_s; oj < oh_e; ++oj, ij += jcp.sh) {
+          int i_t_overflow = -std::min(0, ij);
+          int i_b_overflow = std::max(jcp.ih, ij + jcp.kh) - jcp.ih;
+          int kh_padding = std::max(0, jcp.kh - i_t_overflow - i_b_overflow);
+
+          p.src = src_c + i_t_overflow * src_h_stride;
+          p.wei = wht_w + i_t_overflow * wht_h_stride;
+          p.bia = bias_w;
+          p.acc_s32 = ws_c;
+          p.channel = icb;
+          p.kh_padding = kh_padding;
+          p.scales = scales;
+          p.dst = dst_c;
+          kernel_->jit_ker_(&p);
+
+          src_c += src_h_stride * jcp.sh;
+          dst_c += row_stride;
+          ws_c += jcp.ow * jcp.oc_block * jcp.nb_oc_blocking;
         }
+        src_w += jcp.ic_block * jcp.nb_ic_blocking;
+        wht_w += wht_ic_stride * jcp.nb_ic_blocking;
       }
-      if (jcp.loop_order == loop_cgn) {
-        nd_iterator_jump(start, end, g, jcp.gp, n, jcp.bs, oh_s, jcp.oh);
-      } else if (jcp.loop_order == loop_gnc) {
-        nd_iterator_jump(start, end, g, jcp.gp, n, jcp.bs, oh_s, jcp.oh);
-      } else if (jcp.loop_order == loop_ngc) {
-        nd_iterator_jump(start, end, n, jcp.bs, g, jcp.gp, oh_s, jcp.oh);
-      } else {
-        assert(!"unsupported loop order");
-      }
+      rows_e = oh_e;
     }
+
+    // max pooling from the rows buffer to dst
+    auto dst_w =
+        dst_data_ + ((n * jcp.pool_oh + ph) * jcp.pool_ow) * dst_ld_ + g_oc;
+    pp.kh_padding = std::max(0, oh_e - oh_s);
+    for (int pw = 0; pw < jcp.pool_ow; ++pw) {
+      int ow_s = pw * jcp.pool_sw - jcp.pool_l_pad;
+      int ow_e = std::min(ow_s + jcp.pool_kw, jcp.ow);
+      ow_s = std::max(ow_s, 0);
+      pp.src = rows_l + ow_s * jcp.dst_ld;
+      pp.dst = dst_w + pw * dst_ld_;
+      pp.kw_padding = std::max(0, ow_e - ow_s);
+      pool_kernel_->jit_ker_(&pp);
+    }
+    nd_iterator_step(occ, oc_chunks, g, jcp.gp, n, jcp.bs, ph, jcp.pool_oh);
   }
 }
 
@@ -371,7 +600,13 @@ bool op_conv<dst_data_t>::init_conf(jit::jit_conv_conf_t &conf,
                                     bool conv0_relu,
                                     bool conv1_relu,
                                     round_mode conv0_round_mode,
-                                    round_mode conv1_round_mode) {
+                                    round_mode conv1_round_mode,
+                                    std::array<int, 2> sz_pool_kernel,
+                                    std::array<int, 2> sz_pool_stride,
+                                    std::array<int, 2> sz_pool_padding,
+                                    bool global_avg_pool,
+                                    int shuffle_groups,
+                                    const std::unique_ptr<memory> &sum) {
   using namespace util;
   // check data type
   if (dst->data_type() != type2dtype<dst_data_t>::dtype) {
@@ -384,9 +619,21 @@ bool op_conv<dst_data_t>::init_conf(jit::jit_conv_conf_t &conf,
   auto src_dims = src->std_dims();    // nchw
   auto wei_dims = wei->std_dims();    // oihw
   auto dst_dims = dst->std_dims();    // nchw
+  bool fuse_pool = sz_pool_kernel[0] > 0 && sz_pool_kernel[1] > 0;
+  check_eq(fuse_pool_, fuse_pool);
   for (size_t i = 0; i < 2; ++i) {
     int expected = conv_output_size(
         src_dims[i + 2], wei_dims[i + 2], sz_stride[i], sz_padding[i]);
+    if (global_avg_pool) {
+      expected = 1;
+    } else if (fuse_pool) {
+      if (sz_pool_padding[i] >= sz_pool_kernel[i]) {
+        info("Pooling padding should be smaller than kernel");
+        return false;
+      }
+      expected = pool_output_size(
+          expected, sz_pool_kernel[i], sz_pool_stride[i], sz_pool_padding[i]);
+    }
     if (dst_dims[i + 2] != expected) {
       info("Output image size do not match at %d, %d != %d",
            i,
@@ -418,6 +665,10 @@ bool op_conv<dst_data_t>::init_conf(jit::jit_conv_conf_t &conf,
     }
   } else {
     check_eq(fuse_conv1x1_, true);
+    if (fuse_pool) {
+      info("Can not fuse both conv1x1 and pooling");
+      return false;
+    }
     auto wei1x1_dims = wei1x1->std_dims();  // oihw
     if (wei1x1_dims[C] != wei_dims[0]) {
       info("Conv0 output channel do not match");
@@ -441,6 +692,31 @@ bool op_conv<dst_data_t>::init_conf(jit::jit_conv_conf_t &conf,
     }
   }
 
+  if (shuffle_groups > 1 &&
+      (dst_dims[C] % shuffle_groups != 0 || fuse_pool || global_avg_pool ||
+       wei1x1 != nullptr)) {
+    info("Can not fuse channel shuffle");
+    return false;
+  }
+
+  // sum is only added in the gemm of plain 1x1 conv
+  if (sum != nullptr &&
+      !all_true(wei_dims[H] == 1,
+                wei_dims[W] == 1,
+                sz_stride[0] == 1,
+                sz_stride[1] == 1,
+                sz_padding[0] == 0,
+                sz_padding[1] == 0,
+                wei1x1 == nullptr,
+                !fuse_pool,
+                !global_avg_pool,
+                shuffle_groups <= 1,
+                sum->dim_format() == memory::format::nhwc,
+                sum->std_dims() == dst_dims)) {
+    info("Can not fuse sum");
+    return false;
+  }
+
   check_eq(ngroups, 1);  // only verified gp==1 yet
   return jit::jit_conv_kernel::init_conf(conf,
                                          src,
@@ -457,7 +733,12 @@ bool op_conv<dst_data_t>::init_conf(jit::jit_conv_conf_t &conf,
                                          conv0_relu,
                                          conv1_relu,
                                          conv0_round_mode,
-                                         conv1_round_mode);
+                                         conv1_round_mode,
+                                         sz_pool_kernel,
+                                         sz_pool_stride,
+                                         sz_pool_padding,
+                                         global_avg_pool,
+                                         shuffle_groups);
 }
 
 template class op_conv<f32>;
@@ -16,7 +16,9 @@
 #pragma once
 
 #include <jitinfer.h>
+#include "gemm_u8s8s32.h"
 #include "jit_conv_kernel.h"
+#include "jit_pool_kernel.h"
 
 namespace jitinfer {
 
@@ -41,7 +43,14 @@ public:
                    bool conv0_relu = false,
                    bool conv1_relu = false,
                    round_mode conv0_round_mode = round_mode::nearest,
-                   round_mode conv1_round_mode = round_mode::nearest);
+                   round_mode conv1_round_mode = round_mode::nearest,
+                   std::array<int, 2> sz_pool_kernel = {0, 0},
+                   std::array<int, 2> sz_pool_stride = {0, 0},
+                   std::array<int, 2> sz_pool_padding = {0, 0},
+                   bool global_avg_pool = false,
+                   int shuffle_groups = 0,
+                   const std::unique_ptr<memory> &sum = nullptr,
+                   float sum_scale = 1.f);
 
   ~op_conv();
 
@@ -61,23 +70,40 @@ protected:
                  bool conv0_relu,
                  bool conv1_relu,
                  round_mode conv0_round_mode,
-                 round_mode conv1_round_mode);
-  void infer() override;
-  inline void infer_conv0();
-  inline void infer_conv0conv1();
+                 round_mode conv1_round_mode,
+                 std::array<int, 2> sz_pool_kernel,
+                 std::array<int, 2> sz_pool_stride,
+                 std::array<int, 2> sz_pool_padding,
+                 bool global_avg_pool,
+                 int shuffle_groups,
+                 const std::unique_ptr<memory> &sum);
+  void infer_thread(int ithr, int nthr) override;
+  inline void infer_conv0(int ithr, int nthr);
+  inline void infer_conv0conv1(int ithr, int nthr);
+  inline void infer_conv0pool(int ithr, int nthr);
   const char *name() { return "conv"; }
 
 private:
   bool fuse_conv1x1_;
+  bool fuse_pool_;
+  bool fuse_global_pool_;
   const src_data_t *src_data_;
   const wei_data_t *wei_data_, *wei1x1_data_;
   const void *bia_data_, *bia1x1_data_;
   float *conv0_scales_data_, *conv1_scales_data_;
   dst_data_t *dst_data_;
-  jit::jit_conv_kernel *kernel_;
+  const void *sum_data_;  // added before relu, only for plain 1x1 conv
+  std::shared_ptr<jit::jit_conv_kernel> kernel_;
+  std::shared_ptr<jit::jit_pool_kernel> pool_kernel_;
+  gemm_u8s8s32<dst_data_t> *gemm_;  // for plain 1x1 conv
   size_t ws_per_thread_;
   size_t ws1x1_per_thread_;
+  size_t rows_per_thread_;
+  size_t sums_per_thread_;
   acc_data_t *ws_;
   acc_data_t *ws1x1_;
+  dst_data_t *rows_;  // conv output rows of one oc chunk, for fused pool
+  float *sums_;       // per channel sums of each thread, for global pool
+  int dst_ld_;
 };
 }
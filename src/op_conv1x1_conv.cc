@@ -0,0 +1,288 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "op_conv1x1_conv.h"
+#include <algorithm>
+#include "conv_rows.h"
+#include "log.h"
+#include "thread_pool.h"
+#include "util_jitinfer.h"
+
+namespace jitinfer {
+
+template <typename dst_data_t>
+op_conv1x1_conv<dst_data_t>::op_conv1x1_conv(
+    const std::unique_ptr<memory> &src,
+    const std::unique_ptr<memory> &wei1x1,
+    const std::unique_ptr<memory> &bia1x1,
+    const std::unique_ptr<memory> &wei,
+    const std::unique_ptr<memory> &bia,
+    std::array<int, 2> sz_stride,
+    std::array<int, 2> sz_padding,
+    std::unique_ptr<memory> &dst,
+    const std::vector<float> &conv1x1_scales,
+    const std::vector<float> &conv0_scales,
+    bool conv0_relu,
+    round_mode conv0_round_mode,
+    const std::unique_ptr<memory> &wei1,
+    const std::unique_ptr<memory> &bia1,
+    const std::unique_ptr<memory> &sum,
+    const std::vector<float> &conv1_scales,
+    float sum_scale,
+    bool conv1_relu)
+    : op(),
+      fuse_conv1_(wei1 != nullptr),
+      gemm1_(nullptr),
+      mid_per_thread_(0),
+      mid_(nullptr) {
+  if (!init_conf(src, wei1x1, bia1x1, wei, dst, wei1, bia1, sum)) {
+    error_and_exit("Init Conv1x1Conv op failed!");
+  }
+  auto src_dims = src->std_dims();  // nchw
+  const int bs = src_dims[0], ic = src_dims[1];
+  const int ih = src_dims[2], iw = src_dims[3];
+  const int c1x1 = wei1x1->std_dims()[0];
+  const int c0 = wei->std_dims()[0];
+  const int kh = wei->std_dims()[2];
+  const int oh = dst->std_dims()[2], ow = dst->std_dims()[3];
+  const int nthreads = get_max_threads();
+
+  rows_per_thread_ = kh * iw * c1x1;
+  rows_ = (u8 *)aligned_malloc(nthreads * rows_per_thread_ * sizeof(u8), 4096);
+
+  // the 1x1 output is never allocated in whole, only the dims are described
+  std::unique_ptr<memory> mid;
+  mid.reset(new memory({bs, c1x1, ih, iw}, memory::format::nhwc, memory::u8,
+                       rows_));
+  // when fuse conv1, the conv output is one u8 row in each thread
+  std::unique_ptr<memory> conv_out;
+  if (fuse_conv1_) {
+    mid_per_thread_ = ow * c0;
+    mid_ = (u8 *)aligned_malloc(nthreads * mid_per_thread_ * sizeof(u8), 4096);
+    conv_out.reset(new memory(
+        {bs, c0, oh, ow}, memory::format::nhwc, memory::u8, mid_));
+  }
+  auto conf = util::zero<jit::jit_conv_conf_t>();
+  if (!jit::jit_conv_kernel::init_conf(conf,
+                                       mid,
+                                       wei,
+                                       bia,
+                                       1,
+                                       sz_stride,
+                                       sz_padding,
+                                       fuse_conv1_ ? conv_out : dst,
+                                       conv0_scales,
+                                       {1.f},
+                                       nullptr,
+                                       nullptr,
+                                       conv0_relu,
+                                       false,
+                                       conv0_round_mode,
+                                       round_mode::nearest,
+                                       {0, 0},
+                                       {0, 0},
+                                       {0, 0},
+                                       false)) {
+    error_and_exit("Init Conv1x1Conv op failed!");
+  }
+  kernel_ = jit::get_kernel<jit::jit_conv_kernel>(conf);
+  const auto &jcp = kernel_->jcp;
+  ws_per_thread_ = jcp.ow * jcp.oc_block * jcp.nb_oc_blocking;
+  ws_ = (acc_data_t *)aligned_malloc(
+      nthreads * ws_per_thread_ * sizeof(acc_data_t), 4096);
+
+  // one row of 1x1 conv is a gemm of iw x ic and ic x c1x1 in each thread
+  src_ld_ = src->ld();
+  gemm1x1_ = new gemm_u8s8s32<u8>(
+      iw,
+      c1x1,
+      ic,
+      src_ld_,
+      c1x1,
+      reinterpret_cast<const wei_data_t *>(wei1x1->data()),
+      bia1x1 != nullptr ? bia1x1->data() : nullptr,
+      bia1x1 != nullptr ? bia1x1->data_type() : memory::dtype::undef,
+      conv1x1_scales,
+      true,
+      round_mode::nearest,
+      true);
+
+  // one row of conv1 is a gemm of ow x c0 and c0 x oc in each thread
+  dst_ld_ = dst->ld();
+  sum_ld_ = sum != nullptr ? sum->ld() : 0;
+  typesize_sum_ = sum != nullptr ? util::dtype_size(sum->data_type()) : 0;
+  if (fuse_conv1_) {
+    gemm1_ = new gemm_u8s8s32<dst_data_t>(
+        ow,
+        wei1->std_dims()[0],
+        c0,
+        c0,
+        dst_ld_,
+        reinterpret_cast<const wei_data_t *>(wei1->data()),
+        bia1 != nullptr ? bia1->data() : nullptr,
+        bia1 != nullptr ? bia1->data_type() : memory::dtype::undef,
+        conv1_scales,
+        conv1_relu,
+        round_mode::nearest,
+        true,
+        sum != nullptr ? sum->data_type() : memory::dtype::undef,
+        sum_ld_,
+        sum_scale);
+  }
+
+  conv0_scales_data_ =
+      util::extend_scales(conv0_scales, scales_extended_size);
+
+  src_data_ = reinterpret_cast<const src_data_t *>(src->data());
+  wei_data_ = reinterpret_cast<const wei_data_t *>(wei->data());
+  dst_data_ = reinterpret_cast<dst_data_t *>(dst->data());
+  sum_data_ =
+      sum != nullptr ? reinterpret_cast<const char *>(sum->data()) : nullptr;
+  bia_data_ =
+      bia != nullptr ? reinterpret_cast<const void *>(bia->data()) : NULL;
+}
+
+template <typename dst_data_t>
+op_conv1x1_conv<dst_data_t>::~op_conv1x1_conv() {
+  free(ws_);
+  free(rows_);
+  free(mid_);
+  free(conv0_scales_data_);
+  delete gemm1x1_;
+  delete gemm1_;
+}
+
+template <typename dst_data_t>
+bool op_conv1x1_conv<dst_data_t>::init_conf(
+    const std::unique_ptr<memory> &src,
+    const std::unique_ptr<memory> &wei1x1,
+    const std::unique_ptr<memory> &bia1x1,
+    const std::unique_ptr<memory> &wei,
+    std::unique_ptr<memory> &dst,
+    const std::unique_ptr<memory> &wei1,
+    const std::unique_ptr<memory> &bia1,
+    const std::unique_ptr<memory> &sum) {
+  using namespace util;
+  if (dst->data_type() != type2dtype<dst_data_t>::dtype) {
+    info("Dst data type do not match");
+    return false;
+  }
+  if (!all_true(src->data_type() == memory::dtype::u8,
+                src->dim_format() == memory::format::nhwc,
+                wei1x1->data_type() == memory::dtype::s8,
+                wei1x1->dim_format() == memory::format::OIhw4i16o4i,
+                bia1x1 == nullptr ||
+                    bia1x1->dim_format() == memory::format::x)) {
+    info("Data type or format do not match");
+    return false;
+  }
+  auto src_dims = src->std_dims();        // nchw
+  auto wei1x1_dims = wei1x1->std_dims();  // oihw
+  auto wei_dims = wei->std_dims();        // oihw
+  if (!all_true(wei1x1_dims[1] == src_dims[1],
+                wei1x1_dims[2] == 1,
+                wei1x1_dims[3] == 1,
+                wei_dims[1] == wei1x1_dims[0],
+                bia1x1 == nullptr ||
+                    bia1x1->std_dims()[0] == wei1x1_dims[0])) {
+    info("Dims do not match");
+    return false;
+  }
+  if (wei1 == nullptr) {
+    return sum == nullptr;
+  }
+  auto wei1_dims = wei1->std_dims();  // oihw
+  if (!all_true(wei1->data_type() == memory::dtype::s8,
+                wei1->dim_format() == memory::format::OIhw4i16o4i,
+                dst->dim_format() == memory::format::nhwc,
+                wei1_dims[1] == wei_dims[0],
+                wei1_dims[2] == 1,
+                wei1_dims[3] == 1,
+                dst->std_dims()[1] == wei1_dims[0],
+                bia1 == nullptr || bia1->std_dims()[0] == wei1_dims[0])) {
+    info("Conv1 do not match");
+    return false;
+  }
+  if (sum != nullptr && !all_true(sum->dim_format() == memory::format::nhwc,
+                                  sum->std_dims() == dst->std_dims())) {
+    info("Sum do not match dst");
+    return false;
+  }
+  return true;
+}
+
+template <typename dst_data_t>
+void op_conv1x1_conv<dst_data_t>::infer_thread(int ithr, int nthr) {
+  using namespace util;
+  const auto &jcp = kernel_->jcp;
+  assert(jcp.nb_oc % jcp.nb_oc_blocking == 0);
+  // bias data type can be any of u8,s8,s32,f32
+  auto bias_data = reinterpret_cast<const char *>(bia_data_);
+
+  int start{0}, end{0};
+  int work_amount = jcp.bs * jcp.oh;
+  balance211(work_amount, nthr, ithr, start, end);
+
+  auto ws_l = ws_ + ithr * ws_per_thread_;
+  auto mid_l = mid_ + ithr * mid_per_thread_;
+
+  // the 1x1 output rows have jcp.src_ld channels
+  size_t row_stride = jcp.iw * jcp.src_ld;
+  size_t src_h_stride = jcp.iw * src_ld_;
+
+  // the 1x1 output rows of last n are kept in rows,
+  // the overlapped rows of next conv row are reused
+  conv_rows rows(rows_ + ithr * rows_per_thread_, row_stride);
+  int n{0}, oh{0};
+  nd_iterator_init(start, n, jcp.bs, oh, jcp.oh);
+  for (int iwork = start; iwork < end; ++iwork) {
+    int ij = oh * jcp.sh - jcp.t_pad;
+    int ih_s = std::max(ij, 0);
+    int ih_e = std::min(ij + jcp.kh, jcp.ih);
+    rows.update(n, ih_s, ih_e, [&](int ir, u8 *row) {
+      gemm1x1_->compute_in_thread(
+          src_data_ + (n * jcp.ih + ir) * src_h_stride, row);
+    });
+
+    // the conv output is the u8 row in thread when fuse conv1
+    size_t dst_off = (n * jcp.oh + oh) * jcp.ow * dst_ld_;
+    auto dst_w = fuse_conv1_ ? reinterpret_cast<char *>(mid_l)
+                             : reinterpret_cast<char *>(dst_data_ + dst_off);
+    conv_row(kernel_.get(),
+             rows.data(),
+             wei_data_,
+             bias_data,
+             conv0_scales_data_,
+             ih_s - ij,
+             std::max(0, ih_e - ih_s),
+             dst_w,
+             ws_l);
+    if (fuse_conv1_) {
+      gemm1_->compute_in_thread(
+          mid_l,
+          dst_data_ + dst_off,
+          sum_data_ ? sum_data_ + (n * jcp.oh + oh) * jcp.ow * sum_ld_ *
+                                      typesize_sum_
+                    : nullptr);
+    }
+    nd_iterator_step(n, jcp.bs, oh, jcp.oh);
+  }
+}
+
+template class op_conv1x1_conv<f32>;
+template class op_conv1x1_conv<s32>;
+template class op_conv1x1_conv<s8>;
+template class op_conv1x1_conv<u8>;
+}
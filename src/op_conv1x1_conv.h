@@ -0,0 +1,91 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#pragma once
+
+#include <jitinfer.h>
+#include "gemm_u8s8s32.h"
+#include "jit_conv_kernel.h"
+
+namespace jitinfer {
+
+// 1x1 conv + relu fused before conv, the head of resnet bottleneck.
+// The u8 output of 1x1 conv is computed row by row into a rolling buffer
+// of kh rows per thread, which is the src of conv.
+// With wei1, it is the whole bottleneck: the conv output row is u8 and kept
+// in thread, then 1x1 conv1 + sum + relu writes the dst row.
+template <typename dst_data_t>
+class op_conv1x1_conv : public op {
+  typedef u8 src_data_t;
+  typedef s8 wei_data_t;
+  typedef s32 acc_data_t;
+
+public:
+  explicit op_conv1x1_conv(const std::unique_ptr<memory> &src,
+                           const std::unique_ptr<memory> &wei1x1,
+                           const std::unique_ptr<memory> &bia1x1,
+                           const std::unique_ptr<memory> &wei,
+                           const std::unique_ptr<memory> &bia,
+                           std::array<int, 2> sz_stride,
+                           std::array<int, 2> sz_padding,
+                           std::unique_ptr<memory> &dst,
+                           const std::vector<float> &conv1x1_scales,
+                           const std::vector<float> &conv0_scales,
+                           bool conv0_relu,
+                           round_mode conv0_round_mode,
+                           const std::unique_ptr<memory> &wei1 = nullptr,
+                           const std::unique_ptr<memory> &bia1 = nullptr,
+                           const std::unique_ptr<memory> &sum = nullptr,
+                           const std::vector<float> &conv1_scales = {1.f},
+                           float sum_scale = 1.f,
+                           bool conv1_relu = true);
+
+  ~op_conv1x1_conv();
+
+protected:
+  bool init_conf(const std::unique_ptr<memory> &src,
+                 const std::unique_ptr<memory> &wei1x1,
+                 const std::unique_ptr<memory> &bia1x1,
+                 const std::unique_ptr<memory> &wei,
+                 std::unique_ptr<memory> &dst,
+                 const std::unique_ptr<memory> &wei1,
+                 const std::unique_ptr<memory> &bia1,
+                 const std::unique_ptr<memory> &sum);
+  void infer_thread(int ithr, int nthr) override;
+  const char *name() { return fuse_conv1_ ? "bottleneck" : "conv1x1_conv"; }
+
+private:
+  bool fuse_conv1_;
+  const src_data_t *src_data_;
+  const wei_data_t *wei_data_;
+  const void *bia_data_;
+  float *conv0_scales_data_;
+  dst_data_t *dst_data_;
+  const char *sum_data_;
+  int src_ld_;
+  int dst_ld_;
+  int sum_ld_;
+  int typesize_sum_;
+  gemm_u8s8s32<u8> *gemm1x1_;
+  gemm_u8s8s32<dst_data_t> *gemm1_;
+  std::shared_ptr<jit::jit_conv_kernel> kernel_;
+  size_t ws_per_thread_;
+  size_t rows_per_thread_;
+  size_t mid_per_thread_;
+  acc_data_t *ws_;
+  u8 *rows_;  // 1x1 conv output rows of each thread, nhwc of kh rows
+  u8 *mid_;   // conv output row of each thread, when fuse conv1
+};
+}
@@ -0,0 +1,234 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "op_conv1x1_multi.h"
+#include <algorithm>
+#include <cstring>
+#include "jit_conv_kernel.h"  // scales_extended_size
+#include "log.h"
+#include "thread_pool.h"
+#include "util_jitinfer.h"
+
+namespace jitinfer {
+
+static float bias_at(const std::unique_ptr<memory> &bia, int c) {
+  switch (bia->data_type()) {
+#define CASE(tp)          \
+  case memory::dtype::tp: \
+    return static_cast<const tp *>(bia->data())[c]
+    CASE(f32);
+    CASE(s32);
+    CASE(s8);
+    CASE(u8);
+#undef CASE
+    default:
+      assert(!"bad data_type");
+  }
+  return 0.f;
+}
+
+template <typename dst_data_t>
+op_conv1x1_multi<dst_data_t>::op_conv1x1_multi(
+    const std::unique_ptr<memory> &src,
+    const std::vector<std::unique_ptr<memory>> &weis,
+    const std::vector<std::unique_ptr<memory>> &bias,
+    std::vector<std::unique_ptr<memory>> &dsts,
+    bool post_relu,
+    const std::vector<std::vector<float>> &scales,
+    round_mode rmode)
+    : op() {
+  using namespace util;
+  if (!init_conf(src, weis, bias, dsts, scales)) {
+    error_and_exit("Init Conv1x1Multi op failed!");
+  }
+  auto src_dims = src->std_dims();  // nchw
+  const int num_dsts = dsts.size();
+  const int m = src_dims[0] * src_dims[2] * src_dims[3];
+  const int k = src_dims[1];
+
+  // the output channels of all branches are one wide n
+  int n = 0, n_group = 0;
+  for (int i = 0; i < num_dsts; ++i) {
+    int oc = weis[i]->std_dims()[0];
+    n_off_.push_back(n);
+    ld_.push_back(dsts[i]->ld());
+    dsts_data_.push_back(reinterpret_cast<dst_data_t *>(dsts[i]->data()));
+    n += oc;
+    // the biggest n chunk which does not cross branches
+    n_group = i == 0 ? oc : gcd(n_group, oc);
+  }
+
+  wei_data_ = (wei_data_t *)aligned_malloc(n * k * sizeof(wei_data_t), 4096);
+  scales_data_ = (float *)aligned_malloc(
+      std::max(n, int(scales_extended_size)) * sizeof(float), 64);
+  const bool with_bias = !bias.empty();
+  bia_data_ = with_bias ? (float *)aligned_malloc(n * sizeof(float), 64)
+                        : nullptr;
+  for (int i = 0; i < num_dsts; ++i) {
+    int oc = weis[i]->std_dims()[0];
+    // OIhw4i16o4i of 1x1 is blocked on oc first, so just append them
+    std::memcpy(wei_data_ + n_off_[i] * k,
+                weis[i]->data(),
+                oc * k * sizeof(wei_data_t));
+    for (int c = 0; c < oc; ++c) {
+      scales_data_[n_off_[i] + c] =
+          scales.empty() ? 1.f
+                         : scales[i][scales[i].size() == 1 ? 0 : c];
+    }
+    // branches without bias have zero bias
+    for (int c = 0; with_bias && c < oc; ++c) {
+      bia_data_[n_off_[i] + c] =
+          bias[i] != nullptr ? bias_at(bias[i], c) : 0.f;
+    }
+  }
+
+  // one kernel for each different ld of dsts
+  const int nthreads = get_max_threads();
+  std::vector<int> lds;
+  for (int i = 0; i < num_dsts; ++i) {
+    auto it = std::find(lds.begin(), lds.end(), ld_[i]);
+    if (it == lds.end()) {
+      auto conf = util::zero<jit::jit_gemm_conf_t>();
+      if (!jit::jit_gemm_kernel::init_conf(
+              conf,
+              m,
+              n,
+              k,
+              src->ld(),
+              ld_[i],
+              type2dtype<dst_data_t>::dtype,
+              with_bias ? memory::dtype::f32 : memory::dtype::undef,
+              n,
+              post_relu,
+              rmode,
+              nthreads,
+              memory::dtype::undef,
+              0,
+              1.f,
+              n_group)) {
+        error_and_exit("Init Conv1x1Multi op failed!");
+      }
+      kernels_.push_back(jit::get_kernel<jit::jit_gemm_kernel>(conf));
+      lds.push_back(ld_[i]);
+      it = lds.end() - 1;
+    }
+    ker_idx_.push_back(it - lds.begin());
+  }
+
+  const auto &jcp = kernels_[0]->jcp_;
+  const int chunk = jcp.nb_n_blocking * jcp.n_block;
+  for (int i = 0; i < num_dsts; ++i) {
+    int oc = weis[i]->std_dims()[0];
+    chunk_dst_.insert(chunk_dst_.end(), oc / chunk, i);
+  }
+  src_data_ = reinterpret_cast<const src_data_t *>(src->data());
+}
+
+template <typename dst_data_t>
+op_conv1x1_multi<dst_data_t>::~op_conv1x1_multi() {
+  free(wei_data_);
+  free(bia_data_);
+  free(scales_data_);
+}
+
+template <typename dst_data_t>
+bool op_conv1x1_multi<dst_data_t>::init_conf(
+    const std::unique_ptr<memory> &src,
+    const std::vector<std::unique_ptr<memory>> &weis,
+    const std::vector<std::unique_ptr<memory>> &bias,
+    std::vector<std::unique_ptr<memory>> &dsts,
+    const std::vector<std::vector<float>> &scales) {
+  using namespace util;
+  const size_t num_dsts = dsts.size();
+  if (!all_true(num_dsts > 0,
+                weis.size() == num_dsts,
+                bias.empty() || bias.size() == num_dsts,
+                scales.empty() || scales.size() == num_dsts)) {
+    info("Size of branches do not match");
+    return false;
+  }
+  if (!all_true(src->data_type() == memory::dtype::u8,
+                src->dim_format() == memory::format::nhwc)) {
+    info("Data type or format do not match");
+    return false;
+  }
+  auto src_dims = src->std_dims();  // nchw
+  for (size_t i = 0; i < num_dsts; ++i) {
+    auto wei_dims = weis[i]->std_dims();  // oihw
+    auto dst_dims = dsts[i]->std_dims();  // nchw
+    if (!all_true(weis[i]->data_type() == memory::dtype::s8,
+                  weis[i]->dim_format() == memory::format::OIhw4i16o4i,
+                  dsts[i]->data_type() == type2dtype<dst_data_t>::dtype,
+                  dsts[i]->dim_format() == memory::format::nhwc,
+                  bias.empty() || bias[i] == nullptr ||
+                      bias[i]->dim_format() == memory::format::x)) {
+      info("Data type or format of branch %d do not match", (int)i);
+      return false;
+    }
+    if (!all_true(wei_dims[1] == src_dims[1],
+                  wei_dims[2] == 1,
+                  wei_dims[3] == 1,
+                  dst_dims[0] == src_dims[0],
+                  dst_dims[1] == wei_dims[0],
+                  dst_dims[2] == src_dims[2],
+                  dst_dims[3] == src_dims[3],
+                  bias.empty() || bias[i] == nullptr ||
+                      bias[i]->std_dims()[0] == wei_dims[0],
+                  scales.empty() || scales[i].size() == 1 ||
+                      (int)scales[i].size() == wei_dims[0])) {
+      info("Dims of branch %d do not match", (int)i);
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename dst_data_t>
+void op_conv1x1_multi<dst_data_t>::infer_thread(int ithr, int nthr) {
+  using namespace util;
+  const auto &jcp = kernels_[0]->jcp_;
+
+  int n_chunks = jcp.nb_n / jcp.nb_n_blocking;
+  int m_chunks = div_up(jcp.m, jcp.ur_m);
+
+  // n is the inner loop, so all branches of rows are done in one thread
+  // and the src rows are read only once
+  int start{0}, end{0};
+  int work_amount = m_chunks * n_chunks;
+  balance211(work_amount, nthr, ithr, start, end);
+
+  jit::jit_gemm_call_s p = {0};
+  int mc{0}, nc{0};
+  nd_iterator_init(start, mc, m_chunks, nc, n_chunks);
+  for (int iwork = start; iwork < end; ++iwork) {
+    int i = chunk_dst_[nc];
+    int n_off = nc * jcp.nb_n_blocking * jcp.n_block;
+    int m_off = mc * jcp.ur_m;
+    p.a = src_data_ + (size_t)m_off * jcp.lda;
+    p.b = wei_data_ + (size_t)n_off * jcp.k;
+    p.c = dsts_data_[i] + (size_t)m_off * ld_[i] + n_off - n_off_[i];
+    p.bia = bia_data_ ? bia_data_ + n_off : nullptr;
+    p.scales = scales_data_ + n_off;
+    p.m = std::min(jcp.ur_m, jcp.m - m_off);
+    kernels_[ker_idx_[i]]->jit_ker_(&p);
+    nd_iterator_step(mc, m_chunks, nc, n_chunks);
+  }
+}
+
+template class op_conv1x1_multi<f32>;
+template class op_conv1x1_multi<s32>;
+template class op_conv1x1_multi<s8>;
+template class op_conv1x1_multi<u8>;
+}
@@ -0,0 +1,64 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#pragma once
+
+#include <jitinfer.h>
+#include "jit_gemm_kernel.h"
+
+namespace jitinfer {
+
+// conv1x1 of several branches on one src, such as the branches of inception.
+// The weights of branches are concatenated on oc as one wide gemm,
+// one thread computes all the branches of its rows, so src is read once,
+// and the output of each n chunk is scattered to the dst of its branch.
+template <typename dst_data_t>
+class op_conv1x1_multi : public op {
+  typedef u8 src_data_t;
+  typedef s8 wei_data_t;
+
+public:
+  explicit op_conv1x1_multi(const std::unique_ptr<memory> &src,
+                            const std::vector<std::unique_ptr<memory>> &weis,
+                            const std::vector<std::unique_ptr<memory>> &bias,
+                            std::vector<std::unique_ptr<memory>> &dsts,
+                            bool post_relu,
+                            const std::vector<std::vector<float>> &scales,
+                            round_mode rmode);
+
+  ~op_conv1x1_multi();
+
+protected:
+  bool init_conf(const std::unique_ptr<memory> &src,
+                 const std::vector<std::unique_ptr<memory>> &weis,
+                 const std::vector<std::unique_ptr<memory>> &bias,
+                 std::vector<std::unique_ptr<memory>> &dsts,
+                 const std::vector<std::vector<float>> &scales);
+  void infer_thread(int ithr, int nthr) override;
+  const char *name() { return "conv1x1_multi"; }
+
+private:
+  const src_data_t *src_data_;
+  wei_data_t *wei_data_;  // concatenated weights of all branches
+  float *bia_data_;       // concatenated bias of all branches, in f32
+  float *scales_data_;    // scales of all output channels
+  std::vector<dst_data_t *> dsts_data_;
+  std::vector<int> n_off_;      // the first channel of each branch
+  std::vector<int> ld_;         // ld of each dst, dsts can be views
+  std::vector<int> ker_idx_;    // kernel of each branch, by its ld
+  std::vector<int> chunk_dst_;  // branch of each n chunk
+  std::vector<std::shared_ptr<jit::jit_gemm_kernel>> kernels_;
+};
+}
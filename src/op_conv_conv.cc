@@ -0,0 +1,221 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "op_conv_conv.h"
+#include <algorithm>
+#include "conv_rows.h"
+#include "log.h"
+#include "thread_pool.h"
+#include "util_jitinfer.h"
+
+namespace jitinfer {
+
+template <typename dst_data_t>
+op_conv_conv<dst_data_t>::op_conv_conv(
+    const std::unique_ptr<memory> &src,
+    const std::unique_ptr<memory> &wei0,
+    const std::unique_ptr<memory> &bia0,
+    std::array<int, 2> sz_stride0,
+    std::array<int, 2> sz_padding0,
+    const std::unique_ptr<memory> &wei1,
+    const std::unique_ptr<memory> &bia1,
+    std::array<int, 2> sz_stride1,
+    std::array<int, 2> sz_padding1,
+    std::unique_ptr<memory> &dst,
+    const std::vector<float> &conv0_scales,
+    bool conv1_relu,
+    const std::vector<float> &conv1_scales,
+    round_mode conv1_round_mode)
+    : op() {
+  using namespace util;
+  if (!init_conf(src, wei0, wei1)) {
+    error_and_exit("Init ConvConv op failed!");
+  }
+  auto src_dims = src->std_dims();    // nchw
+  auto wei0_dims = wei0->std_dims();  // oihw
+  const int bs = src_dims[0];
+  const int c0 = wei0_dims[0];
+  const int oh0 = conv_output_size(
+      src_dims[2], wei0_dims[2], sz_stride0[0], sz_padding0[0]);
+  const int ow0 = conv_output_size(
+      src_dims[3], wei0_dims[3], sz_stride0[1], sz_padding0[1]);
+  const int kh1 = wei1->std_dims()[2];
+  const int nthreads = get_max_threads();
+
+  rows_per_thread_ = kh1 * ow0 * c0;
+  rows_ = (u8 *)aligned_malloc(nthreads * rows_per_thread_ * sizeof(u8), 4096);
+
+  // the conv0 output is never allocated in whole, only the dims are described
+  std::unique_ptr<memory> mid;
+  mid.reset(new memory(
+      {bs, c0, oh0, ow0}, memory::format::nhwc, memory::u8, rows_));
+
+  // u8 output of conv0 is the same as relu
+  auto conf0 = util::zero<jit::jit_conv_conf_t>();
+  auto conf1 = util::zero<jit::jit_conv_conf_t>();
+  if (!all_true(jit::jit_conv_kernel::init_conf(conf0,
+                                                src,
+                                                wei0,
+                                                bia0,
+                                                1,
+                                                sz_stride0,
+                                                sz_padding0,
+                                                mid,
+                                                conv0_scales,
+                                                {1.f},
+                                                nullptr,
+                                                nullptr,
+                                                true,
+                                                false,
+                                                round_mode::nearest,
+                                                round_mode::nearest,
+                                                {0, 0},
+                                                {0, 0},
+                                                {0, 0},
+                                                false),
+                jit::jit_conv_kernel::init_conf(conf1,
+                                                mid,
+                                                wei1,
+                                                bia1,
+                                                1,
+                                                sz_stride1,
+                                                sz_padding1,
+                                                dst,
+                                                conv1_scales,
+                                                {1.f},
+                                                nullptr,
+                                                nullptr,
+                                                conv1_relu,
+                                                false,
+                                                conv1_round_mode,
+                                                round_mode::nearest,
+                                                {0, 0},
+                                                {0, 0},
+                                                {0, 0},
+                                                false))) {
+    error_and_exit("Init ConvConv op failed!");
+  }
+  kernel0_ = jit::get_kernel<jit::jit_conv_kernel>(conf0);
+  kernel1_ = jit::get_kernel<jit::jit_conv_kernel>(conf1);
+
+  // the workspace is used by one conv at a time
+  ws_per_thread_ =
+      std::max(conf0.ow * conf0.oc_block * conf0.nb_oc_blocking,
+               conf1.ow * conf1.oc_block * conf1.nb_oc_blocking);
+  ws_ = (acc_data_t *)aligned_malloc(
+      nthreads * ws_per_thread_ * sizeof(acc_data_t), 4096);
+
+  conv0_scales_data_ = extend_scales(conv0_scales, scales_extended_size);
+  conv1_scales_data_ = extend_scales(conv1_scales, scales_extended_size);
+
+  src_data_ = reinterpret_cast<const src_data_t *>(src->data());
+  wei0_data_ = reinterpret_cast<const wei_data_t *>(wei0->data());
+  wei1_data_ = reinterpret_cast<const wei_data_t *>(wei1->data());
+  bia0_data_ =
+      bia0 != nullptr ? reinterpret_cast<const char *>(bia0->data()) : nullptr;
+  bia1_data_ =
+      bia1 != nullptr ? reinterpret_cast<const char *>(bia1->data()) : nullptr;
+  dst_data_ = reinterpret_cast<dst_data_t *>(dst->data());
+}
+
+template <typename dst_data_t>
+op_conv_conv<dst_data_t>::~op_conv_conv() {
+  free(ws_);
+  free(rows_);
+  free(conv0_scales_data_);
+  free(conv1_scales_data_);
+}
+
+template <typename dst_data_t>
+bool op_conv_conv<dst_data_t>::init_conf(const std::unique_ptr<memory> &src,
+                                         const std::unique_ptr<memory> &wei0,
+                                         const std::unique_ptr<memory> &wei1) {
+  using namespace util;
+  if (!all_true(src->data_type() == memory::dtype::u8,
+                src->dim_format() == memory::format::nhwc,
+                wei0->dim_format() == memory::format::OIhw4i16o4i,
+                wei1->dim_format() == memory::format::OIhw4i16o4i)) {
+    info("Data type or format do not match");
+    return false;
+  }
+  if (wei1->std_dims()[1] != wei0->std_dims()[0]) {
+    info("Conv1 input channels do not match conv0 output channels");
+    return false;
+  }
+  return true;
+}
+
+template <typename dst_data_t>
+void op_conv_conv<dst_data_t>::infer_thread(int ithr, int nthr) {
+  using namespace util;
+  const auto &jcp0 = kernel0_->jcp;
+  const auto &jcp = kernel1_->jcp;
+  assert(jcp0.nb_oc % jcp0.nb_oc_blocking == 0);
+  assert(jcp.nb_oc % jcp.nb_oc_blocking == 0);
+
+  int start{0}, end{0};
+  int work_amount = jcp.bs * jcp.oh;
+  balance211(work_amount, nthr, ithr, start, end);
+
+  auto ws_l = ws_ + ithr * ws_per_thread_;
+
+  // the conv0 output rows have jcp.src_ld channels
+  size_t row_stride = jcp.iw * jcp.src_ld;
+  size_t src_h_stride = jcp0.iw * jcp0.src_ld;
+
+  // the conv0 output rows of last n are kept in rows,
+  // the overlapped rows of next conv1 row are reused
+  conv_rows rows(rows_ + ithr * rows_per_thread_, row_stride);
+  int n{0}, oh{0};
+  nd_iterator_init(start, n, jcp.bs, oh, jcp.oh);
+  for (int iwork = start; iwork < end; ++iwork) {
+    int ij = oh * jcp.sh - jcp.t_pad;
+    int ih_s = std::max(ij, 0);
+    int ih_e = std::min(ij + jcp.kh, jcp.ih);
+    rows.update(n, ih_s, ih_e, [&](int ir, u8 *row) {
+      int ij0 = ir * jcp0.sh - jcp0.t_pad;
+      int i_t_overflow = -std::min(0, ij0);
+      int i_b_overflow = std::max(jcp0.ih, ij0 + jcp0.kh) - jcp0.ih;
+      int kh_padding = std::max(0, jcp0.kh - i_t_overflow - i_b_overflow);
+      conv_row(kernel0_.get(),
+               src_data_ + (n * jcp0.ih + ij0 + i_t_overflow) * src_h_stride,
+               wei0_data_,
+               bia0_data_,
+               conv0_scales_data_,
+               i_t_overflow,
+               kh_padding,
+               reinterpret_cast<char *>(row),
+               ws_l);
+    });
+
+    size_t dst_off = (n * jcp.oh + oh) * jcp.ow * jcp.dst_ld;
+    conv_row(kernel1_.get(),
+             rows.data(),
+             wei1_data_,
+             bia1_data_,
+             conv1_scales_data_,
+             ih_s - ij,
+             std::max(0, ih_e - ih_s),
+             reinterpret_cast<char *>(dst_data_ + dst_off),
+             ws_l);
+    nd_iterator_step(n, jcp.bs, oh, jcp.oh);
+  }
+}
+
+template class op_conv_conv<f32>;
+template class op_conv_conv<s32>;
+template class op_conv_conv<s8>;
+template class op_conv_conv<u8>;
+}
@@ -0,0 +1,71 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#pragma once
+
+#include <jitinfer.h>
+#include "jit_conv_kernel.h"
+
+namespace jitinfer {
+
+// two convs fused depth first, such as the stacked 3x3 convs of vgg and unet.
+// The u8 output of conv0 is computed row by row into a rolling buffer
+// of kh1 rows per thread, and conv1 runs as soon as its rows are there.
+// The rows overlapped between threads are computed by both of them.
+template <typename dst_data_t>
+class op_conv_conv : public op {
+  typedef u8 src_data_t;
+  typedef s8 wei_data_t;
+  typedef s32 acc_data_t;
+
+public:
+  explicit op_conv_conv(const std::unique_ptr<memory> &src,
+                        const std::unique_ptr<memory> &wei0,
+                        const std::unique_ptr<memory> &bia0,
+                        std::array<int, 2> sz_stride0,
+                        std::array<int, 2> sz_padding0,
+                        const std::unique_ptr<memory> &wei1,
+                        const std::unique_ptr<memory> &bia1,
+                        std::array<int, 2> sz_stride1,
+                        std::array<int, 2> sz_padding1,
+                        std::unique_ptr<memory> &dst,
+                        const std::vector<float> &conv0_scales,
+                        bool conv1_relu,
+                        const std::vector<float> &conv1_scales,
+                        round_mode conv1_round_mode);
+
+  ~op_conv_conv();
+
+protected:
+  bool init_conf(const std::unique_ptr<memory> &src,
+                 const std::unique_ptr<memory> &wei0,
+                 const std::unique_ptr<memory> &wei1);
+  void infer_thread(int ithr, int nthr) override;
+  const char *name() { return "conv_conv"; }
+
+private:
+  const src_data_t *src_data_;
+  const wei_data_t *wei0_data_, *wei1_data_;
+  const char *bia0_data_, *bia1_data_;
+  float *conv0_scales_data_, *conv1_scales_data_;
+  dst_data_t *dst_data_;
+  std::shared_ptr<jit::jit_conv_kernel> kernel0_;
+  std::shared_ptr<jit::jit_conv_kernel> kernel1_;
+  size_t ws_per_thread_;
+  size_t rows_per_thread_;
+  acc_data_t *ws_;
+  u8 *rows_;  // conv0 output rows of each thread, nhwc of kh1 rows
+};
+}
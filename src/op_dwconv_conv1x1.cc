@@ -0,0 +1,188 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "op_dwconv_conv1x1.h"
+#include <algorithm>
+#include <cstring>
+#include "jit_conv_kernel.h"  // scales_extended_size
+#include "log.h"
+#include "thread_pool.h"
+#include "util_jitinfer.h"
+
+namespace jitinfer {
+
+template <typename dst_data_t>
+op_dwconv_conv1x1<dst_data_t>::op_dwconv_conv1x1(
+    const std::unique_ptr<memory> &src,
+    const std::unique_ptr<memory> &wei,
+    const std::unique_ptr<memory> &bia,
+    std::array<int, 2> sz_stride,
+    std::array<int, 2> sz_padding,
+    const std::unique_ptr<memory> &wei1x1,
+    const std::unique_ptr<memory> &bia1x1,
+    std::unique_ptr<memory> &dst,
+    const std::vector<float> &dw_scales,
+    const std::vector<float> &conv1x1_scales,
+    bool conv1x1_relu,
+    round_mode conv1x1_round_mode)
+    : op() {
+  if (!init_conf(src, wei, wei1x1, bia1x1, dst)) {
+    error_and_exit("Init DWConvConv1x1 op failed!");
+  }
+  auto src_dims = src->std_dims();  // nchw
+  auto dst_dims = dst->std_dims();  // nchw
+  const int bs = src_dims[0], c = src_dims[1];
+  const int oh = dst_dims[2], ow = dst_dims[3];
+  const int nthreads = get_max_threads();
+
+  mid_per_thread_ = ow * c;
+  mid_ = (u8 *)aligned_malloc(nthreads * mid_per_thread_ * sizeof(u8), 4096);
+
+  // the depthwise output is never allocated in whole
+  std::unique_ptr<memory> mid;
+  mid.reset(
+      new memory({bs, c, oh, ow}, memory::format::nhwc, memory::u8, mid_));
+  auto conf = util::zero<jit::jit_dw_conf_t>();
+  if (!jit::jit_dw_kernel::init_conf(conf,
+                                     src,
+                                     wei,
+                                     bia,
+                                     sz_stride,
+                                     sz_padding,
+                                     mid,
+                                     dw_scales.size(),
+                                     round_mode::nearest)) {
+    error_and_exit("Init DWConvConv1x1 op failed!");
+  }
+  kernel_ = jit::get_kernel<jit::jit_dw_kernel>(conf);
+
+  // pack weight from oihw to [c/16][kh][kw][16c] of s32
+  const auto &jcp = kernel_->jcp_;
+  auto wei_src = reinterpret_cast<const wei_data_t *>(wei->data());
+  wei_data_ = (s32 *)aligned_malloc(c * jcp.kh * jcp.kw * sizeof(s32), 64);
+  for (int ic = 0; ic < c; ++ic) {
+    int cb = ic / jcp.c_block, cc = ic % jcp.c_block;
+    for (int k = 0; k < jcp.kh * jcp.kw; ++k) {
+      wei_data_[(cb * jcp.kh * jcp.kw + k) * jcp.c_block + cc] =
+          s32(wei_src[ic * jcp.kh * jcp.kw + k]);
+    }
+  }
+
+  dw_scales_data_ = util::extend_scales(dw_scales, scales_extended_size);
+
+  // one row of conv1x1 is a gemm of ow x c and c x oc in each thread
+  dst_ld_ = dst->ld();
+  gemm1x1_ = new gemm_u8s8s32<dst_data_t>(
+      ow,
+      wei1x1->std_dims()[0],
+      c,
+      c,
+      dst_ld_,
+      reinterpret_cast<const wei_data_t *>(wei1x1->data()),
+      bia1x1 != nullptr ? bia1x1->data() : nullptr,
+      bia1x1 != nullptr ? bia1x1->data_type() : memory::dtype::undef,
+      conv1x1_scales,
+      conv1x1_relu,
+      conv1x1_round_mode,
+      true);
+
+  src_data_ = reinterpret_cast<const src_data_t *>(src->data());
+  dst_data_ = reinterpret_cast<dst_data_t *>(dst->data());
+  bia_data_ =
+      bia != nullptr ? reinterpret_cast<const void *>(bia->data()) : NULL;
+}
+
+template <typename dst_data_t>
+op_dwconv_conv1x1<dst_data_t>::~op_dwconv_conv1x1() {
+  free(mid_);
+  free(wei_data_);
+  free(dw_scales_data_);
+  delete gemm1x1_;
+}
+
+template <typename dst_data_t>
+bool op_dwconv_conv1x1<dst_data_t>::init_conf(
+    const std::unique_ptr<memory> &src,
+    const std::unique_ptr<memory> &wei,
+    const std::unique_ptr<memory> &wei1x1,
+    const std::unique_ptr<memory> &bia1x1,
+    std::unique_ptr<memory> &dst) {
+  using namespace util;
+  if (dst->data_type() != type2dtype<dst_data_t>::dtype) {
+    info("Dst data type do not match");
+    return false;
+  }
+  if (!all_true(dst->dim_format() == memory::format::nhwc,
+                wei1x1->data_type() == memory::dtype::s8,
+                wei1x1->dim_format() == memory::format::OIhw4i16o4i,
+                bia1x1 == nullptr ||
+                    bia1x1->dim_format() == memory::format::x)) {
+    info("Data type or format do not match");
+    return false;
+  }
+  auto wei1x1_dims = wei1x1->std_dims();  // oihw
+  if (!all_true(wei1x1_dims[1] == src->std_dims()[1],
+                wei1x1_dims[1] == wei->std_dims()[0],
+                wei1x1_dims[2] == 1,
+                wei1x1_dims[3] == 1,
+                dst->std_dims()[1] == wei1x1_dims[0],
+                bia1x1 == nullptr ||
+                    bia1x1->std_dims()[0] == wei1x1_dims[0])) {
+    info("Dims do not match");
+    return false;
+  }
+  return true;
+}
+
+template <typename dst_data_t>
+void op_dwconv_conv1x1<dst_data_t>::infer_thread(int ithr, int nthr) {
+  using namespace util;
+  const auto &jcp = kernel_->jcp_;
+
+  int start{0}, end{0};
+  int work_amount = jcp.bs * jcp.oh;
+  balance211(work_amount, nthr, ithr, start, end);
+
+  jit::jit_dw_call_s p = {0};
+  auto mid_l = mid_ + ithr * mid_per_thread_;
+  size_t src_h_stride = jcp.iw * jcp.src_ld;
+  size_t wei_h_stride = jcp.kw * jcp.c_block;
+
+  int n{0}, oh{0};
+  nd_iterator_init(start, n, jcp.bs, oh, jcp.oh);
+  for (int iwork = start; iwork < end; ++iwork) {
+    int ij = oh * jcp.sh - jcp.t_pad;
+    int ih_s = std::max(ij, 0);
+    int ih_e = std::min(ij + jcp.kh, jcp.ih);
+
+    p.src = src_data_ + (n * jcp.ih + ih_s) * src_h_stride;
+    p.wei = wei_data_ + (ih_s - ij) * wei_h_stride;
+    p.bia = bia_data_;
+    p.scales = dw_scales_data_;
+    p.dst = mid_l;
+    p.kh_padding = std::max(0, ih_e - ih_s);
+    kernel_->jit_ker_(&p);
+
+    gemm1x1_->compute_in_thread(
+        mid_l, dst_data_ + (n * jcp.oh + oh) * jcp.ow * dst_ld_);
+    nd_iterator_step(n, jcp.bs, oh, jcp.oh);
+  }
+}
+
+template class op_dwconv_conv1x1<f32>;
+template class op_dwconv_conv1x1<s32>;
+template class op_dwconv_conv1x1<s8>;
+template class op_dwconv_conv1x1<u8>;
+}
@@ -0,0 +1,69 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#pragma once
+
+#include <jitinfer.h>
+#include "gemm_u8s8s32.h"
+#include "jit_dw_kernel.h"
+
+namespace jitinfer {
+
+// depthwise conv + relu fused with conv1x1, the mobilenet block.
+// Each thread computes one u8 row of depthwise conv output, then the 1x1 conv
+// runs on it immediately, so the depthwise output never leaves cache.
+template <typename dst_data_t>
+class op_dwconv_conv1x1 : public op {
+  typedef u8 src_data_t;
+  typedef s8 wei_data_t;
+
+public:
+  explicit op_dwconv_conv1x1(const std::unique_ptr<memory> &src,
+                             const std::unique_ptr<memory> &wei,
+                             const std::unique_ptr<memory> &bia,
+                             std::array<int, 2> sz_stride,
+                             std::array<int, 2> sz_padding,
+                             const std::unique_ptr<memory> &wei1x1,
+                             const std::unique_ptr<memory> &bia1x1,
+                             std::unique_ptr<memory> &dst,
+                             const std::vector<float> &dw_scales,
+                             const std::vector<float> &conv1x1_scales,
+                             bool conv1x1_relu,
+                             round_mode conv1x1_round_mode);
+
+  ~op_dwconv_conv1x1();
+
+protected:
+  bool init_conf(const std::unique_ptr<memory> &src,
+                 const std::unique_ptr<memory> &wei,
+                 const std::unique_ptr<memory> &wei1x1,
+                 const std::unique_ptr<memory> &bia1x1,
+                 std::unique_ptr<memory> &dst);
+  void infer_thread(int ithr, int nthr) override;
+  const char *name() { return "dwconv_conv1x1"; }
+
+private:
+  const src_data_t *src_data_;
+  const void *bia_data_;
+  s32 *wei_data_;  // packed as [c/16][kh][kw][16c]
+  float *dw_scales_data_;
+  dst_data_t *dst_data_;
+  int dst_ld_;
+  std::shared_ptr<jit::jit_dw_kernel> kernel_;
+  gemm_u8s8s32<dst_data_t> *gemm1x1_;
+  size_t mid_per_thread_;
+  u8 *mid_;  // depthwise output row of each thread
+};
+}
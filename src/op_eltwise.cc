@@ -0,0 +1,59 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "op_eltwise.h"
+#include "util_jitinfer.h"
+
+namespace jitinfer {
+
+template <typename dtype>
+void op_eltwise<dtype>::infer_thread(int ithr, int nthr) {
+  using namespace util;
+  const auto &jcp = kernel_->jcp_;
+  const int work_amount = jcp.bs * jcp.h * jcp.w;
+
+  int start{0}, end{0};
+  balance211(work_amount, nthr, ithr, start, end);
+  jit::jit_eltwise_call_s p = {0};
+  p.src = src_data_ + start * jcp.src_ld;
+  p.dst = dst_data_ + start * jcp.dst_ld;
+  p.work = end - start;
+  kernel_->jit_ker_(&p);
+}
+
+template <typename dtype>
+bool op_eltwise<dtype>::init_conf(jit::jit_eltwise_conf_t &conf,
+                                  const std::unique_ptr<memory> &src,
+                                  const std::unique_ptr<memory> &dst,
+                                  eltwise_kind kind,
+                                  float alpha,
+                                  float beta) {
+  using namespace util;
+  if (dst->data_type() != type2dtype<dtype>::dtype) {
+    info("Dst data type do not match");
+    return false;
+  }
+  if (src->std_dims() != dst->std_dims()) {
+    info("Src and dst dims do not equal");
+    return false;
+  }
+  return jit::jit_eltwise_kernel::init_conf(conf, src, dst, kind, alpha, beta);
+}
+
+template class op_eltwise<f32>;
+template class op_eltwise<s32>;
+template class op_eltwise<s8>;
+template class op_eltwise<u8>;
+}
@@ -0,0 +1,58 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#pragma once
+
+#include <jitinfer.h>
+#include "jit_eltwise_kernel.h"
+#include "log.h"
+#include "thread_pool.h"
+
+namespace jitinfer {
+
+template <typename dtype>
+class op_eltwise : public op {
+public:
+  explicit op_eltwise(const std::unique_ptr<memory> &src,
+                      std::unique_ptr<memory> &dst,
+                      eltwise_kind kind,
+                      float alpha = 0.f,
+                      float beta = 0.f)
+      : op() {
+    auto conf = util::zero<jit::jit_eltwise_conf_t>();
+    if (!init_conf(conf, src, dst, kind, alpha, beta)) {
+      error_and_exit("Init Eltwise op failed!");
+    }
+    kernel_ = jit::get_kernel<jit::jit_eltwise_kernel>(conf);
+    src_data_ = reinterpret_cast<const dtype *>(src->data());
+    dst_data_ = reinterpret_cast<dtype *>(dst->data());
+  }
+
+protected:
+  bool init_conf(jit::jit_eltwise_conf_t &conf,
+                 const std::unique_ptr<memory> &src,
+                 const std::unique_ptr<memory> &dst,
+                 eltwise_kind kind,
+                 float alpha,
+                 float beta);
+  void infer_thread(int ithr, int nthr) override;
+  const char *name() { return "eltwise"; }
+
+private:
+  std::shared_ptr<jit::jit_eltwise_kernel> kernel_;
+  const dtype *src_data_;
+  dtype *dst_data_;
+};
+}
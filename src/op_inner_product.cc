@@ -0,0 +1,148 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "op_inner_product.h"
+#include <cstring>
+#include "log.h"
+#include "thread_pool.h"
+#include "util_jitinfer.h"
+
+namespace jitinfer {
+
+std::unique_ptr<memory> pack_inner_product_weights(
+    const std::unique_ptr<memory> &wei) {
+  check_eq(wei->dim_format(), memory::format::OIhw4i16o4i);
+  auto dims = wei->std_dims();  // oihw
+  const int nb_oc = dims[0] / 16, nb_ic = dims[1] / 16;
+  const int hw = dims[2] * dims[3];
+  const size_t blk = 16 * 16;
+  std::unique_ptr<memory> packed(
+      new memory(dims, memory::format::OhwI4i16o4i, wei->data_type()));
+  auto from_data = reinterpret_cast<const s8 *>(wei->data());
+  auto to_data = reinterpret_cast<s8 *>(packed->data());
+  // the k of src row is ordered as (h, w, ic), while it's (ic/16, h, w, 16i)
+  // in OIhw4i16o4i, so reorder the 16i16o blocks
+  parallel(get_max_threads(), [&](int ithr, int nthr) {
+    int start{0}, end{0};
+    util::balance211(nb_oc * nb_ic * hw, nthr, ithr, start, end);
+    for (int from = start; from < end; ++from) {
+      // from is (ocb, icb, i) and to is (ocb, i, icb)
+      int i = from % hw, icb = from / hw % nb_ic, ocb = from / hw / nb_ic;
+      size_t to = ((size_t)ocb * hw + i) * nb_ic + icb;
+      std::memcpy(to_data + to * blk, from_data + from * blk, blk);
+    }
+  });
+  return packed;
+}
+
+template <typename dst_data_t>
+op_inner_product<dst_data_t>::op_inner_product(
+    const std::unique_ptr<memory> &src,
+    const std::unique_ptr<memory> &wei,
+    const std::unique_ptr<memory> &bia,
+    std::unique_ptr<memory> &dst,
+    bool post_relu,
+    const std::vector<float> &scales,
+    round_mode rmode)
+    : op() {
+  if (!init_conf(src, wei, bia, dst)) {
+    error_and_exit("Init InnerProduct op failed!");
+  }
+  auto src_dims = src->std_dims();  // nchw
+  const int ic = src_dims[1];
+  const int hw = src_dims[2] * src_dims[3];
+  const int oc = dst->std_dims()[1];
+  wei_data_ = reinterpret_cast<const wei_data_t *>(wei->data());
+  if (hw > 1 && wei->dim_format() == memory::format::OIhw4i16o4i) {
+    packed_wei_ = pack_inner_product_weights(wei);
+    wei_data_ = reinterpret_cast<const wei_data_t *>(packed_wei_->data());
+  }
+  gemm_ = new gemm_u8s8s32<dst_data_t>(
+      src_dims[0],
+      oc,
+      ic * hw,
+      hw * src->ld(),
+      dst->ld(),
+      wei_data_,
+      bia != nullptr ? bia->data() : nullptr,
+      bia != nullptr ? bia->data_type() : memory::dtype::undef,
+      scales,
+      post_relu,
+      rmode);
+
+  src_data_ = reinterpret_cast<const src_data_t *>(src->data());
+  dst_data_ = reinterpret_cast<dst_data_t *>(dst->data());
+}
+
+template <typename dst_data_t>
+op_inner_product<dst_data_t>::~op_inner_product() {
+  delete gemm_;
+}
+
+template <typename dst_data_t>
+bool op_inner_product<dst_data_t>::init_conf(
+    const std::unique_ptr<memory> &src,
+    const std::unique_ptr<memory> &wei,
+    const std::unique_ptr<memory> &bia,
+    std::unique_ptr<memory> &dst) {
+  using namespace util;
+  if (dst->data_type() != type2dtype<dst_data_t>::dtype) {
+    info("Dst data type do not match");
+    return false;
+  }
+  if (!all_true(src->data_type() == memory::dtype::u8,
+                wei->data_type() == memory::dtype::s8,
+                src->dim_format() == memory::format::nhwc,
+                dst->dim_format() == memory::format::nhwc,
+                one_of(wei->dim_format(),
+                       memory::format::OIhw4i16o4i,
+                       memory::format::OhwI4i16o4i),
+                bia == nullptr || bia->dim_format() == memory::format::x)) {
+    info("Data type or format do not match");
+    return false;
+  }
+  auto src_dims = src->std_dims();  // nchw
+  auto wei_dims = wei->std_dims();  // oihw
+  auto dst_dims = dst->std_dims();  // nchw
+  // the weight covers the whole src of one batch
+  if (!all_true(wei_dims[1] == src_dims[1],
+                wei_dims[2] == src_dims[2],
+                wei_dims[3] == src_dims[3],
+                dst_dims[0] == src_dims[0],
+                dst_dims[1] == wei_dims[0],
+                dst_dims[2] == 1,
+                dst_dims[3] == 1,
+                bia == nullptr || bia->std_dims()[0] == wei_dims[0])) {
+    info("Dims do not match");
+    return false;
+  }
+  // the pixels of one batch should be continuous as one row
+  if (src_dims[2] * src_dims[3] > 1 && src->ld() != src_dims[1]) {
+    info("Only support the view of src with 1x1 size");
+    return false;
+  }
+  return true;
+}
+
+template <typename dst_data_t>
+void op_inner_product<dst_data_t>::infer_thread(int ithr, int nthr) {
+  gemm_->compute_part(ithr, nthr, src_data_, dst_data_);
+}
+
+template class op_inner_product<f32>;
+template class op_inner_product<s32>;
+template class op_inner_product<s8>;
+template class op_inner_product<u8>;
+}
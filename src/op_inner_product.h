@@ -0,0 +1,62 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#pragma once
+
+#include <jitinfer.h>
+#include "gemm_u8s8s32.h"
+
+namespace jitinfer {
+
+// reorder the OIhw4i16o4i wei of inner product to OhwI4i16o4i
+std::unique_ptr<memory> pack_inner_product_weights(
+    const std::unique_ptr<memory> &wei);
+
+template <typename dst_data_t>
+class op_inner_product : public op {
+  typedef u8 src_data_t;
+  typedef s8 wei_data_t;
+
+public:
+  explicit op_inner_product(const std::unique_ptr<memory> &src,
+                            const std::unique_ptr<memory> &wei,
+                            const std::unique_ptr<memory> &bia,
+                            std::unique_ptr<memory> &dst,
+                            bool post_relu,
+                            const std::vector<float> &scales,
+                            round_mode rmode);
+
+  ~op_inner_product();
+
+  // the OhwI4i16o4i weights the gemm reads
+  const wei_data_t *wei_data() { return wei_data_; }
+
+protected:
+  bool init_conf(const std::unique_ptr<memory> &src,
+                 const std::unique_ptr<memory> &wei,
+                 const std::unique_ptr<memory> &bia,
+                 std::unique_ptr<memory> &dst);
+  void infer_thread(int ithr, int nthr) override;
+  const char *name() { return "inner_product"; }
+
+private:
+  const src_data_t *src_data_;
+  dst_data_t *dst_data_;
+  const wei_data_t *wei_data_;
+  // only when wei is OIhw4i16o4i and src has more than one pixel
+  std::unique_ptr<memory> packed_wei_;
+  gemm_u8s8s32<dst_data_t> *gemm_;
+};
+}
@@ -0,0 +1,92 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "op_pool.h"
+#include "util_jitinfer.h"
+
+namespace jitinfer {
+
+template <typename dtype>
+void op_pool<dtype>::infer_thread(int ithr, int nthr) {
+  using namespace util;
+  const auto &jcp = kernel_->jcp_;
+  const int work_amount = jcp.bs * jcp.oh * jcp.ow;
+  const bool exclude_padding = jcp.kind == pooling_avg_exclude_padding;
+
+  int start{0}, end{0};
+  balance211(work_amount, nthr, ithr, start, end);
+  int n{0}, oh{0}, ow{0};
+  nd_iterator_init(start, n, jcp.bs, oh, jcp.oh, ow, jcp.ow);
+  jit::jit_pool_call_s p = {0};
+  for (int iwork = start; iwork < end; ++iwork) {
+    int ih_s = oh * jcp.sh - jcp.t_pad;
+    int iw_s = ow * jcp.sw - jcp.l_pad;
+    int ih_e = std::min(ih_s + jcp.kh, jcp.ih);
+    int iw_e = std::min(iw_s + jcp.kw, jcp.iw);
+    ih_s = std::max(ih_s, 0);
+    iw_s = std::max(iw_s, 0);
+    int kh_padding = std::max(0, ih_e - ih_s);
+    int kw_padding = std::max(0, iw_e - iw_s);
+    int area = exclude_padding ? kh_padding * kw_padding : jcp.kh * jcp.kw;
+    p.src = src_data_ + ((n * jcp.ih + ih_s) * jcp.iw + iw_s) * jcp.src_ld;
+    p.dst = dst_data_ + iwork * dst_ld_;
+    p.kh_padding = kh_padding;
+    p.kw_padding = kw_padding;
+    p.inv_area = area > 0 ? 1.f / area : 0.f;
+    // one kernel pool all channels of one dst pixel
+    kernel_->jit_ker_(&p);
+    nd_iterator_step(n, jcp.bs, oh, jcp.oh, ow, jcp.ow);
+  }
+}
+
+template <typename dtype>
+bool op_pool<dtype>::init_conf(jit::jit_pool_conf_t &conf,
+                               const std::unique_ptr<memory> &src,
+                               const std::unique_ptr<memory> &dst,
+                               std::array<int, 2> sz_kernel,
+                               std::array<int, 2> sz_stride,
+                               std::array<int, 2> sz_padding,
+                               pooling_kind kind) {
+  using namespace util;
+  if (dst->data_type() != type2dtype<dtype>::dtype) {
+    info("Dst data type do not match");
+    return false;
+  }
+  auto src_dims = src->std_dims();  // nchw
+  auto dst_dims = dst->std_dims();  // nchw
+  for (size_t i = 0; i < 2; ++i) {
+    int expected = pool_output_size(
+        src_dims[i + 2], sz_kernel[i], sz_stride[i], sz_padding[i]);
+    if (dst_dims[i + 2] != expected) {
+      info("Output image size do not match at %d, %d != %d",
+           int(i),
+           dst_dims[i + 2],
+           expected);
+      return false;
+    }
+  }
+  if (!all_true(src_dims[0] == dst_dims[0], src_dims[1] == dst_dims[1])) {
+    info("Batch size or channel do not equal");
+    return false;
+  }
+  return jit::jit_pool_kernel::init_conf(
+      conf, src, dst, sz_kernel, sz_stride, sz_padding, kind);
+}
+
+template class op_pool<f32>;
+template class op_pool<s32>;
+template class op_pool<s8>;
+template class op_pool<u8>;
+}
@@ -0,0 +1,63 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#pragma once
+
+#include <jitinfer.h>
+#include "jit_pool_kernel.h"
+#include "log.h"
+#include "thread_pool.h"
+
+namespace jitinfer {
+
+template <typename dtype>
+class op_pool : public op {
+public:
+  explicit op_pool(const std::unique_ptr<memory> &src,
+                   std::unique_ptr<memory> &dst,
+                   std::array<int, 2> sz_kernel,
+                   std::array<int, 2> sz_stride,
+                   std::array<int, 2> sz_padding,
+                   pooling_kind kind = pooling_max)
+      : op() {
+    auto conf = util::zero<jit::jit_pool_conf_t>();
+    if (!init_conf(
+            conf, src, dst, sz_kernel, sz_stride, sz_padding, kind)) {
+      error_and_exit("Init Pool op failed!");
+    }
+    kernel_ = jit::get_kernel<jit::jit_pool_kernel>(conf);
+    src_data_ = reinterpret_cast<const dtype *>(src->data());
+    dst_data_ = reinterpret_cast<dtype *>(dst->data());
+    dst_ld_ = dst->ld();
+  }
+
+protected:
+  bool init_conf(jit::jit_pool_conf_t &conf,
+                 const std::unique_ptr<memory> &src,
+                 const std::unique_ptr<memory> &dst,
+                 std::array<int, 2> sz_kernel,
+                 std::array<int, 2> sz_stride,
+                 std::array<int, 2> sz_padding,
+                 pooling_kind kind);
+  void infer_thread(int ithr, int nthr) override;
+  const char *name() { return "pool"; }
+
+private:
+  std::shared_ptr<jit::jit_pool_kernel> kernel_;
+  const dtype *src_data_;
+  dtype *dst_data_;
+  int dst_ld_;
+};
+}
@@ -0,0 +1,226 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "op_resize.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "log.h"
+#include "thread_pool.h"
+#include "util_jitinfer.h"
+
+namespace jitinfer {
+
+// src index and the weight of the next src index of each dst index,
+// nearest is asymmetric and bilinear has half pixel centers
+static void resize_index(int in,
+                         int out,
+                         resize_kind kind,
+                         std::vector<int> &i0,
+                         std::vector<int> &i1,
+                         std::vector<float> &w1) {
+  const float scale = static_cast<float>(in) / out;
+  for (int o = 0; o < out; ++o) {
+    if (kind == resize_nearest) {
+      int i = std::min(static_cast<int>(std::floor(o * scale)), in - 1);
+      i0.push_back(i);
+      i1.push_back(i);
+      w1.push_back(0.f);
+    } else {
+      float src = std::max((o + 0.5f) * scale - 0.5f, 0.f);
+      int i = std::min(static_cast<int>(src), in - 1);
+      i0.push_back(i);
+      i1.push_back(std::min(i + 1, in - 1));
+      w1.push_back(src - i);
+    }
+  }
+}
+
+template <typename dtype>
+op_resize<dtype>::op_resize(const std::vector<std::unique_ptr<memory>> &srcs,
+                            std::unique_ptr<memory> &dst,
+                            resize_kind kind,
+                            bool post_relu)
+    : op(),
+      kind_(kind),
+      post_relu_(post_relu),
+      kernel_(nullptr),
+      src_with_offset_(nullptr),
+      nb_ic_(nullptr) {
+  if (!init_conf(srcs, dst)) {
+    error_and_exit("Init Resize op failed!");
+  }
+  auto dst_dims = dst->std_dims();  // nchw
+  bs_ = dst_dims[0];
+  oh_ = dst_dims[2];
+  ow_ = dst_dims[3];
+  dst_ld_ = dst->ld();
+  dst_data_ = reinterpret_cast<dtype *>(dst->data());
+
+  const int num_srcs = srcs.size();
+  y0_.resize(num_srcs);
+  y1_.resize(num_srcs);
+  x0_.resize(num_srcs);
+  x1_.resize(num_srcs);
+  wy_.resize(num_srcs);
+  wx_.resize(num_srcs);
+  int c_off = 0;
+  for (int i = 0; i < num_srcs; ++i) {
+    auto src_dims = srcs[i]->std_dims();  // nchw
+    ic_.push_back(src_dims[1]);
+    ih_.push_back(src_dims[2]);
+    iw_.push_back(src_dims[3]);
+    ld_.push_back(srcs[i]->ld());  // srcs can be views
+    c_off_.push_back(c_off);
+    c_off += src_dims[1];
+    srcs_data_.push_back(reinterpret_cast<const dtype *>(srcs[i]->data()));
+    resize_index(ih_[i], oh_, kind_, y0_[i], y1_[i], wy_[i]);
+    resize_index(iw_[i], ow_, kind_, x0_[i], x1_[i], wx_[i]);
+  }
+
+  if (kind_ == resize_nearest) {
+    auto conf = util::zero<jit::jit_concat_conf_t>();
+    if (!jit::jit_concat_kernel::init_conf(conf, srcs, dst, post_relu)) {
+      error_and_exit("Init Resize op failed!");
+    }
+    kernel_ = jit::get_kernel<jit::jit_concat_kernel>(conf);
+    nb_ic_ = (int *)aligned_malloc(num_srcs * sizeof(int), 64);
+    for (int i = 0; i < num_srcs; ++i) {
+      nb_ic_[i] = ic_[i] / conf.block;
+    }
+    const int nthreads = get_max_threads();
+    src_with_offset_ = (const dtype **)aligned_malloc(
+        nthreads * num_srcs * sizeof(dtype *), 4096);
+  }
+}
+
+template <typename dtype>
+op_resize<dtype>::~op_resize() {
+  free(nb_ic_);
+  free(src_with_offset_);
+}
+
+template <typename dtype>
+bool op_resize<dtype>::init_conf(
+    const std::vector<std::unique_ptr<memory>> &srcs,
+    const std::unique_ptr<memory> &dst) {
+  using namespace util;
+  if (!all_true(dst->data_type() == type2dtype<dtype>::dtype,
+                dst->dim_format() == memory::format::nhwc,
+                kind_ == resize_nearest || kind_ == resize_bilinear)) {
+    info("Dst data type or format do not match");
+    return false;
+  }
+  auto dst_dims = dst->std_dims();  // nchw
+  int c = 0;
+  for (size_t i = 0; i < srcs.size(); ++i) {
+    auto src_dims = srcs[i]->std_dims();  // nchw
+    if (!all_true(srcs[i]->data_type() == dst->data_type(),
+                  srcs[i]->dim_format() == memory::format::nhwc,
+                  src_dims[0] == dst_dims[0])) {
+      info("Src %d does not match dst", (int)i);
+      return false;
+    }
+    c += src_dims[1];
+  }
+  if (srcs.empty() || c != dst_dims[1]) {
+    info("Channels of srcs do not match dst");
+    return false;
+  }
+  return true;
+}
+
+template <typename dtype>
+void op_resize<dtype>::infer_nearest(int ithr, int nthr) {
+  using namespace util;
+  const int num_srcs = srcs_data_.size();
+  const int work_amount = bs_ * oh_ * ow_;
+
+  int start{0}, end{0};
+  balance211(work_amount, nthr, ithr, start, end);
+  int n{0}, h{0}, w{0};
+  nd_iterator_init(start, n, bs_, h, oh_, w, ow_);
+  auto srcs = src_with_offset_ + ithr * num_srcs;
+  jit::jit_concat_call_s p = {0};
+  for (int iwork = start; iwork < end; ++iwork) {
+    for (int i = 0; i < num_srcs; ++i) {
+      int pix = (n * ih_[i] + y0_[i][h]) * iw_[i] + x0_[i][w];
+      srcs[i] = srcs_data_[i] + (size_t)pix * ld_[i];
+    }
+    p.src = reinterpret_cast<const void **>(srcs);
+    p.nb_ic = reinterpret_cast<const int *>(nb_ic_);
+    p.dst = reinterpret_cast<void *>(dst_data_ + (size_t)iwork * dst_ld_);
+    kernel_->jit_ker_(&p);
+    nd_iterator_step(n, bs_, h, oh_, w, ow_);
+  }
+}
+
+template <typename dtype>
+void op_resize<dtype>::infer_bilinear(int ithr, int nthr) {
+  using namespace util;
+  const int num_srcs = srcs_data_.size();
+  const int work_amount = bs_ * oh_ * ow_;
+
+  int start{0}, end{0};
+  balance211(work_amount, nthr, ithr, start, end);
+  int n{0}, h{0}, w{0};
+  nd_iterator_init(start, n, bs_, h, oh_, w, ow_);
+  for (int iwork = start; iwork < end; ++iwork) {
+    auto dst_w = dst_data_ + (size_t)iwork * dst_ld_;
+    for (int i = 0; i < num_srcs; ++i) {
+      const int ld = ld_[i];
+      auto src_n = srcs_data_[i] + (size_t)n * ih_[i] * iw_[i] * ld;
+      auto row0 = src_n + (size_t)y0_[i][h] * iw_[i] * ld;
+      auto row1 = src_n + (size_t)y1_[i][h] * iw_[i] * ld;
+      auto p00 = row0 + x0_[i][w] * ld, p01 = row0 + x1_[i][w] * ld;
+      auto p10 = row1 + x0_[i][w] * ld, p11 = row1 + x1_[i][w] * ld;
+      const float wy = wy_[i][h], wx = wx_[i][w];
+      auto dst_c = dst_w + c_off_[i];
+      for (int c = 0; c < ic_[i]; ++c) {
+        float top = p00[c] + wx * (p01[c] - p00[c]);
+        float bottom = p10[c] + wx * (p11[c] - p10[c]);
+        float v = top + wy * (bottom - top);
+        if (post_relu_) {
+          v = std::max(v, 0.f);
+        }
+        if (!std::is_same<dtype, f32>::value) {
+          v = std::nearbyint(v);
+        }
+        if (sizeof(dtype) == 1) {
+          // saturate to s8 or u8
+          v = std::max(v, float(std::numeric_limits<dtype>::lowest()));
+          v = std::min(v, float(std::numeric_limits<dtype>::max()));
+        }
+        dst_c[c] = static_cast<dtype>(v);
+      }
+    }
+    nd_iterator_step(n, bs_, h, oh_, w, ow_);
+  }
+}
+
+template <typename dtype>
+void op_resize<dtype>::infer_thread(int ithr, int nthr) {
+  if (kind_ == resize_nearest) {
+    infer_nearest(ithr, nthr);
+  } else {
+    infer_bilinear(ithr, nthr);
+  }
+}
+
+template class op_resize<f32>;
+template class op_resize<s32>;
+template class op_resize<s8>;
+template class op_resize<u8>;
+}
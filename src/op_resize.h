@@ -0,0 +1,62 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#pragma once
+
+#include <jitinfer.h>
+#include "jit_concat_kernel.h"
+
+namespace jitinfer {
+
+// resize srcs to the h and w of dst and concat them on channel,
+// so the upsampled tensor of fpn and unet decoders is written straight into
+// its channel slice of the concat dst, the same layout as concat.
+// Nearest only moves the pixels, so it is done by the concat kernel
+// with the pointers of the nearest src pixels.
+template <typename dtype>
+class op_resize : public op {
+public:
+  explicit op_resize(const std::vector<std::unique_ptr<memory>> &srcs,
+                     std::unique_ptr<memory> &dst,
+                     resize_kind kind,
+                     bool post_relu);
+
+  ~op_resize();
+
+protected:
+  bool init_conf(const std::vector<std::unique_ptr<memory>> &srcs,
+                 const std::unique_ptr<memory> &dst);
+  void infer_thread(int ithr, int nthr) override;
+  inline void infer_nearest(int ithr, int nthr);
+  inline void infer_bilinear(int ithr, int nthr);
+  const char *name() { return "resize"; }
+
+private:
+  resize_kind kind_;
+  bool post_relu_;
+  int bs_, oh_, ow_;
+  int dst_ld_;
+  dtype *dst_data_;
+  std::vector<const dtype *> srcs_data_;
+  std::vector<int> ih_, iw_, ic_, ld_;
+  std::vector<int> c_off_;  // the first channel of each src in dst
+  // src rows and cols of each dst row and col, with the weights of y1 and x1
+  std::vector<std::vector<int>> y0_, y1_, x0_, x1_;
+  std::vector<std::vector<float>> wy_, wx_;
+  std::shared_ptr<jit::jit_concat_kernel> kernel_;  // only for nearest
+  const dtype **src_with_offset_;
+  int *nb_ic_;
+};
+}
@@ -0,0 +1,47 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "op_split.h"
+#include "util_jitinfer.h"
+
+namespace jitinfer {
+
+template <typename dtype>
+void op_split<dtype>::infer_thread(int ithr, int nthr) {
+  using namespace util;
+  const auto &jcp = kernel_->jcp_;
+
+  const int work_amount = jcp.bs * jcp.h * jcp.w;
+  int start{0}, end{0};
+  balance211(work_amount, nthr, ithr, start, end);
+  auto dsts = dst_with_offset_ + ithr * jcp.n_inputs;
+  jit::jit_concat_call_s p = {0};
+  for (int nhw = start; nhw < end; ++nhw) {
+    for (int i = 0; i < jcp.n_inputs; ++i) {
+      dsts[i] = dsts_data_[i] + nhw * ld_[i];
+    }
+    p.src = const_cast<const void **>(reinterpret_cast<void **>(dsts));
+    p.nb_ic = reinterpret_cast<const int *>(nb_oc_);
+    p.dst = reinterpret_cast<const void *>(src_data_ + nhw * src_ld_);
+    // one kernel move one src pixel to all dsts
+    kernel_->jit_ker_(&p);
+  }
+}
+
+template class op_split<f32>;
+template class op_split<s32>;
+template class op_split<s8>;
+template class op_split<u8>;
+}
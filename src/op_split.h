@@ -0,0 +1,96 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#pragma once
+
+#include <jitinfer.h>
+#include "jit_concat_kernel.h"
+#include "log.h"
+#include "thread_pool.h"
+
+namespace jitinfer {
+
+// split reuse the concat kernel in reverse
+template <typename dtype>
+class op_split : public op {
+public:
+  explicit op_split(const std::unique_ptr<memory> &src,
+                    std::vector<std::unique_ptr<memory>> &dsts,
+                    bool post_relu = false)
+      : op() {
+    auto conf = util::zero<jit::jit_concat_conf_t>();
+    if (!init_conf(conf, src, dsts, post_relu)) {
+      error_and_exit("Init Split op failed!");
+    }
+
+    kernel_ = jit::get_kernel<jit::jit_concat_kernel>(conf);
+
+    const auto &jcp = kernel_->jcp_;
+    const int num_dsts = jcp.n_inputs;
+    assert(num_dsts == (int)dsts.size());
+
+    dsts_data_ = (dtype **)aligned_malloc(num_dsts * sizeof(dtype *), 64);
+    nb_oc_ = (int *)aligned_malloc(num_dsts * sizeof(int), 64);
+    ld_ = (int *)aligned_malloc(num_dsts * sizeof(int), 64);
+
+    for (int i = 0; i < num_dsts; ++i) {
+      auto dim = dsts[i]->actual_dims();
+      assert(dsts[i]->dim_format() == memory::format::nhwc);
+      nb_oc_[i] = dim[3] / jcp.block;
+      ld_[i] = dsts[i]->ld();  // dsts can be views
+      check_eq(nb_oc_[i] * jcp.block, dim[3]);
+      dsts_data_[i] = reinterpret_cast<dtype *>(dsts[i]->data());
+    }
+    src_data_ = reinterpret_cast<const dtype *>(src->data());
+    src_ld_ = src->ld();
+
+    const int nthreads = get_max_threads();
+    debug("Split: Max threads: %d", nthreads);
+    dst_with_offset_ =
+        (dtype **)aligned_malloc(nthreads * num_dsts * sizeof(dtype *), 4096);
+  }
+
+  ~op_split() {
+    free(nb_oc_);
+    free(ld_);
+    free(dsts_data_);
+    free(dst_with_offset_);
+  }
+
+protected:
+  bool init_conf(jit::jit_concat_conf_t &conf,
+                 const std::unique_ptr<memory> &src,
+                 const std::vector<std::unique_ptr<memory>> &dsts,
+                 bool post_relu = false) {
+    // dsts are the list and src is the whole one of concat kernel
+    if (!jit::jit_concat_kernel::init_conf(conf, dsts, src, post_relu)) {
+      return false;
+    }
+    conf.is_split = true;
+    return true;
+  }
+  void infer_thread(int ithr, int nthr) override;
+  const char *name() { return "split"; }
+
+private:
+  std::shared_ptr<jit::jit_concat_kernel> kernel_;
+  const dtype *src_data_;
+  dtype **dsts_data_;
+  dtype **dst_with_offset_;
+  int *nb_oc_;
+  int *ld_;
+  int src_ld_;
+};
+}
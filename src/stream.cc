@@ -0,0 +1,81 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "network.h"
+#include <algorithm>
+#include "log.h"
+#include "thread_pool.h"
+#include "util_jitinfer.h"
+
+namespace jitinfer {
+
+stream::stream(network &net, const std::vector<int> &cpus)
+    : net_(net), cpus_(cpus) {
+  check(!cpus_.empty());
+  // the workspace of ops is allocated for get_max_threads() threads
+  int nthr = std::min<int>(cpus_.size(), get_max_threads());
+  pool_.reset(new thread_pool(nthr, thread_pool::default_spin_count(), cpus_));
+  inst_ = net_.create_instance();
+}
+
+stream::~stream() {
+  // the ops of this stream are released before its threads
+  inst_.reset();
+  pool_.reset();
+}
+
+void stream::run(const std::vector<std::unique_ptr<memory>> &inputs,
+                 std::vector<std::unique_ptr<memory>> &outputs) {
+  net_.prepare(*inst_, inputs, outputs);
+  pool_->pinned_parallel(pool_->size(), [&](int ithr, int nthr) {
+    net_.infer_thread(*inst_, ithr, nthr);
+  });
+}
+
+const std::vector<std::unique_ptr<op>> &stream::ops() { return inst_->ops; }
+
+stream_group::stream_group(network &net,
+                           int nstreams,
+                           const std::vector<int> &cpus) {
+  auto all = cpus.empty() ? process_cpus() : cpus;
+  check_gt(nstreams, 0);
+  check_le(size_t(nstreams), all.size());
+  for (int i = 0; i < nstreams; ++i) {
+    size_t start{0}, end{0};
+    util::balance211(all.size(), size_t(nstreams), size_t(i), start, end);
+    std::vector<int> group(all.begin() + start, all.begin() + end);
+    streams_.emplace_back(new stream(net, group));
+    free_.push_back(nstreams - 1 - i);
+  }
+}
+
+void stream_group::run(const std::vector<std::unique_ptr<memory>> &inputs,
+                       std::vector<std::unique_ptr<memory>> &outputs) {
+  int i = 0;
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    cv_.wait(lock, [&] { return !free_.empty(); });
+    // the stream freed last is used first, since its cache is still warm
+    i = free_.back();
+    free_.pop_back();
+  }
+  streams_[i]->run(inputs, outputs);
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    free_.push_back(i);
+  }
+  cv_.notify_one();
+}
+}
@@ -0,0 +1,378 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "thread_pool.h"
+#include <immintrin.h>
+#include <pthread.h>
+#include <sched.h>
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <thread>
+#include "log.h"
+#include "omp_thread.h"
+#include "util.h"
+
+namespace jitinfer {
+
+namespace {
+// the threads of one parallel of thread_pool
+struct team_t {
+  const std::function<void(int, int)> *fn;
+  int nthr;
+  int spin_count;
+  std::atomic<int> running;  // workers not done with fn
+  std::atomic<int> arrived;  // threads arrived at the barrier
+  std::atomic<unsigned> barrier_epoch;
+};
+
+// the parallel region the current thread is running in
+struct region_t {
+  team_t *team;  // nullptr for OpenMP
+  int nthr;
+};
+thread_local region_t *cur_region = nullptr;
+
+class region_guard {
+public:
+  explicit region_guard(region_t *r) : prev_(cur_region) { cur_region = r; }
+  ~region_guard() { cur_region = prev_; }
+
+private:
+  region_t *prev_;
+};
+
+void run_serial(const std::function<void(int, int)> &fn) {
+  region_t r = {nullptr, 1};
+  region_guard guard(&r);
+  fn(0, 1);
+}
+
+int env_int(const char *name, int default_value) {
+  const int len = 16;
+  char value[len] = {0};
+  return util::env::_getenv(value, name, len) > 0 ? atoi(value)
+                                                  : default_value;
+}
+
+// the pool of each cpu set of exec_ctx, created on the first use
+thread_pool &cpus_pool(const std::vector<int> &cpus) {
+  static std::mutex mu;
+  static std::map<std::vector<int>, std::unique_ptr<thread_pool>> pools;
+  std::lock_guard<std::mutex> lock(mu);
+  auto &pool = pools[cpus];
+  if (!pool) {
+    int nthr = std::min<int>(cpus.size(), get_max_threads());
+    pool.reset(new thread_pool(nthr, thread_pool::default_spin_count(), cpus));
+  }
+  return *pool;
+}
+}
+
+std::vector<int> process_cpus() {
+  std::vector<int> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int i = 0; i < CPU_SETSIZE; ++i) {
+      if (CPU_ISSET(i, &set)) {
+        cpus.push_back(i);
+      }
+    }
+  }
+  return cpus;
+}
+
+struct thread_pool::worker {
+  worker() : epoch(0), team(nullptr), ithr(0) {}
+  std::atomic<unsigned> epoch;  // increased by each parallel it is in
+  team_t *team;
+  int ithr;
+  std::mutex mu;
+  std::condition_variable cv;
+  std::thread thread;
+};
+
+thread_pool::thread_pool(int nthr,
+                         int spin_count,
+                         const std::vector<int> &cpus)
+    : nthr_(std::max(nthr, 1)),
+      spin_count_(spin_count),
+      cpus_(cpus),
+      stop_(false) {
+  for (int i = 1; i < nthr_; ++i) {
+    workers_.emplace_back(new worker());
+    auto &w = *workers_.back();
+    w.thread = std::thread(&thread_pool::work, this, std::ref(w));
+    if (!cpus.empty()) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpus[i % cpus.size()], &set);
+      if (pthread_setaffinity_np(
+              w.thread.native_handle(), sizeof(set), &set) != 0) {
+        info("Can not pin thread %d to cpu %d", i, cpus[i % cpus.size()]);
+      }
+    }
+  }
+  // the first workers are taken first, they are at the back
+  for (int i = nthr_ - 2; i >= 0; --i) {
+    idle_.push_back(i);
+  }
+}
+
+thread_pool::~thread_pool() {
+  stop_.store(true);
+  for (auto &w : workers_) {
+    {
+      std::lock_guard<std::mutex> lock(w->mu);
+      w->epoch.fetch_add(1, std::memory_order_release);
+    }
+    w->cv.notify_one();
+  }
+  for (auto &w : workers_) {
+    w->thread.join();
+  }
+}
+
+void thread_pool::work(worker &w) {
+  unsigned seen = 0;
+  while (true) {
+    // spin first since the next region of a network comes soon
+    for (int i = 0;
+         i < spin_count_ && w.epoch.load(std::memory_order_acquire) == seen;
+         ++i) {
+      _mm_pause();
+    }
+    if (w.epoch.load(std::memory_order_acquire) == seen) {
+      std::unique_lock<std::mutex> lock(w.mu);
+      w.cv.wait(lock, [&] {
+        return w.epoch.load(std::memory_order_acquire) != seen;
+      });
+    }
+    seen = w.epoch.load(std::memory_order_acquire);
+    if (stop_.load()) {
+      return;
+    }
+    team_t *team = w.team;
+    {
+      region_t r = {team, team->nthr};
+      region_guard guard(&r);
+      (*team->fn)(w.ithr, team->nthr);
+    }
+    // the team is released by the caller once all workers are done
+    team->running.fetch_sub(1, std::memory_order_acq_rel);
+  }
+}
+
+void thread_pool::parallel(int nthr, const std::function<void(int, int)> &fn) {
+  nthr = std::min(nthr, nthr_);
+  if (nthr <= 1 || cur_region != nullptr) {
+    run_serial(fn);
+    return;
+  }
+  std::vector<int> taken;
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    while (int(taken.size()) < nthr - 1 && !idle_.empty()) {
+      taken.push_back(idle_.back());
+      idle_.pop_back();
+    }
+  }
+  if (taken.empty()) {
+    run_serial(fn);
+    return;
+  }
+  team_t team;
+  team.fn = &fn;
+  team.nthr = taken.size() + 1;
+  team.spin_count = spin_count_;
+  team.running.store(taken.size(), std::memory_order_relaxed);
+  team.arrived.store(0, std::memory_order_relaxed);
+  team.barrier_epoch.store(0, std::memory_order_relaxed);
+  for (size_t i = 0; i < taken.size(); ++i) {
+    auto &w = *workers_[taken[i]];
+    w.team = &team;
+    w.ithr = i + 1;
+    {
+      std::lock_guard<std::mutex> lock(w.mu);
+      w.epoch.fetch_add(1, std::memory_order_release);
+    }
+    w.cv.notify_one();
+  }
+  {
+    region_t r = {&team, team.nthr};
+    region_guard guard(&r);
+    fn(0, team.nthr);
+  }
+  for (int i = 0; team.running.load(std::memory_order_acquire) > 0; ++i) {
+    if (i < spin_count_) {
+      _mm_pause();
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  std::lock_guard<std::mutex> lock(mu_);
+  for (auto it = taken.rbegin(); it != taken.rend(); ++it) {
+    idle_.push_back(*it);
+  }
+}
+
+void thread_pool::pinned_parallel(int nthr,
+                                  const std::function<void(int, int)> &fn) {
+  if (cpus_.empty() || cur_region != nullptr) {
+    parallel(nthr, fn);
+    return;
+  }
+  // the caller is thread 0, so it runs on the first cpu as well
+  cpu_set_t prev, set;
+  CPU_ZERO(&set);
+  CPU_SET(cpus_[0], &set);
+  pthread_t self = pthread_self();
+  bool pinned = pthread_getaffinity_np(self, sizeof(prev), &prev) == 0 &&
+                pthread_setaffinity_np(self, sizeof(set), &set) == 0;
+  parallel(nthr, fn);
+  if (pinned) {
+    pthread_setaffinity_np(self, sizeof(prev), &prev);
+  }
+}
+
+void thread_pool::barrier() { jitinfer::barrier(); }
+
+int thread_pool::default_spin_count() {
+  static int spin_count = env_int("JITINFER_SPIN_COUNT", 100000);
+  return spin_count;
+}
+
+thread_pool &thread_pool::global() {
+  static std::vector<int> cpus = process_cpus();
+  static thread_pool pool(
+      env_int("JITINFER_NUM_THREADS", std::max<int>(cpus.size(), 1)),
+      default_spin_count(),
+      cpus);
+  return pool;
+}
+
+int get_max_threads() {
+#ifdef WITH_THREAD_POOL
+  return thread_pool::global().size();
+#else
+  return omp_get_max_threads();
+#endif
+}
+
+void parallel(int nthr, const std::function<void(int, int)> &fn) {
+  if (nthr <= 1 || cur_region != nullptr || omp_in_parallel()) {
+    run_serial(fn);
+    return;
+  }
+#ifdef WITH_THREAD_POOL
+  thread_pool::global().parallel(nthr, fn);
+#else
+#pragma omp parallel num_threads(nthr)
+  {
+    region_t r = {nullptr, omp_get_num_threads()};
+    region_guard guard(&r);
+    fn(omp_get_thread_num(), r.nthr);
+  }
+#endif
+}
+
+void parallel(const exec_ctx &ctx, const std::function<void(int, int)> &fn) {
+  int nthr = get_max_threads();
+  if (ctx.nthreads > 0) {
+    nthr = std::min(nthr, ctx.nthreads);
+  }
+  if (ctx.cpus.empty() || cur_region != nullptr || omp_in_parallel()) {
+    parallel(nthr, fn);
+    return;
+  }
+  nthr = std::min<int>(nthr, ctx.cpus.size());
+  cpus_pool(ctx.cpus).pinned_parallel(nthr, fn);
+}
+
+async_queue::async_queue() : stop_(false) {}
+
+async_queue::~async_queue() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+std::shared_future<void> async_queue::enqueue(
+    const std::function<void()> &fn) {
+  // the global pool is created first, so it is released after the queue
+  get_max_threads();
+  auto task = std::make_shared<std::packaged_task<void()>>(fn);
+  std::shared_future<void> done = task->get_future().share();
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    tasks_.push_back([task] { (*task)(); });
+    if (!thread_.joinable()) {
+      thread_ = std::thread(&async_queue::work, this);
+    }
+  }
+  cv_.notify_one();
+  return done;
+}
+
+void async_queue::work() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      cv_.wait(lock, [&] { return stop_ || !tasks_.empty(); });
+      if (stop_) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+void barrier() {
+  if (cur_region == nullptr || cur_region->nthr <= 1) {
+    return;
+  }
+  team_t *team = cur_region->team;
+  if (team == nullptr) {
+#pragma omp barrier
+    return;
+  }
+  unsigned e = team->barrier_epoch.load(std::memory_order_acquire);
+  if (team->arrived.fetch_add(1, std::memory_order_acq_rel) ==
+      team->nthr - 1) {
+    team->arrived.store(0, std::memory_order_relaxed);
+    team->barrier_epoch.fetch_add(1, std::memory_order_release);
+    return;
+  }
+  for (int i = 0; team->barrier_epoch.load(std::memory_order_acquire) == e;
+       ++i) {
+    if (i < team->spin_count) {
+      _mm_pause();
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+}
@@ -0,0 +1,114 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#pragma once
+
+#include <jitinfer.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace jitinfer {
+
+// the threads parallel can use at most
+int get_max_threads();
+
+// run fn(ithr, nthr) on nthr threads and return when all are done, the caller
+// is thread 0. It runs on the thread pool when built WITH_THREAD_POOL,
+// otherwise on OpenMP. Inside a parallel region fn only runs in the caller.
+void parallel(int nthr, const std::function<void(int, int)> &fn);
+
+// run fn on the threads of ctx, which are at most get_max_threads().
+// With cpus, it runs on a pool pinned to them, and the caller is pinned to
+// the first cpu until all threads are done.
+void parallel(const exec_ctx &ctx, const std::function<void(int, int)> &fn);
+
+// wait for all threads of the current parallel region
+void barrier();
+
+// the cpus this process can run on, which respects taskset
+std::vector<int> process_cpus();
+
+// runs the fns enqueued to it one by one in order on its own thread, which
+// is started by the first enqueue. Each op and network has its own, so the
+// async work of one does not wait for the others.
+class async_queue {
+public:
+  async_queue();
+  // the fns not started yet are dropped
+  ~async_queue();
+
+  // run fn after the fns enqueued before it, and return at once.
+  // fn can call parallel to run on the threads as usual.
+  std::shared_future<void> enqueue(const std::function<void()> &fn);
+
+private:
+  void work();
+
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::deque<std::function<void()>> tasks_;
+  bool stop_;
+  std::thread thread_;
+  DISABLE_COPY_AND_ASSIGN(async_queue);
+};
+
+// persistent workers pinned to cpus, an idle worker spins spin_count times
+// before sleeping, so the back-to-back regions of a network do not sleep
+class thread_pool {
+public:
+  // nthr threads including the caller of parallel, workers 1 to nthr - 1 are
+  // pinned to cpus[1] to cpus[nthr - 1] if cpus is not empty
+  explicit thread_pool(int nthr,
+                       int spin_count = default_spin_count(),
+                       const std::vector<int> &cpus = {});
+  ~thread_pool();
+
+  int size() const { return nthr_; }
+  // the caller and nthr - 1 idle workers run fn, only these workers are
+  // woken up, so parallel of few threads can run at the same time as others
+  // on the rest. It runs on fewer threads when not enough workers are idle.
+  void parallel(int nthr, const std::function<void(int, int)> &fn);
+  // the same as parallel, and the caller is pinned to cpus[0] until all
+  // threads are done, then its affinity is restored
+  void pinned_parallel(int nthr, const std::function<void(int, int)> &fn);
+  // wait for the threads of the current parallel
+  void barrier();
+
+  // JITINFER_SPIN_COUNT, or 100000 by default
+  static int default_spin_count();
+  // the global pool used by parallel, with JITINFER_NUM_THREADS threads or
+  // one for each cpu this process can run on
+  static thread_pool &global();
+
+private:
+  struct worker;
+  void work(worker &w);
+
+  int nthr_;
+  int spin_count_;
+  std::vector<int> cpus_;
+  std::vector<std::unique_ptr<worker>> workers_;
+  std::mutex mu_;
+  std::vector<int> idle_;  // the workers not in any parallel
+  std::atomic<bool> stop_;
+  DISABLE_COPY_AND_ASSIGN(thread_pool);
+};
+}
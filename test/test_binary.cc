@@ -0,0 +1,116 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include <limits>
+#include "util_jitinfer.h"
+#include "util_test.h"
+
+namespace jitinfer {
+
+template <typename dtype>
+class test_binary : public ::testing::TestWithParam<memory::nchw_dims> {
+  void check_result(const std::unique_ptr<memory>& src0,
+                    const std::unique_ptr<memory>& src1,
+                    const std::unique_ptr<memory>& dst,
+                    binary_kind kind,
+                    bool post_relu) {
+    const dtype* src0_data = (const dtype*)(src0->data());
+    const dtype* src1_data = (const dtype*)(src1->data());
+    const bool broadcast = src1->dim_format() == memory::format::x;
+    const int c = dst->std_dims()[1];
+    std::vector<dtype> ref(dst->size());
+#pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < ref.size(); ++i) {
+      // s8 and u8 are computed as s32 then saturated
+      typedef typename std::
+          conditional<std::is_same<dtype, f32>::value, f32, s32>::type acc_t;
+      acc_t a = src0_data[i];
+      acc_t b = src1_data[broadcast ? i % c : i];
+      acc_t v = kind == binary_add ? a + b : a * b;
+      if (post_relu) {
+        v = std::max(v, acc_t(0));
+      }
+      if (sizeof(dtype) == 1) {
+        v = std::max(v, acc_t(std::numeric_limits<dtype>::min()));
+        v = std::min(v, acc_t(std::numeric_limits<dtype>::max()));
+      }
+      ref[i] = static_cast<dtype>(v);
+    }
+    util::compare_array<dtype>((dtype*)(dst->data()), ref.data(), dst->size());
+  }
+
+protected:
+  virtual void SetUp() {
+    memory::nchw_dims dims =
+        ::testing::TestWithParam<memory::nchw_dims>::GetParam();
+    auto dt = util::type2dtype<dtype>::dtype;
+    memory::format fmt = memory::format::nhwc;
+    std::unique_ptr<memory> src0, src1, src1_c, dst;
+    src0.reset(new memory(dims, fmt, dt));
+    src1.reset(new memory(dims, fmt, dt));
+    src1_c.reset(new memory({dims[1]}, dt));
+    dst.reset(new memory(dims, fmt, dt));
+    util::fill_data<dtype>(static_cast<dtype*>(src0->data()), src0->size());
+    util::fill_data<dtype>(static_cast<dtype*>(src1->data()), src1->size());
+    util::fill_data<dtype>(static_cast<dtype*>(src1_c->data()),
+                           src1_c->size());
+
+    for (binary_kind kind : {binary_add, binary_mul}) {
+      for (bool post_relu : {true, false}) {
+        auto b0 = binary(src0, src1, dst, kind, post_relu);
+        b0->submit();
+        check_result(src0, src1, dst, kind, post_relu);
+        // broadcast channels
+        auto b1 = binary(src0, src1_c, dst, kind, post_relu);
+        b1->submit();
+        check_result(src0, src1_c, dst, kind, post_relu);
+      }
+    }
+  }
+};
+
+using test_binary_f32 = test_binary<f32>;
+using test_binary_s32 = test_binary<s32>;
+using test_binary_s8 = test_binary<s8>;
+using test_binary_u8 = test_binary<u8>;
+
+TEST_P(test_binary_f32, TestsBinary) {}
+TEST_P(test_binary_s32, TestsBinary) {}
+TEST_P(test_binary_s8, TestsBinary) {}
+TEST_P(test_binary_u8, TestsBinary) {}
+
+// @note: the dims are always given as nchw
+#define BINARY_TEST_CASES                                              \
+  memory::nchw_dims{{2, 16, 4, 4}}, memory::nchw_dims{{2, 48, 13, 13}}, \
+      memory::nchw_dims{{2, 256, 56, 56}}, memory::nchw_dims {        \
+    { 4, 2048, 7, 7 }                                                  \
+  }
+
+INSTANTIATE_TEST_CASE_P(TestBinary,
+                        test_binary_f32,
+                        ::testing::Values(BINARY_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestBinary,
+                        test_binary_s32,
+                        ::testing::Values(BINARY_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestBinary,
+                        test_binary_s8,
+                        ::testing::Values(BINARY_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestBinary,
+                        test_binary_u8,
+                        ::testing::Values(BINARY_TEST_CASES));
+}
@@ -0,0 +1,185 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include <cmath>
+#include <limits>
+#include "util_jitinfer.h"
+#include "util_params.h"
+#include "util_test.h"
+
+namespace jitinfer {
+
+// fused bottleneck should equal to conv1x1, conv and conv1 with u8 outputs,
+// then sum and relu on the f32 output of conv1.
+// here oc1x1 of the params is the output channel of conv1x1,
+// oc is the output channel of conv, and the block output channel is ic.
+template <typename dst_t>
+class test_bottleneck : public ::testing::TestWithParam<util::conv_params> {
+  template <typename sum_t>
+  void check_result(const std::unique_ptr<memory> &conv1_out,
+                    const std::unique_ptr<memory> &sum,
+                    float sum_scale,
+                    const std::unique_ptr<memory> &dst) {
+    const f32 *out_data = (const f32 *)(conv1_out->data());
+    const sum_t *sum_data =
+        sum != nullptr ? (const sum_t *)(sum->data()) : nullptr;
+    std::vector<dst_t> ref(dst->size());
+    for (size_t i = 0; i < dst->size(); ++i) {
+      float v = out_data[i];
+      if (sum_data) {
+        v += sum_scale * (float)sum_data[i];
+      }
+      v = std::max(v, 0.f);
+      if (!std::is_same<dst_t, f32>::value) {
+        v = std::nearbyint(v);
+        v = std::max(v, (float)std::numeric_limits<dst_t>::min());
+        v = std::min(v, (float)std::numeric_limits<dst_t>::max());
+      }
+      ref[i] = static_cast<dst_t>(v);
+    }
+    util::compare_array<dst_t>((dst_t *)(dst->data()), ref.data(), dst->size());
+  }
+
+protected:
+  virtual void SetUp() {
+    util::conv_params p =
+        ::testing::TestWithParam<util::conv_params>::GetParam();
+    using format = memory::format;
+    constexpr format fmt = format::nhwc;
+    std::array<int, 2> sz_stride = {p.sh, p.sw};
+    std::array<int, 2> sz_padding = {p.ph, p.pw};
+    // the shortcut is src itself when the size is kept, otherwise it is
+    // given as the s8 output of a projection
+    const bool identity = p.ih == p.oh && p.iw == p.ow;
+
+    std::unique_ptr<memory> src, wei1x1, bia1x1, mid1x1, wei, bia, mid;
+    std::unique_ptr<memory> wei1, bia1, proj, conv1_out, dst;
+    src.reset(new memory({p.bs, p.ic, p.ih, p.iw}, fmt, memory::dtype::u8));
+    wei1x1.reset(new memory(
+        {p.oc1x1, p.ic, 1, 1}, format::OIhw4i16o4i, memory::dtype::s8));
+    bia1x1.reset(new memory({p.oc1x1}, memory::dtype::s32));
+    mid1x1.reset(
+        new memory({p.bs, p.oc1x1, p.ih, p.iw}, fmt, memory::dtype::u8));
+    wei.reset(new memory(
+        {p.oc, p.oc1x1, p.kh, p.kw}, format::OIhw4i16o4i, memory::dtype::s8));
+    bia.reset(new memory({p.oc}, memory::dtype::s32));
+    mid.reset(new memory({p.bs, p.oc, p.oh, p.ow}, fmt, memory::dtype::u8));
+    wei1.reset(new memory(
+        {p.ic, p.oc, 1, 1}, format::OIhw4i16o4i, memory::dtype::s8));
+    bia1.reset(new memory({p.ic}, memory::dtype::s32));
+    proj.reset(new memory({p.bs, p.ic, p.oh, p.ow}, fmt, memory::dtype::s8));
+    conv1_out.reset(
+        new memory({p.bs, p.ic, p.oh, p.ow}, fmt, memory::dtype::f32));
+    dst.reset(new memory(
+        {p.bs, p.ic, p.oh, p.ow}, fmt, util::type2dtype<dst_t>::dtype));
+    util::fill_data<u8>(static_cast<u8 *>(src->data()), src->size());
+    util::fill_data<s8>(static_cast<s8 *>(wei1x1->data()), wei1x1->size());
+    util::fill_data<s32>(static_cast<s32 *>(bia1x1->data()), bia1x1->size());
+    util::fill_data<s8>(static_cast<s8 *>(wei->data()), wei->size());
+    util::fill_data<s32>(static_cast<s32 *>(bia->data()), bia->size());
+    util::fill_data<s8>(static_cast<s8 *>(wei1->data()), wei1->size());
+    util::fill_data<s32>(static_cast<s32 *>(bia1->data()), bia1->size());
+    util::fill_data<s8>(static_cast<s8 *>(proj->data()), proj->size());
+    const auto &shortcut = identity ? src : proj;
+    const std::unique_ptr<memory> no_sum;
+
+    std::vector<float> conv1x1_scales(p.oc1x1);
+    std::vector<float> conv0_scales(p.oc);
+    std::vector<float> conv1_scales(p.ic);
+    util::fill_data<float>(
+        conv1x1_scales.data(), conv1x1_scales.size(), 0.001f, 0.03f);
+    util::fill_data<float>(
+        conv0_scales.data(), conv0_scales.size(), 0.001f, 0.03f);
+    util::fill_data<float>(
+        conv1_scales.data(), conv1_scales.size(), 0.001f, 0.3f);
+
+    // sum scale of power of 2 keeps the fused fma the same as mul and add
+    for (float sum_scale : {1.f, 0.5f}) {
+      for (bool with_sum : {true, false}) {
+        auto c1x1 = conv(
+            src, wei1x1, bia1x1, {1, 1}, {0, 0}, mid1x1, true, conv1x1_scales);
+        auto c0 = conv(
+            mid1x1, wei, bia, sz_stride, sz_padding, mid, true, conv0_scales);
+        auto c1 = conv(
+            mid, wei1, bia1, {1, 1}, {0, 0}, conv1_out, false, conv1_scales);
+        auto block = bottleneck(src,
+                                wei1x1,
+                                bia1x1,
+                                wei,
+                                bia,
+                                sz_stride,
+                                sz_padding,
+                                wei1,
+                                bia1,
+                                with_sum ? shortcut : no_sum,
+                                dst,
+                                conv1x1_scales,
+                                conv0_scales,
+                                conv1_scales,
+                                sum_scale);
+        c1x1->submit();
+        c0->submit();
+        c1->submit();
+        block->submit();
+        if (!with_sum) {
+          check_result<u8>(conv1_out, no_sum, sum_scale, dst);
+        } else if (identity) {
+          check_result<u8>(conv1_out, shortcut, sum_scale, dst);
+        } else {
+          check_result<s8>(conv1_out, shortcut, sum_scale, dst);
+        }
+      }
+    }
+  }
+};
+
+using test_bottleneck_f32 = test_bottleneck<f32>;
+using test_bottleneck_s32 = test_bottleneck<s32>;
+using test_bottleneck_s8 = test_bottleneck<s8>;
+using test_bottleneck_u8 = test_bottleneck<u8>;
+
+TEST_P(test_bottleneck_f32, TestsBottleneck) {}
+TEST_P(test_bottleneck_s32, TestsBottleneck) {}
+TEST_P(test_bottleneck_s8, TestsBottleneck) {}
+TEST_P(test_bottleneck_u8, TestsBottleneck) {}
+
+// @note: the srcs, wei and dst are always given as nchw
+/*conv: bs, gp, ic, ih, iw, oc, oh, ow, kh, kw, ph, pw, sh, sw, oc1x1*/
+#define BOTTLENECK_TEST_CASES                                            \
+  util::conv_params{2, 1, 64, 4, 4, 16, 4, 4, 3, 3, 1, 1, 1, 1, 16},     \
+      util::conv_params{                                                 \
+          2, 1, 256, 56, 56, 64, 56, 56, 3, 3, 1, 1, 1, 1, 64},          \
+      util::conv_params{                                                 \
+          2, 1, 512, 28, 28, 128, 14, 14, 3, 3, 1, 1, 2, 2, 128},        \
+      util::conv_params {                                                \
+    1, 1, 1024, 14, 14, 256, 14, 14, 3, 3, 1, 1, 1, 1, 256               \
+  }
+
+INSTANTIATE_TEST_CASE_P(TestBottleneck,
+                        test_bottleneck_f32,
+                        ::testing::Values(BOTTLENECK_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestBottleneck,
+                        test_bottleneck_s32,
+                        ::testing::Values(BOTTLENECK_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestBottleneck,
+                        test_bottleneck_s8,
+                        ::testing::Values(BOTTLENECK_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestBottleneck,
+                        test_bottleneck_u8,
+                        ::testing::Values(BOTTLENECK_TEST_CASES));
+}
@@ -0,0 +1,130 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "util_jitinfer.h"
+#include "util_test.h"
+
+namespace jitinfer {
+
+struct test_concat_conv1x1_params {
+  std::vector<int> ics;  // channels of each src
+  memory::nchw_dims dst_dims;
+};
+
+// fused concat_conv1x1 should equal to concat then conv1x1
+template <typename dst_t>
+class test_concat_conv1x1
+    : public ::testing::TestWithParam<test_concat_conv1x1_params> {
+protected:
+  virtual void SetUp() {
+    test_concat_conv1x1_params p =
+        ::testing::TestWithParam<test_concat_conv1x1_params>::GetParam();
+    using format = memory::format;
+    constexpr format fmt = format::nhwc;
+    auto dst_dt = util::type2dtype<dst_t>::dtype;
+    const int bs = p.dst_dims[0], oc = p.dst_dims[1];
+    const int h = p.dst_dims[2], w = p.dst_dims[3];
+    const size_t num = p.ics.size();
+
+    std::unique_ptr<memory> concated, wei, bia, ref, dst, whole;
+    const std::unique_ptr<memory> none;
+    std::vector<std::unique_ptr<memory>> srcs(num), views(num);
+    int ic = 0;
+    for (size_t i = 0; i < num; ++i) {
+      ic += p.ics[i];
+    }
+    // the srcs are also given as views of one memory, as densenet does
+    whole.reset(new memory({bs, ic, h, w}, fmt, memory::dtype::u8));
+    int c_offset = 0;
+    for (size_t i = 0; i < num; ++i) {
+      srcs[i].reset(new memory({bs, p.ics[i], h, w}, fmt, memory::dtype::u8));
+      util::fill_data<u8>(static_cast<u8 *>(srcs[i]->data()), srcs[i]->size());
+      views[i].reset(new memory(whole, c_offset, p.ics[i]));
+      c_offset += p.ics[i];
+    }
+    concated.reset(new memory({bs, ic, h, w}, fmt, memory::dtype::u8));
+    wei.reset(
+        new memory({oc, ic, 1, 1}, format::OIhw4i16o4i, memory::dtype::s8));
+    bia.reset(new memory({oc}, memory::dtype::s32));
+    ref.reset(new memory(p.dst_dims, fmt, dst_dt));
+    dst.reset(new memory(p.dst_dims, fmt, dst_dt));
+    util::fill_data<s8>(static_cast<s8 *>(wei->data()), wei->size());
+    util::fill_data<s32>(static_cast<s32 *>(bia->data()), bia->size());
+    std::vector<float> scales_1(1), scales_c(oc);
+    util::fill_data<float>(scales_1.data(), 1, 0.001f, 0.3f);
+    util::fill_data<float>(scales_c.data(), oc, 0.001f, 0.3f);
+
+    auto c = concat(srcs, concated);
+    c->submit();
+    // fill the views from the concat output
+    auto fill_views = concat(srcs, whole);
+    fill_views->submit();
+
+    for (bool with_bias : {true, false}) {
+      for (bool post_relu : {true, false}) {
+        for (bool multi_scales : {true, false}) {
+          auto &scales = multi_scales ? scales_c : scales_1;
+          auto &b = with_bias ? bia : none;
+          auto conv1x1 = conv(
+              concated, wei, b, {1, 1}, {0, 0}, ref, post_relu, scales);
+          conv1x1->submit();
+          for (auto *in : {&srcs, &views}) {
+            auto fused = concat_conv1x1(*in, wei, b, dst, post_relu, scales);
+            fused->submit();
+            util::compare_array<dst_t>((dst_t *)(dst->data()),
+                                       (dst_t *)(ref->data()),
+                                       ref->size());
+          }
+        }
+      }
+    }
+  }
+};
+
+using test_concat_conv1x1_f32 = test_concat_conv1x1<f32>;
+using test_concat_conv1x1_s32 = test_concat_conv1x1<s32>;
+using test_concat_conv1x1_s8 = test_concat_conv1x1<s8>;
+using test_concat_conv1x1_u8 = test_concat_conv1x1<u8>;
+
+TEST_P(test_concat_conv1x1_f32, TestsConcatConv1x1) {}
+TEST_P(test_concat_conv1x1_s32, TestsConcatConv1x1) {}
+TEST_P(test_concat_conv1x1_s8, TestsConcatConv1x1) {}
+TEST_P(test_concat_conv1x1_u8, TestsConcatConv1x1) {}
+
+// @note: the srcs and dst are always given as nchw
+/*channels of srcs, dst dims*/
+#define CONCAT_CONV1X1_TEST_CASES                                         \
+  test_concat_conv1x1_params{{16}, {2, 32, 4, 4}},                        \
+      test_concat_conv1x1_params{{64, 32}, {2, 128, 14, 14}},             \
+      test_concat_conv1x1_params{{64, 32, 32, 32, 32}, {2, 128, 28, 28}}, \
+      test_concat_conv1x1_params{                                         \
+          {512, 32, 32, 32, 32, 32, 32, 32, 32}, {1, 128, 7, 7}}
+
+INSTANTIATE_TEST_CASE_P(TestConcatConv1x1,
+                        test_concat_conv1x1_f32,
+                        ::testing::Values(CONCAT_CONV1X1_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestConcatConv1x1,
+                        test_concat_conv1x1_s32,
+                        ::testing::Values(CONCAT_CONV1X1_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestConcatConv1x1,
+                        test_concat_conv1x1_s8,
+                        ::testing::Values(CONCAT_CONV1X1_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestConcatConv1x1,
+                        test_concat_conv1x1_u8,
+                        ::testing::Values(CONCAT_CONV1X1_TEST_CASES));
+}
@@ -307,7 +307,9 @@ protected:
           util::conv_params{                                                 \
               2, 1, 256, 15, 45, 512, 15, 45, 3, 3, 1, 1, 1, 1, 256},        \
           util::conv_params{                                                 \
-              2, 1, 1024, 15, 45, 512, 15, 45, 3, 3, 1, 1, 1, 1, 80}))
+              2, 1, 1024, 15, 45, 512, 15, 45, 3, 3, 1, 1, 1, 1, 80},        \
+          util::conv_params{                                                 \
+              2, 1, 64, 28, 28, 256, 28, 28, 1, 1, 0, 0, 1, 1, 64}))
 
 // data type: src, weight, bias, dst
 test_conv_case(u8, s8, s8, u8);
@@ -0,0 +1,144 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "util_jitinfer.h"
+#include "util_params.h"
+#include "util_test.h"
+
+namespace jitinfer {
+
+// fused conv1x1_conv should equal to conv1x1 with u8 output then conv
+// here oc1x1 of the params is the output channel of conv1x1
+template <typename dst_t>
+class test_conv1x1_conv : public ::testing::TestWithParam<util::conv_params> {
+protected:
+  virtual void SetUp() {
+    util::conv_params p =
+        ::testing::TestWithParam<util::conv_params>::GetParam();
+    using format = memory::format;
+    constexpr format fmt = format::nhwc;
+    auto dst_dt = util::type2dtype<dst_t>::dtype;
+    std::array<int, 2> sz_stride = {p.sh, p.sw};
+    std::array<int, 2> sz_padding = {p.ph, p.pw};
+
+    std::unique_ptr<memory> src, wei1x1, bia1x1, mid, wei, bia, dst_ref, dst;
+    src.reset(new memory({p.bs, p.ic, p.ih, p.iw}, fmt, memory::dtype::u8));
+    wei1x1.reset(new memory(
+        {p.oc1x1, p.ic, 1, 1}, format::OIhw4i16o4i, memory::dtype::s8));
+    bia1x1.reset(new memory({p.oc1x1}, memory::dtype::s32));
+    mid.reset(
+        new memory({p.bs, p.oc1x1, p.ih, p.iw}, fmt, memory::dtype::u8));
+    wei.reset(new memory(
+        {p.oc, p.oc1x1, p.kh, p.kw}, format::OIhw4i16o4i, memory::dtype::s8));
+    bia.reset(new memory({p.oc}, memory::dtype::s32));
+    dst_ref.reset(new memory({p.bs, p.oc, p.oh, p.ow}, fmt, dst_dt));
+    dst.reset(new memory({p.bs, p.oc, p.oh, p.ow}, fmt, dst_dt));
+    util::fill_data<u8>(static_cast<u8 *>(src->data()), src->size());
+    util::fill_data<s8>(static_cast<s8 *>(wei1x1->data()), wei1x1->size());
+    util::fill_data<s32>(static_cast<s32 *>(bia1x1->data()), bia1x1->size());
+    util::fill_data<s8>(static_cast<s8 *>(wei->data()), wei->size());
+    util::fill_data<s32>(static_cast<s32 *>(bia->data()), bia->size());
+
+    std::vector<float> conv1x1_scales(p.oc1x1);
+    std::vector<float> conv0_scales(p.oc);
+    util::fill_data<float>(
+        conv1x1_scales.data(), conv1x1_scales.size(), 0.001f, 0.03f);
+    util::fill_data<float>(
+        conv0_scales.data(), conv0_scales.size(), 0.001f, 0.3f);
+
+    for (bool multi_scales : {true, false}) {
+      for (bool conv0_relu : {true, false}) {
+        for (round_mode conv0_round_mode : {nearest, down}) {
+          std::vector<float> s1x1 =
+              multi_scales ? conv1x1_scales
+                           : std::vector<float>{conv1x1_scales[0]};
+          std::vector<float> s0 = multi_scales
+                                      ? conv0_scales
+                                      : std::vector<float>{conv0_scales[0]};
+          auto c1x1 =
+              conv(src, wei1x1, bia1x1, {1, 1}, {0, 0}, mid, true, s1x1);
+          auto c0 = conv(mid,
+                         wei,
+                         bia,
+                         sz_stride,
+                         sz_padding,
+                         dst_ref,
+                         conv0_relu,
+                         s0,
+                         conv0_round_mode);
+          auto fused = conv1x1_conv(src,
+                                    wei1x1,
+                                    bia1x1,
+                                    wei,
+                                    bia,
+                                    sz_stride,
+                                    sz_padding,
+                                    dst,
+                                    s1x1,
+                                    conv0_relu,
+                                    s0,
+                                    conv0_round_mode);
+          c1x1->submit();
+          c0->submit();
+          fused->submit();
+          util::compare_array<dst_t>((dst_t *)(dst->data()),
+                                     (dst_t *)(dst_ref->data()),
+                                     dst->size());
+        }
+      }
+    }
+  }
+};
+
+using test_conv1x1_conv_f32 = test_conv1x1_conv<f32>;
+using test_conv1x1_conv_s32 = test_conv1x1_conv<s32>;
+using test_conv1x1_conv_s8 = test_conv1x1_conv<s8>;
+using test_conv1x1_conv_u8 = test_conv1x1_conv<u8>;
+
+TEST_P(test_conv1x1_conv_f32, TestsConv1x1Conv) {}
+TEST_P(test_conv1x1_conv_s32, TestsConv1x1Conv) {}
+TEST_P(test_conv1x1_conv_s8, TestsConv1x1Conv) {}
+TEST_P(test_conv1x1_conv_u8, TestsConv1x1Conv) {}
+
+// @note: the srcs, wei and dst are always given as nchw
+/*conv: bs, gp, ic, ih, iw, oc, oh, ow, kh, kw, ph, pw, sh, sw, oc1x1*/
+#define CONV1X1_CONV_TEST_CASES                                          \
+  util::conv_params{2, 1, 16, 4, 4, 16, 4, 4, 3, 3, 1, 1, 1, 1, 16},     \
+      util::conv_params{                                                 \
+          2, 1, 64, 13, 13, 32, 11, 11, 3, 3, 0, 0, 1, 1, 32},           \
+      util::conv_params{                                                 \
+          2, 1, 256, 56, 56, 64, 56, 56, 3, 3, 1, 1, 1, 1, 64},          \
+      util::conv_params{                                                 \
+          2, 1, 256, 56, 56, 128, 28, 28, 3, 3, 1, 1, 2, 2, 128},        \
+      util::conv_params {                                                \
+    1, 1, 1024, 14, 14, 256, 14, 14, 3, 3, 1, 1, 1, 1, 256               \
+  }
+
+INSTANTIATE_TEST_CASE_P(TestConv1x1Conv,
+                        test_conv1x1_conv_f32,
+                        ::testing::Values(CONV1X1_CONV_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestConv1x1Conv,
+                        test_conv1x1_conv_s32,
+                        ::testing::Values(CONV1X1_CONV_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestConv1x1Conv,
+                        test_conv1x1_conv_s8,
+                        ::testing::Values(CONV1X1_CONV_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestConv1x1Conv,
+                        test_conv1x1_conv_u8,
+                        ::testing::Values(CONV1X1_CONV_TEST_CASES));
+}
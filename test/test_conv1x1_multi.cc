@@ -0,0 +1,147 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "util_jitinfer.h"
+#include "util_test.h"
+
+namespace jitinfer {
+
+struct test_conv1x1_multi_params {
+  memory::nchw_dims src_dims;
+  std::vector<int> ocs;  // output channels of each branch
+};
+
+// fused conv1x1_multi should equal to conv1x1 of each branch
+template <typename dst_t>
+class test_conv1x1_multi
+    : public ::testing::TestWithParam<test_conv1x1_multi_params> {
+protected:
+  virtual void SetUp() {
+    test_conv1x1_multi_params p =
+        ::testing::TestWithParam<test_conv1x1_multi_params>::GetParam();
+    using format = memory::format;
+    constexpr format fmt = format::nhwc;
+    auto dst_dt = util::type2dtype<dst_t>::dtype;
+    const int bs = p.src_dims[0], ic = p.src_dims[1];
+    const int h = p.src_dims[2], w = p.src_dims[3];
+    const size_t num = p.ocs.size();
+
+    std::unique_ptr<memory> src, concat;
+    const std::unique_ptr<memory> none;
+    std::vector<std::unique_ptr<memory>> weis(num), bias(num), no_bias;
+    std::vector<std::unique_ptr<memory>> refs(num), dsts(num), views(num);
+    std::vector<std::vector<float>> scales_1(num), scales_c(num);
+    src.reset(new memory(p.src_dims, fmt, memory::dtype::u8));
+    util::fill_data<u8>(static_cast<u8 *>(src->data()), src->size());
+    int total_oc = 0;
+    for (size_t i = 0; i < num; ++i) {
+      total_oc += p.ocs[i];
+    }
+    concat.reset(new memory({bs, total_oc, h, w}, fmt, dst_dt));
+    int c_offset = 0;
+    for (size_t i = 0; i < num; ++i) {
+      int oc = p.ocs[i];
+      weis[i].reset(new memory(
+          {oc, ic, 1, 1}, format::OIhw4i16o4i, memory::dtype::s8));
+      util::fill_data<s8>(static_cast<s8 *>(weis[i]->data()), weis[i]->size());
+      // the last branch has no bias
+      if (i + 1 < num) {
+        bias[i].reset(new memory({oc}, memory::dtype::s32));
+        util::fill_data<s32>(static_cast<s32 *>(bias[i]->data()),
+                             bias[i]->size());
+      }
+      refs[i].reset(new memory({bs, oc, h, w}, fmt, dst_dt));
+      dsts[i].reset(new memory({bs, oc, h, w}, fmt, dst_dt));
+      views[i].reset(new memory(concat, c_offset, oc));
+      c_offset += oc;
+      scales_1[i].resize(1);
+      scales_c[i].resize(oc);
+      util::fill_data<float>(scales_1[i].data(), 1, 0.001f, 0.3f);
+      util::fill_data<float>(scales_c[i].data(), oc, 0.001f, 0.3f);
+    }
+
+    for (bool with_bias : {true, false}) {
+      for (bool post_relu : {true, false}) {
+        for (bool multi_scales : {true, false}) {
+          auto &scales = multi_scales ? scales_c : scales_1;
+          for (size_t i = 0; i < num; ++i) {
+            auto c = conv(src,
+                          weis[i],
+                          with_bias ? bias[i] : none,
+                          {1, 1},
+                          {0, 0},
+                          refs[i],
+                          post_relu,
+                          scales[i]);
+            c->submit();
+          }
+          auto &b = with_bias ? bias : no_bias;
+          auto fused = conv1x1_multi(src, weis, b, dsts, post_relu, scales);
+          auto fused_concat =
+              conv1x1_multi(src, weis, b, views, post_relu, scales);
+          fused->submit();
+          fused_concat->submit();
+          for (size_t i = 0; i < num; ++i) {
+            util::compare_array<dst_t>((dst_t *)(dsts[i]->data()),
+                                       (dst_t *)(refs[i]->data()),
+                                       refs[i]->size());
+            // the concat output of this branch is a view with ld
+            for (int pix = 0; pix < bs * h * w; ++pix) {
+              util::compare_array<dst_t>(
+                  (dst_t *)(views[i]->data()) + pix * views[i]->ld(),
+                  (dst_t *)(refs[i]->data()) + pix * p.ocs[i],
+                  p.ocs[i]);
+            }
+          }
+        }
+      }
+    }
+  }
+};
+
+using test_conv1x1_multi_f32 = test_conv1x1_multi<f32>;
+using test_conv1x1_multi_s32 = test_conv1x1_multi<s32>;
+using test_conv1x1_multi_s8 = test_conv1x1_multi<s8>;
+using test_conv1x1_multi_u8 = test_conv1x1_multi<u8>;
+
+TEST_P(test_conv1x1_multi_f32, TestsConv1x1Multi) {}
+TEST_P(test_conv1x1_multi_s32, TestsConv1x1Multi) {}
+TEST_P(test_conv1x1_multi_s8, TestsConv1x1Multi) {}
+TEST_P(test_conv1x1_multi_u8, TestsConv1x1Multi) {}
+
+// @note: the srcs and dst are always given as nchw
+/*src dims, output channels of branches*/
+#define CONV1X1_MULTI_TEST_CASES                                        \
+  test_conv1x1_multi_params{{2, 16, 4, 4}, {16, 32}},                   \
+      test_conv1x1_multi_params{{2, 192, 28, 28}, {64, 96, 16}},        \
+      test_conv1x1_multi_params{{2, 256, 28, 28}, {128, 128, 32}},      \
+      test_conv1x1_multi_params{{1, 832, 7, 7}, {384, 192, 48, 128}}
+
+INSTANTIATE_TEST_CASE_P(TestConv1x1Multi,
+                        test_conv1x1_multi_f32,
+                        ::testing::Values(CONV1X1_MULTI_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestConv1x1Multi,
+                        test_conv1x1_multi_s32,
+                        ::testing::Values(CONV1X1_MULTI_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestConv1x1Multi,
+                        test_conv1x1_multi_s8,
+                        ::testing::Values(CONV1X1_MULTI_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestConv1x1Multi,
+                        test_conv1x1_multi_u8,
+                        ::testing::Values(CONV1X1_MULTI_TEST_CASES));
+}
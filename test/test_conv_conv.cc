@@ -0,0 +1,146 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "util_jitinfer.h"
+#include "util_params.h"
+#include "util_test.h"
+
+namespace jitinfer {
+
+// fused conv_conv should equal to conv0 with u8 output then conv1
+// here conv0 is 3x3 of stride 1 and padding 1 from ic to oc1x1 of the params,
+// and the others of the params are conv1
+template <typename dst_t>
+class test_conv_conv : public ::testing::TestWithParam<util::conv_params> {
+protected:
+  virtual void SetUp() {
+    util::conv_params p =
+        ::testing::TestWithParam<util::conv_params>::GetParam();
+    using format = memory::format;
+    constexpr format fmt = format::nhwc;
+    auto dst_dt = util::type2dtype<dst_t>::dtype;
+    std::array<int, 2> sz_stride = {p.sh, p.sw};
+    std::array<int, 2> sz_padding = {p.ph, p.pw};
+    const int c0 = p.oc1x1;
+
+    std::unique_ptr<memory> src, wei0, bia0, mid, wei1, bia1, dst_ref, dst;
+    src.reset(new memory({p.bs, p.ic, p.ih, p.iw}, fmt, memory::dtype::u8));
+    wei0.reset(
+        new memory({c0, p.ic, 3, 3}, format::OIhw4i16o4i, memory::dtype::s8));
+    bia0.reset(new memory({c0}, memory::dtype::s32));
+    mid.reset(new memory({p.bs, c0, p.ih, p.iw}, fmt, memory::dtype::u8));
+    wei1.reset(new memory(
+        {p.oc, c0, p.kh, p.kw}, format::OIhw4i16o4i, memory::dtype::s8));
+    bia1.reset(new memory({p.oc}, memory::dtype::s32));
+    dst_ref.reset(new memory({p.bs, p.oc, p.oh, p.ow}, fmt, dst_dt));
+    dst.reset(new memory({p.bs, p.oc, p.oh, p.ow}, fmt, dst_dt));
+    util::fill_data<u8>(static_cast<u8 *>(src->data()), src->size());
+    util::fill_data<s8>(static_cast<s8 *>(wei0->data()), wei0->size());
+    util::fill_data<s32>(static_cast<s32 *>(bia0->data()), bia0->size());
+    util::fill_data<s8>(static_cast<s8 *>(wei1->data()), wei1->size());
+    util::fill_data<s32>(static_cast<s32 *>(bia1->data()), bia1->size());
+
+    std::vector<float> conv0_scales(c0);
+    std::vector<float> conv1_scales(p.oc);
+    util::fill_data<float>(
+        conv0_scales.data(), conv0_scales.size(), 0.001f, 0.03f);
+    util::fill_data<float>(
+        conv1_scales.data(), conv1_scales.size(), 0.001f, 0.3f);
+
+    for (bool multi_scales : {true, false}) {
+      for (bool conv1_relu : {true, false}) {
+        for (round_mode conv1_round_mode : {nearest, down}) {
+          std::vector<float> s0 = multi_scales
+                                      ? conv0_scales
+                                      : std::vector<float>{conv0_scales[0]};
+          std::vector<float> s1 = multi_scales
+                                      ? conv1_scales
+                                      : std::vector<float>{conv1_scales[0]};
+          auto c0 = conv(src, wei0, bia0, {1, 1}, {1, 1}, mid, true, s0);
+          auto c1 = conv(mid,
+                         wei1,
+                         bia1,
+                         sz_stride,
+                         sz_padding,
+                         dst_ref,
+                         conv1_relu,
+                         s1,
+                         conv1_round_mode);
+          auto fused = conv_conv(src,
+                                 wei0,
+                                 bia0,
+                                 {1, 1},
+                                 {1, 1},
+                                 wei1,
+                                 bia1,
+                                 sz_stride,
+                                 sz_padding,
+                                 dst,
+                                 s0,
+                                 conv1_relu,
+                                 s1,
+                                 conv1_round_mode);
+          c0->submit();
+          c1->submit();
+          fused->submit();
+          util::compare_array<dst_t>((dst_t *)(dst->data()),
+                                     (dst_t *)(dst_ref->data()),
+                                     dst->size());
+        }
+      }
+    }
+  }
+};
+
+using test_conv_conv_f32 = test_conv_conv<f32>;
+using test_conv_conv_s32 = test_conv_conv<s32>;
+using test_conv_conv_s8 = test_conv_conv<s8>;
+using test_conv_conv_u8 = test_conv_conv<u8>;
+
+TEST_P(test_conv_conv_f32, TestsConvConv) {}
+TEST_P(test_conv_conv_s32, TestsConvConv) {}
+TEST_P(test_conv_conv_s8, TestsConvConv) {}
+TEST_P(test_conv_conv_u8, TestsConvConv) {}
+
+// @note: the srcs, wei and dst are always given as nchw
+/*conv1: bs, gp, ic, ih, iw, oc, oh, ow, kh, kw, ph, pw, sh, sw, conv0 oc*/
+#define CONV_CONV_TEST_CASES                                             \
+  util::conv_params{2, 1, 16, 4, 4, 16, 4, 4, 3, 3, 1, 1, 1, 1, 16},     \
+      util::conv_params{                                                 \
+          2, 1, 32, 13, 13, 32, 11, 11, 3, 3, 0, 0, 1, 1, 64},           \
+      util::conv_params{                                                 \
+          2, 1, 64, 56, 56, 64, 56, 56, 3, 3, 1, 1, 1, 1, 64},           \
+      util::conv_params{                                                 \
+          2, 1, 128, 56, 56, 128, 28, 28, 3, 3, 1, 1, 2, 2, 128},        \
+      util::conv_params {                                                \
+    1, 1, 256, 28, 28, 256, 28, 28, 3, 3, 1, 1, 1, 1, 256                \
+  }
+
+INSTANTIATE_TEST_CASE_P(TestConvConv,
+                        test_conv_conv_f32,
+                        ::testing::Values(CONV_CONV_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestConvConv,
+                        test_conv_conv_s32,
+                        ::testing::Values(CONV_CONV_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestConvConv,
+                        test_conv_conv_s8,
+                        ::testing::Values(CONV_CONV_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestConvConv,
+                        test_conv_conv_u8,
+                        ::testing::Values(CONV_CONV_TEST_CASES));
+}
@@ -0,0 +1,233 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include <utility>
+#include "util_jitinfer.h"
+#include "util_params.h"
+#include "util_test.h"
+
+namespace jitinfer {
+
+typedef std::pair<util::conv_params, util::pool_params> conv_pool_params;
+
+// fused conv and max pooling should equal to conv then pool
+template <typename dst_t>
+class test_conv_pool : public ::testing::TestWithParam<conv_pool_params> {
+protected:
+  virtual void SetUp() {
+    conv_pool_params pm =
+        ::testing::TestWithParam<conv_pool_params>::GetParam();
+    const util::conv_params &p = pm.first;
+    const util::pool_params &pp = pm.second;
+    EXPECT_EQ(p.oc, pp.c);
+    EXPECT_EQ(p.oh, pp.ih);
+    EXPECT_EQ(p.ow, pp.iw);
+    using format = memory::format;
+    constexpr format fmt = format::nhwc;
+    auto dst_dt = util::type2dtype<dst_t>::dtype;
+    std::array<int, 2> sz_stride = {p.sh, p.sw};
+    std::array<int, 2> sz_padding = {p.ph, p.pw};
+    std::array<int, 2> sz_pool_kernel = {pp.kh, pp.kw};
+    std::array<int, 2> sz_pool_stride = {pp.sh, pp.sw};
+    std::array<int, 2> sz_pool_padding = {pp.ph, pp.pw};
+
+    std::unique_ptr<memory> src, wei, bia, dst_conv, dst_ref, dst;
+    src.reset(new memory({p.bs, p.ic, p.ih, p.iw}, fmt, memory::dtype::u8));
+    wei.reset(new memory(
+        {p.oc, p.ic, p.kh, p.kw}, format::OIhw4i16o4i, memory::dtype::s8));
+    bia.reset(new memory({p.oc}, memory::dtype::s32));
+    dst_conv.reset(new memory({p.bs, p.oc, p.oh, p.ow}, fmt, dst_dt));
+    dst_ref.reset(new memory({pp.bs, pp.c, pp.oh, pp.ow}, fmt, dst_dt));
+    dst.reset(new memory({pp.bs, pp.c, pp.oh, pp.ow}, fmt, dst_dt));
+    util::fill_data<u8>(static_cast<u8 *>(src->data()), src->size());
+    util::fill_data<s8>(static_cast<s8 *>(wei->data()), wei->size());
+    util::fill_data<s32>(static_cast<s32 *>(bia->data()), bia->size());
+    std::vector<float> scales = {0.05f};
+
+    for (bool relu : {true, false}) {
+      auto c0 =
+          conv(src, wei, bia, sz_stride, sz_padding, dst_conv, relu, scales);
+      auto pl = pool(dst_conv,
+                     dst_ref,
+                     sz_pool_kernel,
+                     sz_pool_stride,
+                     sz_pool_padding,
+                     pooling_max);
+      auto fused = conv(src,
+                        wei,
+                        bia,
+                        sz_stride,
+                        sz_padding,
+                        sz_pool_kernel,
+                        sz_pool_stride,
+                        sz_pool_padding,
+                        dst,
+                        relu,
+                        scales);
+      c0->submit();
+      pl->submit();
+      fused->submit();
+      util::compare_array<dst_t>(
+          (dst_t *)(dst->data()), (dst_t *)(dst_ref->data()), dst->size());
+    }
+  }
+};
+
+using test_conv_pool_f32 = test_conv_pool<f32>;
+using test_conv_pool_s32 = test_conv_pool<s32>;
+using test_conv_pool_s8 = test_conv_pool<s8>;
+using test_conv_pool_u8 = test_conv_pool<u8>;
+
+TEST_P(test_conv_pool_f32, TestsConvPool) {}
+TEST_P(test_conv_pool_s32, TestsConvPool) {}
+TEST_P(test_conv_pool_s8, TestsConvPool) {}
+TEST_P(test_conv_pool_u8, TestsConvPool) {}
+
+// @note: the srcs, wei and dst are always given as nchw
+/*conv: bs, gp, ic, ih, iw, oc, oh, ow, kh, kw, ph, pw, sh, sw, oc1x1*/
+/*pool: bs, c, ih, iw, oh, ow, kh, kw, ph, pw, sh, sw*/
+#define CONV_POOL_TEST_CASES                                              \
+  std::make_pair(                                                         \
+      util::conv_params{2, 1, 16, 4, 4, 16, 4, 4, 3, 3, 1, 1, 1, 1, 16},  \
+      util::pool_params{2, 16, 4, 4, 2, 2, 2, 2, 0, 0, 2, 2}),            \
+      std::make_pair(                                                     \
+          util::conv_params{                                              \
+              2, 1, 32, 13, 13, 64, 13, 13, 3, 3, 1, 1, 1, 1, 64},        \
+          util::pool_params{2, 64, 13, 13, 7, 7, 3, 3, 1, 1, 2, 2}),      \
+      std::make_pair(                                                     \
+          util::conv_params{                                              \
+              2, 1, 64, 56, 56, 128, 56, 56, 3, 3, 1, 1, 1, 1, 128},      \
+          util::pool_params{2, 128, 56, 56, 28, 28, 3, 3, 0, 0, 2, 2}),   \
+      std::make_pair(                                                     \
+          util::conv_params{                                              \
+              2, 1, 256, 15, 45, 96, 15, 45, 3, 3, 1, 1, 1, 1, 96},       \
+          util::pool_params{2, 96, 15, 45, 15, 45, 3, 3, 1, 1, 1, 1})
+
+INSTANTIATE_TEST_CASE_P(TestConvPool,
+                        test_conv_pool_f32,
+                        ::testing::Values(CONV_POOL_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestConvPool,
+                        test_conv_pool_s32,
+                        ::testing::Values(CONV_POOL_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestConvPool,
+                        test_conv_pool_s8,
+                        ::testing::Values(CONV_POOL_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestConvPool,
+                        test_conv_pool_u8,
+                        ::testing::Values(CONV_POOL_TEST_CASES));
+
+// fused conv and global average pooling should equal to conv then pool
+template <typename dst_t>
+class test_conv_global_pool
+    : public ::testing::TestWithParam<util::conv_params> {
+protected:
+  virtual void SetUp() {
+    util::conv_params p =
+        ::testing::TestWithParam<util::conv_params>::GetParam();
+    using format = memory::format;
+    constexpr format fmt = format::nhwc;
+    auto dst_dt = util::type2dtype<dst_t>::dtype;
+    std::array<int, 2> sz_stride = {p.sh, p.sw};
+    std::array<int, 2> sz_padding = {p.ph, p.pw};
+
+    std::unique_ptr<memory> src, wei, bia, dst_conv, dst_ref, dst;
+    src.reset(new memory({p.bs, p.ic, p.ih, p.iw}, fmt, memory::dtype::u8));
+    wei.reset(new memory(
+        {p.oc, p.ic, p.kh, p.kw}, format::OIhw4i16o4i, memory::dtype::s8));
+    bia.reset(new memory({p.oc}, memory::dtype::s32));
+    dst_conv.reset(new memory({p.bs, p.oc, p.oh, p.ow}, fmt, dst_dt));
+    dst_ref.reset(new memory({p.bs, p.oc, 1, 1}, fmt, dst_dt));
+    dst.reset(new memory({p.bs, p.oc, 1, 1}, fmt, dst_dt));
+    util::fill_data<u8>(static_cast<u8 *>(src->data()), src->size());
+    util::fill_data<s8>(static_cast<s8 *>(wei->data()), wei->size());
+    util::fill_data<s32>(static_cast<s32 *>(bia->data()), bia->size());
+    std::vector<float> scales = {0.05f};
+
+    for (bool relu : {true, false}) {
+      for (round_mode rmode : {nearest, down}) {
+        auto c0 = conv(src,
+                       wei,
+                       bia,
+                       sz_stride,
+                       sz_padding,
+                       dst_conv,
+                       relu,
+                       scales,
+                       rmode);
+        auto pl = pool(
+            dst_conv, dst_ref, {p.oh, p.ow}, {1, 1}, {0, 0}, pooling_avg);
+        auto fused = conv(src,
+                          wei,
+                          bia,
+                          sz_stride,
+                          sz_padding,
+                          dst,
+                          relu,
+                          scales,
+                          rmode,
+                          true);
+        c0->submit();
+        pl->submit();
+        fused->submit();
+        util::compare_array<dst_t>(
+            (dst_t *)(dst->data()), (dst_t *)(dst_ref->data()), dst->size());
+      }
+    }
+  }
+};
+
+using test_conv_global_pool_f32 = test_conv_global_pool<f32>;
+using test_conv_global_pool_s32 = test_conv_global_pool<s32>;
+using test_conv_global_pool_s8 = test_conv_global_pool<s8>;
+using test_conv_global_pool_u8 = test_conv_global_pool<u8>;
+
+TEST_P(test_conv_global_pool_f32, TestsConvGlobalPool) {}
+TEST_P(test_conv_global_pool_s32, TestsConvGlobalPool) {}
+TEST_P(test_conv_global_pool_s8, TestsConvGlobalPool) {}
+TEST_P(test_conv_global_pool_u8, TestsConvGlobalPool) {}
+
+#define CONV_GLOBAL_POOL_TEST_CASES                                      \
+  util::conv_params{2, 1, 16, 4, 4, 16, 4, 4, 3, 3, 1, 1, 1, 1, 16},     \
+      util::conv_params{                                                 \
+          2, 1, 32, 13, 13, 64, 13, 13, 3, 3, 1, 1, 1, 1, 64},           \
+      util::conv_params{                                                 \
+          2, 1, 16, 14, 14, 32, 14, 14, 3, 3, 1, 1, 1, 1, 32},           \
+      util::conv_params{                                                 \
+          2, 1, 32, 14, 14, 48, 14, 14, 1, 1, 0, 0, 1, 1, 48},           \
+      util::conv_params{                                                 \
+          2, 1, 256, 7, 7, 512, 7, 7, 3, 3, 1, 1, 1, 1, 512},            \
+      util::conv_params {                                                \
+    2, 1, 512, 7, 7, 1024, 7, 7, 1, 1, 0, 0, 1, 1, 1024                  \
+  }
+
+INSTANTIATE_TEST_CASE_P(TestConvGlobalPool,
+                        test_conv_global_pool_f32,
+                        ::testing::Values(CONV_GLOBAL_POOL_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestConvGlobalPool,
+                        test_conv_global_pool_s32,
+                        ::testing::Values(CONV_GLOBAL_POOL_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestConvGlobalPool,
+                        test_conv_global_pool_s8,
+                        ::testing::Values(CONV_GLOBAL_POOL_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestConvGlobalPool,
+                        test_conv_global_pool_u8,
+                        ::testing::Values(CONV_GLOBAL_POOL_TEST_CASES));
+}
@@ -0,0 +1,123 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "util_jitinfer.h"
+#include "util_params.h"
+#include "util_test.h"
+
+namespace jitinfer {
+
+struct test_conv_shuffle_params {
+  util::conv_params conv;
+  int shuffle_groups;
+};
+
+// conv with fused channel shuffle should equal to conv then shuffle
+template <typename dst_t>
+class test_conv_shuffle
+    : public ::testing::TestWithParam<test_conv_shuffle_params> {
+protected:
+  virtual void SetUp() {
+    test_conv_shuffle_params tp =
+        ::testing::TestWithParam<test_conv_shuffle_params>::GetParam();
+    const util::conv_params &p = tp.conv;
+    const int gp = tp.shuffle_groups;
+    using format = memory::format;
+    constexpr format fmt = format::nhwc;
+    auto dst_dt = util::type2dtype<dst_t>::dtype;
+    std::array<int, 2> sz_stride = {p.sh, p.sw};
+    std::array<int, 2> sz_padding = {p.ph, p.pw};
+
+    std::unique_ptr<memory> src, wei, bia, dst_ref, dst;
+    src.reset(new memory({p.bs, p.ic, p.ih, p.iw}, fmt, memory::dtype::u8));
+    wei.reset(new memory(
+        {p.oc, p.ic, p.kh, p.kw}, format::OIhw4i16o4i, memory::dtype::s8));
+    bia.reset(new memory({p.oc}, memory::dtype::s32));
+    dst_ref.reset(new memory({p.bs, p.oc, p.oh, p.ow}, fmt, dst_dt));
+    dst.reset(new memory({p.bs, p.oc, p.oh, p.ow}, fmt, dst_dt));
+    util::fill_data<u8>(static_cast<u8 *>(src->data()), src->size());
+    util::fill_data<s8>(static_cast<s8 *>(wei->data()), wei->size());
+    util::fill_data<s32>(static_cast<s32 *>(bia->data()), bia->size());
+    std::vector<float> scales(p.oc);
+    util::fill_data<float>(scales.data(), scales.size(), 0.001f, 0.3f);
+
+    const int oc_per_gp = p.oc / gp;
+    std::vector<dst_t> ref(dst->size());
+    for (bool conv0_relu : {true, false}) {
+      auto c = conv(
+          src, wei, bia, sz_stride, sz_padding, dst_ref, conv0_relu, scales);
+      auto fused = conv(src,
+                        wei,
+                        bia,
+                        sz_stride,
+                        sz_padding,
+                        gp,
+                        dst,
+                        conv0_relu,
+                        scales);
+      c->submit();
+      fused->submit();
+      // channel i of group g goes to i * gp + g
+      auto ref_data = (const dst_t *)(dst_ref->data());
+      for (int pix = 0; pix < p.bs * p.oh * p.ow; ++pix) {
+        for (int oc = 0; oc < p.oc; ++oc) {
+          int g = oc / oc_per_gp, i = oc % oc_per_gp;
+          ref[pix * p.oc + i * gp + g] = ref_data[pix * p.oc + oc];
+        }
+      }
+      util::compare_array<dst_t>(
+          (dst_t *)(dst->data()), ref.data(), dst->size());
+    }
+  }
+};
+
+using test_conv_shuffle_f32 = test_conv_shuffle<f32>;
+using test_conv_shuffle_s32 = test_conv_shuffle<s32>;
+using test_conv_shuffle_s8 = test_conv_shuffle<s8>;
+using test_conv_shuffle_u8 = test_conv_shuffle<u8>;
+
+TEST_P(test_conv_shuffle_f32, TestsConvShuffle) {}
+TEST_P(test_conv_shuffle_s32, TestsConvShuffle) {}
+TEST_P(test_conv_shuffle_s8, TestsConvShuffle) {}
+TEST_P(test_conv_shuffle_u8, TestsConvShuffle) {}
+
+// @note: the srcs, wei and dst are always given as nchw
+/*{conv: bs, gp, ic, ih, iw, oc, oh, ow, kh, kw, ph, pw, sh, sw, -}, groups*/
+#define CONV_SHUFFLE_TEST_CASES                                      \
+  test_conv_shuffle_params{                                          \
+      {2, 1, 16, 4, 4, 32, 4, 4, 3, 3, 1, 1, 1, 1, 0}, 2},           \
+      test_conv_shuffle_params{                                      \
+          {2, 1, 64, 28, 28, 96, 28, 28, 3, 3, 1, 1, 1, 1, 0}, 3},   \
+      test_conv_shuffle_params{                                      \
+          {2, 1, 128, 28, 28, 128, 14, 14, 3, 3, 1, 1, 2, 2, 0}, 4}, \
+      test_conv_shuffle_params{                                      \
+          {1, 1, 240, 14, 14, 256, 14, 14, 1, 1, 0, 0, 1, 1, 0}, 8}
+
+INSTANTIATE_TEST_CASE_P(TestConvShuffle,
+                        test_conv_shuffle_f32,
+                        ::testing::Values(CONV_SHUFFLE_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestConvShuffle,
+                        test_conv_shuffle_s32,
+                        ::testing::Values(CONV_SHUFFLE_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestConvShuffle,
+                        test_conv_shuffle_s8,
+                        ::testing::Values(CONV_SHUFFLE_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestConvShuffle,
+                        test_conv_shuffle_u8,
+                        ::testing::Values(CONV_SHUFFLE_TEST_CASES));
+}
@@ -0,0 +1,184 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include <cmath>
+#include "util_jitinfer.h"
+#include "util_params.h"
+#include "util_test.h"
+
+namespace jitinfer {
+
+// fused dwconv_conv1x1 should equal to depthwise conv with u8 output,
+// then conv1x1. Here ic and oc of the params are both the channels of
+// depthwise conv, oc1x1 is the output channel of conv1x1.
+template <typename dst_t>
+class test_dwconv_conv1x1 : public ::testing::TestWithParam<util::conv_params> {
+  // the u8 output of depthwise conv with relu
+  void depthwise(const util::conv_params &p,
+                 const std::unique_ptr<memory> &src,
+                 const std::unique_ptr<memory> &wei,
+                 const std::unique_ptr<memory> &bia,
+                 const std::vector<float> &scales,
+                 std::unique_ptr<memory> &dst) {
+    const u8 *src_data = (const u8 *)(src->data());
+    const s8 *wei_data = (const s8 *)(wei->data());
+    const s32 *bia_data = (const s32 *)(bia->data());
+    u8 *dst_data = (u8 *)(dst->data());
+#pragma omp parallel for collapse(3) schedule(static)
+    for (int n = 0; n < p.bs; ++n) {
+      for (int oh = 0; oh < p.oh; ++oh) {
+        for (int ow = 0; ow < p.ow; ++ow) {
+          for (int c = 0; c < p.ic; ++c) {
+            s32 acc = 0;
+            for (int kh = 0; kh < p.kh; ++kh) {
+              int ih = oh * p.sh - p.ph + kh;
+              if (ih < 0 || ih >= p.ih) {
+                continue;
+              }
+              for (int kw = 0; kw < p.kw; ++kw) {
+                int iw = ow * p.sw - p.pw + kw;
+                if (iw < 0 || iw >= p.iw) {
+                  continue;
+                }
+                // src is nhwc, wei is oihw
+                acc += s32(src_data[((n * p.ih + ih) * p.iw + iw) * p.ic + c]) *
+                       s32(wei_data[(c * p.kh + kh) * p.kw + kw]);
+              }
+            }
+            float scale = scales.size() == 1 ? scales[0] : scales[c];
+            float v = ((float)acc + (float)bia_data[c]) * scale;
+            v = std::nearbyint(std::max(v, 0.f));
+            v = std::min(v, 255.f);
+            dst_data[((n * p.oh + oh) * p.ow + ow) * p.ic + c] = (u8)v;
+          }
+        }
+      }
+    }
+  }
+
+protected:
+  virtual void SetUp() {
+    util::conv_params p =
+        ::testing::TestWithParam<util::conv_params>::GetParam();
+    using format = memory::format;
+    constexpr format fmt = format::nhwc;
+    auto dst_dt = util::type2dtype<dst_t>::dtype;
+    std::array<int, 2> sz_stride = {p.sh, p.sw};
+    std::array<int, 2> sz_padding = {p.ph, p.pw};
+
+    std::unique_ptr<memory> src, wei, bia, mid, wei1x1, bia1x1, dst_ref, dst;
+    src.reset(new memory({p.bs, p.ic, p.ih, p.iw}, fmt, memory::dtype::u8));
+    wei.reset(
+        new memory({p.ic, 1, p.kh, p.kw}, format::oihw, memory::dtype::s8));
+    bia.reset(new memory({p.ic}, memory::dtype::s32));
+    mid.reset(new memory({p.bs, p.ic, p.oh, p.ow}, fmt, memory::dtype::u8));
+    wei1x1.reset(new memory(
+        {p.oc1x1, p.ic, 1, 1}, format::OIhw4i16o4i, memory::dtype::s8));
+    bia1x1.reset(new memory({p.oc1x1}, memory::dtype::s32));
+    dst_ref.reset(new memory({p.bs, p.oc1x1, p.oh, p.ow}, fmt, dst_dt));
+    dst.reset(new memory({p.bs, p.oc1x1, p.oh, p.ow}, fmt, dst_dt));
+    util::fill_data<u8>(static_cast<u8 *>(src->data()), src->size());
+    util::fill_data<s8>(static_cast<s8 *>(wei->data()), wei->size());
+    util::fill_data<s32>(static_cast<s32 *>(bia->data()), bia->size());
+    util::fill_data<s8>(static_cast<s8 *>(wei1x1->data()), wei1x1->size());
+    util::fill_data<s32>(static_cast<s32 *>(bia1x1->data()), bia1x1->size());
+
+    std::vector<float> dw_scales(p.ic);
+    std::vector<float> conv1x1_scales(p.oc1x1);
+    util::fill_data<float>(dw_scales.data(), dw_scales.size(), 0.05f, 0.5f);
+    util::fill_data<float>(
+        conv1x1_scales.data(), conv1x1_scales.size(), 0.001f, 0.3f);
+
+    for (bool multi_scales : {true, false}) {
+      for (bool conv1x1_relu : {true, false}) {
+        for (round_mode conv1x1_round_mode : {nearest, down}) {
+          std::vector<float> s_dw =
+              multi_scales ? dw_scales : std::vector<float>{dw_scales[0]};
+          std::vector<float> s1x1 =
+              multi_scales ? conv1x1_scales
+                           : std::vector<float>{conv1x1_scales[0]};
+          depthwise(p, src, wei, bia, s_dw, mid);
+          auto c1x1 = conv(mid,
+                           wei1x1,
+                           bia1x1,
+                           {1, 1},
+                           {0, 0},
+                           dst_ref,
+                           conv1x1_relu,
+                           s1x1,
+                           conv1x1_round_mode);
+          auto fused = dwconv_conv1x1(src,
+                                      wei,
+                                      bia,
+                                      sz_stride,
+                                      sz_padding,
+                                      wei1x1,
+                                      bia1x1,
+                                      dst,
+                                      s_dw,
+                                      conv1x1_relu,
+                                      s1x1,
+                                      conv1x1_round_mode);
+          c1x1->submit();
+          fused->submit();
+          util::compare_array<dst_t>((dst_t *)(dst->data()),
+                                     (dst_t *)(dst_ref->data()),
+                                     dst->size());
+        }
+      }
+    }
+  }
+};
+
+using test_dwconv_conv1x1_f32 = test_dwconv_conv1x1<f32>;
+using test_dwconv_conv1x1_s32 = test_dwconv_conv1x1<s32>;
+using test_dwconv_conv1x1_s8 = test_dwconv_conv1x1<s8>;
+using test_dwconv_conv1x1_u8 = test_dwconv_conv1x1<u8>;
+
+TEST_P(test_dwconv_conv1x1_f32, TestsDWConvConv1x1) {}
+TEST_P(test_dwconv_conv1x1_s32, TestsDWConvConv1x1) {}
+TEST_P(test_dwconv_conv1x1_s8, TestsDWConvConv1x1) {}
+TEST_P(test_dwconv_conv1x1_u8, TestsDWConvConv1x1) {}
+
+// @note: the srcs, wei and dst are always given as nchw
+/*conv: bs, gp, ic, ih, iw, oc, oh, ow, kh, kw, ph, pw, sh, sw, oc1x1*/
+#define DWCONV_CONV1X1_TEST_CASES                                        \
+  util::conv_params{2, 1, 16, 4, 4, 16, 4, 4, 3, 3, 1, 1, 1, 1, 16},     \
+      util::conv_params{                                                 \
+          2, 1, 32, 112, 112, 32, 112, 112, 3, 3, 1, 1, 1, 1, 64},       \
+      util::conv_params{                                                 \
+          2, 1, 64, 112, 112, 64, 56, 56, 3, 3, 1, 1, 2, 2, 128},        \
+      util::conv_params{                                                 \
+          2, 1, 48, 13, 13, 48, 11, 11, 3, 3, 0, 0, 1, 1, 32},           \
+      util::conv_params {                                                \
+    1, 1, 512, 14, 14, 512, 14, 14, 3, 3, 1, 1, 1, 1, 512                \
+  }
+
+INSTANTIATE_TEST_CASE_P(TestDWConvConv1x1,
+                        test_dwconv_conv1x1_f32,
+                        ::testing::Values(DWCONV_CONV1X1_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestDWConvConv1x1,
+                        test_dwconv_conv1x1_s32,
+                        ::testing::Values(DWCONV_CONV1X1_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestDWConvConv1x1,
+                        test_dwconv_conv1x1_s8,
+                        ::testing::Values(DWCONV_CONV1X1_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestDWConvConv1x1,
+                        test_dwconv_conv1x1_u8,
+                        ::testing::Values(DWCONV_CONV1X1_TEST_CASES));
+}
@@ -0,0 +1,111 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include <cmath>
+#include <limits>
+#include "util_jitinfer.h"
+#include "util_test.h"
+
+namespace jitinfer {
+
+template <typename dtype>
+class test_eltwise : public ::testing::TestWithParam<memory::nchw_dims> {
+  void check_result(const std::unique_ptr<memory>& src,
+                    const std::unique_ptr<memory>& dst,
+                    eltwise_kind kind,
+                    float alpha,
+                    float beta) {
+    const dtype* src_data = (const dtype*)(src->data());
+    std::vector<dtype> ref(dst->size());
+    // the bounds of integers are ceil(alpha) and floor(beta)
+    float lo = kind == eltwise_relu ? 0.f : alpha;
+    float hi = kind == eltwise_relu ? std::numeric_limits<float>::max() : beta;
+    if (!std::is_same<dtype, f32>::value) {
+      lo = std::max(std::ceil(lo), float(std::numeric_limits<dtype>::min()));
+      hi = std::min(std::floor(hi), float(std::numeric_limits<dtype>::max()));
+    }
+#pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < ref.size(); ++i) {
+      float v = static_cast<float>(src_data[i]);
+      ref[i] = static_cast<dtype>(std::min(std::max(v, lo), hi));
+    }
+    util::compare_array<dtype>((dtype*)(dst->data()), ref.data(), dst->size());
+  }
+
+protected:
+  virtual void SetUp() {
+    memory::nchw_dims dims =
+        ::testing::TestWithParam<memory::nchw_dims>::GetParam();
+    auto dt = util::type2dtype<dtype>::dtype;
+    memory::format fmt = memory::format::nhwc;
+    std::unique_ptr<memory> src, dst;
+    src.reset(new memory(dims, fmt, dt));
+    dst.reset(new memory(dims, fmt, dt));
+    // cover both negative and positive values, and u8 over 127
+    dtype a = std::is_signed<dtype>::value ? dtype(-100) : dtype(0);
+    dtype b = std::is_same<dtype, u8>::value ? dtype(250) : dtype(120);
+    util::fill_data<dtype>(
+        static_cast<dtype*>(src->data()), src->size(), a, b);
+
+    auto relu = eltwise(src, dst, eltwise_relu);
+    relu->submit();
+    check_result(src, dst, eltwise_relu, 0.f, 0.f);
+
+    for (auto bound : {std::make_pair(-6.f, 6.f),
+                       std::make_pair(0.f, 6.f),
+                       std::make_pair(-20.5f, 100.3f),
+                       // bytes of the top bit set, u8 255 and s8 -100, -128
+                       std::make_pair(-100.f, 255.f),
+                       std::make_pair(-128.f, 200.f)}) {
+      auto clip = eltwise(src, dst, eltwise_clip, bound.first, bound.second);
+      clip->submit();
+      check_result(src, dst, eltwise_clip, bound.first, bound.second);
+    }
+  }
+};
+
+using test_eltwise_f32 = test_eltwise<f32>;
+using test_eltwise_s32 = test_eltwise<s32>;
+using test_eltwise_s8 = test_eltwise<s8>;
+using test_eltwise_u8 = test_eltwise<u8>;
+
+TEST_P(test_eltwise_f32, TestsEltwise) {}
+TEST_P(test_eltwise_s32, TestsEltwise) {}
+TEST_P(test_eltwise_s8, TestsEltwise) {}
+TEST_P(test_eltwise_u8, TestsEltwise) {}
+
+// @note: the dims are always given as nchw
+#define ELTWISE_TEST_CASES                                             \
+  memory::nchw_dims{{2, 16, 4, 4}}, memory::nchw_dims{{2, 48, 13, 13}}, \
+      memory::nchw_dims{{2, 64, 56, 56}}, memory::nchw_dims {         \
+    { 4, 2048, 7, 7 }                                                  \
+  }
+
+INSTANTIATE_TEST_CASE_P(TestEltwise,
+                        test_eltwise_f32,
+                        ::testing::Values(ELTWISE_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestEltwise,
+                        test_eltwise_s32,
+                        ::testing::Values(ELTWISE_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestEltwise,
+                        test_eltwise_s8,
+                        ::testing::Values(ELTWISE_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestEltwise,
+                        test_eltwise_u8,
+                        ::testing::Values(ELTWISE_TEST_CASES));
+}
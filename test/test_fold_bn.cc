@@ -0,0 +1,128 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include <cmath>
+#include "util_jitinfer.h"
+#include "util_params.h"
+#include "util_test.h"
+
+namespace jitinfer {
+
+// conv with folded scales and bias should equal to conv then batch norm
+template <typename bia_t>
+class test_fold_bn : public ::testing::TestWithParam<util::conv_params> {
+protected:
+  virtual void SetUp() {
+    util::conv_params p =
+        ::testing::TestWithParam<util::conv_params>::GetParam();
+    using format = memory::format;
+    constexpr format fmt = format::nhwc;
+    std::array<int, 2> sz_stride = {p.sh, p.sw};
+    std::array<int, 2> sz_padding = {p.ph, p.pw};
+
+    std::unique_ptr<memory> src, wei, bia, dst_ref, dst, folded_bia;
+    src.reset(new memory({p.bs, p.ic, p.ih, p.iw}, fmt, memory::dtype::u8));
+    wei.reset(new memory(
+        {p.oc, p.ic, p.kh, p.kw}, format::OIhw4i16o4i, memory::dtype::s8));
+    bia.reset(new memory({p.oc}, util::type2dtype<bia_t>::dtype));
+    dst_ref.reset(new memory({p.bs, p.oc, p.oh, p.ow}, fmt, memory::f32));
+    dst.reset(new memory({p.bs, p.oc, p.oh, p.ow}, fmt, memory::f32));
+    util::fill_data<u8>(static_cast<u8 *>(src->data()), src->size());
+    util::fill_data<s8>(static_cast<s8 *>(wei->data()), wei->size());
+    util::fill_data<bia_t>(static_cast<bia_t *>(bia->data()), bia->size());
+
+    std::vector<float> gamma(p.oc), beta(p.oc), mean(p.oc), var(p.oc);
+    util::fill_data<float>(gamma.data(), p.oc, 0.5f, 2.f);
+    util::fill_data<float>(beta.data(), p.oc, -3.f, 3.f);
+    util::fill_data<float>(mean.data(), p.oc, -10.f, 10.f);
+    util::fill_data<float>(var.data(), p.oc, 0.1f, 4.f);
+    const float eps = 1e-5f;
+    std::vector<float> scales = {0.01f};
+
+    for (bool with_mean_var : {true, false}) {
+      if (!with_mean_var) {
+        // a plain scale layer
+        mean.clear();
+        var.clear();
+      }
+      std::vector<float> folded_scales;
+      fold_batch_norm(
+          gamma, beta, mean, var, eps, bia, scales, folded_bia, folded_scales);
+      auto c0 =
+          conv(src, wei, bia, sz_stride, sz_padding, dst_ref, false, scales);
+      auto c1 = conv(src,
+                     wei,
+                     folded_bia,
+                     sz_stride,
+                     sz_padding,
+                     dst,
+                     false,
+                     folded_scales);
+      c0->submit();
+      c1->submit();
+
+      const float *ref_data = (const float *)(dst_ref->data());
+      const float *out_data = (const float *)(dst->data());
+      for (size_t i = 0; i < dst->size(); ++i) {
+        int c = i % p.oc;
+        float a =
+            with_mean_var ? gamma[c] / std::sqrt(var[c] + eps) : gamma[c];
+        float b = with_mean_var ? beta[c] - a * mean[c] : beta[c];
+        float ref = a * ref_data[i] + b;
+        // the error is relative to the terms before cancellation
+        float tolerance =
+            1e-4f * (std::fabs(a * ref_data[i]) + std::fabs(b) + 1.f);
+        EXPECT_NEAR(out_data[i], ref, tolerance) << "Index: " << i;
+      }
+    }
+  }
+};
+
+using test_fold_bn_f32 = test_fold_bn<f32>;
+using test_fold_bn_s32 = test_fold_bn<s32>;
+using test_fold_bn_s8 = test_fold_bn<s8>;
+using test_fold_bn_u8 = test_fold_bn<u8>;
+
+TEST_P(test_fold_bn_f32, TestsFoldBN) {}
+TEST_P(test_fold_bn_s32, TestsFoldBN) {}
+TEST_P(test_fold_bn_s8, TestsFoldBN) {}
+TEST_P(test_fold_bn_u8, TestsFoldBN) {}
+
+// @note: the srcs, wei and dst are always given as nchw
+/*conv: bs, gp, ic, ih, iw, oc, oh, ow, kh, kw, ph, pw, sh, sw, oc1x1*/
+#define FOLD_BN_TEST_CASES                                             \
+  util::conv_params{2, 1, 16, 4, 4, 16, 4, 4, 3, 3, 1, 1, 1, 1, 16},   \
+      util::conv_params{                                               \
+          2, 1, 32, 13, 13, 64, 13, 13, 3, 3, 1, 1, 1, 1, 64},         \
+      util::conv_params {                                              \
+    2, 1, 64, 28, 28, 128, 28, 28, 1, 1, 0, 0, 1, 1, 128               \
+  }
+
+INSTANTIATE_TEST_CASE_P(TestFoldBN,
+                        test_fold_bn_f32,
+                        ::testing::Values(FOLD_BN_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestFoldBN,
+                        test_fold_bn_s32,
+                        ::testing::Values(FOLD_BN_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestFoldBN,
+                        test_fold_bn_s8,
+                        ::testing::Values(FOLD_BN_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestFoldBN,
+                        test_fold_bn_u8,
+                        ::testing::Values(FOLD_BN_TEST_CASES));
+}
@@ -0,0 +1,147 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include <cmath>
+#include <limits>
+#include "util_jitinfer.h"
+#include "util_params.h"
+#include "util_test.h"
+
+namespace jitinfer {
+
+template <typename dst_t>
+class test_inner_product
+    : public ::testing::TestWithParam<util::inner_product_params> {
+  // weight format is OIhw4i16o4i
+  size_t wei_index(const util::inner_product_params& p,
+                   int o,
+                   int i,
+                   int h,
+                   int w) {
+    size_t blk = (size_t)(o / 16) * (p.ic / 16) + i / 16;
+    blk = (blk * p.ih + h) * p.iw + w;
+    return blk * 256 + ((i % 16) / 4) * 64 + (o % 16) * 4 + i % 4;
+  }
+
+  template <typename bia_t>
+  void check_result(const util::inner_product_params& p,
+                    const std::unique_ptr<memory>& src,
+                    const std::unique_ptr<memory>& wei,
+                    const std::unique_ptr<memory>& bia,
+                    const std::unique_ptr<memory>& dst,
+                    bool post_relu,
+                    const std::vector<float>& scales) {
+    const u8* src_data = (const u8*)(src->data());
+    const s8* wei_data = (const s8*)(wei->data());
+    const bia_t* bia_data = (const bia_t*)(bia->data());
+    std::vector<dst_t> ref(dst->size());
+#pragma omp parallel for collapse(2) schedule(static)
+    for (int n = 0; n < p.bs; ++n) {
+      for (int o = 0; o < p.oc; ++o) {
+        s32 acc = 0;
+        for (int h = 0; h < p.ih; ++h) {
+          for (int w = 0; w < p.iw; ++w) {
+            // src is nhwc
+            const u8* s = src_data + ((n * p.ih + h) * p.iw + w) * p.ic;
+            for (int i = 0; i < p.ic; ++i) {
+              acc += s32(s[i]) * s32(wei_data[wei_index(p, o, i, h, w)]);
+            }
+          }
+        }
+        float scale = scales.size() == 1 ? scales[0] : scales[o];
+        float v = ((float)acc + (float)bia_data[o]) * scale;
+        if (post_relu || std::is_same<dst_t, u8>::value) {
+          v = std::max(v, 0.f);
+        }
+        if (!std::is_same<dst_t, f32>::value) {
+          v = std::nearbyint(v);
+          v = std::max(v, (float)std::numeric_limits<dst_t>::min());
+          v = std::min(v, (float)std::numeric_limits<dst_t>::max());
+        }
+        ref[n * p.oc + o] = static_cast<dst_t>(v);
+      }
+    }
+    util::compare_array<dst_t>((dst_t*)(dst->data()), ref.data(), dst->size());
+  }
+
+protected:
+  virtual void SetUp() {
+    util::inner_product_params p =
+        ::testing::TestWithParam<util::inner_product_params>::GetParam();
+    using format = memory::format;
+    std::unique_ptr<memory> src, wei, bia, dst;
+    src.reset(new memory(
+        {p.bs, p.ic, p.ih, p.iw}, format::nhwc, memory::dtype::u8));
+    wei.reset(new memory(
+        {p.oc, p.ic, p.ih, p.iw}, format::OIhw4i16o4i, memory::dtype::s8));
+    bia.reset(new memory({p.oc}, memory::dtype::s32));
+    dst.reset(new memory({p.bs, p.oc, 1, 1},
+                         format::nhwc,
+                         util::type2dtype<dst_t>::dtype));
+    util::fill_data<u8>(static_cast<u8*>(src->data()), src->size());
+    util::fill_data<s8>(static_cast<s8*>(wei->data()), wei->size());
+    util::fill_data<s32>(static_cast<s32*>(bia->data()), bia->size());
+
+    std::vector<float> scales_1 = {0.3f};
+    std::vector<float> scales_c(p.oc);
+    util::fill_data<float>(scales_c.data(), scales_c.size(), 0.1f, 1.f);
+    for (bool multi_scales : {false, true}) {
+      for (bool post_relu : {false, true}) {
+        auto& scales = multi_scales ? scales_c : scales_1;
+        auto ip = inner_product(src, wei, bia, dst, post_relu, scales);
+        ip->submit();
+        check_result<s32>(p, src, wei, bia, dst, post_relu, scales);
+      }
+    }
+  }
+};
+
+using test_inner_product_f32 = test_inner_product<f32>;
+using test_inner_product_s32 = test_inner_product<s32>;
+using test_inner_product_s8 = test_inner_product<s8>;
+using test_inner_product_u8 = test_inner_product<u8>;
+
+TEST_P(test_inner_product_f32, TestsInnerProduct) {}
+TEST_P(test_inner_product_s32, TestsInnerProduct) {}
+TEST_P(test_inner_product_s8, TestsInnerProduct) {}
+TEST_P(test_inner_product_u8, TestsInnerProduct) {}
+
+// @note: the src is always given as nchw
+/*inner product: bs, ic, ih, iw, oc*/
+#define INNER_PRODUCT_TEST_CASES                                          \
+  util::inner_product_params{1, 16, 1, 1, 16},                            \
+      util::inner_product_params{1, 2048, 1, 1, 1008},                    \
+      util::inner_product_params{7, 256, 1, 1, 64},                       \
+      util::inner_product_params{2, 64, 7, 7, 256},                       \
+      util::inner_product_params {                                        \
+    32, 512, 1, 1, 1024                                                   \
+  }
+
+INSTANTIATE_TEST_CASE_P(TestInnerProduct,
+                        test_inner_product_f32,
+                        ::testing::Values(INNER_PRODUCT_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestInnerProduct,
+                        test_inner_product_s32,
+                        ::testing::Values(INNER_PRODUCT_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestInnerProduct,
+                        test_inner_product_s8,
+                        ::testing::Values(INNER_PRODUCT_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestInnerProduct,
+                        test_inner_product_u8,
+                        ::testing::Values(INNER_PRODUCT_TEST_CASES));
+}
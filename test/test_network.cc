@@ -0,0 +1,373 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include <sched.h>
+#include <chrono>
+#include <thread>
+#include "src/op_inner_product.h"
+#include "util_jitinfer.h"
+#include "util_test.h"
+
+namespace jitinfer {
+
+struct test_network_params {
+  memory::nchw_dims src_dims;
+  int oc;
+};
+
+// network should equal to the same ops created and submitted one by one
+template <typename dst_t>
+class test_network : public ::testing::TestWithParam<test_network_params> {
+protected:
+  virtual void SetUp() {
+    test_network_params p =
+        ::testing::TestWithParam<test_network_params>::GetParam();
+    using format = memory::format;
+    constexpr format fmt = format::nhwc;
+    constexpr memory::dtype u8_dt = memory::dtype::u8;
+    constexpr memory::dtype s8_dt = memory::dtype::s8;
+    auto dst_dt = util::type2dtype<dst_t>::dtype;
+    const int bs = p.src_dims[0], ic = p.src_dims[1];
+    const int h = p.src_dims[2], w = p.src_dims[3];
+    const int ph = util::pool_output_size(h, 2, 2, 0);
+    const int pw = util::pool_output_size(w, 2, 2, 0);
+
+    // conv3x3 -> pool -> {conv1x1, conv3x3} -> concat -> conv1x1
+    //  -> sum with the conv1x1 branch -> conv1x1 to dst
+    std::unique_ptr<memory> wei0, wei1, wei2, wei3, wei4, bia0, bia4;
+    const std::unique_ptr<memory> none;
+    wei0.reset(new memory({32, ic, 3, 3}, format::OIhw4i16o4i, s8_dt));
+    wei1.reset(new memory({32, 32, 1, 1}, format::OIhw4i16o4i, s8_dt));
+    wei2.reset(new memory({16, 32, 3, 3}, format::OIhw4i16o4i, s8_dt));
+    wei3.reset(new memory({32, 48, 1, 1}, format::OIhw4i16o4i, s8_dt));
+    wei4.reset(new memory({p.oc, 32, 1, 1}, format::OIhw4i16o4i, s8_dt));
+    bia0.reset(new memory({32}, memory::dtype::s32));
+    bia4.reset(new memory({p.oc}, memory::dtype::s32));
+    for (auto *wei : {&wei0, &wei1, &wei2, &wei3, &wei4}) {
+      util::fill_data<s8>(static_cast<s8 *>((*wei)->data()), (*wei)->size());
+    }
+    util::fill_data<s32>(static_cast<s32 *>(bia0->data()), bia0->size());
+    util::fill_data<s32>(static_cast<s32 *>(bia4->data()), bia4->size());
+    std::vector<float> scales(1);
+    util::fill_data<float>(scales.data(), 1, 0.001f, 0.1f);
+
+    std::vector<std::unique_ptr<memory>> srcs(1), dsts(1);
+    std::unique_ptr<memory> ref, t0, t1, t2, t3, t4, t5, t6;
+    srcs[0].reset(new memory(p.src_dims, fmt, u8_dt));
+    util::fill_data<u8>(static_cast<u8 *>(srcs[0]->data()), srcs[0]->size());
+    t0.reset(new memory({bs, 32, h, w}, fmt, u8_dt));
+    t1.reset(new memory({bs, 32, ph, pw}, fmt, u8_dt));
+    t2.reset(new memory({bs, 48, ph, pw}, fmt, u8_dt));
+    t3.reset(new memory({bs, 32, ph, pw}, fmt, u8_dt));
+    t4.reset(new memory({bs, 16, ph, pw}, fmt, u8_dt));
+    t5.reset(new memory({bs, 32, ph, pw}, fmt, u8_dt));
+    t6.reset(new memory({bs, 32, ph, pw}, fmt, u8_dt));
+    ref.reset(new memory({bs, p.oc, ph, pw}, fmt, dst_dt));
+
+    std::vector<std::unique_ptr<op>> ops;
+    ops.push_back(conv(srcs[0], wei0, bia0, {1, 1}, {1, 1}, t0, true, scales));
+    ops.push_back(pool(t0, t1, {2, 2}, {2, 2}, {0, 0}));
+    ops.push_back(conv(t1, wei1, none, {1, 1}, {0, 0}, t3, true, scales));
+    ops.push_back(conv(t1, wei2, none, {1, 1}, {1, 1}, t4, true, scales));
+    std::vector<std::unique_ptr<memory>> cat_srcs(2);
+    cat_srcs[0].reset(new memory(t3->std_dims(), fmt, u8_dt, t3->data()));
+    cat_srcs[1].reset(new memory(t4->std_dims(), fmt, u8_dt, t4->data()));
+    ops.push_back(concat(cat_srcs, t2));
+    ops.push_back(conv(t2, wei3, none, {1, 1}, {0, 0}, t5, false, scales));
+    ops.push_back(binary(t5, t3, t6, binary_add, true));
+    ops.push_back(conv(t6, wei4, bia4, {1, 1}, {0, 0}, ref, false, scales));
+    for (auto &o : ops) {
+      o->submit();
+    }
+
+    network net;
+    int x = net.input(p.src_dims);
+    int x0 = net.conv(x, wei0, bia0, {1, 1}, {1, 1}, true, scales);
+    int x1 = net.pool(x0, {2, 2}, {2, 2}, {0, 0});
+    int x3 = net.conv(x1, wei1, none, {1, 1}, {0, 0}, true, scales);
+    int x4 = net.conv(x1, wei2, none, {1, 1}, {1, 1}, true, scales);
+    int x2 = net.concat({x3, x4});
+    int x5 = net.conv(x2, wei3, none, {1, 1}, {0, 0}, false, scales);
+    int x6 = net.binary(x5, x3, binary_add, true);
+    int y = net.conv(x6,
+                     wei4,
+                     bia4,
+                     {1, 1},
+                     {0, 0},
+                     false,
+                     scales,
+                     round_mode::nearest,
+                     dst_dt);
+    net.output(y);
+    EXPECT_TRUE(net.dims(y) == ref->std_dims());
+    net.build();
+    size_t intermediates = 0;
+    for (auto *t : {&t0, &t1, &t2, &t3, &t4, &t5, &t6}) {
+      intermediates += (*t)->buffer_size();
+    }
+    // the tensors not alive at the same time share the arena
+    EXPECT_LT(net.arena_size(), intermediates);
+
+    // run twice on each dst with all threads and one thread,
+    // the second dst creates the ops again
+    for (int i = 0; i < 2; ++i) {
+      dsts[0].reset(new memory(ref->std_dims(), fmt, dst_dt));
+      for (int j = 0; j < 2; ++j) {
+        net.run(srcs, dsts, exec_ctx(j));
+        util::compare_array<dst_t>((dst_t *)(dsts[0]->data()),
+                                   (dst_t *)(ref->data()),
+                                   ref->size());
+      }
+    }
+
+    // run async on a new dst, and check it after wait
+    dsts[0].reset(new memory(ref->std_dims(), fmt, dst_dt));
+    auto done = net.run_async(srcs, dsts);
+    net.wait();
+    EXPECT_EQ(done.wait_for(std::chrono::seconds(0)),
+              std::future_status::ready);
+    util::compare_array<dst_t>(
+        (dst_t *)(dsts[0]->data()), (dst_t *)(ref->data()), ref->size());
+  }
+};
+
+using test_network_f32 = test_network<f32>;
+using test_network_s32 = test_network<s32>;
+using test_network_s8 = test_network<s8>;
+using test_network_u8 = test_network<u8>;
+
+TEST_P(test_network_f32, TestsNetwork) {}
+TEST_P(test_network_s32, TestsNetwork) {}
+TEST_P(test_network_s8, TestsNetwork) {}
+TEST_P(test_network_u8, TestsNetwork) {}
+
+// @note: the src is always given as nchw
+/*src dims, oc of dst*/
+#define NETWORK_TEST_CASES                      \
+  test_network_params{{2, 16, 14, 14}, 16},     \
+      test_network_params{{1, 32, 28, 28}, 64}, \
+      test_network_params{{2, 64, 7, 7}, 32}
+
+INSTANTIATE_TEST_CASE_P(TestNetwork,
+                        test_network_f32,
+                        ::testing::Values(NETWORK_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestNetwork,
+                        test_network_s32,
+                        ::testing::Values(NETWORK_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestNetwork,
+                        test_network_s8,
+                        ::testing::Values(NETWORK_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestNetwork,
+                        test_network_u8,
+                        ::testing::Values(NETWORK_TEST_CASES));
+
+// fused network should equal to the one without fusion
+class test_network_fuse
+    : public ::testing::TestWithParam<memory::nchw_dims> {
+protected:
+  virtual void SetUp() {
+    memory::nchw_dims src_dims =
+        ::testing::TestWithParam<memory::nchw_dims>::GetParam();
+    using format = memory::format;
+    constexpr format fmt = format::nhwc;
+    constexpr memory::dtype u8_dt = memory::dtype::u8;
+    constexpr memory::dtype s8_dt = memory::dtype::s8;
+    constexpr memory::dtype f32_dt = memory::dtype::f32;
+    const int ic = src_dims[1];
+
+    std::vector<std::unique_ptr<memory>> weis(6);
+    std::unique_ptr<memory> bia;
+    const std::unique_ptr<memory> none;
+    const std::array<memory::oihw_dims, 6> wei_dims = {{{32, ic, 3, 3},
+                                                        {32, 32, 1, 1},
+                                                        {32, 32, 1, 1},
+                                                        {32, 32, 1, 1},
+                                                        {16, 32, 3, 3},
+                                                        {16, 32, 1, 1}}};
+    for (size_t i = 0; i < weis.size(); ++i) {
+      weis[i].reset(new memory(wei_dims[i], format::OIhw4i16o4i, s8_dt));
+      util::fill_data<s8>(static_cast<s8 *>(weis[i]->data()),
+                          weis[i]->size());
+    }
+    bia.reset(new memory({32}, memory::dtype::s32));
+    util::fill_data<s32>(static_cast<s32 *>(bia->data()), bia->size());
+    std::vector<float> scales(1);
+    util::fill_data<float>(scales.data(), 1, 0.001f, 0.1f);
+
+    // conv3x3 -> relu -> conv1x1 -> {conv1x1 + conv1x1 -> relu,
+    //                                concat(conv3x3, conv1x1) -> relu,
+    //                                concat(input y, conv1x1) -> relu}
+    const int bs = src_dims[0], h = src_dims[2], w = src_dims[3];
+    auto add_layers = [&](network &net) {
+      int x = net.input(src_dims);
+      int y = net.input({bs, 16, h, w});
+      int a = net.conv(x, weis[0], bia, {1, 1}, {1, 1}, false, scales);
+      int b = net.conv(net.eltwise(a, eltwise_relu),
+                       weis[1],
+                       none,
+                       {1, 1},
+                       {0, 0},
+                       false,
+                       scales);
+      auto conv1x1_f32 = [&](const std::unique_ptr<memory> &wei) {
+        return net.conv(b,
+                        wei,
+                        none,
+                        {1, 1},
+                        {0, 0},
+                        false,
+                        scales,
+                        round_mode::nearest,
+                        f32_dt);
+      };
+      int s = conv1x1_f32(weis[2]);
+      int c = conv1x1_f32(weis[3]);
+      net.output(net.eltwise(net.binary(c, s, binary_add), eltwise_relu));
+      int e0 = net.conv(b, weis[4], none, {1, 1}, {1, 1}, false, scales);
+      int e1 = net.conv(b, weis[5], none, {1, 1}, {0, 0}, false, scales);
+      int e = net.eltwise(net.concat({e0, e1}), eltwise_relu);
+      net.output(e);
+      // the concat of an input can not be views, so it does the relu
+      int g0 = net.conv(b, weis[5], none, {1, 1}, {0, 0}, false, scales);
+      net.output(net.eltwise(net.concat({y, g0}), eltwise_relu));
+    };
+    network ref_net, net;
+    add_layers(ref_net);
+    add_layers(net);
+    std::vector<std::string> expected = {"conv + relu",
+                                         "binary + relu",
+                                         "concat + relu",
+                                         "concat + relu",
+                                         "conv + conv1x1",
+                                         "conv + sum + relu",
+                                         "conv, conv -> concat views"};
+    EXPECT_EQ(net.fuse(), expected);
+    ref_net.build();
+    net.build();
+    EXPECT_LT(net.arena_size(), ref_net.arena_size());
+
+    std::vector<std::unique_ptr<memory>> srcs(2), refs(3), dsts(3);
+    srcs[0].reset(new memory(src_dims, fmt, u8_dt));
+    util::fill_data<u8>(static_cast<u8 *>(srcs[0]->data()), srcs[0]->size());
+    // the values over 127 are kept by the relu of u8
+    srcs[1].reset(new memory({bs, 16, h, w}, fmt, u8_dt));
+    util::fill_data<u8>(
+        static_cast<u8 *>(srcs[1]->data()), srcs[1]->size(), u8(0), u8(255));
+    auto reset_outs = [&](std::vector<std::unique_ptr<memory>> &outs) {
+      outs.resize(3);
+      outs[0].reset(new memory({bs, 32, h, w}, fmt, f32_dt));
+      outs[1].reset(new memory({bs, 32, h, w}, fmt, u8_dt));
+      outs[2].reset(new memory({bs, 32, h, w}, fmt, u8_dt));
+    };
+    auto compare_outs = [&](std::vector<std::unique_ptr<memory>> &outs) {
+      util::compare_array<f32>((f32 *)(outs[0]->data()),
+                               (f32 *)(refs[0]->data()),
+                               refs[0]->size());
+      for (int i = 1; i < 3; ++i) {
+        util::compare_array<u8>((u8 *)(outs[i]->data()),
+                                (u8 *)(refs[i]->data()),
+                                refs[i]->size());
+      }
+    };
+    reset_outs(refs);
+    reset_outs(dsts);
+    ref_net.run(srcs, refs);
+    net.run(srcs, dsts);
+    compare_outs(dsts);
+
+    // the fused network saved and loaded again, on the mapped weights
+    const std::string path = "test_network_fuse.model";
+    net.save(path);
+    auto loaded = network::load(path);
+    loaded->build();
+    for (auto &d : dsts) {
+      memset(d->data(), 0, d->buffer_size());
+    }
+    loaded->run(srcs, dsts);
+    compare_outs(dsts);
+    loaded.reset();
+    std::remove(path.c_str());
+
+    // 2 streams of the fused network run by 4 threads, each stream has 2
+    // threads on the cpu of this test
+    const int cpu = sched_getcpu();
+    stream_group group(net, 2, {cpu, cpu, cpu, cpu});
+    EXPECT_EQ(group.size(), 2);
+    std::vector<std::vector<std::unique_ptr<memory>>> outs(4);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < outs.size(); ++i) {
+      reset_outs(outs[i]);
+      threads.emplace_back([&, i] { group.run(srcs, outs[i]); });
+    }
+    for (size_t i = 0; i < outs.size(); ++i) {
+      threads[i].join();
+      compare_outs(outs[i]);
+    }
+  }
+};
+
+TEST_P(test_network_fuse, TestsNetworkFuse) {}
+
+INSTANTIATE_TEST_CASE_P(TestNetworkFuse,
+                        test_network_fuse,
+                        ::testing::Values(memory::nchw_dims{{2, 16, 14, 14}},
+                                          memory::nchw_dims{{1, 32, 28, 28}}));
+
+// the inner product weights are packed once by network, and the ops of all
+// streams read the same buffer
+TEST(TestNetwork, test_stream_shared_weights) {
+  using format = memory::format;
+  constexpr memory::dtype f32_dt = memory::dtype::f32;
+  const int bs = 2, ic = 32, h = 3, w = 3, oc = 32;
+  const std::unique_ptr<memory> none;
+  std::unique_ptr<memory> wei(
+      new memory({oc, ic, h, w}, format::OIhw4i16o4i, memory::dtype::s8));
+  util::fill_data<s8>(static_cast<s8 *>(wei->data()), wei->size());
+  std::vector<float> scales = {0.01f};
+
+  network net;
+  int x = net.input({bs, ic, h, w});
+  net.output(net.inner_product(x, wei, none, false, scales));
+  net.build();
+
+  std::vector<std::unique_ptr<memory>> srcs(1), refs(1);
+  srcs[0].reset(new memory({bs, ic, h, w}, format::nhwc, memory::dtype::u8));
+  util::fill_data<u8>(static_cast<u8 *>(srcs[0]->data()), srcs[0]->size());
+  refs[0].reset(new memory({bs, oc, 1, 1}, format::nhwc, f32_dt));
+  inner_product(srcs[0], wei, none, refs[0], false, scales)->submit();
+
+  const int cpu = sched_getcpu();
+  stream s0(net, {cpu}), s1(net, {cpu});
+  std::vector<const s8 *> weis;
+  for (auto *s : {&s0, &s1}) {
+    std::vector<std::unique_ptr<memory>> dsts(1);
+    dsts[0].reset(new memory({bs, oc, 1, 1}, format::nhwc, f32_dt));
+    s->run(srcs, dsts);
+    util::compare_array<f32>((f32 *)(dsts[0]->data()),
+                             (f32 *)(refs[0]->data()),
+                             refs[0]->size());
+    ASSERT_EQ(s->ops().size(), 1UL);
+    auto ip = dynamic_cast<op_inner_product<f32> *>(s->ops()[0].get());
+    ASSERT_TRUE(ip != nullptr);
+    weis.push_back(ip->wei_data());
+  }
+  EXPECT_EQ(weis[0], weis[1]);
+  // the packed weights, not the OIhw4i16o4i of user
+  EXPECT_NE(weis[0], static_cast<const s8 *>(wei->data()));
+}
+}
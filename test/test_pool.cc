@@ -0,0 +1,138 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include <limits>
+#include "util_jitinfer.h"
+#include "util_params.h"
+#include "util_test.h"
+
+namespace jitinfer {
+
+template <typename dtype>
+class test_pool : public ::testing::TestWithParam<util::pool_params> {
+  void check_result(const util::pool_params& p,
+                    const std::unique_ptr<memory>& src,
+                    const std::unique_ptr<memory>& dst,
+                    pooling_kind kind) {
+    const dtype* src_data = (const dtype*)(src->data());
+    std::vector<dtype> ref(dst->size());
+#pragma omp parallel for collapse(3) schedule(static)
+    for (int n = 0; n < p.bs; ++n) {
+      for (int oh = 0; oh < p.oh; ++oh) {
+        for (int ow = 0; ow < p.ow; ++ow) {
+          int ih_s = oh * p.sh - p.ph, iw_s = ow * p.sw - p.pw;
+          int ih_e = std::min(ih_s + p.kh, p.ih);
+          int iw_e = std::min(iw_s + p.kw, p.iw);
+          ih_s = std::max(ih_s, 0);
+          iw_s = std::max(iw_s, 0);
+          int area = kind == pooling_avg_exclude_padding
+                         ? std::max(0, ih_e - ih_s) * std::max(0, iw_e - iw_s)
+                         : p.kh * p.kw;
+          float inv_area = area > 0 ? 1.f / area : 0.f;
+          dtype* pref = ref.data() + ((n * p.oh + oh) * p.ow + ow) * p.c;
+          for (int c = 0; c < p.c; ++c) {
+            dtype vmax = std::numeric_limits<dtype>::lowest();
+            // s32 for integers, f32 for float
+            typename std::conditional<std::is_same<dtype, f32>::value,
+                                      f32,
+                                      s32>::type sum = 0;
+            for (int ih = ih_s; ih < ih_e; ++ih) {
+              for (int iw = iw_s; iw < iw_e; ++iw) {
+                dtype v = src_data[((n * p.ih + ih) * p.iw + iw) * p.c + c];
+                vmax = std::max(vmax, v);
+                sum += v;
+              }
+            }
+            if (kind == pooling_max) {
+              pref[c] = vmax;
+            } else if (std::is_same<dtype, f32>::value) {
+              pref[c] = static_cast<dtype>(sum * inv_area);
+            } else {
+              pref[c] = static_cast<dtype>(
+                  std::nearbyint(static_cast<f32>(sum) * inv_area));
+            }
+          }
+        }
+      }
+    }
+    util::compare_array<dtype>((dtype*)(dst->data()), ref.data(), dst->size());
+  }
+
+protected:
+  virtual void SetUp() {
+    util::pool_params p =
+        ::testing::TestWithParam<util::pool_params>::GetParam();
+    auto dt = util::type2dtype<dtype>::dtype;
+    memory::format fmt = memory::format::nhwc;
+    std::array<int, 2> sz_kernel = {p.kh, p.kw};
+    std::array<int, 2> sz_stride = {p.sh, p.sw};
+    std::array<int, 2> sz_padding = {p.ph, p.pw};
+    EXPECT_EQ(p.oh, util::pool_output_size(p.ih, p.kh, p.sh, p.ph));
+    EXPECT_EQ(p.ow, util::pool_output_size(p.iw, p.kw, p.sw, p.pw));
+
+    std::unique_ptr<memory> src, dst;
+    src.reset(new memory({p.bs, p.c, p.ih, p.iw}, fmt, dt));
+    dst.reset(new memory({p.bs, p.c, p.oh, p.ow}, fmt, dt));
+    util::fill_data<dtype>(static_cast<dtype*>(src->data()), src->size());
+
+    for (pooling_kind kind : {pooling_max,
+                              pooling_avg_include_padding,
+                              pooling_avg_exclude_padding}) {
+      auto pl = pool(src, dst, sz_kernel, sz_stride, sz_padding, kind);
+      pl->submit();
+      check_result(p, src, dst, kind);
+    }
+  }
+};
+
+using test_pool_f32 = test_pool<f32>;
+using test_pool_s32 = test_pool<s32>;
+using test_pool_s8 = test_pool<s8>;
+using test_pool_u8 = test_pool<u8>;
+
+TEST_P(test_pool_f32, TestsPool) {}
+TEST_P(test_pool_s32, TestsPool) {}
+TEST_P(test_pool_s8, TestsPool) {}
+TEST_P(test_pool_u8, TestsPool) {}
+
+// @note: the src and dst are always given as nchw
+/*bs, c, ih, iw, oh, ow, kh, kw, ph, pw, sh, sw*/
+#define POOL_TEST_CASES                                            \
+  util::pool_params{2, 16, 4, 4, 2, 2, 2, 2, 0, 0, 2, 2},          \
+      util::pool_params{2, 32, 5, 5, 3, 3, 3, 3, 1, 1, 2, 2},      \
+      util::pool_params{2, 64, 112, 112, 56, 56, 3, 3, 0, 0, 2, 2}, \
+      util::pool_params{2, 48, 13, 13, 13, 13, 3, 3, 1, 1, 1, 1},  \
+      util::pool_params{2, 96, 5, 5, 4, 4, 2, 2, 1, 1, 2, 2},      \
+      util::pool_params{2, 256, 7, 7, 1, 1, 7, 7, 0, 0, 1, 1},     \
+      util::pool_params {                                          \
+    4, 2048, 7, 7, 1, 1, 7, 7, 0, 0, 1, 1                          \
+  }
+
+INSTANTIATE_TEST_CASE_P(TestPool,
+                        test_pool_f32,
+                        ::testing::Values(POOL_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestPool,
+                        test_pool_s32,
+                        ::testing::Values(POOL_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestPool,
+                        test_pool_s8,
+                        ::testing::Values(POOL_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestPool,
+                        test_pool_u8,
+                        ::testing::Values(POOL_TEST_CASES));
+}
@@ -0,0 +1,154 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include <cmath>
+#include <limits>
+#include "util_jitinfer.h"
+#include "util_test.h"
+
+namespace jitinfer {
+
+struct test_resize_params {
+  int bs, c, ih, iw, oh, ow;
+  int skip_c;  // channels of the skip src of resize_concat, already oh x ow
+};
+
+template <typename dtype>
+class test_resize : public ::testing::TestWithParam<test_resize_params> {
+  // scalar resize of src to ref, asymmetric nearest and bilinear with half
+  // pixel centers
+  void ref_resize(const test_resize_params& p,
+                  const std::unique_ptr<memory>& src,
+                  std::vector<dtype>& ref,
+                  resize_kind kind) {
+    const dtype* src_data = (const dtype*)(src->data());
+    const float sh = static_cast<float>(p.ih) / p.oh;
+    const float sw = static_cast<float>(p.iw) / p.ow;
+    for (int n = 0; n < p.bs; ++n) {
+      for (int oh = 0; oh < p.oh; ++oh) {
+        for (int ow = 0; ow < p.ow; ++ow) {
+          int y0, y1, x0, x1;
+          float wy = 0.f, wx = 0.f;
+          if (kind == resize_nearest) {
+            y0 = y1 = std::min(static_cast<int>(std::floor(oh * sh)), p.ih - 1);
+            x0 = x1 = std::min(static_cast<int>(std::floor(ow * sw)), p.iw - 1);
+          } else {
+            float fy = std::max((oh + 0.5f) * sh - 0.5f, 0.f);
+            float fx = std::max((ow + 0.5f) * sw - 0.5f, 0.f);
+            y0 = std::min(static_cast<int>(fy), p.ih - 1);
+            x0 = std::min(static_cast<int>(fx), p.iw - 1);
+            y1 = std::min(y0 + 1, p.ih - 1);
+            x1 = std::min(x0 + 1, p.iw - 1);
+            wy = fy - y0;
+            wx = fx - x0;
+          }
+          auto at = [&](int y, int x, int c) {
+            return src_data[((n * p.ih + y) * p.iw + x) * p.c + c];
+          };
+          dtype* pref = ref.data() + ((n * p.oh + oh) * p.ow + ow) * p.c;
+          for (int c = 0; c < p.c; ++c) {
+            float top = at(y0, x0, c) + wx * (at(y0, x1, c) - at(y0, x0, c));
+            float bottom =
+                at(y1, x0, c) + wx * (at(y1, x1, c) - at(y1, x0, c));
+            float v = top + wy * (bottom - top);
+            if (!std::is_same<dtype, f32>::value) {
+              v = std::nearbyint(v);
+            }
+            pref[c] = static_cast<dtype>(v);
+          }
+        }
+      }
+    }
+  }
+
+protected:
+  virtual void SetUp() {
+    test_resize_params p =
+        ::testing::TestWithParam<test_resize_params>::GetParam();
+    auto dt = util::type2dtype<dtype>::dtype;
+    memory::format fmt = memory::format::nhwc;
+    const int total_c = p.c + p.skip_c;
+
+    std::unique_ptr<memory> src, skip, dst, concated, view;
+    src.reset(new memory({p.bs, p.c, p.ih, p.iw}, fmt, dt));
+    skip.reset(new memory({p.bs, p.skip_c, p.oh, p.ow}, fmt, dt));
+    dst.reset(new memory({p.bs, p.c, p.oh, p.ow}, fmt, dt));
+    concated.reset(new memory({p.bs, total_c, p.oh, p.ow}, fmt, dt));
+    view.reset(new memory(concated, p.skip_c, p.c));
+    util::fill_data<dtype>(static_cast<dtype*>(src->data()), src->size());
+    util::fill_data<dtype>(static_cast<dtype*>(skip->data()), skip->size());
+    std::vector<std::unique_ptr<memory>> srcs;
+    srcs.emplace_back(new memory(skip, 0, p.skip_c));
+    srcs.emplace_back(new memory(src, 0, p.c));
+
+    std::vector<dtype> ref(dst->size());
+    const int pixels = p.bs * p.oh * p.ow;
+    for (resize_kind kind : {resize_nearest, resize_bilinear}) {
+      ref_resize(p, src, ref, kind);
+      auto rs = resize(src, dst, kind);
+      rs->submit();
+      util::compare_array<dtype>((dtype*)(dst->data()), ref.data(), ref.size());
+
+      // skip connection first, then the upsampled src in its channel slice
+      auto rc = resize_concat(srcs, concated, kind);
+      rc->submit();
+      for (int pix = 0; pix < pixels; ++pix) {
+        util::compare_array<dtype>((dtype*)(concated->data()) + pix * total_c,
+                                   (dtype*)(skip->data()) + pix * p.skip_c,
+                                   p.skip_c);
+        util::compare_array<dtype>((dtype*)(view->data()) + pix * total_c,
+                                   ref.data() + pix * p.c,
+                                   p.c);
+      }
+    }
+  }
+};
+
+using test_resize_f32 = test_resize<f32>;
+using test_resize_s32 = test_resize<s32>;
+using test_resize_s8 = test_resize<s8>;
+using test_resize_u8 = test_resize<u8>;
+
+TEST_P(test_resize_f32, TestsResize) {}
+TEST_P(test_resize_s32, TestsResize) {}
+TEST_P(test_resize_s8, TestsResize) {}
+TEST_P(test_resize_u8, TestsResize) {}
+
+// @note: the src and dst are always given as nchw
+/*bs, c, ih, iw, oh, ow, skip_c*/
+#define RESIZE_TEST_CASES                              \
+  test_resize_params{2, 16, 4, 4, 8, 8, 16},           \
+      test_resize_params{2, 64, 7, 7, 14, 14, 32},     \
+      test_resize_params{2, 128, 28, 28, 56, 56, 64},  \
+      test_resize_params{1, 256, 13, 13, 26, 26, 256}, \
+      test_resize_params{1, 32, 10, 10, 15, 15, 16},   \
+      test_resize_params{2, 64, 16, 16, 8, 8, 64}
+
+INSTANTIATE_TEST_CASE_P(TestResize,
+                        test_resize_f32,
+                        ::testing::Values(RESIZE_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestResize,
+                        test_resize_s32,
+                        ::testing::Values(RESIZE_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestResize,
+                        test_resize_s8,
+                        ::testing::Values(RESIZE_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestResize,
+                        test_resize_u8,
+                        ::testing::Values(RESIZE_TEST_CASES));
+}
@@ -0,0 +1,141 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include "util_jitinfer.h"
+#include "util_test.h"
+
+namespace jitinfer {
+
+struct test_split_params {
+  memory::nchw_dims src_dims;
+  std::vector<int> dsts_channels;
+};
+
+template <typename dtype>
+class test_split : public ::testing::TestWithParam<test_split_params> {
+  // check dst with the channel slice of src in nhwc
+  void check_slice(const std::unique_ptr<memory>& src,
+                   const std::unique_ptr<memory>& dst,
+                   int c_offset,
+                   bool post_relu) {
+    auto sd = src->actual_dims();
+    auto dd = dst->actual_dims();
+    const int nhw = sd[0] * sd[1] * sd[2];
+    const int sc = src->ld(), dc = dd[3], ld = dst->ld();
+    const dtype* src_data = (const dtype*)(src->data());
+    const dtype* dst_data = (const dtype*)(dst->data());
+    for (int i = 0; i < nhw; ++i) {
+      for (int c = 0; c < dc; ++c) {
+        dtype ref = src_data[i * sc + c_offset + c];
+        if (post_relu && ref < 0) {
+          ref = 0;
+        }
+        ASSERT_EQ(dst_data[i * ld + c], ref) << "Pixel: " << i
+                                             << " Channel: " << c;
+      }
+    }
+  }
+
+protected:
+  virtual void SetUp() {
+    test_split_params p =
+        ::testing::TestWithParam<test_split_params>::GetParam();
+    auto dt = util::type2dtype<dtype>::dtype;
+    memory::format fmt = memory::format::nhwc;
+    std::unique_ptr<memory> src, src_back;
+    std::vector<std::unique_ptr<memory>> dsts(p.dsts_channels.size());
+    std::vector<std::unique_ptr<memory>> views(p.dsts_channels.size());
+    src.reset(new memory(p.src_dims, fmt, dt));
+    src_back.reset(new memory(p.src_dims, fmt, dt));
+    util::fill_data<dtype>(static_cast<dtype*>(src->data()), src->size());
+    int c_offset = 0;
+    for (size_t i = 0; i < dsts.size(); ++i) {
+      int c = p.dsts_channels[i];
+      memory::nchw_dims dm = {p.src_dims[0], c, p.src_dims[2], p.src_dims[3]};
+      dsts[i].reset(new memory(dm, fmt, dt));
+      views[i].reset(new memory(src, c_offset, c));
+      EXPECT_TRUE(views[i]->is_view());
+      EXPECT_EQ(views[i]->ld(), p.src_dims[1]);
+      c_offset += c;
+    }
+    EXPECT_EQ(c_offset, p.src_dims[1]);
+
+    for (bool post_relu : {true, false}) {
+      auto s = split(src, dsts, post_relu);
+      s->submit();
+      c_offset = 0;
+      for (size_t i = 0; i < dsts.size(); ++i) {
+        check_slice(src, dsts[i], c_offset, post_relu);
+        c_offset += p.dsts_channels[i];
+      }
+    }
+
+    // zero-copy views can be read directly by concat
+    auto c = concat(views, src_back);
+    c->submit();
+    util::compare_array<dtype>(
+        (dtype*)(src_back->data()), (dtype*)(src->data()), src->size());
+
+    // and split can write to views directly
+    auto s = split(src_back, views, true);
+    s->submit();
+    check_slice(src_back, src, 0, true);
+  }
+};
+
+using test_split_f32 = test_split<f32>;
+using test_split_s32 = test_split<s32>;
+using test_split_s8 = test_split<s8>;
+using test_split_u8 = test_split<u8>;
+
+TEST_P(test_split_f32, TestsSplit) {}
+TEST_P(test_split_s32, TestsSplit) {}
+TEST_P(test_split_s8, TestsSplit) {}
+TEST_P(test_split_u8, TestsSplit) {}
+
+// @note: the src is always given as nchw
+#define BASIC_TEST_CASES                                            \
+  test_split_params{{2, 160, 1, 1}, {64, 96}},                      \
+      test_split_params{{2, 96, 4, 4}, {64, 32}},                   \
+      test_split_params{{2, 48, 8, 8}, {16, 32}},                   \
+      test_split_params{{2, 112, 3, 3}, {16, 32, 64}},              \
+      test_split_params{{2, 512, 16, 16}, {256, 256}},              \
+      test_split_params{{4, 384, 14, 14}, {128, 128, 128}},         \
+      test_split_params {                                           \
+    {1, 256, 7, 7}, { 128, 128 }                                    \
+  }
+
+INSTANTIATE_TEST_CASE_P(
+    TestSplit,
+    test_split_f32,
+    ::testing::Values(BASIC_TEST_CASES,
+                      test_split_params{{2, 12, 4, 4}, {4, 8}},
+                      test_split_params{{2, 24, 4, 4}, {16, 8}}));
+
+INSTANTIATE_TEST_CASE_P(
+    TestSplit,
+    test_split_s32,
+    ::testing::Values(BASIC_TEST_CASES,
+                      test_split_params{{2, 12, 4, 4}, {4, 8}},
+                      test_split_params{{2, 24, 4, 4}, {16, 8}}));
+
+INSTANTIATE_TEST_CASE_P(TestSplit,
+                        test_split_s8,
+                        ::testing::Values(BASIC_TEST_CASES));
+
+INSTANTIATE_TEST_CASE_P(TestSplit,
+                        test_split_u8,
+                        ::testing::Values(BASIC_TEST_CASES));
+}
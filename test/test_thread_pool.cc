@@ -0,0 +1,171 @@
+/*******************************************************************************
+ * Copyright 2018 Tensor Tang. All Rights Reserved
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+*******************************************************************************/
+#include <sched.h>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "src/thread_pool.h"
+
+namespace jitinfer {
+
+// each thread sums what all threads wrote before the barrier
+TEST(TestThreadPool, test_pool) {
+  const int pool_size = 4;
+  thread_pool pool(pool_size, 100);
+  EXPECT_EQ(pool.size(), pool_size);
+  for (int n = 1; n <= pool_size + 1; ++n) {
+    int used = 0;
+    std::vector<int> vals(pool_size, 0), sums(pool_size, 0);
+    pool.parallel(n, [&](int ithr, int nthr) {
+      if (ithr == 0) {
+        used = nthr;
+      }
+      vals[ithr] = ithr + 1;
+      pool.barrier();
+      for (int i = 0; i < nthr; ++i) {
+        sums[ithr] += vals[i];
+      }
+    });
+    EXPECT_EQ(used, std::min(n, pool_size));
+    for (int i = 0; i < used; ++i) {
+      EXPECT_EQ(sums[i], used * (used + 1) / 2);
+    }
+  }
+}
+
+// parallels of 2 threads from 2 callers run on their own workers
+TEST(TestThreadPool, test_pool_concurrent) {
+  thread_pool pool(4, 100);
+  std::vector<std::vector<int>> sums(2, std::vector<int>(2, 0));
+  std::vector<std::thread> callers;
+  for (int c = 0; c < 2; ++c) {
+    callers.emplace_back([&, c] {
+      for (int k = 0; k < 100; ++k) {
+        std::vector<int> vals(2, 0);
+        pool.parallel(2, [&](int ithr, int nthr) {
+          EXPECT_LE(nthr, 2);
+          vals[ithr] = 1;
+          pool.barrier();
+          for (int i = 0; i < nthr; ++i) {
+            sums[c][ithr] += vals[i];
+          }
+        });
+      }
+    });
+  }
+  for (auto &t : callers) {
+    t.join();
+  }
+  for (auto &s : sums) {
+    // each of 100 parallels sums 1 or 2 values on thread 0
+    EXPECT_GE(s[0], 100);
+    EXPECT_LE(s[0], 200);
+  }
+}
+
+TEST(TestThreadPool, test_parallel) {
+  const int nthr = get_max_threads();
+  std::vector<int> vals(nthr, 0), sums(nthr, 0);
+  int used = 0;
+  parallel(nthr, [&](int ithr, int nthr) {
+    if (ithr == 0) {
+      used = nthr;
+    }
+    vals[ithr] = ithr + 1;
+    barrier();
+    for (int i = 0; i < nthr; ++i) {
+      sums[ithr] += vals[i];
+    }
+    // nested parallel only runs in the caller
+    parallel(nthr, [&](int jthr, int mthr) {
+      EXPECT_EQ(jthr, 0);
+      EXPECT_EQ(mthr, 1);
+    });
+  });
+  EXPECT_GE(used, 1);
+  EXPECT_LE(used, nthr);
+  for (int i = 0; i < used; ++i) {
+    EXPECT_EQ(sums[i], used * (used + 1) / 2);
+  }
+}
+
+TEST(TestThreadPool, test_exec_ctx) {
+  const int cpu = sched_getcpu();
+  for (int n = 1; n <= 2; ++n) {
+    for (auto &ctx : {exec_ctx(n), exec_ctx(n, {cpu})}) {
+      std::vector<int> cpus(n, -1);
+      int used = 0;
+      parallel(ctx, [&](int ithr, int nthr) {
+        if (ithr == 0) {
+          used = nthr;
+        }
+        cpus[ithr] = sched_getcpu();
+      });
+      // no more threads than ctx and its cpus
+      EXPECT_GE(used, 1);
+      EXPECT_LE(used, ctx.cpus.empty() ? n : 1);
+      if (!ctx.cpus.empty()) {
+        EXPECT_EQ(cpus[0], cpu);
+      }
+    }
+  }
+}
+
+// the fns run one by one in order, and each can run in parallel
+TEST(TestThreadPool, test_enqueue) {
+  const int n = 8;
+  async_queue queue;
+  std::vector<int> order;
+  std::vector<std::shared_future<void>> done;
+  for (int i = 0; i < n; ++i) {
+    done.push_back(queue.enqueue([&order, i] {
+      int used = 0;
+      parallel(get_max_threads(), [&](int ithr, int nthr) {
+        if (ithr == 0) {
+          used = nthr;
+        }
+      });
+      EXPECT_GE(used, 1);
+      order.push_back(i);
+    }));
+  }
+  done.back().wait();
+  for (int i = 0; i < n; ++i) {
+    EXPECT_EQ(done[i].wait_for(std::chrono::seconds(0)),
+              std::future_status::ready);
+  }
+  ASSERT_EQ(order.size(), size_t(n));
+  for (int i = 0; i < n; ++i) {
+    EXPECT_EQ(order[i], i);
+  }
+}
+
+// the fns of two queues do not wait for each other
+TEST(TestThreadPool, test_enqueue_queues) {
+  async_queue q0, q1;
+  std::promise<void> started;
+  std::shared_future<void> wait_q1 = started.get_future().share();
+  std::future_status status = std::future_status::deferred;
+  auto done0 = q0.enqueue(
+      [&] { status = wait_q1.wait_for(std::chrono::seconds(10)); });
+  auto done1 = q1.enqueue([&] { started.set_value(); });
+  done0.wait();
+  done1.wait();
+  EXPECT_EQ(status, std::future_status::ready);
+}
+}
@@ -80,6 +80,8 @@ inline int dividable_of(int val, int divisor, Args... others_divisor) {
   }
 }
 
+inline int gcd(int a, int b) { return b == 0 ? a : gcd(b, a % b); }
+
 inline int find_dividable(int val, int divisor) {
   if (divisor <= 1) {
     return 1;
@@ -94,10 +96,10 @@ inline int find_dividable(int val, int divisor) {
   }
 }
 
+// serial, since they are used in the part of one thread of ops
 template <typename T>
 inline void copy_array(T *dst, const T *src, size_t sz) {
-// do not use memcpy, in case of memory aligment
-#pragma omp parallel for schedule(static)
+  // do not use memcpy, in case of memory aligment
   for (size_t i = 0; i < sz; ++i) {
     dst[i] = src[i];
   }
@@ -105,7 +107,6 @@ inline void copy_array(T *dst, const T *src, size_t sz) {
 
 template <typename T, typename U>
 inline void set_array(T *arr, const U &val, size_t size) {
-#pragma omp parallel for schedule(static)
   for (size_t i = 0; i < size; ++i) {
     arr[i] = static_cast<T>(val);
   }
@@ -14,6 +14,8 @@
  * limitations under the License.
 *******************************************************************************/
 #include "util_jitinfer.h"
+#include <algorithm>
+#include <cstring>
 
 namespace jitinfer {
 namespace util {
@@ -39,5 +41,16 @@ int conv_output_size(int image, int kernel, int stride, int padding) {
 int pool_output_size(int image, int kernel, int stride, int padding) {
   return (image + 2 * padding - kernel + stride - 1) / stride + 1;
 }
+
+float *extend_scales(const std::vector<float> &scales, size_t extended_size) {
+  float *data = (float *)aligned_malloc(
+      std::max(scales.size(), extended_size) * sizeof(float), 64);
+  if (scales.size() == 1) {
+    set_array(data, scales[0], extended_size);
+  } else {
+    std::memcpy(data, scales.data(), scales.size() * sizeof(float));
+  }
+  return data;
+}
 }
 }
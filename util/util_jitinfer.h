@@ -68,5 +68,10 @@ size_t dtype_size(memory::dtype dt);
 
 int conv_output_size(int image, int kernel, int stride, int padding);
 int pool_output_size(int image, int kernel, int stride, int padding);
+
+// the scales of kernels, which load 16 channels once: one scale is repeated
+// to extended_size, or the per channel scales are copied.
+// The returned buffer is aligned and should be released by free().
+float *extend_scales(const std::vector<float> &scales, size_t extended_size);
 }
 }
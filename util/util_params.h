@@ -67,5 +67,47 @@ struct conv_params {
   int oc1x1;
   int dh, dw;  // dilation, do not use yet
 };
+
+struct pool_params {
+  pool_params(int bs,
+              int c,
+              int ih,
+              int iw,
+              int oh,
+              int ow,
+              int kh,
+              int kw,
+              int ph,
+              int pw,
+              int sh,
+              int sw)
+      : bs(bs),
+        c(c),
+        ih(ih),
+        iw(iw),
+        oh(oh),
+        ow(ow),
+        kh(kh),
+        kw(kw),
+        ph(ph),
+        pw(pw),
+        sh(sh),
+        sw(sw) {}
+  int bs;
+  int c;
+  int ih, iw;
+  int oh, ow;
+  int kh, kw;
+  int ph, pw;
+  int sh, sw;
+};
+
+struct inner_product_params {
+  inner_product_params(int bs, int ic, int ih, int iw, int oc)
+      : bs(bs), ic(ic), ih(ih), iw(iw), oc(oc) {}
+  int bs;
+  int ic, ih, iw;  // src is flattened to ic * ih * iw
+  int oc;
+};
 }
 }